@@ -0,0 +1,182 @@
+// Database benchmark on the host: pio run -e db-bench, then
+//   SAFEBITE_FS_ROOT=<dir with foods.bin> .pio/build/db-bench/program
+// or scripts/db_bench.py for synthetic databases of 200, 2k and 20k foods.
+// Reports the load time and heap, then the time per record and the cache
+// hit rate for random lookups and for whole-category walks, and the heap
+// high-water mark of the whole run (the page cache should keep it flat
+// whatever the size).
+//
+// With SAFEBITE_LEGACY_JSON=<LittleFS path of the same foods.json> it also
+// loads that file the way the firmware did before the image (ArduinoJson
+// document, then a String per field) and reports its time and heap.
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <chrono>
+#include <vector>
+#include "food_db.h"
+#include "native_hal.h"
+
+#define BENCH_MIN_NS  200000000ULL  // repeat each pass until this much time has passed
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static size_t liveBytes() {
+    NativeHeapStats s;
+    nativeHeapStats(s);
+    return s.live;
+}
+
+// Keeps the compiler from dropping the reads
+static volatile uint32_t sink;
+
+static uint32_t touch(const Food& f) {
+    return f.attrs + (uint8_t)f.name_pt[0] + (uint8_t)f.name_en[0];
+}
+
+// Cache counters at the start of a pass
+static uint32_t passHits, passMisses;
+
+static void beginPass() {
+    foodDbCacheStats(passHits, passMisses);
+}
+
+static void report(const char* pass, uint64_t elapsed, uint32_t records) {
+    uint32_t hits, misses;
+    foodDbCacheStats(hits, misses);
+    hits -= passHits;
+    misses -= passMisses;
+    Serial.printf("[BENCH] %-10s %8.0f ns/record  cache hits %5.1f%%\n",
+                  pass, (double)elapsed / records, hits + misses ? 100.0 * hits / (hits + misses) : 0.0);
+}
+
+// The loader the image replaced, without its 8 category and 200 food caps
+struct LegacyFood {
+    String name_pt;
+    String name_en;
+    String category;
+    String fodmap;
+    bool gluten;
+};
+
+struct LegacyCategory {
+    String id;
+    String name_pt;
+    String name_en;
+};
+
+static std::vector<LegacyCategory> legacyCategories;
+static std::vector<LegacyFood> legacyFoods;
+
+static bool legacyLoad(const char* path) {
+    File file = LittleFS.open(path, "r");
+    if (!file) return false;
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+    if (error) {
+        Serial.printf("[BENCH] Legacy load: %s\n", error.c_str());
+        return false;
+    }
+
+    JsonArray cats = doc["categories"];
+    legacyCategories.reserve(cats.size());
+    for (JsonObject cat : cats) {
+        legacyCategories.push_back({cat["id"].as<String>(), cat["name_pt"].as<String>(),
+                                    cat["name_en"].as<String>()});
+    }
+    JsonArray foodsArray = doc["foods"];
+    legacyFoods.reserve(foodsArray.size());
+    for (JsonObject food : foodsArray) {
+        legacyFoods.push_back({food["name_pt"].as<String>(), food["name_en"].as<String>(),
+                               food["category"].as<String>(), food["fodmap"].as<String>(),
+                               food["gluten"].as<bool>()});
+    }
+    return true;
+}
+
+static void benchLegacy(const char* path) {
+    size_t before = liveBytes();
+    nativeHeapSetPeak(before);
+    uint64_t start = nowNs();
+    bool ok = legacyLoad(path);
+    uint64_t loadNs = nowNs() - start;
+    if (!ok) {
+        Serial.printf("[BENCH] Legacy load of %s failed\n", path);
+        exit(2);
+    }
+    NativeHeapStats heap;
+    nativeHeapStats(heap);
+    Serial.printf("[BENCH] legacy: %u foods, %u categories: load %.3f ms, heap %u bytes kept, %u peak\n",
+                  (unsigned)legacyFoods.size(), (unsigned)legacyCategories.size(), loadNs / 1e6,
+                  (unsigned)(heap.live - before), (unsigned)(heap.peak - before));
+}
+
+void setup() {
+    if (!LittleFS.begin(false)) {
+        Serial.printf("[BENCH] No filesystem root, set SAFEBITE_FS_ROOT\n");
+        exit(2);
+    }
+
+    size_t before = liveBytes();
+    nativeHeapSetPeak(before);
+    const char* error = nullptr;
+    uint64_t start = nowNs();
+    bool ok = foodDbLoad(error);
+    uint64_t loadNs = nowNs() - start;
+    if (!ok) {
+        Serial.printf("[BENCH] Load failed: %s\n", error);
+        exit(2);
+    }
+    NativeHeapStats heap;
+    nativeHeapStats(heap);
+    int foods = foodDbFoodCount();
+    int categories = foodDbCategoryCount();
+    Serial.printf("[BENCH] image: %d foods, %d categories: load %.3f ms, heap %u bytes kept, %u peak\n",
+                  foods, categories, loadNs / 1e6, (unsigned)(heap.live - before),
+                  (unsigned)(heap.peak - before));
+
+    // Random lookups: mostly misses once the image is larger than the cache
+    uint32_t seed = 1, records = 0, acc = 0;
+    beginPass();
+    start = nowNs();
+    uint64_t elapsed;
+    do {
+        for (int i = 0; i < 1000; i++) {
+            seed = seed * 1103515245u + 12345u;
+            acc += touch(foodDbGetFood((seed >> 8) % foods));
+        }
+        records += 1000;
+        elapsed = nowNs() - start;
+    } while (elapsed < BENCH_MIN_NS);
+    report("random", elapsed, records);
+
+    // Category walks, as the food list scrolls through one
+    records = 0;
+    beginPass();
+    start = nowNs();
+    do {
+        for (int c = 0; c < categories; c++) {
+            int begin, end;
+            foodDbCategoryRange(c, begin, end);
+            for (int i = begin; i < end; i++) acc += touch(foodDbGetFood(i));
+            records += end - begin;
+        }
+        elapsed = nowNs() - start;
+    } while (elapsed < BENCH_MIN_NS);
+    report("categories", elapsed, records);
+    sink = acc;
+
+    nativeHeapStats(heap);
+    Serial.printf("[BENCH] heap %u bytes in use, %u peak since load\n",
+                  (unsigned)(heap.live - before), (unsigned)(heap.peak - before));
+
+    const char* legacyPath = getenv("SAFEBITE_LEGACY_JSON");
+    if (legacyPath) benchLegacy(legacyPath);
+    exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,128 @@
+// Encoder benchmark on the host: pio run -e encoder-bench, then
+//   SAFEBITE_MIC_WAV=speech.wav .pio/build/encoder-bench/program
+// Feeds the recording (16 kHz mono 16-bit WAV) through every encoder in
+// capture frames, the way the recorder does, and reports the compression
+// ratio and the encode time per second of audio and for the slowest frame
+// (which must stay far below the 1 s the capture ring holds). With
+// SAFEBITE_BENCH_OUT=<dir> it also writes each encoding there for listening.
+#include <Arduino.h>
+#include <chrono>
+#include <vector>
+#include "audio_encoder.h"
+#include "audio_capture.h"
+
+#define BENCH_MIN_NS        1000000000ULL  // repeat until this much time has passed
+
+struct BenchEncoder {
+    const AudioEncoder& enc;
+    const char*         outName;  // under SAFEBITE_BENCH_OUT
+};
+
+static const BenchEncoder ENCODERS[] = {
+    { PCM_ENCODER,   "pcm.wav" },
+    { FLAC_ENCODER,  "flac.flac" },
+    { ADPCM_ENCODER, "adpcm.wav" },
+};
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool loadWav(const char* path, std::vector<int16_t>& samples) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t riff[12];
+    bool ok = fread(riff, 1, 12, f) == 12 && memcmp(riff, "RIFF", 4) == 0 && memcmp(riff + 8, "WAVE", 4) == 0;
+    uint8_t chunk[8];
+    while (ok && fread(chunk, 1, 8, f) == 8) {
+        uint32_t size = chunk[4] | chunk[5] << 8 | chunk[6] << 16 | (uint32_t)chunk[7] << 24;
+        if (memcmp(chunk, "data", 4) == 0) {
+            samples.resize(size / sizeof(int16_t));
+            samples.resize(fread(samples.data(), sizeof(int16_t), samples.size(), f));
+            break;
+        }
+        fseek(f, size + (size & 1), SEEK_CUR);
+    }
+    fclose(f);
+    return ok && !samples.empty();
+}
+
+// One pass over the recording; returns the encoded size and the slowest frame
+static size_t encodeAll(const AudioEncoder& enc, const std::vector<int16_t>& samples,
+                        std::vector<uint8_t>* out, uint64_t& worstFrameNs) {
+    std::vector<int16_t> block(enc.blockSamples);
+    std::vector<uint8_t> coded(enc.maxBlockBytes);
+    uint8_t header[AUDIO_ENCODER_MAX_HEADER];
+    size_t fill = 0;
+    size_t total = enc.headerSize;
+    worstFrameNs = 0;
+
+    enc.begin();
+    if (out) out->assign(enc.headerSize, 0);
+    for (size_t at = 0; at < samples.size(); at += CAPTURE_FRAME_SAMPLES) {
+        size_t end = min(at + CAPTURE_FRAME_SAMPLES, samples.size());
+        uint64_t start = nowNs();
+        for (size_t i = at; i < end; i++) {
+            block[fill++] = samples[i];
+            if (fill == enc.blockSamples || i + 1 == samples.size()) {
+                size_t n = enc.encodeBlock(block.data(), fill, coded.data());
+                if (out) out->insert(out->end(), coded.begin(), coded.begin() + n);
+                total += n;
+                fill = 0;
+            }
+        }
+        worstFrameNs = max(worstFrameNs, nowNs() - start);
+    }
+    enc.header(header, samples.size(), total - enc.headerSize);
+    if (out) memcpy(out->data(), header, enc.headerSize);
+    return total;
+}
+
+void setup() {
+    const char* path = getenv("SAFEBITE_MIC_WAV");
+    std::vector<int16_t> samples;
+    if (!path || !loadWav(path, samples)) {
+        Serial.printf("[BENCH] Set SAFEBITE_MIC_WAV to a 16 kHz mono 16-bit WAV\n");
+        exit(2);
+    }
+    double seconds = (double)samples.size() / 16000;
+    size_t pcmBytes = 44 + samples.size() * sizeof(int16_t);
+    Serial.printf("[BENCH] %s: %.2f s, %u bytes as PCM WAV\n", path, seconds, (unsigned)pcmBytes);
+
+    const char* outDir = getenv("SAFEBITE_BENCH_OUT");
+    for (const BenchEncoder& bench : ENCODERS) {
+        const AudioEncoder* enc = &bench.enc;
+        std::vector<uint8_t> encoded;
+        uint64_t worstFrameNs, frameNs;
+        size_t bytes = encodeAll(*enc, samples, &encoded, worstFrameNs);
+
+        int runs = 0;
+        uint64_t start = nowNs(), elapsed, worst = 0;
+        do {
+            encodeAll(*enc, samples, nullptr, frameNs);
+            worst = max(worst, frameNs);
+            runs++;
+            elapsed = nowNs() - start;
+        } while (elapsed < BENCH_MIN_NS);
+
+        double msPerSecond = elapsed / 1e6 / runs / seconds;
+        Serial.printf("[BENCH] %-9s %7u bytes  ratio %.2f  %6.1f kbit/s  %.3f ms per s of audio"
+                      " (%.0fx real time)  worst frame %.3f ms\n",
+                      enc->name, (unsigned)bytes, (double)pcmBytes / bytes, bytes * 8 / seconds / 1000,
+                      msPerSecond, 1000 / msPerSecond, worst / 1e6);
+
+        if (outDir) {
+            char outPath[256];
+            snprintf(outPath, sizeof(outPath), "%s/%s", outDir, bench.outName);
+            FILE* f = fopen(outPath, "wb");
+            if (f) {
+                fwrite(encoded.data(), 1, encoded.size(), f);
+                fclose(f);
+            }
+        }
+    }
+    exit(0);
+}
+
+void loop() {}
@@ -0,0 +1,140 @@
+// Local matcher benchmark on the host: pio run -e match-bench, then
+//   mkdir -p .pio/native_fs && cp data/foods.bin .pio/native_fs/
+//   .pio/build/match-bench/program
+// Runs every transcript of the corpus (bench/transcripts.tsv, or the file
+// SAFEBITE_MATCH_CORPUS names) through foodMatchFind() and scores
+// the local answer (foodMatchConfident) against the expected food: correct,
+// wrong (a confident answer naming another food, the error that matters),
+// or left to the classifier. Then reports the latency per query, the
+// matcher's own logs silenced so they are not timed. Exits 1 when any
+// answer is wrong.
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include "food_db.h"
+#include "food_match.h"
+
+#define BENCH_CORPUS   "bench/transcripts.tsv"
+#define BENCH_MIN_NS   20000000ULL  // repeat each query until this much time has passed
+
+struct Transcript {
+    std::string text;
+    std::string expected;  // name_en, or "-" for no local answer
+};
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool loadCorpus(const char* path, std::vector<Transcript>& out) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char* tab = strchr(line, '\t');
+        if (line[0] == '#' || tab == nullptr) continue;
+        *tab = '\0';
+        out.push_back({line, tab + 1});
+    }
+    fclose(f);
+    return !out.empty();
+}
+
+// The matcher logs every query: send stdout to /dev/null around the timed calls
+static int savedStdout = -1;
+
+static void quiet(bool on) {
+    fflush(stdout);
+    if (on) {
+        savedStdout = dup(STDOUT_FILENO);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        close(null);
+    } else if (savedStdout >= 0) {
+        dup2(savedStdout, STDOUT_FILENO);
+        close(savedStdout);
+        savedStdout = -1;
+    }
+}
+
+static int foodByName(const std::string& nameEn) {
+    for (int i = 0; i < foodDbFoodCount(); i++) {
+        if (nameEn == foodDbGetFood(i).name_en) return i;
+    }
+    return -1;
+}
+
+void setup() {
+    const char* path = BENCH_CORPUS;
+    const char* arg = getenv("SAFEBITE_MATCH_CORPUS");
+    if (arg) path = arg;
+    std::vector<Transcript> corpus;
+    if (!loadCorpus(path, corpus)) {
+        Serial.printf("[BENCH] No corpus at %s (set SAFEBITE_MATCH_CORPUS)\n", path);
+        exit(2);
+    }
+    const char* error = nullptr;
+    LittleFS.begin(false);
+    if (!foodDbLoad(error)) {
+        Serial.printf("[BENCH] Load failed: %s\n", error);
+        exit(2);
+    }
+
+    int correct = 0, wrong = 0, missed = 0, unknown = 0;
+    std::vector<double> latencies;
+    for (const Transcript& t : corpus) {
+        int expected = t.expected == "-" ? -1 : foodByName(t.expected);
+        if (t.expected != "-" && expected < 0) {
+            Serial.printf("[BENCH] \"%s\": no food named \"%s\"\n", t.text.c_str(), t.expected.c_str());
+            unknown++;
+            continue;
+        }
+
+        FoodMatch m;
+        quiet(true);
+        foodMatchFind(t.text.c_str(), m);
+        uint32_t runs = 0;
+        uint64_t start = nowNs(), elapsed;
+        do {
+            FoodMatch again;
+            foodMatchFind(t.text.c_str(), again);
+            runs++;
+            elapsed = nowNs() - start;
+        } while (elapsed < BENCH_MIN_NS);
+        quiet(false);
+        latencies.push_back((double)elapsed / runs);
+
+        int answer = foodMatchConfident(m) ? m.foodIndex : -1;
+        const char* verdict = "ok";
+        if (answer == expected) correct++;
+        else if (answer >= 0) { wrong++; verdict = "WRONG"; }
+        else { missed++; verdict = "to classifier"; }
+        if (answer != expected) {
+            Serial.printf("[BENCH] %-13s \"%s\" -> %s (%.2f, next %.2f), expected %s\n", verdict, t.text.c_str(),
+                          m.foodIndex >= 0 ? foodDbGetFood(m.foodIndex).name_en : "nothing", m.score, m.runnerUp,
+                          t.expected.c_str());
+        }
+    }
+
+    int scored = corpus.size() - unknown;
+    std::sort(latencies.begin(), latencies.end());
+    double total = 0;
+    for (double ns : latencies) total += ns;
+    Serial.printf("[BENCH] %d transcripts: %d correct (%.1f%%), %d wrong, %d left to the classifier\n",
+                  scored, correct, scored ? 100.0 * correct / scored : 0.0, wrong, missed);
+    if (!latencies.empty()) {
+        Serial.printf("[BENCH] latency per query: mean %.1f us, median %.1f us, p95 %.1f us, max %.1f us\n",
+                      total / latencies.size() / 1000, latencies[latencies.size() / 2] / 1000,
+                      latencies[latencies.size() * 95 / 100] / 1000, latencies.back() / 1000);
+    }
+    exit(wrong > 0 ? 1 : 0);
+}
+
+void loop() {}
@@ -0,0 +1,241 @@
+// Hot-path benchmark on the host: pio run -e perf-bench, then
+//   python3 scripts/perf_compare.py
+// which runs it over foods.bin images of several sizes (SAFEBITE_FS_ROOT) and
+// compares the figures with scripts/perf_baseline.json.
+// Every hot function of the firmware runs a fixed number of times over the
+// same inputs: the recorded responses and classifier replies in
+// bench/fixtures, a synthetic recording and the database's own names. The
+// PERF_PROBE scopes carry the firmware's names; each prints
+// "[PERF] name calls=.. ns/op=.. allocs/op=.. peak=.." at exit. The
+// functions' own logs are silenced so they are not timed.
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <math.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+#include "audio_encoder.h"
+#include "classify_parse.h"
+#include "food_alpha.h"
+#include "food_db.h"
+#include "http_reader.h"
+#include "language.h"
+#include "perf_probe.h"
+#include "scroll_text.h"
+#include "vad.h"
+
+#define BENCH_FIXTURES       "bench/fixtures/"
+#define BENCH_LOADS          200     // database loads
+#define BENCH_FILTER_PASSES  500     // over every category in both languages
+#define BENCH_SCROLL_FOODS   200     // foods whose names are scrolled through, from the first
+#define BENCH_SCROLL_PASSES  20
+#define BENCH_PARSE_PASSES   20000   // over every classifier reply
+#define BENCH_HTTP_PASSES    20000   // over every recorded response
+#define BENCH_HEADERS        1000000
+#define BENCH_AUDIO_PASSES   50      // over the recording
+#define BENCH_AUDIO_SECONDS  3
+#define BENCH_RATE           16000
+
+static const char* const RESPONSES[] = { "stt_plain.http", "classify_chunked.http" };
+
+// A recorded response played back the way the client's buffer hands it over
+class FixtureStream : public Stream {
+public:
+    explicit FixtureStream(const std::string& data) : data(data), pos(0) {}
+
+    int available() override { return (int)(data.size() - pos); }
+    int read() override { return pos < data.size() ? (uint8_t)data[pos++] : -1; }
+    int peek() override { return pos < data.size() ? (uint8_t)data[pos] : -1; }
+    size_t readBytes(char* buf, size_t len) override {
+        if (len > data.size() - pos) len = data.size() - pos;
+        memcpy(buf, data.data() + pos, len);
+        pos += len;
+        return len;
+    }
+    using Stream::readBytes;
+    size_t write(uint8_t) override { return 0; }
+
+    void rewind() { pos = 0; }
+
+private:
+    const std::string& data;
+    size_t pos;
+};
+
+static int savedStdout = -1;
+
+static void quiet(bool on) {
+    fflush(stdout);
+    if (on) {
+        savedStdout = dup(STDOUT_FILENO);
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        close(null);
+    } else if (savedStdout >= 0) {
+        dup2(savedStdout, STDOUT_FILENO);
+        close(savedStdout);
+        savedStdout = -1;
+    }
+}
+
+static void fail(const char* what, const char* detail) {
+    quiet(false);
+    Serial.printf("[BENCH] %s: %s\n", what, detail);
+    exit(2);
+}
+
+static std::string readFixture(const char* name) {
+    std::string path = std::string(BENCH_FIXTURES) + name;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) fail("Cannot read", path.c_str());
+    std::stringstream data;
+    data << in.rdbuf();
+    return data.str();
+}
+
+// One reply per line, "\n" written out as in the classifier's JSON string
+static std::vector<std::string> readReplies() {
+    std::vector<std::string> replies;
+    std::istringstream lines(readFixture("classify_replies.txt"));
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.empty()) continue;
+        std::string reply;
+        for (size_t i = 0; i < line.size(); i++) {
+            if (line[i] == '\\' && i + 1 < line.size() && line[i + 1] == 'n') {
+                reply += '\n';
+                i++;
+            } else {
+                reply += line[i];
+            }
+        }
+        replies.push_back(reply);
+    }
+    return replies;
+}
+
+// Room noise, then a voiced vowel (140 Hz and its harmonics under a smooth
+// envelope) from 0.5 s to 2 s; the same samples on every run
+static std::vector<int16_t> makeRecording() {
+    std::vector<int16_t> samples(BENCH_AUDIO_SECONDS * BENCH_RATE);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < samples.size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        float value = (float)((int32_t)(seed >> 16) % 81 - 40);
+        float t = (float)i / BENCH_RATE;
+        if (t >= 0.5f && t < 2.0f) {
+            float envelope = sinf((float)M_PI * (t - 0.5f) / 1.5f);
+            float voiced = 0;
+            for (int h = 1; h < 20; h++) voiced += sinf(2 * (float)M_PI * 140 * h * t) / h;
+            value += 5000 * envelope * voiced;
+        }
+        samples[i] = (int16_t)fmaxf(-32768, fminf(32767, value));
+    }
+    return samples;
+}
+
+static void benchDatabase() {
+    for (int i = 0; i < BENCH_LOADS; i++) {
+        PERF_PROBE("db_load");
+        const char* error = nullptr;
+        if (!foodDbLoad(error)) fail("Load failed", error);
+    }
+
+    int categories = foodDbCategoryCount();
+    for (int pass = 0; pass < BENCH_FILTER_PASSES; pass++) {
+        for (int c = 0; c < categories; c++) {
+            for (uint8_t lang = 0; lang < LANG_COUNT; lang++) {
+                PERF_PROBE("filter_category");
+                alphaOpen(c, lang);
+                alphaCount();
+            }
+        }
+    }
+
+    // Every step of the marquee, as updateScroll() moves it
+    int foods = min(foodDbFoodCount(), BENCH_SCROLL_FOODS);
+    for (int i = 0; i < foods * BENCH_SCROLL_PASSES; i++) {
+        Food food = foodDbGetFood(i % foods);
+        const char* names[] = { food.name_en, food.name_pt };
+        for (const char* name : names) {
+            char text[SCROLL_TEXT_MAX];
+            snprintf(text, sizeof(text), "%s", name);
+            int steps = (int)strlen(text) + 3;
+            for (int pos = 0; pos < steps; pos++) getScrolledText(text, pos);
+        }
+    }
+}
+
+static void benchResponses() {
+    std::vector<std::string> replies = readReplies();
+    for (int pass = 0; pass < BENCH_PARSE_PASSES; pass++) {
+        for (const std::string& reply : replies) {
+            FodmapLevel fodmap;
+            bool gluten;
+            parseClassifyResponse(reply.c_str(), fodmap, gluten);
+        }
+    }
+
+    for (const char* name : RESPONSES) {
+        std::string data = readFixture(name);
+        FixtureStream in(data);
+        for (int pass = 0; pass < BENCH_HTTP_PASSES; pass++) {
+            in.rewind();
+            HttpResponse head;
+            if (!httpReadHead(in, head) || head.status != 200) fail("No 200 response", name);
+            PERF_PROBE("http_body");
+            HttpBody body(in, head);
+            char buf[256];
+            while (body.readBytes(buf, sizeof(buf)) > 0) {}
+        }
+    }
+}
+
+static void benchAudio() {
+    const AudioEncoder& encoder = audioEncoder();
+    uint8_t header[AUDIO_ENCODER_MAX_HEADER];
+    for (uint32_t i = 0; i < BENCH_HEADERS; i++) {
+        PERF_PROBE("rec_header");
+        encoder.header(header, i, i * 2);
+    }
+
+    std::vector<int16_t> recording = makeRecording();
+    std::vector<uint8_t> out(encoder.maxBlockBytes);
+    volatile uint8_t level = 0;
+    for (int pass = 0; pass < BENCH_AUDIO_PASSES; pass++) {
+        vadReset();
+        for (size_t at = 0; at + VAD_FRAME_SAMPLES <= recording.size(); at += VAD_FRAME_SAMPLES) {
+            {
+                PERF_PROBE("peak_scan");
+                level = vadPeakLevel(&recording[at], VAD_FRAME_SAMPLES);
+            }
+            PERF_PROBE("vad");
+            vadFeed(&recording[at], VAD_FRAME_SAMPLES);
+        }
+
+        encoder.begin();
+        for (size_t at = 0; at < recording.size(); at += encoder.blockSamples) {
+            size_t count = min(encoder.blockSamples, recording.size() - at);
+            PERF_PROBE("encode");
+            encoder.encodeBlock(&recording[at], count, out.data());
+        }
+    }
+    (void)level;
+}
+
+void setup() {
+    Serial.begin(115200);
+    if (!LittleFS.begin(false)) fail("No LittleFS directory", "SAFEBITE_FS_ROOT");
+    quiet(true);
+    benchDatabase();
+    benchResponses();
+    benchAudio();
+    quiet(false);
+    Serial.printf("[BENCH] %d foods, %d categories\n", foodDbFoodCount(), foodDbCategoryCount());
+    exit(0);  // the probes report at exit
+}
+
+void loop() {}
@@ -0,0 +1,451 @@
+// Behaviour checks on the host: pio run -e self-check, then
+//   python3 scripts/self_check.py
+// which runs it over a scratch LittleFS root holding foods.bin and a chain
+// of deltas made by foods_delta.py, and compares the merged views it prints
+// with what foods_db.py makes of the same edits.
+//
+// The streaming JSON reader, the query arena and the HTTP body reader are
+// checked here against fixed inputs and their expected results; each input
+// is also fed one byte per read, as a slow socket hands it over. Each check
+// prints "[CHECK] name: ok" or the first mismatch; the program exits 1 when
+// any failed. The deltas found on the filesystem (/delta1.sbdelta, ...) are
+// applied in order, each followed by "[DELTA] n applied" or the error, and
+// the merged view ("[VIEW]" then one "[FOOD]" line per food) for the script.
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "food_db.h"
+#include "http_reader.h"
+#include "json_stream.h"
+#include "query_arena.h"
+
+#define CHECK_FIXTURES  "bench/fixtures/"
+#define CHECK_DELTAS    "/delta%d.sbdelta"
+
+// Bytes from memory, all at once or `step` per read like a socket; counts
+// reads past the end, which a reader that knows where the data stops never makes
+class MemoryStream : public Stream {
+public:
+    MemoryStream(const std::string& data, size_t step = 0) : data(data), pos(0), step(step), overreads(0) {}
+
+    int available() override {
+        size_t left = data.size() - pos;
+        return (int)(step && left > step ? step : left);
+    }
+    int read() override {
+        if (pos == data.size()) {
+            overreads++;
+            return -1;
+        }
+        return (uint8_t)data[pos++];
+    }
+    int peek() override { return pos < data.size() ? (uint8_t)data[pos] : -1; }
+    size_t readBytes(char* buf, size_t len) override {
+        if (pos == data.size()) overreads++;
+        if (step && len > step) len = step;
+        if (len > data.size() - pos) len = data.size() - pos;
+        memcpy(buf, data.data() + pos, len);
+        pos += len;
+        return len;
+    }
+    using Stream::readBytes;
+    size_t write(uint8_t) override { return 0; }
+
+    std::string rest() const { return data.substr(pos); }
+    int overreadCount() const { return overreads; }
+
+private:
+    std::string data;
+    size_t pos;
+    size_t step;
+    int overreads;
+};
+
+static int failures = 0;
+
+// One line per check: the first mismatch, or ok
+static bool expect(const char* check, const std::string& got, const std::string& want) {
+    if (got == want) return true;
+    Serial.printf("[CHECK] %s: FAILED\n  got:  %s\n  want: %s\n", check, got.c_str(), want.c_str());
+    failures++;
+    return false;
+}
+
+static void passed(const char* check, int before) {
+    if (failures == before) Serial.printf("[CHECK] %s: ok\n", check);
+}
+
+static std::string readFixture(const char* name) {
+    std::ifstream in(std::string(CHECK_FIXTURES) + name, std::ios::binary);
+    std::stringstream data;
+    data << in.rdbuf();
+    return data.str();
+}
+
+// ---------------------------------------------------------------------------
+// json_stream: the events of a document as "{ k:key s:string n:1 t f z [ ] } $",
+// "!error" for an error
+
+static std::string events(const std::string& doc, size_t step) {
+    MemoryStream in(doc, step);
+    JsonStream js;
+    jsonStreamBegin(js, in);
+    std::string out;
+    for (int guard = 0; guard < 1000; guard++) {
+        JsonEvent ev = jsonStreamNext(js);
+        if (!out.empty()) out += ' ';
+        switch (ev) {
+            case JSON_OBJECT_BEGIN: out += '{'; break;
+            case JSON_OBJECT_END:   out += '}'; break;
+            case JSON_ARRAY_BEGIN:  out += '['; break;
+            case JSON_ARRAY_END:    out += ']'; break;
+            case JSON_KEY:          out += std::string("k:") + js.text; break;
+            case JSON_STRING:       out += std::string("s:") + js.text; break;
+            case JSON_NUMBER:       out += std::string("n:") + js.text; break;
+            case JSON_TRUE:         out += 't'; break;
+            case JSON_FALSE:        out += 'f'; break;
+            case JSON_NULL:         out += 'z'; break;
+            case JSON_DONE:         return out + '$';
+            case JSON_ERROR:        return out + '!' + js.error;
+        }
+    }
+    return out + "!no end";
+}
+
+static void checkJsonStream() {
+    int before = failures;
+    std::string longText(JSON_STREAM_TEXT - 1, 'x');
+    std::string deep(JSON_STREAM_DEPTH + 1, '[');
+    std::string deepWant;
+    for (int i = 0; i < JSON_STREAM_DEPTH; i++) deepWant += "[ ";
+    deepWant += "!Nesting too deep";
+    const struct {
+        std::string doc;
+        std::string want;
+    } cases[] = {
+        { "{\"a\":1,\"b\":[true,false,null],\"c\":{\"d\":\"x\"}}",
+          "{ k:a n:1 k:b [ t f z ] k:c { k:d s:x } } $" },
+        { " \r\n\t{ } ", "{ } $" },
+        { "[[],{},-0.5e+3,1E2]", "[ [ ] { } n:-0.5e+3 n:1E2 ] $" },
+        { "[\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"]", "[ s:\"\\/\b\f\n\r\t ] $" },
+        { "[\"Ma\\u00e7\\u00c3\",\"\\u20ac\",\"\\ud83c\\udf4e\",\"p\xc3\xa3o\"]",
+          "[ s:Ma\xc3\xa7\xc3\x83 s:\xe2\x82\xac s:\xf0\x9f\x8d\x8e s:p\xc3\xa3o ] $" },
+        { "[\"" + longText + "\"]", "[ s:" + longText + " ] $" },
+        { "[\"" + longText + "x\"]", "[ !String too long" },
+        { "{\"a\" 1}", "{ k:a !Expected ':'" },
+        { "{\"a\":1", "{ k:a n:1 !Unexpected end" },
+        { "{\"a\":1 \"b\":2}", "{ k:a n:1 !Expected ','" },
+        { "{1:2}", "{ !Expected key" },
+        { "[1,]", "[ n:1 !Unexpected character" },
+        { "[tru]", "[ !Bad literal" },
+        { "[\"\\ud83c\"]", "[ !Bad escape" },
+        { "[\"\\x\"]", "[ !Bad escape" },
+        { "[\"a\nb\"]", "[ !Bad string" },
+        { deep, deepWant },
+        { "", "!Unexpected end" },
+    };
+    for (const auto& c : cases) {
+        // Whole, and one byte per read: chunk boundaries must not matter
+        if (!expect("json_stream", events(c.doc, 0), c.want)) continue;
+        expect("json_stream (byte by byte)", events(c.doc, 1), c.want);
+    }
+
+    // Skip a nested value, then carry on after it
+    MemoryStream in("{\"skip\":{\"x\":[1,{\"y\":\"}\"}]},\"keep\":3}");
+    JsonStream js;
+    jsonStreamBegin(js, in);
+    std::string got;
+    jsonStreamNext(js);
+    JsonEvent ev = jsonStreamNext(js);
+    got += ev == JSON_KEY ? js.text : "!key";
+    got += jsonStreamSkip(js, jsonStreamNext(js)) ? " skipped" : " !skip";
+    ev = jsonStreamNext(js);
+    got += ev == JSON_KEY ? std::string(" k:") + js.text : " !key";
+    expect("json_stream skip", got, "skip skipped k:keep");
+
+    // Offset of the next unread byte, past a buffer refill inside a string
+    std::string doc = std::string(100, ' ') + "[\"" + std::string(100, 'y') + "\",1]";
+    MemoryStream in2(doc);
+    jsonStreamBegin(js, in2);
+    jsonStreamNext(js);
+    ev = jsonStreamNext(js);
+    expect("json_stream offset", ev == JSON_STRING ? std::to_string(jsonStreamOffset(js)) : "!string", "203");
+    passed("json_stream", before);
+}
+
+// ---------------------------------------------------------------------------
+// query_arena
+
+static bool inArena(const void* ptr, const uint8_t* base) {
+    return (const uint8_t*)ptr >= base && (const uint8_t*)ptr < base + QUERY_ARENA_SIZE;
+}
+
+static void checkQueryArena() {
+    int before = failures;
+    if (!queryArenaReset()) {
+        expect("query_arena", "blocks in use at start", "empty");
+        return;
+    }
+
+    // Blocks are 8-byte aligned and follow each other with an 8-byte header
+    uint8_t* a = (uint8_t*)queryArenaAlloc(10);
+    uint8_t* b = (uint8_t*)queryArenaAlloc(3);
+    const uint8_t* base = a - 8;
+    expect("query_arena alignment", std::to_string((uintptr_t)a % 8) + " " + std::to_string((uintptr_t)b % 8), "0 0");
+    expect("query_arena layout", std::to_string(b - a), "24");
+
+    // Freeing the topmost block gives its space back at once
+    queryArenaFree(b);
+    uint8_t* c = (uint8_t*)queryArenaAlloc(3);
+    expect("query_arena free top", c == b ? "reused" : "not reused", "reused");
+
+    // A block below the top waits: the next one still goes above it
+    queryArenaFree(a);
+    uint8_t* d = (uint8_t*)queryArenaAlloc(1);
+    expect("query_arena free below", d > c ? "above" : "reused early", "above");
+
+    // The topmost block grows and shrinks in place, keeping its bytes
+    memcpy(d, "q", 1);
+    uint8_t* grown = (uint8_t*)queryArenaRealloc(d, 1000);
+    expect("query_arena grow top", grown == d && grown[0] == 'q' ? "in place" : "moved", "in place");
+    grown = (uint8_t*)queryArenaRealloc(grown, 16);
+    uint8_t* e = (uint8_t*)queryArenaAlloc(1);
+    expect("query_arena shrink top", std::to_string(e - grown), "24");
+
+    // Any other block moves, with its bytes
+    memcpy(c, "abc", 3);
+    uint8_t* moved = (uint8_t*)queryArenaRealloc(c, 40);
+    expect("query_arena grow below", moved != c && memcmp(moved, "abc", 3) == 0 ? "moved" : "wrong", "moved");
+
+    // Too big for what is left: served by malloc, freed back to it
+    void* big = queryArenaAlloc(QUERY_ARENA_SIZE);
+    expect("query_arena fallback", big && !inArena(big, base) ? "heap" : "arena", "heap");
+
+    // Reset is refused while anything is in use, and then starts from the bottom
+    std::string reset = queryArenaReset() ? "reset" : "refused";
+    queryArenaFree(big);
+    queryArenaFree(moved);
+    queryArenaFree(e);
+    queryArenaFree(grown);
+    reset += queryArenaReset() ? " reset" : " refused";
+    expect("query_arena reset", reset, "refused reset");
+    void* first = queryArenaAlloc(1);
+    expect("query_arena after reset", first == a ? "bottom" : "elsewhere", "bottom");
+    queryArenaFree(first);
+
+    // An ArduinoJson document on the arena leaves it empty when it goes
+    {
+        JsonDocument doc(queryArenaJsonAllocator());
+        doc["model"] = "mistral-small-latest";
+        JsonArray messages = doc["messages"].to<JsonArray>();
+        for (int i = 0; i < 20; i++) messages.add<JsonObject>()["content"] = "a message that is copied";
+        char out[32];
+        serializeJson(doc, out, sizeof(out));
+    }
+    expect("query_arena json", queryArenaReset() ? "empty" : "blocks left", "empty");
+    passed("query_arena", before);
+}
+
+// ---------------------------------------------------------------------------
+// HttpBody: the body of each response, the bytes left after it, and whether
+// it read past the data it was given
+
+static std::string body(const std::string& response, size_t step, size_t readSize, bool ends, std::string& rest) {
+    MemoryStream in(response, step);
+    HttpResponse head;
+    if (!httpReadHead(in, head)) return "!no head";
+    HttpBody b(in, head);
+    std::string out;
+    char buf[64];
+    if (readSize == 1) {
+        for (int c = b.read(); c >= 0; c = b.read()) out += (char)c;
+    } else {
+        size_t n;
+        while ((n = b.readBytes(buf, readSize)) > 0) out.append(buf, n);
+    }
+    if (b.read() >= 0 || b.available() != 0) out += "!more after the end";
+    rest = in.rest();
+    // On a socket a read past the end waits for the timeout
+    if (ends && in.overreadCount()) out += "!read past the end";
+    return out;
+}
+
+static void checkHttpBody() {
+    int before = failures;
+    const std::string head = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+    const struct {
+        std::string response;
+        std::string want;
+        std::string rest;  // what the reader must leave unread
+        bool        ends;  // the head says where the body ends
+    } cases[] = {
+        // Chunk extensions, a trailer, upper- and lower-case hex sizes
+        { head + "5;name=value\r\nhello\r\n6\r\n world\r\n0\r\nX-Trailer: y\r\n\r\n", "hello world",
+          "X-Trailer: y\r\n\r\n", true },
+        { head + "A\r\n0123456789\r\nb\r\n0123456789a\r\n0\r\n\r\nNEXT", "01234567890123456789a", "\r\nNEXT", true },
+        // Only the last chunk
+        { head + "0\r\n\r\n", "", "\r\n", true },
+        // A chunk cut short by a closed connection: what arrived, then the end
+        { head + "10\r\nshort", "short", "", false },
+        // Content-Length stops at the length, the next response stays unread
+        { "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhelloHTTP/1.1", "hello", "HTTP/1.1", true },
+        { "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello", "hello", "", true },
+        { "HTTP/1.1 204 No Content\r\nContent-Length: 0\r\n\r\n", "", "", true },
+        // Neither: the body runs until the connection closes
+        { "HTTP/1.0 200 OK\r\n\r\nuntil closed", "until closed", "", false },
+    };
+    for (const auto& c : cases) {
+        // Whole reads, short reads, byte by byte, and a socket that trickles
+        for (size_t step : { (size_t)0, (size_t)1, (size_t)7 }) {
+            for (size_t readSize : { (size_t)64, (size_t)3, (size_t)1 }) {
+                std::string rest;
+                std::string got = body(c.response, step, readSize, c.ends, rest);
+                if (!expect("http_body", got, c.want)) break;
+                if (!expect("http_body rest", rest, c.rest)) break;
+            }
+        }
+    }
+
+    // The recorded Mistral responses, parsed straight from the body as the client does
+    {
+        MemoryStream in(readFixture("classify_chunked.http"), 7);
+        HttpResponse h;
+        httpReadHead(in, h);
+        JsonDocument filter(queryArenaJsonAllocator());
+        filter["choices"][0]["message"]["content"] = true;
+        JsonDocument doc(queryArenaJsonAllocator());
+        HttpBody b(in, h);
+        DeserializationError err = deserializeJson(doc, b, DeserializationOption::Filter(filter));
+        expect("http_body classify fixture",
+               err ? std::string("!") + err.c_str() : std::string(doc["choices"][0]["message"]["content"] | ""),
+               "FODMAP: HIGH\nGLUTEN: YES");
+    }
+    {
+        MemoryStream in(readFixture("stt_plain.http"), 7);
+        HttpResponse h;
+        httpReadHead(in, h);
+        HttpBody b(in, h);
+        JsonStream js;
+        jsonStreamBegin(js, b);
+        std::string text = "!no text";
+        for (JsonEvent ev = jsonStreamNext(js); ev != JSON_DONE && ev != JSON_ERROR; ev = jsonStreamNext(js)) {
+            if (ev == JSON_KEY && strcmp(js.text, "text") == 0 && jsonStreamNext(js) == JSON_STRING) text = js.text;
+        }
+        expect("http_body stt fixture", text + (js.error ? std::string(" !") + js.error : ""),
+               "Batata-doce assada com azeite e alecrim");
+    }
+    expect("http_body arena", queryArenaReset() ? "empty" : "blocks left", "empty");
+    passed("http_body", before);
+}
+
+// ---------------------------------------------------------------------------
+// Deltas: the merged view after each one, and its own consistency
+
+static void printView(const char* label) {
+    int count = foodDbFoodCount();
+    Serial.printf("[VIEW] %s %08x %d\n", label, (unsigned)foodDbRevision(), count);
+    for (int c = 0; c < foodDbCategoryCount(); c++) {
+        int begin, end;
+        foodDbCategoryRange(c, begin, end);
+        for (int i = begin; i < end; i++) {
+            Food f = foodDbGetFood(i);
+            Serial.printf("[FOOD] %d %u %s\t%s\n", c, f.attrs, f.name_en, f.name_pt);
+        }
+    }
+}
+
+// Every view index in exactly one category range; the image records shown
+// unchanged and the overlay's own records together make up the view
+static void checkView(const char* label) {
+    int before = failures;
+    int count = foodDbFoodCount();
+    int next = 0;
+    std::string ranges;
+    for (int c = 0; c < foodDbCategoryCount(); c++) {
+        int begin, end;
+        foodDbCategoryRange(c, begin, end);
+        if (begin != next || end < begin) ranges += " " + std::to_string(c);
+        for (int i = begin; i < end; i++) {
+            if (foodDbGetFood(i).category != c) ranges += " food " + std::to_string(i);
+        }
+        next = end;
+    }
+    if (next != count) ranges += " count";
+    expect("delta view ranges", ranges, "");
+
+    std::vector<bool> seen(count, false);
+    std::string mapping;
+    int begin, end;
+    foodDbImageCategoryRange(foodDbCategoryCount() - 1, begin, end);
+    for (int image = 0; image < end; image++) {
+        int v = foodDbFromImageIndex(image);
+        if (v < 0) continue;
+        Food shown = foodDbGetFood(v);
+        std::string a = std::string(shown.name_en) + "\t" + shown.name_pt;
+        Food kept = foodDbImageFood(image);
+        if (v >= count || seen[v] || a != std::string(kept.name_en) + "\t" + kept.name_pt) {
+            mapping += " image " + std::to_string(image);
+        } else {
+            seen[v] = true;
+        }
+    }
+    int changed[FOODDB_OVERLAY_MAX];
+    int n = foodDbOverlayFoods(changed, FOODDB_OVERLAY_MAX);
+    for (int i = 0; i < n; i++) {
+        if (changed[i] < 0 || changed[i] >= count || seen[changed[i]]) mapping += " overlay " + std::to_string(i);
+        else seen[changed[i]] = true;
+    }
+    for (int v = 0; v < count; v++) {
+        if (!seen[v]) mapping += " unmapped " + std::to_string(v);
+    }
+    expect("delta view mapping", mapping, "");
+    if (failures == before) Serial.printf("[CHECK] delta view %s: ok\n", label);
+}
+
+static void checkDeltas() {
+    char path[32];
+    snprintf(path, sizeof(path), CHECK_DELTAS, 1);
+    if (!LittleFS.exists(path)) {
+        Serial.println("[CHECK] deltas: skipped, none on the filesystem (run scripts/self_check.py)");
+        return;
+    }
+    const char* error = nullptr;
+    if (!foodDbLoad(error)) {
+        expect("delta load", error, "loaded");
+        return;
+    }
+    printView("image");
+    for (int i = 1;; i++) {
+        snprintf(path, sizeof(path), CHECK_DELTAS, i);
+        if (!LittleFS.exists(path)) break;
+        bool ok = foodDbApplyDelta(path, error);
+        Serial.printf("[DELTA] %d %s\n", i, ok ? "applied" : error);
+        checkView(path + 1);
+        printView(path + 1);
+    }
+
+    // The overlay as written to flash gives the same view after a reboot
+    if (!foodDbLoad(error)) {
+        expect("delta reload", error, "loaded");
+        return;
+    }
+    checkView("reloaded");
+    printView("reloaded");
+}
+
+void setup() {
+    Serial.begin(115200);
+    LittleFS.begin(false);
+    checkJsonStream();
+    checkQueryArena();
+    checkHttpBody();
+    checkDeltas();
+    Serial.printf("[CHECK] %s\n", failures ? "FAILED" : "all ok");
+    exit(failures ? 1 : 0);
+}
+
+void loop() {}
@@ -0,0 +1,24 @@
+#ifndef AUDIO_CAPTURE_H
+#define AUDIO_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Microphone capture on a task of its own. The task keeps two frames queued
+// with the mic, so the I2S DMA always has somewhere to go, and publishes
+// every full frame into a lock-free single-producer/single-consumer ring.
+// The recorder drains the ring from loop() at its own pace: a slow display
+// draw or flash write only lets frames pile up. When the ring is full the
+// mic records into a scratch frame that is dropped and counted as an overrun.
+#define CAPTURE_FRAME_SAMPLES  320  // 20 ms at 16 kHz, one VAD frame
+#define CAPTURE_RING_FRAMES    50   // 1 s of slack, 32 KB
+
+bool captureInit();                       // allocate the ring (kept until captureFreeBuffer())
+bool captureStart(uint32_t sampleRate);   // mic on (configured by the caller), task running
+void captureStop();                       // mic off; frames already published stay readable
+const int16_t* captureFrame();            // oldest unread frame, nullptr when there is none
+void captureRelease();                    // done with the frame from captureFrame()
+uint32_t captureOverruns();               // frames dropped since captureStart()
+void captureFreeBuffer();
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef AUDIO_ENCODER_H
+#define AUDIO_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Encoders between the recorder's double buffer and the upload file. Audio
+// goes in as 16 kHz mono 16-bit blocks and comes out as a self-contained
+// stream the transcription endpoint accepts. Every block is encoded on its
+// own in bounded time (no look-ahead), and only the last block of a recording
+// may be shorter. The header has a fixed size, so it can be written first as
+// a placeholder and rewritten in place once the length is known.
+#define AUDIO_ENCODER_MAX_HEADER  64
+
+// header() samples and dataBytes for a stream whose length is not known yet:
+// WAV sizes of 0xFFFFFFFF, FLAC's "total samples unknown" (0)
+#define AUDIO_LENGTH_UNKNOWN  0xFFFFFFFFu
+
+struct AudioEncoder {
+    const char* name;           // for logs and the benchmark
+    const char* fileName;       // multipart filename: the server goes by its extension
+    const char* mimeType;
+    size_t      headerSize;
+    size_t      blockSamples;   // input per block
+    size_t      maxBlockBytes;  // worst-case output of one block
+    void   (*begin)();          // reset the stream state before the first block
+    void   (*header)(uint8_t* out, uint32_t samples, uint32_t dataBytes);  // headerSize bytes
+    size_t (*encodeBlock)(const int16_t* samples, size_t count, uint8_t* out);  // bytes written
+};
+
+extern const AudioEncoder PCM_ENCODER;    // WAV, 16-bit PCM: 32 KB per second
+extern const AudioEncoder FLAC_ENCODER;   // FLAC, fixed predictors: lossless, about half of PCM
+extern const AudioEncoder ADPCM_ENCODER;  // WAV, IMA ADPCM: 4 bits per sample, 8 KB per second
+
+// The upload format: AUDIO_ENCODER in config.h, FLAC_ENCODER by default
+const AudioEncoder& audioEncoder();
+
+#endif
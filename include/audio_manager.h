@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <atomic>
 
 // Recording states
 enum AudioState {
@@ -16,14 +17,7 @@ enum AudioState {
 #define AUDIO_SAMPLE_RATE     16000
 #define AUDIO_DURATION_MS     5000
 #define AUDIO_DURATION_SEC    (AUDIO_DURATION_MS / 1000)
-#define WAV_HEADER_SIZE       44
-
-// Chunk-based streaming to flash
-#define AUDIO_CHUNK_DURATION_MS  1000
-#define AUDIO_CHUNK_SAMPLES      (AUDIO_SAMPLE_RATE * AUDIO_CHUNK_DURATION_MS / 1000)  // 16000
-#define AUDIO_CHUNK_BUFFER_SIZE  (AUDIO_CHUNK_SAMPLES * sizeof(int16_t))               // 32000
-#define AUDIO_TOTAL_CHUNKS       (AUDIO_DURATION_MS / AUDIO_CHUNK_DURATION_MS)          // 5
-#define AUDIO_TOTAL_SAMPLES      (AUDIO_SAMPLE_RATE * AUDIO_DURATION_MS / 1000)         // 80000
+#define AUDIO_TOTAL_SAMPLES   (AUDIO_SAMPLE_RATE * AUDIO_DURATION_MS / 1000)  // 80000
 
 // Function declarations
 bool audioInit();
@@ -37,8 +31,28 @@ void audioFreeBuffer();
 float getRecordingProgress();  // 0.0 to 1.0
 void drawRecordingScreen();
 
-// WAV file on flash (written incrementally during recording)
-size_t getWavFileSize();
-const char* getWavFilePath();
+// The last recording, in the audioEncoder() format (written incrementally
+// during recording); the size is 0 when no speech was heard. It is in PSRAM
+// when the board has it (getRecordingData(), valid until the next recording
+// or audioDiscardRecording()), otherwise in the LittleFS file at
+// getRecordingPath() and getRecordingData() is nullptr. Both outlive
+// audioReset() and audioFreeBuffer().
+size_t getRecordingSize();
+const uint8_t* getRecordingData();
+const char* getRecordingPath();
+void audioDiscardRecording();
+
+// A PSRAM recording as it is made, for uploading it while recording: the
+// bytes before ready (header included) are final. With complete set, ready
+// is the final size, and 0 when there was no speech or the recording was
+// cancelled. The header at the start is a placeholder of unknown length.
+// Both are stored with release: after an acquire load of complete (read
+// first), ready is final; after one of ready, the bytes before it are.
+struct AudioStream {
+    const uint8_t*      data = nullptr;
+    std::atomic<size_t> ready{0};
+    std::atomic<bool>   complete{true};  // set after ready
+};
+const AudioStream* audioStream();  // nullptr unless recording into PSRAM
 
 #endif
@@ -0,0 +1,38 @@
+#ifndef CLASSIFY_CACHE_H
+#define CLASSIFY_CACHE_H
+
+#include <stdint.h>
+
+// Remembers classifier answers across queries and deep sleep, keyed by a hash
+// of the normalized transcript ("Pão!" and "pães" share an entry).
+// RAM: an open-addressing index over a fixed entry table with LRU eviction.
+// Flash: an append-only log of answers on LittleFS, replayed on first use and
+// compacted when it grows past CLASSIFY_LOG_MAX_RECORDS. Hits only reorder
+// the table in RAM; the order reaches flash when the log is compacted or
+// classifyCacheFlush() runs before deep sleep. Without LittleFS (no mount)
+// the cache is off: every lookup misses.
+#define CLASSIFY_CACHE_PATH         "/classify.log"
+#define CLASSIFY_CACHE_CAPACITY     128
+#define CLASSIFY_CACHE_SLOTS        256   // index slots (power of two, > capacity)
+#define CLASSIFY_LOG_MAX_RECORDS    (4 * CLASSIFY_CACHE_CAPACITY)
+
+// Cached value: FodmapLevel | FOOD_ATTR_GLUTEN, or CLASSIFY_CACHE_NOT_FOOD
+#define CLASSIFY_CACHE_NOT_FOOD     0x80
+
+struct ClassifyCacheStats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t entries;
+    uint32_t lookupUsTotal;  // time spent in lookups
+    uint32_t remoteCalls;    // classifier calls stored with classifyCachePut
+    uint32_t remoteMsTotal;  // ...and the time they took
+};
+
+bool classifyCacheGet(const char* text, uint8_t& valueOut);
+void classifyCachePut(const char* text, uint8_t value, uint32_t remoteMs);
+void classifyCacheStats(ClassifyCacheStats& out);
+
+// Write the LRU order back if hits changed it (before deep sleep)
+void classifyCacheFlush();
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef CLASSIFY_PARSE_H
+#define CLASSIFY_PARSE_H
+
+#include "food_db.h"
+
+// The classifier's answer as SYSTEM_PROMPT asks for it: "FODMAP: LOW\nGLUTEN: YES"
+// (case and spacing as they come), or "NOT_FOOD". Returns false for NOT_FOOD;
+// a level or gluten line that is missing leaves FODMAP_UNKNOWN / no gluten.
+bool parseClassifyResponse(const char* content, FodmapLevel& fodmapOut, bool& glutenOut);
+
+#endif
@@ -11,4 +11,19 @@
 
 // Optional: Set spending limit at https://console.mistral.ai/billing
 
+// Optional: voice upload format (default FLAC_ENCODER, lossless, about half the size of WAV).
+// ADPCM_ENCODER is 4:1 but lossy; PCM_ENCODER is plain WAV.
+// #define AUDIO_ENCODER ADPCM_ENCODER
+
+// Optional: another transcription/classification endpoint, e.g. scripts/mock_mistral.py
+// #define MISTRAL_HOST "192.168.1.10"
+// #define MISTRAL_PORT 8443
+
+// Optional: upload voice recordings after recording instead of while speaking (PSRAM boards)
+// #define MISTRAL_STREAM_UPLOAD 0
+
+// Optional: food database update server (see scripts/foods_delta.py)
+// #define DB_UPDATE_HOST "192.168.1.10"
+// #define DB_UPDATE_PORT 8000
+
 #endif
@@ -0,0 +1,27 @@
+#ifndef DB_UPDATE_H
+#define DB_UPDATE_H
+
+// Delivery of food database deltas (scripts/foods_delta.py) to the device.
+// Both paths store the delta in DB_UPDATE_PATCH_PATH and hand it to
+// foodDbApplyDelta(); a delta that does not match the current revision is
+// rejected there, so a stale or repeated delta is harmless.
+//
+// Serial:  host sends "DBPATCH <size>\n", device answers "DBPATCH READY", then
+//          "DBPATCH ACK <received>" after every DB_UPDATE_CHUNK bytes and
+//          finally "DBPATCH OK <revision>" or "DBPATCH ERR <reason>".
+// HTTP:    GET http://DB_UPDATE_HOST:DB_UPDATE_PORT/<revision>.sbdelta, where
+//          <revision> is foodDbRevision() as 8 hex digits; 404 = up to date.
+#define DB_UPDATE_PATCH_PATH  "/foods.patch"
+#define DB_UPDATE_CHUNK       256     // serial bytes per ACK
+#define DB_UPDATE_TIMEOUT     5000    // ms without progress before giving up
+#define DB_UPDATE_MAX_CHAIN   8       // deltas fetched in a row
+
+// Handle a pending serial transfer, if any; true when a delta was applied
+bool dbUpdatePollSerial();
+
+// Fetch and apply deltas from the update server until it has none for the
+// current revision; true when at least one was applied. Needs WiFi and
+// DB_UPDATE_HOST in config.h.
+bool dbUpdateFetch();
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef FOOD_ALPHA_H
+#define FOOD_ALPHA_H
+
+#include <stdint.h>
+
+// Alphabetical view of one category, for the food list and the letter search
+// screen. The order is precomputed per language in the database image
+// (FOODDB_SECTION_ALPHA) by collation key (textCollate: "Maçã" sorts as
+// "maca"), with per-letter offsets, so a prefix lookup is a short binary
+// search over cached pages. Records changed by delta updates are merged in.
+#define ALPHA_BUCKETS  27   // keys starting with a digit, then 'a'..'z'
+
+// Select the category and language (LANG_EN / LANG_PT) to view
+void alphaOpen(int category, uint8_t lang);
+int  alphaCount();
+
+// False when the image has no alphabetical order (imported from foods.json):
+// the view is in database order and the searches below find nothing
+bool alphaSorted();
+
+// Food index (for foodDbGetFood) at a position of the sorted view
+int  alphaFood(int pos);
+
+// First position whose collation key is >= key
+int  alphaLowerBound(const char* key);
+
+// Positions [begin, end) of the foods whose key starts with prefix
+void alphaPrefixRange(const char* prefix, int& begin, int& end);
+
+// Next character, after `after` ('\0' = the first), that extends prefix to
+// the key of at least one food; '\0' when there is none
+char alphaNextChar(const char* prefix, char after);
+
+#endif
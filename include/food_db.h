@@ -0,0 +1,94 @@
+#ifndef FOOD_DB_H
+#define FOOD_DB_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Compiled database image on LittleFS (built from data/foods.json by scripts/foods_db.py).
+// Build with -DFOODDB_PROGMEM to use the generated include/foods_table.h in flash instead.
+#define FOODDB_PATH       "/foods.bin"
+#define FOODDB_JSON_PATH  "/foods.json"  // imported into FOODDB_PATH when present (see food_db.cpp)
+#define FOODDB_MAGIC      "SBDB"
+#define FOODDB_VERSION    11
+
+// The image is read in fixed-size pages through a small LRU cache, so RAM use
+// does not grow with the number of foods
+#define FOODDB_PAGE_SIZE    512
+#define FOODDB_CACHE_PAGES  4
+
+// Optional sections (search indexes) stored after the records
+#define FOODDB_MAX_SECTIONS   16
+#define FOODDB_SECTION_MATCH  1   // trigram index over food names (food_match.cpp)
+#define FOODDB_SECTION_IDS    2   // stable food id -> image index
+#define FOODDB_SECTION_ALPHA  3   // alphabetical order per language (food_alpha.cpp)
+#define FOODDB_SECTION_ATTRS  4   // attribute bitmaps (food_query.cpp)
+#define FOODDB_SECTION_EXACT  5   // perfect hash over names and aliases (food_match.cpp)
+#define FOODDB_SECTION_VECTORS 6  // int8 sketches of names and aliases (food_vector.cpp)
+
+// Field updates (scripts/foods_delta.py). The uploaded image is never
+// rewritten: deltas are merged into a small overlay of changed records that
+// is replaced atomically, so an update costs flash writes in proportion to
+// what changed. The overlay is held in RAM; bigger edits need a full uploadfs.
+#define FOODDB_OVERLAY_PATH   "/foods.ovl"
+#define FOODDB_OVERLAY_MAX    48     // changed records
+#define FOODDB_OVERLAY_BYTES  2048   // overlay file size
+#define FOODDB_DELTA_MAX      4096   // largest delta accepted
+
+// FODMAP levels, stored in the low bits of Food::attrs
+enum FodmapLevel {
+    FODMAP_UNKNOWN,
+    FODMAP_LOW,
+    FODMAP_MODERATE,
+    FODMAP_HIGH
+};
+
+// Food attribute bits
+#define FOOD_ATTR_FODMAP_MASK  0x03
+#define FOOD_ATTR_GLUTEN       0x04
+
+// Food record view. Names point into a cached page (or flash): use them right away,
+// they stay valid only until FOODDB_CACHE_PAGES - 1 other pages have been read.
+struct Food {
+    const char* name_pt;
+    const char* name_en;
+    uint8_t     category;  // index into the category table
+    uint8_t     attrs;     // FodmapLevel | FOOD_ATTR_* bits
+};
+
+// Category record view
+struct Category {
+    const char* id;
+    const char* name_pt;
+    const char* name_en;
+};
+
+// Function declarations
+bool     foodDbLoad(const char*& errorOut);
+int      foodDbFoodCount();
+int      foodDbCategoryCount();
+Food     foodDbGetFood(int index);
+Category foodDbGetCategory(int index);
+void     foodDbCategoryRange(int category, int& begin, int& end);  // foods are sorted by category
+void     foodDbCacheStats(uint32_t& hits, uint32_t& misses);
+uint32_t foodDbSectionSize(uint16_t id);  // 0 when the image has no such section
+bool     foodDbSectionRead(uint16_t id, uint32_t offset, void* dst, size_t len);
+// Same, straight from the file past the page cache: for bulk scans that
+// would otherwise evict the record pages
+bool     foodDbSectionReadDirect(uint16_t id, uint32_t offset, void* dst, size_t len);
+uint32_t foodDbRevision();                 // content revision, after any applied deltas
+bool     foodDbApplyDelta(const char* path, const char*& errorOut);
+
+// Section indexes refer to records by their position in the image. With an
+// overlay applied, map them to food indices (-1 = the record was changed or
+// deleted) and consider the overlay records separately.
+int      foodDbFromImageIndex(int imageIndex);
+Food     foodDbImageFood(int imageIndex);        // record as stored in the image
+void     foodDbImageCategoryRange(int category, int& begin, int& end);  // image indices
+int      foodDbOverlayFoods(int* out, int max);  // food indices of changed records
+
+// Attribute helpers
+inline FodmapLevel getFodmap(const Food& f) { return (FodmapLevel)(f.attrs & FOOD_ATTR_FODMAP_MASK); }
+inline bool        hasGluten(const Food& f) { return (f.attrs & FOOD_ATTR_GLUTEN) != 0; }
+FodmapLevel        parseFodmapLevel(const char* level);  // "low" | "moderate" | "high"
+
+#endif
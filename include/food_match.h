@@ -0,0 +1,41 @@
+#ifndef FOOD_MATCH_H
+#define FOOD_MATCH_H
+
+#include <stddef.h>
+
+// Offline matcher: resolves a voice transcript to a food in the local database
+// through the trigram index built by scripts/foods_db.py, so queries for known
+// foods are answered without a round trip to the classifier.
+#define FOOD_MATCH_CONFIDENT  0.8f   // answer locally at or above this score...
+#define FOOD_MATCH_MARGIN     0.1f   // ...and this far ahead of any other food
+
+struct FoodMatch {
+    int   foodIndex;  // -1 = no candidate
+    float score;      // similarity to the closest name or alias, 0..1 (trigram Dice, or a sketch cosine mapped onto it)
+    float runnerUp;   // best score of any other food
+};
+
+// "chocolate" scores the same against dark and milk chocolate: only a clear
+// winner (or an exact name) is answered locally
+inline bool foodMatchConfident(const FoodMatch& m) {
+    return m.foodIndex >= 0 && m.score >= FOOD_MATCH_CONFIDENT &&
+           (m.score >= 1.0f || m.score - m.runnerUp >= FOOD_MATCH_MARGIN);
+}
+
+// Food whose name or alias is exactly `text` (after normalization and filler
+// word removal), in O(1) through the perfect hash of the database image;
+// -1 when there is none or the record was changed by a delta update
+int foodMatchExact(const char* text);
+
+// Closest food to `text`, an exact name or alias first; false when the database has no match index or no
+// name comes near enough to matter (well below FOOD_MATCH_CONFIDENT)
+bool foodMatchFind(const char* text, FoodMatch& out);
+
+// Filler word of spoken queries ("can", "posso"), given in normalized form
+bool foodMatchIsFiller(const char* word, size_t len);
+
+// Normalized text without filler words, unless that would leave nothing
+// (query_key in scripts/text_norm.py): the key names are indexed under
+void foodMatchQueryKey(const char* text, char* out, size_t outSize);
+
+#endif
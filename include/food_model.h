@@ -0,0 +1,32 @@
+#ifndef FOOD_MODEL_H
+#define FOOD_MODEL_H
+
+#include "food_db.h"
+
+// Offline guess for foods that are not in the database, used when the cloud
+// classifier cannot be reached: logistic regression over hashed words and
+// trigrams of the name, trained on the host by scripts/food_model.py and
+// compiled in as int8 weights (include/food_model_table.h). It learns words
+// like "pão" or "leite", not food science: treat every answer as an estimate.
+#define FOOD_MODEL_CONFIDENT  0.8f   // below this, the answer is shown as uncertain
+
+struct FoodGuess {
+    FodmapLevel fodmap;
+    float       fodmapConfidence;  // probability of that level, 0..1
+    float       glutenLikelihood;  // 0..1, gluten when >= 0.5
+    float       confidence;        // the lower of the two answers' probabilities
+};
+
+inline bool foodGuessConfident(const FoodGuess& g) {
+    return g.confidence >= FOOD_MODEL_CONFIDENT;
+}
+
+// FodmapLevel | FOOD_ATTR_GLUTEN of a guess
+inline uint8_t foodGuessAttrs(const FoodGuess& g) {
+    return g.fodmap | (g.glutenLikelihood >= 0.5f ? FOOD_ATTR_GLUTEN : 0);
+}
+
+// false when the text has no words to go by
+bool foodModelGuess(const char* text, FoodGuess& out);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef FOOD_QUERY_H
+#define FOOD_QUERY_H
+
+#include <stdint.h>
+#include "food_db.h"
+
+// Multi-criteria food queries over the attribute bitmaps of the database
+// image (FOODDB_SECTION_ATTRS): one bit per food and attribute, so "low
+// FODMAP, gluten-free snacks" is a word-wide AND over the category's range
+// and the result is counted and indexed with popcounts.
+enum FoodBitmap {
+    FOOD_BITMAP_FODMAP_LOW,
+    FOOD_BITMAP_FODMAP_MODERATE,
+    FOOD_BITMAP_FODMAP_HIGH,
+    FOOD_BITMAP_GLUTEN,
+    FOOD_BITMAP_COUNT  // new attributes go before this (and in ATTR_BITMAPS, scripts/foods_db.py)
+};
+
+#define FOOD_BIT(b)  (1u << (b))
+
+struct FoodQuery {
+    uint32_t require;   // FOOD_BIT()s a food must have
+    uint32_t exclude;   // FOOD_BIT()s it must not have
+    int      category;  // -1 = all categories
+};
+
+// Low FODMAP and gluten free, across all categories
+#define FOOD_QUERY_SAFE  { FOOD_BIT(FOOD_BITMAP_FODMAP_LOW), FOOD_BIT(FOOD_BITMAP_GLUTEN), -1 }
+
+uint32_t foodBitmapsOf(const Food& f);  // FOOD_BIT()s of one record
+bool     foodQueryMatches(const FoodQuery& q, const Food& f);
+
+// Evaluate a query. The result (a bitmap with a rank table, ~1 bit per food
+// in range) stays in RAM until the next run or foodQueryClear().
+bool foodQueryRun(const FoodQuery& q);
+int  foodQueryCount();
+int  foodQueryFood(int pos);  // food index of the pos-th match, in database order (-1 = none)
+void foodQueryClear();
+
+#endif
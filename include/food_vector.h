@@ -0,0 +1,37 @@
+#ifndef FOOD_VECTOR_H
+#define FOOD_VECTOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Nearest-neighbour search over int8 sketches of every food name and alias
+// (FOODDB_SECTION_VECTORS). A sketch is the sum of one pseudo-random +-1
+// vector per trigram, so the cosine of two sketches estimates the cosine of
+// their trigram sets; it is close for similar texts (noise ~0.03 near 0.9)
+// and meets misspellings of aliases the trigram index does not cover
+// ("berinjella", "espreso"). It is lexical: no meaning is learned.
+#define FOOD_VECTOR_MAX_DIMS  64
+#define FOOD_VECTOR_TOP_K     4
+
+// The cosine of two trigram sets is never below their Dice coefficient
+// (and the sketch adds noise), so cosines get a threshold of their own.
+// food_match.cpp maps it onto FOOD_MATCH_CONFIDENT and 1 onto 1 before
+// comparing with Dice scores, which makes the margin (1 - threshold) / 2.
+// Over bench/transcripts.tsv and ~900 one-edit misspellings of the names,
+// 0.87 answered 11% of the misspellings with none wrong; at 0.80, 0.4% of
+// the answers named the wrong food ("pop corn" -> Corn).
+#define FOOD_VECTOR_CONFIDENT  0.87f
+
+struct FoodVectorHit {
+    int   foodIndex;
+    float score;  // estimated cosine, -1..1
+};
+
+// Up to k best distinct foods for the trigrams of a query (textTrigrams of
+// the normalized text), best first, among the candidates (image indices,
+// ascending; usually the foods sharing trigrams with the query). Only their
+// sketches are read, past the page cache. Returns the number of hits.
+int foodVectorSearch(const uint16_t* grams, size_t gramCount, const uint16_t* candidates,
+                     size_t candidateCount, FoodVectorHit* out, int k);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef HTTP_READER_H
+#define HTTP_READER_H
+
+#include <Arduino.h>
+
+// HTTP/1.x responses read from a client Stream (WiFiClient, WiFiClientSecure)
+// through fixed buffers: no String, no heap, so a fragmented heap is left as
+// it was for the next TLS connect.
+#define HTTP_LINE_MAX  128   // longest status or header line kept, including NUL
+
+struct HttpResponse {
+    int  status;          // 0 when the status line is missing or malformed
+    bool chunked;         // Transfer-Encoding: chunked
+    long contentLength;   // -1 when not given
+};
+
+// One line without its line ending or trailing blanks, cut to fit (the rest
+// of a longer line is consumed and dropped); returns the length kept
+size_t httpReadLine(Stream& in, char* buf, size_t size);
+
+// Status line (leading blank lines skipped) and headers up to the blank line;
+// false when no status line arrived
+bool httpReadHead(Stream& in, HttpResponse& out);
+
+// The body of a response as a Stream: de-chunks chunked bodies and ends at
+// the last chunk or Content-Length without waiting for a timeout, so a parser
+// (ArduinoJson) can read straight from the socket with no body buffer
+class HttpBody : public Stream {
+public:
+    HttpBody(Stream& in, const HttpResponse& head);
+
+    int    available() override;
+    int    read() override;
+    int    peek() override;
+    size_t readBytes(char* buf, size_t len) override;
+    using Stream::readBytes;
+    size_t write(uint8_t) override { return 0; }
+
+    // Read and drop the rest of the body
+    void   drain();
+
+private:
+    bool   ready();  // false at the end of the body
+
+    Stream& in;
+    bool    chunked;
+    long    left;    // bytes left in this chunk (or the body), -1 = until closed
+    bool    done;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <Arduino.h>
+
+// Event-driven (SAX-style) JSON reader: pulls a document from a Stream
+// through a small buffer and reports it one token at a time, so memory use is
+// fixed no matter how large the document is. Keys, strings (unescaped, UTF-8)
+// and numbers are copied into JsonStream::text; longer ones are an error.
+#define JSON_STREAM_CHUNK  128   // bytes read from the stream at a time
+#define JSON_STREAM_TEXT   128   // longest key, string or number, including NUL
+#define JSON_STREAM_DEPTH  32    // deepest nesting
+
+enum JsonEvent : uint8_t {
+    JSON_OBJECT_BEGIN,
+    JSON_OBJECT_END,
+    JSON_ARRAY_BEGIN,
+    JSON_ARRAY_END,
+    JSON_KEY,
+    JSON_STRING,
+    JSON_NUMBER,
+    JSON_TRUE,
+    JSON_FALSE,
+    JSON_NULL,
+    JSON_DONE,   // end of the top-level value
+    JSON_ERROR   // malformed or truncated document, see JsonStream::error
+};
+
+struct JsonStream {
+    Stream*     in;
+    uint8_t     buf[JSON_STREAM_CHUNK];
+    uint16_t    len;
+    uint16_t    pos;
+    uint32_t    offset;       // bytes consumed before buf, for error messages
+    char        text[JSON_STREAM_TEXT];
+    uint16_t    textLen;
+    uint8_t     depth;
+    uint8_t     state;
+    uint32_t    arrays;       // bit d set: nesting level d is an array
+    const char* error;
+};
+
+void      jsonStreamBegin(JsonStream& js, Stream& in);
+JsonEvent jsonStreamNext(JsonStream& js);
+
+// Skip the rest of a value whose first event was `first` (nested containers
+// included); false on errors
+bool      jsonStreamSkip(JsonStream& js, JsonEvent first);
+
+// Byte position of the next unread character
+uint32_t  jsonStreamOffset(const JsonStream& js);
+
+#endif
@@ -29,6 +29,10 @@ extern const char* STR_SETTINGS[];
 extern const char* STR_LANGUAGE[];
 extern const char* STR_LANG_NAME[];
 extern const char* STR_NAV_SETTINGS[];
+extern const char* STR_NAV_FOODS[];
+extern const char* STR_NAV_SEARCH[];
+extern const char* STR_FIND[];
+extern const char* STR_SAFE_FOODS[];
 
 // WiFi status strings
 extern const char* STR_WIFI_CONNECTING[];
@@ -46,6 +50,8 @@ extern const char* STR_BROWSE_FOODS[];
 extern const char* STR_ERROR_API[];
 extern const char* STR_NOT_FOOD[];
 extern const char* STR_TRY_AGAIN[];
+extern const char* STR_ESTIMATE[];
+extern const char* STR_UNCERTAIN[];
 
 // Shared labels (same in both languages)
 #define STR_FODMAP_LABEL  "FODMAP: "
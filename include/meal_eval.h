@@ -0,0 +1,24 @@
+#ifndef MEAL_EVAL_H
+#define MEAL_EVAL_H
+
+#include <stdint.h>
+
+// Local evaluation of composite meals ("hambúrguer com queijo e cebola"),
+// using the same rules SYSTEM_PROMPT gives the classifier: the highest FODMAP
+// level of all ingredients, gluten if any ingredient has it.
+#define MEAL_MAX_INGREDIENTS  8
+#define MEAL_MAX_SEGMENTS     12   // phrases between connectives
+#define MEAL_MAX_SPAN         4    // segments tried together as one food name
+
+struct MealResult {
+    int     count;                        // ingredients resolved
+    int     foods[MEAL_MAX_INGREDIENTS];  // food index per ingredient
+    uint8_t attrs;                        // highest FodmapLevel | FOOD_ATTR_GLUTEN if any has it
+};
+
+// True when every ingredient of `text` resolves confidently to a food with a
+// known FODMAP level; otherwise the meal should go to the classifier.
+// Ingredients after "sem"/"without" are left out of the aggregate.
+bool mealEvaluate(const char* text, MealResult& out);
+
+#endif
@@ -2,18 +2,42 @@
 #define MISTRAL_CLIENT_H
 
 #include <Arduino.h>
+#include "food_db.h"
+#include "audio_manager.h"
+
+#define MISTRAL_TEXT_MAX  128   // longest transcript kept, including NUL (cut at a character)
 
 struct MistralResult {
-    bool   success;
-    bool   notFood;   // true if input was not recognized as food
-    String transcribedText;
-    String fodmap;    // "low" | "moderate" | "high" | "unknown"
-    bool   gluten;
-    String errorMsg;
+    bool        success;
+    bool        notFood;   // true if input was not recognized as food
+    char        transcribedText[MISTRAL_TEXT_MAX];
+    FodmapLevel fodmap;
+    bool        gluten;
+    const char* errorMsg;
 };
 
-// Transcribe from a WAV file stored in LittleFS (avoids keeping audio buffer in heap during TLS)
-String        mistralTranscribeFile(const char* wavPath, size_t wavSize, String& errorOut);
-bool          mistralClassify(const String& text, String& fodmapOut, bool& glutenOut, bool& notFoodOut, String& errorOut);
+// Error messages are constants or a static buffer, valid until the next call.
+
+// Transcribe a recording stored in LittleFS, in the audioEncoder() format (avoids keeping
+// audio buffer in heap during TLS); false with errorOut set when there is no transcript
+bool mistralTranscribeFile(const char* audioPath, size_t audioSize, char* textOut, size_t textSize,
+                           const char*& errorOut);
+// Same, from a recording in memory (PSRAM)
+bool mistralTranscribeMemory(const uint8_t* audioData, size_t audioSize, char* textOut, size_t textSize,
+                             const char*& errorOut);
+
+// Pipelined transcription of a recording in PSRAM: the request is opened when
+// recording starts and the recording goes out in HTTP chunks (Transfer-Encoding:
+// chunked) as it is made, from a task on the other core. mistralStreamFinish()
+// waits for the transcript once recording has ended; retryOut is set when the
+// request never completed, so the recording can still be sent with
+// mistralTranscribeMemory().
+bool mistralStreamSupported();  // API key set and MISTRAL_STREAM_UPLOAD not 0
+bool mistralStreamBegin(const AudioStream& source);  // false: upload after recording
+bool mistralStreamFinish(char* textOut, size_t textSize, const char*& errorOut, bool& retryOut);
+void mistralStreamCancel();  // recording cancelled; the task closes the request on its own
+
+bool mistralClassify(const char* text, FodmapLevel& fodmapOut, bool& glutenOut, bool& notFoodOut,
+                     const char*& errorOut);
 
 #endif
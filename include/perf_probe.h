@@ -0,0 +1,45 @@
+#ifndef PERF_PROBE_H
+#define PERF_PROBE_H
+
+// Hot-path probes for host benchmarks (env:native builds with PERF_PROBES):
+// PERF_PROBE("name") times the rest of its scope and counts the allocations
+// and the heap high-water mark above the start, summed per name. At exit one
+// "[PERF] name ..." line per probe goes to the log, for
+// scripts/perf_compare.py. Device builds leave PERF_PROBES undefined and the
+// probes compile to nothing.
+#ifdef PERF_PROBES
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct PerfSlot;
+
+PerfSlot& perfSlot(const char* name);  // registered on first use
+void perfReport();
+
+class PerfProbe {
+public:
+    explicit PerfProbe(PerfSlot& slot);
+    ~PerfProbe();
+
+private:
+    PerfSlot& slot;
+    uint64_t  startNs;
+    uint32_t  startAllocs;
+    size_t    startLive;
+    size_t    outerPeak;  // high-water mark of an enclosing probe, restored at the end
+};
+
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b)  PERF_CONCAT_(a, b)
+#define PERF_PROBE(name) \
+    static PerfSlot& PERF_CONCAT(perfSlot_, __LINE__) = perfSlot(name); \
+    PerfProbe PERF_CONCAT(perfProbe_, __LINE__)(PERF_CONCAT(perfSlot_, __LINE__))
+
+#else
+
+#define PERF_PROBE(name) do {} while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef QUERY_ARENA_H
+#define QUERY_ARENA_H
+
+#include <stddef.h>
+#include <ArduinoJson.h>
+
+// Bump allocator for the short-lived allocations of one voice query (JSON
+// documents and filters, the serialized classify request), so they never
+// touch the main heap and leave it unfragmented for mbedTLS. Blocks come off
+// the top of a static buffer; freeing the topmost block (and any freed ones
+// below it) gives the space back at once, others wait for queryArenaReset().
+// Requests that do not fit fall back to malloc and are counted.
+#define QUERY_ARENA_SIZE  12288
+
+void* queryArenaAlloc(size_t size);            // 8-byte aligned
+void  queryArenaFree(void* ptr);
+void* queryArenaRealloc(void* ptr, size_t size);
+
+// Drop everything at once when the query is over; refused (false) while
+// blocks are still in use
+bool  queryArenaReset();
+
+// For JsonDocument(queryArenaJsonAllocator())
+ArduinoJson::Allocator* queryArenaJsonAllocator();
+
+#endif
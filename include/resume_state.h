@@ -0,0 +1,27 @@
+#ifndef RESUME_STATE_H
+#define RESUME_STATE_H
+
+#include <stdint.h>
+
+// Where the user was when the device went to deep sleep, so the next wake
+// goes straight back there: kept in RTC slow memory, which survives deep
+// sleep but not a reset or power loss, under a CRC so a cold boot never
+// takes leftovers for a snapshot.
+struct ResumeState {
+    uint8_t  lang;         // currentLang, so the wake skips the NVS read
+    uint8_t  screen;       // MenuState in main.cpp
+    int16_t  index;        // cursor on that screen
+    int16_t  category;     // list shown on the foods screen (the category count = safe foods)
+    uint32_t dbRevision;   // foodDbRevision(): positions only hold for the same database
+    uint8_t  bssid[6];     // access point of the last connection, all zero if none
+    uint8_t  channel;
+};
+
+// Just before esp_deep_sleep_start()
+void resumeSave(const ResumeState& state);
+
+// Once at boot: true after a wake from deep sleep with a valid snapshot,
+// which is then used up (a later reset boots cold)
+bool resumeTake(ResumeState& out);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef SCROLL_TEXT_H
+#define SCROLL_TEXT_H
+
+#include <stddef.h>
+
+// Names wider than the screen: a marquee over text + "   " + text, measured
+// in pixels of the current display font (proportional fonts), or cut with "..".
+#define SCROLL_TEXT_MAX    128  // longest scrolling text, including NUL
+#define SCROLL_AREA_WIDTH  220  // pixels available for scrolling text
+
+// The visible part of text scrolled pos characters in; text itself when it
+// fits. Points into a static buffer, valid until the next call.
+const char* getScrolledText(const char* text, int pos);
+
+// Text cut with ".." when wider than SCROLL_AREA_WIDTH; returns text itself when it fits
+const char* fitText(const char* text, char* buf, size_t bufSize);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef TEXT_NORM_H
+#define TEXT_NORM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Text normalization for matching transcripts against food names.
+// Must stay in sync with scripts/text_norm.py, which builds the match index.
+#define TEXT_NORM_MAX         96   // normalized buffer size, including NUL
+#define TEXT_TRIGRAM_MAX      (TEXT_NORM_MAX + 1)
+#define TEXT_TRIGRAM_ALPHABET 37   // space, a-z, 0-9
+
+// Fold case and accents (Maçãs -> maca), turn everything that is not a letter
+// or digit into single spaces and strip PT/EN plural endings from each word.
+// Returns the output length; input that does not fit is truncated at a word.
+size_t textNormalize(const char* in, char* out, size_t outSize);
+
+// Sort key for alphabetical lists: case and accents folded as above (so PT
+// "ç" sorts with "c" and "á" with "a"), other characters as single spaces,
+// no plural stripping. Compare keys with strcmp.
+size_t textCollate(const char* in, char* out, size_t outSize);
+
+// Sorted unique trigram codes of a normalized string padded with spaces
+// (" maca "). Returns the number of codes written.
+size_t textTrigrams(const char* norm, uint16_t* out, size_t maxOut);
+
+#endif
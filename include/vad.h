@@ -0,0 +1,38 @@
+#ifndef VAD_H
+#define VAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Streaming voice activity detector for the recorder. Each 20 ms frame is
+// speech when its energy stands well above the noise floor, or somewhat above
+// it with a high zero-crossing rate (fricatives like "s" or "f"). The floor
+// follows the quietest frames heard so far and creeps up through silence, so
+// it settles within the first half-second in any room. The first
+// VAD_PREROLL_MS seed the floor and are classified once it is set.
+// Positions are sample indices counted from the last vadReset().
+#define VAD_SAMPLE_RATE     16000  // AUDIO_SAMPLE_RATE
+#define VAD_FRAME_MS        20
+#define VAD_FRAME_SAMPLES   (VAD_SAMPLE_RATE * VAD_FRAME_MS / 1000)  // 320
+#define VAD_ONSET_FRAMES    3      // speech frames in a row before speech counts (clicks do not)
+#define VAD_TRAILING_MS     800    // silence after speech that ends the query
+#define VAD_PREROLL_MS      200    // kept before the first speech frame (soft onsets)
+#define VAD_POSTROLL_MS     250    // kept after the last one (trailing consonants)
+
+void vadReset();
+
+// Classify the next block of the recording; a partial frame at the end of
+// the block is counted in the position but not classified
+void vadFeed(const int16_t* samples, size_t count);
+
+bool   vadHeardSpeech();
+size_t vadSpeechStart();  // first sample of the first speech frame
+size_t vadSpeechEnd();    // one past the last sample of the last speech frame
+
+// Speech was heard and has been followed by VAD_TRAILING_MS of silence
+bool vadEndpoint();
+
+// Loudest sample of a frame as 0-255, for the level meter
+uint8_t vadPeakLevel(const int16_t* samples, size_t count);
+
+#endif
@@ -36,6 +36,12 @@ void wifiDisable();
 void wifiReconnect();
 void drawWifiIndicator();
 
+// Access point of the last connection (false if there was none), and a hint
+// to join one directly on the next connect, skipping the scan; a hinted
+// connect that fails falls back to a normal one
+bool wifiLastAp(uint8_t bssid[6], uint8_t& channel);
+void wifiHintAp(const uint8_t bssid[6], uint8_t channel);
+
 // State accessors
 WifiState getWifiState();
 ConnectionMode getConnectionMode();
@@ -0,0 +1,254 @@
+#ifndef NATIVE_HAL_ARDUINO_H
+#define NATIVE_HAL_ARDUINO_H
+
+// Minimal Arduino core for host builds: String, Serial, timing, FreeRTOS
+// tasks and ESP helpers.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+// FreeRTOS tasks (std::thread on the host)
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+#define pdPASS 1
+#define pdFAIL 0
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t prio, TaskHandle_t* handle, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+
+class String {
+public:
+    String() {}
+    String(const char* s) : s_(s ? s : "") {}
+    String(const char* s, size_t n) : s_(s, n) {}
+    String(const std::string& s) : s_(s) {}
+    String(char c) : s_(1, c) {}
+    String(int v) : s_(std::to_string(v)) {}
+    String(unsigned int v) : s_(std::to_string(v)) {}
+    String(long v) : s_(std::to_string(v)) {}
+    String(unsigned long v) : s_(std::to_string(v)) {}
+    String(float v, unsigned int decimals = 2) { fmt(v, decimals); }
+    String(double v, unsigned int decimals = 2) { fmt(v, decimals); }
+
+    const char* c_str() const { return s_.c_str(); }
+    unsigned int length() const { return (unsigned int)s_.size(); }
+    bool reserve(unsigned int n) { s_.reserve(n); return true; }
+    char operator[](unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+    char& operator[](unsigned int i) { return s_[i]; }
+    char charAt(unsigned int i) const { return (*this)[i]; }
+
+    String& operator+=(const String& o) { s_ += o.s_; return *this; }
+    String& operator+=(const char* o) { if (o) s_ += o; return *this; }
+    String& operator+=(char c) { s_ += c; return *this; }
+    String& operator+=(int v) { s_ += std::to_string(v); return *this; }
+    String& operator+=(unsigned int v) { s_ += std::to_string(v); return *this; }
+    bool concat(const String& o) { s_ += o.s_; return true; }
+    bool concat(const char* o) { if (o) s_ += o; return true; }
+    bool concat(const char* o, unsigned int n) { s_.append(o, n); return true; }
+
+    bool operator==(const String& o) const { return s_ == o.s_; }
+    bool operator==(const char* o) const { return o && s_ == o; }
+    bool operator!=(const String& o) const { return s_ != o.s_; }
+    bool operator!=(const char* o) const { return !(*this == o); }
+    bool operator<(const String& o) const { return s_ < o.s_; }
+    bool equals(const String& o) const { return s_ == o.s_; }
+    bool equalsIgnoreCase(const String& o) const {
+        if (s_.size() != o.s_.size()) return false;
+        for (size_t i = 0; i < s_.size(); i++) {
+            if (tolower((unsigned char)s_[i]) != tolower((unsigned char)o.s_[i])) return false;
+        }
+        return true;
+    }
+
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t p = s_.find(c, from);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+    int indexOf(const String& s, unsigned int from = 0) const {
+        size_t p = s_.find(s.s_, from);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+    int lastIndexOf(char c) const {
+        size_t p = s_.rfind(c);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+    bool startsWith(const String& p) const { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+    bool endsWith(const String& p) const {
+        return s_.size() >= p.s_.size() &&
+               s_.compare(s_.size() - p.s_.size(), p.s_.size(), p.s_) == 0;
+    }
+    String substring(unsigned int from) const {
+        return from >= s_.size() ? String() : String(s_.substr(from));
+    }
+    String substring(unsigned int from, unsigned int to) const {
+        if (to > s_.size()) to = (unsigned int)s_.size();
+        return from >= to ? String() : String(s_.substr(from, to - from));
+    }
+    void trim() {
+        size_t b = 0, e = s_.size();
+        while (b < e && isspace((unsigned char)s_[b])) b++;
+        while (e > b && isspace((unsigned char)s_[e - 1])) e--;
+        s_ = s_.substr(b, e - b);
+    }
+    void toUpperCase() { for (auto& c : s_) c = (char)toupper((unsigned char)c); }
+    void toLowerCase() { for (auto& c : s_) c = (char)tolower((unsigned char)c); }
+    void replace(const String& from, const String& to) {
+        if (from.s_.empty()) return;
+        size_t p = 0;
+        while ((p = s_.find(from.s_, p)) != std::string::npos) {
+            s_.replace(p, from.s_.size(), to.s_);
+            p += to.s_.size();
+        }
+    }
+    void remove(unsigned int index, unsigned int count = (unsigned int)-1) {
+        if (index < s_.size()) s_.erase(index, count);
+    }
+    long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(s_.c_str(), nullptr); }
+
+    friend String operator+(const String& a, const String& b) { return String(a.s_ + b.s_); }
+    friend String operator+(const String& a, const char* b) { return String(a.s_ + (b ? b : "")); }
+    friend String operator+(const char* a, const String& b) { return String(std::string(a ? a : "") + b.s_); }
+    friend String operator+(const String& a, char b) { return String(a.s_ + b); }
+
+private:
+    void fmt(double v, unsigned int decimals) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+        s_ = buf;
+    }
+    std::string s_;
+};
+
+// What operator+ returns in the Arduino core; ArduinoJson may refer to it
+class StringSumHelper : public String {
+public:
+    using String::String;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t n) {
+        size_t w = 0;
+        while (n--) w += write(*buf++);
+        return w;
+    }
+    size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[512];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if (n < 0) return 0;
+        return write((const uint8_t*)buf, std::min((size_t)n, sizeof(buf) - 1));
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long ms) { timeoutMs_ = ms; }
+    unsigned long getTimeout() const { return timeoutMs_; }
+
+    size_t readBytes(uint8_t* buf, size_t len) { return readBytes((char*)buf, len); }
+    virtual size_t readBytes(char* cbuf, size_t len) {
+        uint8_t* buf = (uint8_t*)cbuf;
+        size_t n = 0;
+        while (n < len) {
+            int c = timedRead();
+            if (c < 0) break;
+            buf[n++] = (uint8_t)c;
+        }
+        return n;
+    }
+    String readStringUntil(char terminator) {
+        std::string s;
+        int c;
+        while ((c = timedRead()) >= 0 && c != terminator) s += (char)c;
+        return String(s);
+    }
+    String readString() {
+        std::string s;
+        int c;
+        while ((c = timedRead()) >= 0) s += (char)c;
+        return String(s);
+    }
+
+protected:
+    virtual int timedRead() { return available() > 0 ? read() : -1; }
+    unsigned long timeoutMs_ = 1000;
+};
+
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+    size_t write(const uint8_t* buf, size_t n) override { return fwrite(buf, 1, n, stdout); }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getPsramSize();
+    void restart() { exit(0); }
+};
+
+extern EspClass ESP;
+
+#endif
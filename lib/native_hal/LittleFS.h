@@ -0,0 +1,82 @@
+#ifndef NATIVE_HAL_LITTLEFS_H
+#define NATIVE_HAL_LITTLEFS_H
+
+// LittleFS backed by a host directory (SAFEBITE_FS_ROOT, default ".pio/native_fs").
+
+#include <Arduino.h>
+#include <memory>
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File : public Stream {
+public:
+    File() {}
+    explicit File(FILE* fp) : fp_(fp, &fclose) {}
+
+    explicit operator bool() const { return fp_ != nullptr; }
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buf, size_t n) override {
+        return fp_ ? fwrite(buf, 1, n, fp_.get()) : 0;
+    }
+    using Print::write;
+
+    int available() override {
+        if (!fp_) return 0;
+        long pos = ftell(fp_.get());
+        return (int)(size() - pos);
+    }
+    int read() override {
+        return fp_ ? fgetc(fp_.get()) : -1;
+    }
+    int read(uint8_t* buf, size_t n) {
+        return fp_ ? (int)fread(buf, 1, n, fp_.get()) : -1;
+    }
+    using Stream::readBytes;
+    size_t readBytes(char* buf, size_t n) override {
+        return fp_ ? fread(buf, 1, n, fp_.get()) : 0;
+    }
+    int peek() override {
+        if (!fp_) return -1;
+        int c = fgetc(fp_.get());
+        if (c >= 0) ungetc(c, fp_.get());
+        return c;
+    }
+    bool seek(uint32_t pos, SeekMode mode = SeekSet) {
+        return fp_ && fseek(fp_.get(), (long)pos, (int)mode) == 0;
+    }
+    size_t position() const { return fp_ ? (size_t)ftell(fp_.get()) : 0; }
+    size_t size() const {
+        if (!fp_) return 0;
+        long cur = ftell(fp_.get());
+        fseek(fp_.get(), 0, SEEK_END);
+        long end = ftell(fp_.get());
+        fseek(fp_.get(), cur, SEEK_SET);
+        return (size_t)end;
+    }
+    void flush() { if (fp_) fflush(fp_.get()); }
+    void close() { fp_.reset(); }
+
+private:
+    std::shared_ptr<FILE> fp_;
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool formatOnFail = false);
+    void end() {}
+    File open(const char* path, const char* mode = "r");
+    File open(const String& path, const char* mode = "r") { return open(path.c_str(), mode); }
+    bool exists(const char* path);
+    bool remove(const char* path);
+    bool rename(const char* from, const char* to);
+    size_t totalBytes() { return 1024 * 1024; }
+    size_t usedBytes() { return 0; }
+
+private:
+    std::string hostPath(const char* path) const;
+};
+
+extern LittleFSFS LittleFS;
+
+#endif
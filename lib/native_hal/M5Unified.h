@@ -0,0 +1,133 @@
+#ifndef NATIVE_HAL_M5UNIFIED_H
+#define NATIVE_HAL_M5UNIFIED_H
+
+// Headless M5Unified: display calls are no-ops with a fixed-advance text
+// metric, buttons are driven from stdin (end of input ends the program), the
+// mic replays a host WAV file.
+
+#include <Arduino.h>
+#include <esp_sleep.h>
+
+struct GFXglyph {
+    uint16_t bitmapOffset;
+    uint8_t  width, height;
+    uint8_t  xAdvance;
+    int8_t   xOffset, yOffset;
+};
+
+struct GFXfont {
+    uint8_t*  bitmap;
+    GFXglyph* glyph;
+    uint16_t  first, last;
+    uint8_t   yAdvance;
+};
+
+#define TFT_BLACK     0x0000
+#define TFT_BLUE      0x001F
+#define TFT_RED       0xF800
+#define TFT_GREEN     0x07E0
+#define TFT_CYAN      0x07FF
+#define TFT_ORANGE    0xFDA0
+#define TFT_YELLOW    0xFFE0
+#define TFT_WHITE     0xFFFF
+#define TFT_DARKGREY  0x7BEF
+#define TFT_LIGHTGREY 0xD69A
+
+enum class textdatum_t : uint8_t { top_left = 0 };
+
+class M5Display : public Print {
+public:
+    void setRotation(uint8_t) {}
+    void fillScreen(uint16_t) {}
+    void setTextSize(float) {}
+    void setTextDatum(textdatum_t) {}
+    void setFont(const GFXfont* f) { font_ = f; }
+    void setTextColor(uint16_t) {}
+    void setCursor(int32_t x, int32_t y) { x_ = x; y_ = y; }
+    void fillRect(int32_t, int32_t, int32_t, int32_t, uint16_t) {}
+    void drawRect(int32_t, int32_t, int32_t, int32_t, uint16_t) {}
+    void drawLine(int32_t, int32_t, int32_t, int32_t, uint16_t) {}
+    void fillCircle(int32_t, int32_t, int32_t, uint16_t) {}
+    void drawCircle(int32_t, int32_t, int32_t, uint16_t) {}
+    void sleep() {}
+    void wakeup() {}
+
+    int32_t textWidth(const char* s) const;
+    int32_t textLength(const char* s, int32_t width) const;
+    int32_t fontHeight() const { return font_ ? font_->yAdvance : 8; }
+
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+private:
+    const GFXfont* font_ = nullptr;
+    int32_t x_ = 0, y_ = 0;
+};
+
+// A key is a whole press in one update: wasPressed() and wasClicked() (or
+// wasHold() for a hold) all report it until the next M5.update()
+class M5Button {
+public:
+    bool wasPressed() const { return pressed_; }
+    bool wasClicked() const { return clicked_; }
+    bool wasHold() const { return held_; }
+    bool isPressed() const { return false; }
+    void press() { pressed_ = clicked_ = true; }
+    void hold() { pressed_ = held_ = true; }
+    void clear() { pressed_ = clicked_ = held_ = false; }
+
+private:
+    bool pressed_ = false;
+    bool clicked_ = false;
+    bool held_ = false;
+};
+
+class M5Mic {
+public:
+    struct config_t {
+        uint32_t sample_rate = 16000;
+        uint8_t  magnification = 1;
+        uint8_t  dma_buf_count = 3;
+        uint16_t dma_buf_len = 256;
+        uint8_t  task_pinned_core = 0;
+    };
+    config_t config() const { return cfg_; }
+    void config(const config_t& c) { cfg_ = c; }
+    bool begin();
+    void end();
+    // Like M5Unified: two buffers can be queued, filled one after the other
+    // with no gap; record() waits while both are taken, and isRecording()
+    // returns how many are still queued
+    bool record(int16_t* buf, size_t samples, uint32_t rate);
+    size_t isRecording();
+    bool isEnabled() const { return enabled_; }
+
+private:
+    struct Pending {
+        int16_t* buf;
+        size_t samples;
+        unsigned long dueAt;
+    };
+    config_t cfg_;
+    bool enabled_ = false;
+    Pending queue_[2];
+    size_t queued_ = 0;
+};
+
+class M5UnifiedClass {
+public:
+    struct config_t {};
+    config_t config() const { return config_t(); }
+    void begin(const config_t&);
+    void update();
+
+    M5Display Display;
+    M5Button  BtnA;
+    M5Button  BtnB;
+    M5Button  BtnPWR;
+    M5Mic     Mic;
+};
+
+extern M5UnifiedClass M5;
+
+#endif
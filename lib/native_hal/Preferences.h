@@ -0,0 +1,46 @@
+#ifndef NATIVE_HAL_PREFERENCES_H
+#define NATIVE_HAL_PREFERENCES_H
+
+// In-memory NVS replacement; values live for the lifetime of the process.
+
+#include <Arduino.h>
+#include <map>
+
+class Preferences {
+public:
+    bool begin(const char* ns, bool readOnly = false) {
+        ns_ = ns;
+        readOnly_ = readOnly;
+        return true;
+    }
+    void end() {}
+
+    uint8_t getUChar(const char* key, uint8_t def = 0) {
+        auto it = store().find(ns_ + "/" + key);
+        return it == store().end() ? def : (uint8_t)it->second;
+    }
+    size_t putUChar(const char* key, uint8_t value) {
+        if (readOnly_) return 0;
+        store()[ns_ + "/" + key] = value;
+        return 1;
+    }
+    uint32_t getUInt(const char* key, uint32_t def = 0) {
+        auto it = store().find(ns_ + "/" + key);
+        return it == store().end() ? def : it->second;
+    }
+    size_t putUInt(const char* key, uint32_t value) {
+        if (readOnly_) return 0;
+        store()[ns_ + "/" + key] = value;
+        return 4;
+    }
+
+private:
+    static std::map<std::string, uint32_t>& store() {
+        static std::map<std::string, uint32_t> s;
+        return s;
+    }
+    std::string ns_;
+    bool readOnly_ = true;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef NATIVE_HAL_WIFI_H
+#define NATIVE_HAL_WIFI_H
+
+// Loopback WiFi: begin() "associates" immediately and fires GOT_IP on the
+// next status poll, so the firmware's event-driven state machine runs as-is.
+
+#include <Arduino.h>
+#include <functional>
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1 } wifi_mode_t;
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_STA_CONNECTED,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP
+} WiFiEvent_t;
+
+typedef struct { int reason; } WiFiEventInfo_t;
+typedef void (*WiFiEventSysCb)(WiFiEvent_t event, WiFiEventInfo_t info);
+
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t m) { mode_ = m; return true; }
+    int begin(const char* ssid, const char* pass, int32_t channel = 0,
+              const uint8_t* bssid = nullptr, bool connect = true);
+    bool disconnect(bool wifiOff = false);
+    wl_status_t status();
+    int onEvent(WiFiEventSysCb cb) { cb_ = cb; return 0; }
+    uint8_t* BSSID() { return bssid_; }
+    int32_t channel() { return 1; }
+
+private:
+    wifi_mode_t mode_ = WIFI_OFF;
+    wl_status_t status_ = WL_DISCONNECTED;
+    WiFiEventSysCb cb_ = nullptr;
+    uint8_t bssid_[6] = {0x02, 0, 0, 0, 0, 1};
+};
+
+extern WiFiClass WiFi;
+
+#include <WiFiClientSecure.h>
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef NATIVE_HAL_WIFICLIENTSECURE_H
+#define NATIVE_HAL_WIFICLIENTSECURE_H
+
+// Plain POSIX TCP client standing in for WiFiClientSecure (and WiFiClient).
+// There is no TLS on the host: connect to a local plain-HTTP endpoint.
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+class WiFiClientSecure : public Stream {
+public:
+    WiFiClientSecure() {}
+    ~WiFiClientSecure() { stop(); }
+
+    void setInsecure() {}
+    void setTimeout(uint32_t seconds) { timeoutMs_ = seconds * 1000UL; }
+    int connect(const char* host, uint16_t port);
+    uint8_t connected();
+    void stop();
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buf, size_t n) override;
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t n);
+    int peek() override;
+
+protected:
+    int timedRead() override;
+
+private:
+    bool fill(unsigned long waitMs);
+
+    int fd_ = -1;
+    uint8_t rx_[512];
+    size_t rxLen_ = 0;
+    size_t rxPos_ = 0;
+    bool eof_ = false;
+};
+
+typedef WiFiClientSecure WiFiClient;
+
+#endif
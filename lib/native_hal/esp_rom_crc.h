@@ -0,0 +1,17 @@
+#ifndef NATIVE_HAL_ESP_ROM_CRC_H
+#define NATIVE_HAL_ESP_ROM_CRC_H
+
+// The ROM's CRC-32 (IEEE, reflected), bitwise
+
+#include <stdint.h>
+
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef NATIVE_HAL_ESP_SLEEP_H
+#define NATIVE_HAL_ESP_SLEEP_H
+
+#include <stdint.h>
+
+typedef enum { GPIO_NUM_35 = 35 } gpio_num_t;
+
+typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED = 0,
+    ESP_SLEEP_WAKEUP_EXT0 = 2,
+    ESP_SLEEP_WAKEUP_TIMER = 4
+} esp_sleep_wakeup_cause_t;
+
+int esp_sleep_enable_ext0_wakeup(gpio_num_t pin, int level);
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
+void esp_deep_sleep_start();
+
+#endif
@@ -0,0 +1,599 @@
+// Host implementations behind the native HAL headers.
+
+#include <Arduino.h>
+#include <M5Unified.h>
+#include <LittleFS.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <esp_heap_caps.h>
+#include <esp_sleep.h>
+#include <native_hal.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <pthread.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+LittleFSFS LittleFS;
+WiFiClass WiFi;
+M5UnifiedClass M5;
+
+// ---------------------------------------------------------------------------
+// Timing
+
+static const auto bootTime = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - bootTime).count();
+}
+
+unsigned long micros() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+// ---------------------------------------------------------------------------
+// Heap accounting for benchmarks: glibc's allocator behind counting wrappers
+// (new and delete go through them too)
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void  __libc_free(void* ptr);
+}
+
+static std::atomic<uint32_t> heapAllocs(0);
+static std::atomic<int64_t>  heapLive(0);  // signed: blocks from memalign() are only seen freed
+static std::atomic<int64_t>  heapPeak(0);
+static std::atomic<int64_t>  heapHigh(0);  // heapPeak that nativeHeapSetPeak() leaves alone
+
+static void heapRaise(std::atomic<int64_t>& mark, int64_t live) {
+    int64_t seen = mark.load();
+    while (live > seen && !mark.compare_exchange_weak(seen, live)) {}
+}
+
+static void heapTrack(void* ptr) {
+    if (ptr == nullptr) return;
+    heapAllocs++;
+    int64_t live = heapLive += malloc_usable_size(ptr);
+    heapRaise(heapPeak, live);
+    heapRaise(heapHigh, live);
+}
+
+extern "C" void* malloc(size_t size) {
+    void* ptr = __libc_malloc(size);
+    heapTrack(ptr);
+    return ptr;
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    void* ptr = __libc_calloc(count, size);
+    heapTrack(ptr);
+    return ptr;
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    size_t old = ptr ? malloc_usable_size(ptr) : 0;
+    void* moved = __libc_realloc(ptr, size);
+    if (moved != nullptr || size == 0) {
+        heapLive -= old;
+        heapTrack(moved);
+    }
+    return moved;
+}
+
+extern "C" void free(void* ptr) {
+    if (ptr) heapLive -= malloc_usable_size(ptr);
+    __libc_free(ptr);
+}
+
+void nativeHeapStats(NativeHeapStats& out) {
+    int64_t live = heapLive.load();
+    out.allocs = heapAllocs.load();
+    out.live = live > 0 ? (size_t)live : 0;
+    out.peak = (size_t)heapPeak.load();
+}
+
+void nativeHeapSetPeak(size_t peak) {
+    heapPeak = (int64_t)peak;
+}
+
+// ---------------------------------------------------------------------------
+// Heap as the firmware sees it: an ESP32-sized internal heap over glibc's
+// main arena. There is one arena for every thread and nothing below the heap
+// size is mmap()ed, so every firmware block lives in it. The figures are the
+// allocator's own, less what the host runtime held before main().
+// PSRAM is absent unless SAFEBITE_PSRAM gives its size in bytes. Its blocks
+// are mapped apart from the arena, so they never count as internal heap.
+
+static const size_t NATIVE_HEAP_SIZE = 160 * 1024;
+static const size_t PSRAM_BLOCKS = 1024;  // live PSRAM blocks at once (a JSON document's strings)
+
+static size_t bootLive = 0;  // bytes in use before main()
+static size_t bootSpan = 0;  // arena bytes below the top chunk before main()
+
+// Arena bytes below the top chunk: blocks in use and the holes between them
+static size_t arenaSpan() {
+    struct mallinfo2 info = mallinfo2();
+    return info.arena - info.keepcost;  // keepcost is the main arena's top chunk
+}
+
+static size_t internalFree(int64_t live) {
+    size_t used = live > (int64_t)bootLive ? (size_t)live - bootLive : 0;
+    return used < NATIVE_HEAP_SIZE ? NATIVE_HEAP_SIZE - used : 0;
+}
+
+// Largest free chunk in glibc's bins, from malloc_info(), which gives the
+// smallest and largest chunk of every bin. Its FILE is opened at boot, since
+// one opened here would stay in a cache above the firmware's blocks.
+static char infoXml[16384];
+static FILE* infoOut = nullptr;
+static std::mutex infoLock;
+
+static size_t largestBinnedChunk() {
+    std::lock_guard<std::mutex> guard(infoLock);
+    if (infoOut == nullptr) return 0;
+    rewind(infoOut);
+    malloc_info(0, infoOut);
+    fflush(infoOut);
+    size_t len = (size_t)ftell(infoOut);
+    infoXml[len < sizeof(infoXml) ? len : sizeof(infoXml) - 1] = '\0';
+
+    size_t largest = 0;
+    const char* end = strstr(infoXml, "</sizes>");
+    for (const char* p = strstr(infoXml, " to=\""); p != nullptr && (end == nullptr || p < end);
+         p = strstr(p + 1, " to=\"")) {
+        size_t size = strtoull(p + 5, nullptr, 10);
+        if (size > largest) largest = size;
+    }
+    return largest > sizeof(size_t) ? largest - sizeof(size_t) : 0;  // less the chunk header
+}
+
+// Freed blocks that glibc caches rather than merges (fastbins; tcache only
+// through GLIBC_TUNABLES=glibc.malloc.tcache_count=0, as scripts/heap_soak.py
+// sets it) would read as holes the ESP32 allocator does not leave
+__attribute__((constructor(101))) static void heapBoot() {
+    mallopt(M_ARENA_MAX, 1);
+    mallopt(M_MMAP_THRESHOLD, NATIVE_HEAP_SIZE);
+    mallopt(M_MXFAST, 0);
+    infoOut = fmemopen(infoXml, sizeof(infoXml) - 1, "w");
+    bootLive = (size_t)heapLive.load();
+    heapHigh = (int64_t)bootLive;
+    bootSpan = arenaSpan();
+}
+
+struct PsramBlock {
+    void*  ptr;
+    size_t size;
+};
+
+static PsramBlock psramBlocks[PSRAM_BLOCKS];
+static size_t psramUsed = 0;
+static std::mutex psramLock;
+
+static size_t psramSize() {
+    static const char* env = getenv("SAFEBITE_PSRAM");
+    return env ? strtoul(env, nullptr, 0) : 0;
+}
+
+static PsramBlock* psramFind(void* ptr) {
+    for (size_t i = 0; i < PSRAM_BLOCKS; i++) {
+        if (psramBlocks[i].ptr == ptr) return &psramBlocks[i];
+    }
+    return nullptr;
+}
+
+static void* psramAlloc(size_t size) {
+    std::lock_guard<std::mutex> guard(psramLock);
+    if (size == 0 || size > psramSize() - psramUsed) return nullptr;
+    PsramBlock* block = psramFind(nullptr);
+    if (block == nullptr) return nullptr;
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) return nullptr;
+    block->ptr = ptr;
+    block->size = size;
+    psramUsed += size;
+    return ptr;
+}
+
+// False when ptr is not a PSRAM block
+static bool psramBlockSize(void* ptr, size_t& size) {
+    std::lock_guard<std::mutex> guard(psramLock);
+    PsramBlock* block = ptr ? psramFind(ptr) : nullptr;
+    if (block == nullptr) return false;
+    size = block->size;
+    return true;
+}
+
+static bool psramRelease(void* ptr) {
+    std::lock_guard<std::mutex> guard(psramLock);
+    PsramBlock* block = ptr ? psramFind(ptr) : nullptr;
+    if (block == nullptr) return false;
+    munmap(block->ptr, block->size);
+    psramUsed -= block->size;
+    block->ptr = nullptr;
+    return true;
+}
+
+static size_t psramFree() {
+    std::lock_guard<std::mutex> guard(psramLock);
+    return psramSize() - psramUsed;
+}
+
+uint32_t EspClass::getFreeHeap() { return internalFree(heapLive.load()); }
+uint32_t EspClass::getMinFreeHeap() { return internalFree(heapHigh.load()); }
+uint32_t EspClass::getPsramSize() { return psramSize(); }
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) return psramAlloc(size);
+    return malloc(size);
+}
+
+void* heap_caps_realloc(void* ptr, size_t size, uint32_t caps) {
+    size_t oldSize = 0;
+    bool fromPsram = psramBlockSize(ptr, oldSize);
+    if (!(caps & MALLOC_CAP_SPIRAM) && !fromPsram) return realloc(ptr, size);
+
+    void* moved = (caps & MALLOC_CAP_SPIRAM) ? psramAlloc(size) : malloc(size);
+    if (moved == nullptr) return nullptr;
+    if (ptr != nullptr) {
+        if (!fromPsram) oldSize = malloc_usable_size(ptr);
+        memcpy(moved, ptr, oldSize < size ? oldSize : size);
+        heap_caps_free(ptr);
+    }
+    return moved;
+}
+
+void heap_caps_free(void* ptr) {
+    if (!psramRelease(ptr)) free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    return (caps & MALLOC_CAP_SPIRAM) ? psramFree() : internalFree(heapLive.load());
+}
+
+// The larger of the biggest hole and the heap left above the arena's last
+// block in use, as no block can be bigger than the free bytes
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    if (caps & MALLOC_CAP_SPIRAM) return psramFree();
+    size_t span = arenaSpan();
+    size_t used = span > bootSpan ? span - bootSpan : 0;
+    size_t largest = used < NATIVE_HEAP_SIZE ? NATIVE_HEAP_SIZE - used : 0;
+    size_t hole = largestBinnedChunk();
+    if (hole > largest) largest = hole;
+    size_t free = internalFree(heapLive.load());
+    return largest < free ? largest : free;
+}
+
+// ---------------------------------------------------------------------------
+// LittleFS: a scratch directory by default, never data/ itself, since the
+// firmware consumes a foods.json it finds there
+
+#define NATIVE_FS_ROOT  ".pio/native_fs"
+
+std::string LittleFSFS::hostPath(const char* path) const {
+    const char* root = getenv("SAFEBITE_FS_ROOT");
+    return std::string(root ? root : NATIVE_FS_ROOT) + path;
+}
+
+bool LittleFSFS::begin(bool) {
+    struct stat st;
+    std::string root = hostPath("");
+    if (stat(root.c_str(), &st) == 0) return S_ISDIR(st.st_mode);
+    return mkdir(root.c_str(), 0755) == 0;  // parent must exist (.pio after a build)
+}
+
+File LittleFSFS::open(const char* path, const char* mode) {
+    const char* m = "rb";
+    if (mode[0] == 'w') m = (mode[1] == '+') ? "w+b" : "wb";
+    else if (mode[0] == 'a') m = (mode[1] == '+') ? "a+b" : "ab";
+    else if (mode[1] == '+') m = "r+b";
+    FILE* fp = fopen(hostPath(path).c_str(), m);
+    return fp ? File(fp) : File();
+}
+
+bool LittleFSFS::exists(const char* path) {
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool LittleFSFS::remove(const char* path) {
+    return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool LittleFSFS::rename(const char* from, const char* to) {
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+// ---------------------------------------------------------------------------
+// Display: fixed 6 px advance, text goes to stdout when SAFEBITE_ECHO_DISPLAY is set
+
+int32_t M5Display::textWidth(const char* s) const {
+    int32_t w = 0;
+    for (; *s; s++) {
+        if (((uint8_t)*s & 0xC0) != 0x80) w += 6;  // count UTF-8 lead bytes only
+    }
+    return w;
+}
+
+int32_t M5Display::textLength(const char* s, int32_t width) const {
+    int32_t w = 0;
+    int32_t i = 0;
+    while (s[i]) {
+        int32_t next = i + 1;
+        while (((uint8_t)s[next] & 0xC0) == 0x80) next++;
+        if (w + 6 > width) break;
+        w += 6;
+        i = next;
+    }
+    return i;
+}
+
+size_t M5Display::write(uint8_t c) {
+    static const bool echo = getenv("SAFEBITE_ECHO_DISPLAY") != nullptr;
+    if (echo) fputc(c, stdout);
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Mic: replays SAFEBITE_MIC_WAV (16-bit mono) in real time, silence when unset
+
+static FILE* micSource = nullptr;
+
+bool M5Mic::begin() {
+    const char* path = getenv("SAFEBITE_MIC_WAV");
+    if (path && !micSource) {
+        micSource = fopen(path, "rb");
+        if (micSource) fseek(micSource, 44, SEEK_SET);
+    }
+    enabled_ = true;
+    return true;
+}
+
+void M5Mic::end() {
+    if (micSource) {
+        fclose(micSource);
+        micSource = nullptr;
+    }
+    enabled_ = false;
+    queued_ = 0;
+}
+
+bool M5Mic::record(int16_t* buf, size_t samples, uint32_t rate) {
+    if (!enabled_) return false;
+    while (isRecording() == 2) delay(1);
+    // Back to back with the buffer ahead of it, as the mic never stops
+    unsigned long start = queued_ > 0 ? queue_[queued_ - 1].dueAt : millis();
+    queue_[queued_++] = { buf, samples, start + (unsigned long)(samples * 1000ULL / rate) };
+    return true;
+}
+
+// Buffers are filled from the WAV file when their time is up
+size_t M5Mic::isRecording() {
+    while (queued_ > 0 && millis() >= queue_[0].dueAt) {
+        Pending& p = queue_[0];
+        size_t got = micSource ? fread(p.buf, sizeof(int16_t), p.samples, micSource) : 0;
+        memset(p.buf + got, 0, (p.samples - got) * sizeof(int16_t));
+        queue_[0] = queue_[1];
+        queued_--;
+    }
+    return queued_;
+}
+
+// ---------------------------------------------------------------------------
+// Buttons: single keys on stdin ('a' = M5, 'b' = side, 'p' = power, 'h' = hold M5),
+// at most one per button per update
+
+void M5UnifiedClass::begin(const config_t&) {
+    int flags = fcntl(STDIN_FILENO, F_GETFL, 0);
+    fcntl(STDIN_FILENO, F_SETFL, flags | O_NONBLOCK);
+}
+
+void M5UnifiedClass::update() {
+    BtnA.clear();
+    BtnB.clear();
+    BtnPWR.clear();
+    char c;
+    ssize_t n;
+    while ((n = ::read(STDIN_FILENO, &c, 1)) == 1) {
+        switch (c) {
+            case 'a': BtnA.press(); break;
+            case 'b': BtnB.press(); break;
+            case 'p': BtnPWR.press(); break;
+            case 'h': BtnA.hold(); break;
+            default: break;
+        }
+    }
+    if (n == 0) {
+        // Scripted sessions (scripts/perf_compare.py) end here, running atexit handlers
+        Serial.println("[HAL] End of input - exiting");
+        exit(0);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// WiFi
+
+// Connected at once: the event goes out from begin(), which wifi_manager only
+// calls with its state already at connecting
+int WiFiClass::begin(const char*, const char*, int32_t, const uint8_t*, bool) {
+    status_ = WL_CONNECTED;
+    if (cb_) {
+        WiFiEventInfo_t info = {0};
+        cb_(ARDUINO_EVENT_WIFI_STA_GOT_IP, info);
+    }
+    return status_;
+}
+
+bool WiFiClass::disconnect(bool wifiOff) {
+    status_ = WL_DISCONNECTED;
+    if (wifiOff) mode_ = WIFI_OFF;
+    return true;
+}
+
+wl_status_t WiFiClass::status() {
+    return status_;
+}
+
+// ---------------------------------------------------------------------------
+// TCP client
+
+int WiFiClientSecure::connect(const char* host, uint16_t port) {
+    stop();
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* res = nullptr;
+    char portStr[8];
+    snprintf(portStr, sizeof(portStr), "%u", port);
+    if (getaddrinfo(host, portStr, &hints, &res) != 0) return 0;
+    for (struct addrinfo* ai = res; ai; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            fd_ = fd;
+            break;
+        }
+        close(fd);
+    }
+    freeaddrinfo(res);
+    rxLen_ = rxPos_ = 0;
+    eof_ = false;
+    return fd_ >= 0 ? 1 : 0;
+}
+
+void WiFiClientSecure::stop() {
+    if (fd_ >= 0) close(fd_);
+    fd_ = -1;
+    rxLen_ = rxPos_ = 0;
+}
+
+bool WiFiClientSecure::fill(unsigned long waitMs) {
+    if (rxPos_ < rxLen_) return true;
+    if (fd_ < 0 || eof_) return false;
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(fd_, &set);
+    struct timeval tv = { (time_t)(waitMs / 1000), (suseconds_t)((waitMs % 1000) * 1000) };
+    if (select(fd_ + 1, &set, nullptr, nullptr, &tv) <= 0) return false;
+    ssize_t n = recv(fd_, rx_, sizeof(rx_), 0);
+    if (n <= 0) {
+        eof_ = true;
+        return false;
+    }
+    rxLen_ = (size_t)n;
+    rxPos_ = 0;
+    return true;
+}
+
+uint8_t WiFiClientSecure::connected() {
+    if (fd_ < 0) return 0;
+    if (rxPos_ < rxLen_) return 1;
+    fill(0);
+    return eof_ ? 0 : 1;
+}
+
+size_t WiFiClientSecure::write(const uint8_t* buf, size_t n) {
+    if (fd_ < 0) return 0;
+    size_t sent = 0;
+    while (sent < n) {
+        ssize_t w = send(fd_, buf + sent, n - sent, MSG_NOSIGNAL);
+        if (w <= 0) break;
+        sent += (size_t)w;
+    }
+    return sent;
+}
+
+int WiFiClientSecure::available() {
+    fill(0);
+    return (int)(rxLen_ - rxPos_);
+}
+
+int WiFiClientSecure::read() {
+    return fill(0) ? rx_[rxPos_++] : -1;
+}
+
+int WiFiClientSecure::read(uint8_t* buf, size_t n) {
+    size_t got = 0;
+    while (got < n && fill(0)) {
+        size_t take = std::min(n - got, rxLen_ - rxPos_);
+        memcpy(buf + got, rx_ + rxPos_, take);
+        rxPos_ += take;
+        got += take;
+    }
+    return (int)got;
+}
+
+int WiFiClientSecure::peek() {
+    return fill(0) ? rx_[rxPos_] : -1;
+}
+
+int WiFiClientSecure::timedRead() {
+    return fill(timeoutMs_) ? rx_[rxPos_++] : -1;
+}
+
+// ---------------------------------------------------------------------------
+// FreeRTOS tasks run as detached threads; there are no cores to pin to
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char*, uint32_t, void* arg,
+                                   UBaseType_t, TaskHandle_t* handle, BaseType_t) {
+    std::thread([fn, arg] { fn(arg); }).detach();
+    if (handle) *handle = nullptr;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr) pthread_exit(nullptr);  // only a task deleting itself is supported
+}
+
+void vTaskDelay(TickType_t ticks) {
+    delay(ticks);  // one tick per ms, as configured on the device
+}
+
+// ---------------------------------------------------------------------------
+// Deep sleep ends the process; wake-up is the next run
+
+int esp_sleep_enable_ext0_wakeup(gpio_num_t, int) { return 0; }
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+    return getenv("SAFEBITE_WAKE") ? ESP_SLEEP_WAKEUP_EXT0 : ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+void esp_deep_sleep_start() {
+    Serial.println("[HAL] Deep sleep - exiting");
+    fflush(stdout);
+    exit(0);
+}
+
+// ---------------------------------------------------------------------------
+// Arduino entry points
+
+void setup();
+void loop();
+
+int main() {
+    setvbuf(stdout, nullptr, _IONBF, 0);
+    setup();
+    for (;;) loop();
+}
@@ -0,0 +1,20 @@
+#ifndef NATIVE_HAL_H
+#define NATIVE_HAL_H
+
+// Host-only extras with no device counterpart, for benchmarks (perf_probe.h)
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct NativeHeapStats {
+    uint32_t allocs;  // malloc, calloc, realloc and new calls since start, all threads
+    size_t   live;    // bytes in use
+    size_t   peak;    // most bytes in use since start or the last nativeHeapSetPeak()
+};
+
+void nativeHeapStats(NativeHeapStats& out);
+
+// Restart the high-water mark from `peak` (usually the current live bytes)
+void nativeHeapSetPeak(size_t peak);
+
+#endif
@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""Run the database benchmark on databases of several sizes.
+
+Usage: python3 scripts/db_bench.py [--import] [PROGRAM]
+
+PROGRAM is the env:db-bench build (default .pio/build/db-bench/program, see
+bench/db_bench.cpp). Each size in SIZES is data/foods.json or generated with
+gen_synthetic_foods.py, compiled with foods_db.py into a scratch filesystem
+root and benchmarked there, along with the old loader on the same JSON; the
+program's "[BENCH]" lines are printed under the size, then the image's load
+time and heap high-water mark as a fraction of the old loader's. Load time
+and record latency may grow with the image, the heap figures should not.
+
+--import times the on-device import instead (see food_db.cpp): data/foods.json
+at 1x, 10x and 100x its size is put on the filesystem as /foods.json, so the
+load includes the import's parse time and heap peak, against the old loader
+on the same file.
+"""
+
+import contextlib
+import io
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import foods_db  # noqa: E402
+import gen_synthetic_foods  # noqa: E402
+
+PROGRAM = os.path.join(".pio", "build", "db-bench", "program")
+
+# (label, foods, categories); foods 0 = data/foods.json as it is
+SIZES = [("foods.json", 0, 0), ("200", 200, 8), ("2k", 2000, 20), ("20k", 20000, 40)]
+
+# --import: data/foods.json repeated this many times, imported on the device
+IMPORT_SCALES = [1, 10, 100]
+
+LOAD_LINE = re.compile(r"\[BENCH\] (image|legacy): .* load ([\d.]+) ms, heap \d+ bytes kept, (\d+) peak")
+
+
+def scaled_foods(scale):
+    """data/foods.json with its foods repeated `scale` times under new names."""
+    with open(os.path.join("data", "foods.json"), encoding="utf-8") as f:
+        db = json.load(f)
+    foods = []
+    for k in range(scale):
+        for food in db["foods"]:
+            copy = dict(food, id=len(foods) + 1)
+            if k:
+                copy["name_pt"] = "%s %d" % (food["name_pt"], k)
+                copy["name_en"] = "%s %d" % (food["name_en"], k)
+            foods.append(copy)
+    db["foods"] = foods
+    return db
+
+
+def run(program, root):
+    env = dict(os.environ, SAFEBITE_FS_ROOT=root, SAFEBITE_LEGACY_JSON="/legacy.json")
+    out = subprocess.run([program], env=env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                         timeout=300).stdout.decode("utf-8", "replace")
+    loads = {}
+    for line in out.splitlines():
+        if line.startswith("[BENCH]") or line.startswith("[DB] Imported"):
+            print("  " + line.split("] ", 1)[1])
+        m = LOAD_LINE.match(line)
+        if m:
+            loads[m.group(1)] = (float(m.group(2)), int(m.group(3)))
+    if "image" in loads and "legacy" in loads and loads["legacy"][0] and loads["legacy"][1]:
+        print("  image/legacy: load time %.3f, heap peak %.3f" % (
+            loads["image"][0] / loads["legacy"][0], loads["image"][1] / loads["legacy"][1]))
+
+
+def main():
+    args = [a for a in sys.argv[1:] if a != "--import"]
+    program = args[0] if args else PROGRAM
+    if not os.path.exists(program):
+        sys.exit("db_bench: %s not found, run 'pio run -e db-bench' first" % program)
+    work = tempfile.mkdtemp(prefix="db_bench_")
+    try:
+        if "--import" in sys.argv:
+            for scale in IMPORT_SCALES:
+                root = os.path.join(work, "%dx" % scale)
+                os.makedirs(root)
+                with open(os.path.join(root, "legacy.json"), "w", encoding="utf-8") as f:
+                    json.dump(scaled_foods(scale), f, ensure_ascii=False)
+                shutil.copy(os.path.join(root, "legacy.json"), os.path.join(root, "foods.json"))
+                print("db_bench: import of foods.json x%d" % scale, flush=True)
+                run(program, root)
+            return 0
+
+        for label, food_count, category_count in SIZES:
+            root = os.path.join(work, label)
+            os.makedirs(root)
+            # Not /foods.json, which the firmware would import
+            src = os.path.join(root, "legacy.json")
+            if food_count:
+                with open(src, "w", encoding="utf-8") as f:
+                    json.dump(gen_synthetic_foods.generate(food_count, category_count, 1), f, ensure_ascii=False)
+            else:
+                shutil.copy(os.path.join("data", "foods.json"), src)
+            with contextlib.redirect_stderr(io.StringIO()):  # duplicate-name warnings of the nonsense names
+                image = foods_db.build(src, os.path.join(root, "foods.bin"))
+            print("db_bench: %s, %d byte image" % (label, len(image)), flush=True)
+            run(program, root)
+    finally:
+        shutil.rmtree(work)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+"""Train the offline food classifier and export it as a C++ weight table.
+
+Usage: food_model.py [foods.json] [ingredients.json] [out.h] [--eval]
+
+The firmware guesses FODMAP level and gluten for foods that are not in the
+database when the cloud classifier cannot be reached (src/food_model.cpp).
+The model is logistic regression over hashed features of the name:
+
+- every word and every trigram of text_norm.query_key(name) is hashed into
+  one of FEATURES buckets (binary features, collisions share a weight)
+- a softmax over 3 outputs gives the FODMAP level (low, moderate, high)
+- a sigmoid over 1 output gives the likelihood of gluten
+
+Examples are every name and alias in foods.json plus model_ingredients.json
+(ingredients and dishes the database does not list). Training is plain SGD
+with L2 over a fixed seed, so the same inputs always give the same table.
+Weights are quantized to int8 with one float scale per output; --eval prints
+5-fold accuracy of the quantized model, folds split by food so no name of a
+held-out food is seen in training.
+"""
+
+import math
+import os
+import random
+import sys
+
+import text_norm
+from foods_db import FODMAP_LEVELS, load_json, mix32
+
+FEATURES = 4096          # hashed buckets, FOOD_MODEL_FEATURES
+OUTPUTS = 4              # FODMAP low, moderate, high logits, then gluten
+TRIGRAM_TAG = 0x10000    # keeps trigram codes (< 37^3) apart from word hashes
+FNV_OFFSET = 0x811C9DC5
+FNV_PRIME = 0x01000193
+
+EPOCHS = 20
+LEARNING_RATE = 0.2
+L2 = 3e-2
+SEED = 20250109
+CONFIDENT = 0.8          # FOOD_MODEL_CONFIDENT, only used by --eval
+
+
+def fnv1a(text):
+    h = FNV_OFFSET
+    for b in text.encode("ascii"):
+        h = ((h ^ b) * FNV_PRIME) & 0xFFFFFFFF
+    return h
+
+
+def features(key):
+    """Sorted unique buckets of the words and trigrams of a query key."""
+    buckets = {mix32(fnv1a(word)) % FEATURES for word in key.split()}
+    buckets.update(mix32(code | TRIGRAM_TAG) % FEATURES for code in text_norm.trigrams(key))
+    return sorted(buckets)
+
+
+def examples(foods_path, extra_path):
+    """(food number, features, FODMAP class 0-2 or None, gluten) per name."""
+    foods = load_json(foods_path)["foods"] + load_json(extra_path)["ingredients"]
+    out = []
+    for number, food in enumerate(foods):
+        level = FODMAP_LEVELS.get(food.get("fodmap", ""))
+        names = [food["name_en"], food["name_pt"]] + list(food.get("aliases", []))
+        for key in sorted({text_norm.query_key(n) for n in names}):
+            if key:
+                out.append((number, features(key), level - 1 if level else None, bool(food.get("gluten"))))
+    return out
+
+
+def softmax(logits):
+    top = max(logits)
+    exps = [math.exp(v - top) for v in logits]
+    total = sum(exps)
+    return [e / total for e in exps]
+
+
+def sigmoid(v):
+    return 1.0 / (1.0 + math.exp(-v)) if v >= 0 else math.exp(v) / (1.0 + math.exp(v))
+
+
+def train(samples):
+    weights = [[0.0] * OUTPUTS for _ in range(FEATURES)]
+    bias = [0.0] * OUTPUTS
+    order = list(range(len(samples)))
+    rng = random.Random(SEED)
+    for _ in range(EPOCHS):
+        rng.shuffle(order)
+        for i in order:
+            _, feats, level, gluten = samples[i]
+            logits = list(bias)
+            for f in feats:
+                for o in range(OUTPUTS):
+                    logits[o] += weights[f][o]
+
+            # Gradients of the cross-entropy losses with respect to the logits
+            grad = [0.0] * OUTPUTS
+            if level is not None:
+                probs = softmax(logits[:3])
+                for o in range(3):
+                    grad[o] = probs[o] - (1.0 if o == level else 0.0)
+            grad[3] = sigmoid(logits[3]) - (1.0 if gluten else 0.0)
+
+            for o in range(OUTPUTS):
+                bias[o] -= LEARNING_RATE * grad[o]
+            for f in feats:
+                w = weights[f]
+                for o in range(OUTPUTS):
+                    w[o] -= LEARNING_RATE * (grad[o] + L2 * w[o])
+    return weights, bias
+
+
+def quantize(weights, bias):
+    """int8 weights and a float scale per output: weight = q * scale."""
+    scales = []
+    for o in range(OUTPUTS):
+        peak = max(abs(w[o]) for w in weights)
+        scales.append(peak / 127 if peak else 1.0)
+    q = [[max(-127, min(127, int(round(w[o] / scales[o])))) for o in range(OUTPUTS)] for w in weights]
+    return q, scales, list(bias)
+
+
+def predict(model, feats):
+    """(FODMAP class, its probability, gluten likelihood) as the firmware computes them."""
+    q, scales, bias = model
+    acc = [0] * OUTPUTS
+    for f in feats:
+        for o in range(OUTPUTS):
+            acc[o] += q[f][o]
+    logits = [acc[o] * scales[o] + bias[o] for o in range(OUTPUTS)]
+    probs = softmax(logits[:3])
+    level = max(range(3), key=lambda o: probs[o])
+    return level, probs[level], sigmoid(logits[3])
+
+
+def evaluate(samples, folds=5):
+    numbers = sorted({s[0] for s in samples})
+    rng = random.Random(SEED)
+    rng.shuffle(numbers)
+    fold_of = {n: i % folds for i, n in enumerate(numbers)}
+    fodmap_ok = gluten_ok = total = confident = confident_ok = 0
+    for k in range(folds):
+        model = quantize(*train([s for s in samples if fold_of[s[0]] != k]))
+        for _, feats, level, gluten in (s for s in samples if fold_of[s[0]] == k):
+            if level is None:
+                continue
+            guess, prob, p_gluten = predict(model, feats)
+            right = guess == level and (p_gluten >= 0.5) == gluten
+            total += 1
+            fodmap_ok += guess == level
+            gluten_ok += (p_gluten >= 0.5) == gluten
+            if min(prob, max(p_gluten, 1 - p_gluten)) >= CONFIDENT:
+                confident += 1
+                confident_ok += right
+    print("food_model: %d-fold over %d names: FODMAP %.0f%%, gluten %.0f%%, "
+          "confident %.0f%% of names with both right in %.0f%%" %
+          (folds, total, 100.0 * fodmap_ok / total, 100.0 * gluten_ok / total,
+           100.0 * confident / total, 100.0 * confident_ok / max(confident, 1)))
+
+
+def render_header(model, sample_count):
+    q, scales, bias = model
+    lines = [
+        "// Generated by scripts/food_model.py from data/foods.json and",
+        "// scripts/model_ingredients.json (%d names) - do not edit." % sample_count,
+        "#ifndef FOOD_MODEL_TABLE_H",
+        "#define FOOD_MODEL_TABLE_H",
+        "",
+        "#include <stdint.h>",
+        "",
+        "#define FOOD_MODEL_FEATURES  %d" % FEATURES,
+        "#define FOOD_MODEL_OUTPUTS   %d   // FODMAP low, moderate, high logits, then gluten" % OUTPUTS,
+        "",
+        "static constexpr float FOOD_MODEL_SCALE[FOOD_MODEL_OUTPUTS] = {%s};" %
+        ", ".join("%.9gf" % s for s in scales),
+        "static constexpr float FOOD_MODEL_BIAS[FOOD_MODEL_OUTPUTS] = {%s};" %
+        ", ".join("%.9gf" % b for b in bias),
+        "",
+        "// Weights of bucket f at [f * FOOD_MODEL_OUTPUTS, (f + 1) * FOOD_MODEL_OUTPUTS)",
+        "static constexpr int8_t FOOD_MODEL_WEIGHTS[FOOD_MODEL_FEATURES * FOOD_MODEL_OUTPUTS] = {",
+    ]
+    flat = [v for row in q for v in row]
+    for i in range(0, len(flat), 16):
+        lines.append("    " + ", ".join("%d" % v for v in flat[i:i + 16]) + ",")
+    lines += ["};", "", "#endif", ""]
+    return "\n".join(lines)
+
+
+def build(foods_path, extra_path, header_path):
+    samples = examples(foods_path, extra_path)
+    model = quantize(*train(samples))
+    with open(header_path, "w", encoding="utf-8") as f:
+        f.write(render_header(model, len(samples)))
+    return len(samples)
+
+
+def build_if_stale(foods_path, extra_path, header_path):
+    """Retrain when the table is missing or older than its inputs (or this script)."""
+    inputs = (foods_path, extra_path, __file__, text_norm.__file__)
+    newest = max(os.path.getmtime(p) for p in inputs)
+    if os.path.exists(header_path) and os.path.getmtime(header_path) >= newest:
+        return False
+    count = build(foods_path, extra_path, header_path)
+    print("food_model: %d names -> %s" % (count, header_path))
+    return True
+
+
+if __name__ == "__main__":
+    args = [a for a in sys.argv[1:] if a != "--eval"]
+    foods_path = args[0] if len(args) > 0 else "data/foods.json"
+    extra_path = args[1] if len(args) > 1 else "scripts/model_ingredients.json"
+    header_path = args[2] if len(args) > 2 else "include/food_model_table.h"
+    try:
+        if "--eval" in sys.argv:
+            evaluate(examples(foods_path, extra_path))
+        count = build(foods_path, extra_path, header_path)
+    except (OSError, ValueError, KeyError) as e:
+        sys.exit("food_model: error: %s" % e)
+    print("food_model: %d names -> %s" % (count, header_path))
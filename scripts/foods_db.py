@@ -0,0 +1,555 @@
+#!/usr/bin/env python3
+"""Compile data/foods.json into the food database read by the firmware.
+
+Usage: python3 scripts/foods_db.py [data/foods.json] [data/foods.bin] [include/foods_table.h]
+
+Two outputs are produced from the same validated records:
+
+- a binary image uploaded to LittleFS (default build), and
+- a C++ header of constexpr Food/Category tables kept in flash
+  (builds with -DFOODDB_PROGMEM).
+
+Image layout (little-endian, see include/food_db.h). The file is a sequence of
+PAGE_SIZE pages so the firmware can read it through a small LRU page cache:
+
+    page 0      header: magic "SBDB", u16 version, u16 page size, u16 food
+                count, u16 category count, u16 foods per page, u16 categories
+                per page, u16 range/category/food first page, u16 page count,
+                u16 section count, u16 flags (0; 1 = imported from JSON on
+                the device), u32 revision; then per
+                optional section: u16 id, u16 first page, u32 size in bytes
+    page 1      u16 first food index per category, plus the food count
+                (foods are sorted by category: category c is [start[c], start[c+1]))
+    categories  record pages of: id\0 name_pt\0 name_en\0
+    foods       record pages of: u8 category, u8 attrs, name_pt\0 name_en\0
+                (attrs = FODMAP level in bits 0-1 | gluten in bit 2)
+    sections    optional indexes, each starting on a page boundary and read
+                as a flat byte range
+
+Sections:
+
+    1 match     trigram inverted index over the normalized names and
+                aliases (see scripts/text_norm.py): u32 key count, u16
+                sorted trigram codes, u32 posting start per key plus the
+                total, u16 food indices (ascending) per key
+    2 ids       u32 count, then (u16 stable id, u16 food index) sorted by id
+    3 alpha     alphabetical order per language (0 = EN, 1 = PT) by
+                text_norm.collate() of the name: u32 food count, u32
+                category count, u16 first food index per category plus the
+                food count, then per language u16 food indices (category c
+                sorted within [start[c], start[c+1])), then per language and
+                category u16 ALPHA_BUCKETS first positions (relative to the
+                category) of keys starting with a digit, then 'a'..'z'
+    4 attrs     attribute bitmaps over the food indices: u32 food count, u32
+                bitmap count, then per bitmap (ATTR_BITMAPS order) u32 words,
+                bit i of word w set when food 32*w + i has the attribute
+    5 exact     minimal perfect hash (hash and displace) over the query keys
+                (text_norm.query_key) of every name and alias: u32 key
+                count n, u32 bucket count, i32 displacement per bucket (> 0:
+                seed, < 0: -1 - slot, 0: empty), then per slot u32 offset
+                of its key in the section and u16 food index, then the keys
+                (ASCII, NUL-terminated) in slot order
+    6 vectors   int8 sketches of the same keys for nearest-neighbour search:
+                u32 key count, u32 dimensions D, u32 food count F, u32
+                first key per food plus the key count (F + 1), then per key
+                (sorted by food) u16 food index, u16 vector norm, D x i8
+                (random +-1 projection of the key's trigram set, scaled to
+                +-127)
+
+Every food has a stable numeric "id" in foods.json, so scripts/foods_delta.py
+can describe an edit as added/modified/deleted records. The revision is a
+CRC-32 of the validated content; a delta names the revision it applies to.
+
+A record page holds a fixed number of records (chosen so that every page fits)
+and starts with a u16 offset per record slot. The last byte of every page is a
+NUL pad so strings always terminate inside their page.
+"""
+
+import bisect
+import json
+import math
+import os
+import struct
+import sys
+import zlib
+
+import text_norm
+
+MAGIC = b"SBDB"
+VERSION = 11
+PAGE_SIZE = 512
+MAX_SECTIONS = 16
+
+SECTION_MATCH = 1
+SECTION_IDS = 2
+SECTION_ALPHA = 3
+SECTION_ATTRS = 4
+SECTION_EXACT = 5
+SECTION_VECTORS = 6
+
+# Exact-name hash (must match src/food_match.cpp)
+FNV_OFFSET = 0x811C9DC5
+FNV_PRIME = 0x01000193
+
+# Trigram sketches (must match src/food_vector.cpp)
+VECTOR_DIMS = 32
+VECTOR_GOLDEN = 0x9E3779B9
+
+ALPHA_LANGS = ("name_en", "name_pt")  # LANG_EN, LANG_PT in include/language.h
+ALPHA_BUCKETS = 27                    # digits, a-z
+
+FODMAP_LEVELS = {"low": 1, "moderate": 2, "high": 3}
+FODMAP_NAMES = ["FODMAP_UNKNOWN", "FODMAP_LOW", "FODMAP_MODERATE", "FODMAP_HIGH"]
+ATTR_GLUTEN = 0x04
+
+# Attribute bitmaps, in FoodBitmap order (include/food_query.h). A new
+# attribute (lactose, nuts) is one more entry here and there; queries are
+# masks over these and need no other change.
+ATTR_BITMAPS = (
+    lambda r: r["fodmap"] == 1,  # FOOD_BITMAP_FODMAP_LOW
+    lambda r: r["fodmap"] == 2,  # FOOD_BITMAP_FODMAP_MODERATE
+    lambda r: r["fodmap"] == 3,  # FOOD_BITMAP_FODMAP_HIGH
+    lambda r: r["gluten"],       # FOOD_BITMAP_GLUTEN
+)
+
+MAX_FOODS = 0xFFFF
+MAX_FOOD_ID = 0xFFFF
+MAX_CATEGORIES = PAGE_SIZE // 2 - 1  # range table must fit one page
+# Longest name in UTF-8 bytes: SCROLL_TEXT_MAX - 1 in include/scroll_text.h,
+# which is also what the device's own importer keeps (JSON_STREAM_TEXT - 1)
+MAX_NAME_BYTES = 127
+
+
+def load_json(path):
+    with open(path, encoding="utf-8") as f:
+        return json.load(f)
+
+
+def check_names(what, names):
+    for name in names:
+        if len(name.encode("utf-8")) > MAX_NAME_BYTES:
+            raise ValueError("%s: name longer than %d bytes: '%s'" % (what, MAX_NAME_BYTES, name))
+
+
+def prepare(db):
+    """Validate foods.json and resolve categories and attributes."""
+    categories = db["categories"]
+    foods = db["foods"]
+
+    if len(categories) > MAX_CATEGORIES:
+        raise ValueError("too many categories: %d (max %d)" % (len(categories), MAX_CATEGORIES))
+    if len(foods) > MAX_FOODS:
+        raise ValueError("too many foods: %d (max %d)" % (len(foods), MAX_FOODS))
+
+    cat_index = {}
+    for i, cat in enumerate(categories):
+        if cat["id"] in cat_index:
+            raise ValueError("duplicate category id '%s'" % cat["id"])
+        check_names("category '%s'" % cat["id"], [cat["name_pt"], cat["name_en"]])
+        cat_index[cat["id"]] = i
+
+    rows = []
+    ids = set()
+    for food in foods:
+        food_id = food.get("id")
+        if not isinstance(food_id, int) or not 1 <= food_id <= MAX_FOOD_ID:
+            raise ValueError("food '%s' needs an integer id in 1..%d" % (food["name_en"], MAX_FOOD_ID))
+        if food_id in ids:
+            raise ValueError("duplicate food id %d" % food_id)
+        ids.add(food_id)
+        if food["category"] not in cat_index:
+            raise ValueError("food '%s' has unknown category '%s'" % (food["name_en"], food["category"]))
+        level = FODMAP_LEVELS.get(food.get("fodmap", ""), 0)
+        if level == 0:
+            print("foods_db: warning: '%s' has no FODMAP level" % food["name_en"], file=sys.stderr)
+        aliases = food.get("aliases", [])
+        if not isinstance(aliases, list) or not all(isinstance(a, str) and a for a in aliases):
+            raise ValueError("food '%s': aliases must be a list of names" % food["name_en"])
+        check_names("food %d" % food_id, [food["name_pt"], food["name_en"]] + aliases)
+        rows.append({
+            "id": food_id,
+            "name_pt": food["name_pt"],
+            "name_en": food["name_en"],
+            "aliases": aliases,
+            "category": cat_index[food["category"]],
+            "fodmap": level,
+            "gluten": bool(food.get("gluten")),
+        })
+
+    # Group by category (stable, so foods.json order is kept inside a category)
+    rows.sort(key=lambda r: r["category"])
+    return categories, rows
+
+
+def revision_of(categories, rows):
+    """Content revision: CRC-32 of the validated records, in image order."""
+    canonical = json.dumps([categories, rows], sort_keys=True, ensure_ascii=False)
+    return zlib.crc32(canonical.encode("utf-8"))
+
+
+def category_starts(categories, rows):
+    starts = [0] * (len(categories) + 1)
+    for r in rows:
+        starts[r["category"] + 1] += 1
+    for i in range(len(categories)):
+        starts[i + 1] += starts[i]
+    return starts
+
+
+def attrs_of(row):
+    return row["fodmap"] | (ATTR_GLUTEN if row["gluten"] else 0)
+
+
+def cstr(text):
+    return text.encode("utf-8") + b"\0"
+
+
+def fits(records, per_page):
+    for i in range(0, len(records), per_page):
+        chunk = records[i:i + per_page]
+        if 2 * per_page + sum(len(r) for r in chunk) > PAGE_SIZE - 1:
+            return False
+    return True
+
+
+def records_per_page(records):
+    """Largest fixed record count per page for which every page fits."""
+    if not records:
+        return 1
+    per_page = max(1, min(len(records), (PAGE_SIZE - 1) // 4))
+    while per_page > 1 and not fits(records, per_page):
+        per_page -= 1
+    if not fits(records, per_page):
+        raise ValueError("record too large for a %d-byte page" % PAGE_SIZE)
+    return per_page
+
+
+def pack_pages(records, per_page):
+    pages = bytearray()
+    for i in range(0, len(records), per_page):
+        chunk = records[i:i + per_page]
+        offsets, body = [], bytearray()
+        for rec in chunk:
+            offsets.append(2 * per_page + len(body))
+            body += rec
+        offsets += [2 * per_page] * (per_page - len(chunk))  # unused slots
+        page = struct.pack("<%dH" % per_page, *offsets) + body
+        pages += page + bytes(PAGE_SIZE - len(page))
+    return pages
+
+
+def match_index(rows):
+    """Trigram -> foods whose PT or EN name or an alias contains it."""
+    postings = {}
+    for i, r in enumerate(rows):
+        codes = set()
+        for name in [r["name_pt"], r["name_en"]] + r["aliases"]:
+            codes.update(text_norm.trigrams(text_norm.normalize(name)))
+        for code in codes:
+            postings.setdefault(code, []).append(i)
+
+    keys = sorted(postings)
+    starts, flat = [], []
+    for key in keys:
+        starts.append(len(flat))
+        flat += postings[key]
+    starts.append(len(flat))
+    return (struct.pack("<I", len(keys)) + struct.pack("<%dH" % len(keys), *keys) +
+            struct.pack("<%dI" % len(starts), *starts) + struct.pack("<%dH" % len(flat), *flat))
+
+
+def id_index(rows):
+    """(stable id, food index) pairs sorted by id."""
+    pairs = sorted((r["id"], i) for i, r in enumerate(rows))
+    out = struct.pack("<I", len(pairs))
+    for food_id, index in pairs:
+        out += struct.pack("<HH", food_id, index)
+    return out
+
+
+def alpha_index(categories, rows):
+    """Per language, each category's foods in collation order, plus letter offsets."""
+    starts = category_starts(categories, rows)
+    orders, buckets = [], []
+    for field in ALPHA_LANGS:
+        for c in range(len(categories)):
+            span = range(starts[c], starts[c + 1])
+            keyed = sorted((text_norm.collate(rows[i][field]), i) for i in span)
+            orders += [i for _, i in keyed]
+            keys = [key for key, _ in keyed]
+            buckets.append(0)  # digits sort first
+            buckets += [bisect.bisect_left(keys, chr(ord("a") + b)) for b in range(ALPHA_BUCKETS - 1)]
+    return (struct.pack("<II", len(rows), len(categories)) +
+            struct.pack("<%dH" % len(starts), *starts) +
+            struct.pack("<%dH" % len(orders), *orders) +
+            struct.pack("<%dH" % len(buckets), *buckets))
+
+
+def attr_bitmaps(rows):
+    """One bitmap per ATTR_BITMAPS entry, 32 foods per word."""
+    words = (len(rows) + 31) // 32
+    out = struct.pack("<II", len(rows), len(ATTR_BITMAPS))
+    for has in ATTR_BITMAPS:
+        bits = [0] * words
+        for i, r in enumerate(rows):
+            if has(r):
+                bits[i // 32] |= 1 << (i % 32)
+        out += struct.pack("<%dI" % words, *bits)
+    return out
+
+
+def key_hash(seed, key):
+    """FNV-1a with the offset basis mixed with a seed."""
+    h = FNV_OFFSET ^ seed
+    for b in key.encode("ascii"):
+        h = ((h ^ b) * FNV_PRIME) & 0xFFFFFFFF
+    return h
+
+
+def exact_keys(rows):
+    """Query key -> food index; keys shared by different foods are left out."""
+    owners = {}
+    for i, r in enumerate(rows):
+        for name in [r["name_pt"], r["name_en"]] + r["aliases"]:
+            key = text_norm.query_key(name)
+            if key:
+                owners.setdefault(key, set()).add(i)
+    keys = {}
+    for key, foods in sorted(owners.items()):
+        if len(foods) == 1:
+            keys[key] = foods.pop()
+        else:
+            names = ", ".join(sorted(rows[i]["name_en"] for i in foods))
+            print("foods_db: warning: '%s' names several foods (%s), left to the fuzzy matcher" % (key, names),
+                  file=sys.stderr)
+    return keys
+
+
+def exact_index(rows):
+    """Minimal perfect hash over the query keys: one slot per key."""
+    keys = exact_keys(rows)
+    n = len(keys)
+    buckets = [[] for _ in range(n)]
+    for key in keys:
+        buckets[key_hash(0, key) % n].append(key)
+
+    displace = [0] * n
+    slots = [None] * n
+    # Largest buckets first, each with the first seed that lands all its keys on free slots
+    for b in sorted(range(n), key=lambda b: -len(buckets[b])):
+        bucket = buckets[b]
+        if len(bucket) <= 1:
+            break
+        seed = 1
+        while True:
+            taken = [key_hash(seed, key) % n for key in bucket]
+            if len(set(taken)) == len(taken) and all(slots[s] is None for s in taken):
+                break
+            seed += 1
+        displace[b] = seed
+        for key, s in zip(bucket, taken):
+            slots[s] = key
+    # Single keys go straight to the remaining slots
+    free = [s for s in range(n) if slots[s] is None]
+    for b in range(n):
+        if len(buckets[b]) == 1:
+            s = free.pop()
+            displace[b] = -1 - s
+            slots[s] = buckets[b][0]
+
+    # The keys themselves, so the device compares the string it hashed
+    out = struct.pack("<II", n, n) + struct.pack("<%di" % n, *displace)
+    keys_at = len(out) + n * 4 + n * 2
+    blob = bytearray()
+    for key in slots:
+        out += struct.pack("<I", keys_at + len(blob))
+        blob += key.encode("ascii") + b"\0"
+    for key in slots:
+        out += struct.pack("<H", keys[key])
+    return out + bytes(blob)
+
+
+def mix32(x):
+    """Murmur3 finalizer."""
+    x ^= x >> 16
+    x = (x * 0x85EBCA6B) & 0xFFFFFFFF
+    x ^= x >> 13
+    x = (x * 0xC2B2AE35) & 0xFFFFFFFF
+    return x ^ (x >> 16)
+
+
+def sketch(codes, dims=VECTOR_DIMS):
+    """Sum of a pseudo-random +-1 vector per trigram, scaled to int8."""
+    acc = [0] * dims
+    for code in codes:
+        for word in range((dims + 31) // 32):
+            bits = mix32((code + word * VECTOR_GOLDEN) & 0xFFFFFFFF)
+            for j in range(word * 32, min(dims, word * 32 + 32)):
+                acc[j] += 1 if bits >> (j % 32) & 1 else -1
+    peak = max(abs(v) for v in acc)
+    if peak == 0:
+        return None
+    # Round half away from zero, in integers (as the firmware does)
+    return [(2 * 127 * v + peak) // (2 * peak) if v >= 0 else -((2 * 127 * -v + peak) // (2 * peak)) for v in acc]
+
+
+def vector_index(rows):
+    """Sketch of every distinct (query key, food) of names and aliases."""
+    pairs = set()
+    for i, r in enumerate(rows):
+        for name in [r["name_pt"], r["name_en"]] + r["aliases"]:
+            key = text_norm.query_key(name)
+            if key:
+                pairs.add((key, i))
+    keys = bytearray()
+    first = [0] * (len(rows) + 1)
+    count = 0
+    for key, food in sorted(pairs, key=lambda p: (p[1], p[0])):
+        vec = sketch(text_norm.trigrams(key))
+        if vec is None:
+            continue
+        norm = round(math.sqrt(sum(v * v for v in vec)))
+        keys += struct.pack("<HH%db" % VECTOR_DIMS, food, norm, *vec)
+        count += 1
+        first[food + 1] = count
+    for i in range(1, len(first)):
+        first[i] = max(first[i], first[i - 1])
+    return (struct.pack("<III", count, VECTOR_DIMS, len(rows)) + struct.pack("<%dI" % len(first), *first) +
+            bytes(keys))
+
+
+def sections_of(categories, rows):
+    sections = [(SECTION_MATCH, match_index(rows)), (SECTION_IDS, id_index(rows)),
+                (SECTION_ALPHA, alpha_index(categories, rows)), (SECTION_ATTRS, attr_bitmaps(rows)),
+                (SECTION_EXACT, exact_index(rows)), (SECTION_VECTORS, vector_index(rows))]
+    assert len(sections) <= MAX_SECTIONS
+    return sections
+
+
+def compile_db(db):
+    categories, rows = prepare(db)
+
+    cat_records = [cstr(c["id"]) + cstr(c["name_pt"]) + cstr(c["name_en"]) for c in categories]
+    food_records = [bytes([r["category"], attrs_of(r)]) + cstr(r["name_pt"]) + cstr(r["name_en"])
+                    for r in rows]
+    cats_per_page = records_per_page(cat_records)
+    foods_per_page = records_per_page(food_records)
+    cat_pages = pack_pages(cat_records, cats_per_page)
+    food_pages = pack_pages(food_records, foods_per_page)
+
+    range_page = 1
+    category_page = range_page + 1
+    food_page = category_page + len(cat_pages) // PAGE_SIZE
+    page_count = food_page + len(food_pages) // PAGE_SIZE
+
+    sections = sections_of(categories, rows)
+    section_table, section_pages = bytearray(), bytearray()
+    for section_id, data in sections:
+        section_table += struct.pack("<HHI", section_id, page_count, len(data))
+        padded = data + bytes(-len(data) % PAGE_SIZE)
+        section_pages += padded
+        page_count += len(padded) // PAGE_SIZE
+    if page_count > 0xFFFF:
+        raise ValueError("database image too large: %d pages" % page_count)
+
+    header = struct.pack("<4s12HI", MAGIC, VERSION, PAGE_SIZE, len(rows), len(categories),
+                         foods_per_page, cats_per_page, range_page, category_page, food_page,
+                         page_count, len(sections), 0, revision_of(categories, rows)) + section_table
+    starts = category_starts(categories, rows)
+    ranges = struct.pack("<%dH" % len(starts), *starts)
+
+    out = bytearray()
+    out += header + bytes(PAGE_SIZE - len(header))
+    out += ranges + bytes(PAGE_SIZE - len(ranges))
+    out += cat_pages
+    out += food_pages
+    out += section_pages
+    return bytes(out)
+
+
+def c_string(text):
+    return '"' + text.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def category_enum(cat):
+    return "CATEGORY_" + "".join(ch if ch.isalnum() else "_" for ch in cat["id"].upper())
+
+
+def render_header(db):
+    categories, rows = prepare(db)
+    enums = [category_enum(c) for c in categories]
+
+    lines = [
+        "// Generated by scripts/foods_db.py from data/foods.json - do not edit.",
+        "// Used instead of /foods.bin when building with -DFOODDB_PROGMEM.",
+        "#ifndef FOODS_TABLE_H",
+        "#define FOODS_TABLE_H",
+        "",
+        '#include "food_db.h"',
+        "",
+        "#define FOODDB_REVISION 0x%08xu" % revision_of(categories, rows),
+        "",
+        "enum FoodCategoryId : uint8_t {",
+    ]
+    lines += ["    %s," % name for name in enums]
+    lines += ["};", "", "static constexpr Category FOODDB_CATEGORIES[] = {"]
+    for cat in categories:
+        lines.append("    {%s, %s, %s}," % (c_string(cat["id"]), c_string(cat["name_pt"]), c_string(cat["name_en"])))
+    starts = category_starts(categories, rows)
+    lines += ["};", "", "// Foods of category c are [FOODDB_CATEGORY_START[c], FOODDB_CATEGORY_START[c + 1])",
+              "static constexpr uint16_t FOODDB_CATEGORY_START[] = {",
+              "    " + ", ".join(str(s) for s in starts) + ","]
+    lines += ["};", "", "static constexpr Food FOODDB_FOODS[] = {"]
+    for r in rows:
+        attrs = FODMAP_NAMES[r["fodmap"]] + (" | FOOD_ATTR_GLUTEN" if r["gluten"] else "")
+        lines.append("    {%s, %s, %s, %s}," % (c_string(r["name_pt"]), c_string(r["name_en"]),
+                                               enums[r["category"]], attrs))
+    lines += ["};", ""]
+
+    # Optional sections as raw byte arrays, same contents as in the image
+    sections = sections_of(categories, rows)
+    lines += ["struct FoodDbBlob {", "    uint16_t       id;", "    const uint8_t* data;",
+              "    uint32_t       size;", "};", ""]
+    for section_id, data in sections:
+        lines.append("static constexpr uint8_t FOODDB_SECTION_%d[] = {" % section_id)
+        for i in range(0, len(data), 16):
+            lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+        lines += ["};", ""]
+    lines.append("static constexpr FoodDbBlob FOODDB_SECTIONS[] = {")
+    for section_id, data in sections:
+        lines.append("    {%d, FOODDB_SECTION_%d, sizeof(FOODDB_SECTION_%d)}," % (section_id, section_id, section_id))
+    lines += ["};", "", "#endif", ""]
+    return "\n".join(lines)
+
+
+def build(src, image_path, header_path=None):
+    db = load_json(src)
+    image = compile_db(db)
+    with open(image_path, "wb") as f:
+        f.write(image)
+    if header_path:
+        with open(header_path, "w", encoding="utf-8") as f:
+            f.write(render_header(db))
+    return image
+
+
+def build_if_stale(src, image_path, header_path=None):
+    """Rebuild outputs when missing or older than src (or this script)."""
+    outputs = [p for p in (image_path, header_path) if p]
+    newest = max(os.path.getmtime(src), os.path.getmtime(__file__), os.path.getmtime(text_norm.__file__))
+    if all(os.path.exists(p) and os.path.getmtime(p) >= newest for p in outputs):
+        return False
+    image = build(src, image_path, header_path)
+    print("foods_db: %s -> %s (%d bytes)" % (src, ", ".join(outputs), len(image)))
+    return True
+
+
+if __name__ == "__main__":
+    src = sys.argv[1] if len(sys.argv) > 1 else "data/foods.json"
+    dst = sys.argv[2] if len(sys.argv) > 2 else "data/foods.bin"
+    header = sys.argv[3] if len(sys.argv) > 3 else None
+    try:
+        image = build(src, dst, header)
+    except (OSError, ValueError, KeyError) as e:
+        sys.exit("foods_db: error: %s" % e)
+    print("foods_db: %s -> %s (%d bytes)" % (src, dst, len(image)))
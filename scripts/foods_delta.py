@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""Incremental food database updates.
+
+Usage:
+    python3 scripts/foods_delta.py make OLD.json NEW.json OUTDIR
+    python3 scripts/foods_delta.py send DELTA PORT [BAUD]
+
+make    compares two versions of foods.json by stable food id and writes
+        OUTDIR/<old revision>.sbdelta. Serve OUTDIR over HTTP (for example
+        `python3 -m http.server 8000 --directory OUTDIR`) and set
+        DB_UPDATE_HOST in include/config.h: the device asks for the delta of
+        its current revision whenever it comes online.
+send    pushes a delta over the serial port (needs pyserial, which ships with
+        PlatformIO).
+
+The device keeps the uploaded foods.bin untouched and merges deltas into a
+small overlay file, so an update costs flash writes proportional to the
+records that changed. Category and alias changes need a full
+`pio run --target uploadfs`. Both versions are validated as foods_db.py
+does, so a name the screen cannot hold is refused here too.
+
+Delta layout (little-endian):
+
+    magic "SBDP", u16 format version, u16 op count, u32 from revision,
+    u32 to revision, then per op:
+        'A' add / 'M' modify: u8 op, u16 id, u8 category, u8 attrs,
+                              name_pt\\0 name_en\\0
+        'D' delete:           u8 op, u16 id
+    u32 CRC-32 of everything before it
+"""
+
+import os
+import struct
+import sys
+import time
+import zlib
+
+import foods_db
+
+DELTA_MAGIC = b"SBDP"
+DELTA_VERSION = 1
+SERIAL_CHUNK = 256  # must match DB_UPDATE_CHUNK in include/db_update.h
+
+
+def record_of(row):
+    return (bytes([row["category"], foods_db.attrs_of(row)]) +
+            foods_db.cstr(row["name_pt"]) + foods_db.cstr(row["name_en"]))
+
+
+def make_delta(old_db, new_db):
+    old_cats, old_rows = foods_db.prepare(old_db)
+    new_cats, new_rows = foods_db.prepare(new_db)
+    if old_cats != new_cats:
+        raise ValueError("categories changed: upload the full image with `pio run --target uploadfs`")
+    # Aliases live only in the image's indexes: a food may come or go, but
+    # one that stays keeps its aliases, and a new one has none
+    old_aliases = {r["id"]: r["aliases"] for r in old_rows}
+    if any(r["aliases"] != old_aliases.get(r["id"], []) for r in new_rows):
+        raise ValueError("aliases changed: upload the full image with `pio run --target uploadfs`")
+
+    old = {r["id"]: r for r in old_rows}
+    new = {r["id"]: r for r in new_rows}
+    ops = []
+    for food_id in sorted(old.keys() - new.keys()):
+        ops.append(struct.pack("<cH", b"D", food_id))
+    for food_id in sorted(new.keys()):
+        if food_id not in old:
+            ops.append(struct.pack("<cH", b"A", food_id) + record_of(new[food_id]))
+        elif record_of(old[food_id]) != record_of(new[food_id]):
+            ops.append(struct.pack("<cH", b"M", food_id) + record_of(new[food_id]))
+
+    body = struct.pack("<4sHHII", DELTA_MAGIC, DELTA_VERSION, len(ops),
+                       foods_db.revision_of(old_cats, old_rows),
+                       foods_db.revision_of(new_cats, new_rows)) + b"".join(ops)
+    return body + struct.pack("<I", zlib.crc32(body)), len(ops)
+
+
+def make(old_path, new_path, out_dir):
+    delta, count = make_delta(foods_db.load_json(old_path), foods_db.load_json(new_path))
+    from_rev = struct.unpack_from("<I", delta, 8)[0]
+    os.makedirs(out_dir, exist_ok=True)
+    path = os.path.join(out_dir, "%08x.sbdelta" % from_rev)
+    with open(path, "wb") as f:
+        f.write(delta)
+    print("foods_delta: %d change(s), %d bytes -> %s" % (count, len(delta), path))
+
+
+def wait_reply(port, prefix, timeout=10.0):
+    """Next "DBPATCH ..." line from the device (log lines are skipped)."""
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        line = port.readline().decode("utf-8", "replace").strip()
+        if line.startswith("DBPATCH "):
+            if line.startswith("DBPATCH ERR"):
+                raise RuntimeError(line[len("DBPATCH "):])
+            if line.startswith(prefix):
+                return line
+    raise RuntimeError("no '%s' from device" % prefix)
+
+
+def send(delta_path, port_name, baud=115200):
+    import serial  # pyserial, bundled with PlatformIO
+
+    with open(delta_path, "rb") as f:
+        delta = f.read()
+    with serial.Serial(port_name, baud, timeout=1) as port:
+        port.write(b"DBPATCH %d\n" % len(delta))
+        wait_reply(port, "DBPATCH READY")
+        for i in range(0, len(delta), SERIAL_CHUNK):
+            port.write(delta[i:i + SERIAL_CHUNK])
+            wait_reply(port, "DBPATCH ACK")
+        print("foods_delta: %s" % wait_reply(port, "DBPATCH OK", timeout=30))
+
+
+if __name__ == "__main__":
+    try:
+        if len(sys.argv) == 5 and sys.argv[1] == "make":
+            make(sys.argv[2], sys.argv[3], sys.argv[4])
+        elif len(sys.argv) in (4, 5) and sys.argv[1] == "send":
+            send(sys.argv[2], sys.argv[3], int(sys.argv[4]) if len(sys.argv) == 5 else 115200)
+        else:
+            sys.exit(__doc__.strip())
+    except (OSError, ValueError, KeyError, RuntimeError) as e:
+        sys.exit("foods_delta: error: %s" % e)
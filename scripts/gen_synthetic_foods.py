@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""Generate a synthetic foods.json of arbitrary size for scale testing.
+
+Usage: python3 scripts/gen_synthetic_foods.py FOODS [CATEGORIES] [SEED] > foods.json
+
+Names are pronounceable nonsense built from PT/EN syllables, with accents, so
+the database, pager and text matching see realistic string lengths.
+"""
+
+import json
+import random
+import sys
+
+SYLLABLES_PT = ["ba", "ça", "da", "fei", "jão", "lã", "ma", "nha", "pão", "que",
+                "ra", "sé", "ta", "vo", "xi", "zé", "gri", "lho", "mó", "cou"]
+SYLLABLES_EN = ["ap", "ber", "car", "dor", "el", "fin", "gle", "ham", "ip", "jor",
+                "kel", "lo", "mun", "nut", "or", "pe", "qua", "ry", "son", "tu"]
+FODMAP = ["low", "low", "low", "moderate", "high"]
+
+
+def word(rng, syllables):
+    return "".join(rng.choice(syllables) for _ in range(rng.randint(2, 4)))
+
+
+def name(rng, syllables):
+    words = [word(rng, syllables) for _ in range(rng.randint(1, 3))]
+    return " ".join(words).capitalize()
+
+
+def generate(food_count, category_count, seed):
+    rng = random.Random(seed)
+    categories = []
+    for i in range(category_count):
+        categories.append({
+            "id": "cat%02d" % i,
+            "name_pt": "%s %d" % (name(rng, SYLLABLES_PT), i),
+            "name_en": "%s %d" % (name(rng, SYLLABLES_EN), i),
+        })
+    foods = []
+    for i in range(food_count):
+        foods.append({
+            "id": i + 1,
+            "name_pt": name(rng, SYLLABLES_PT),
+            "name_en": name(rng, SYLLABLES_EN),
+            "category": rng.choice(categories)["id"],
+            "fodmap": rng.choice(FODMAP),
+            "gluten": rng.random() < 0.2,
+        })
+    return {"version": "synthetic", "categories": categories, "foods": foods}
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        sys.exit(__doc__.strip())
+    food_count = int(sys.argv[1])
+    category_count = int(sys.argv[2]) if len(sys.argv) > 2 else 8
+    seed = int(sys.argv[3]) if len(sys.argv) > 3 else 1
+    json.dump(generate(food_count, category_count, seed), sys.stdout, ensure_ascii=False, indent=1)
+    sys.stdout.write("\n")
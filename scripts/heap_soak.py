@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+"""Run voice queries against the mock Mistral and watch the heap.
+
+Usage: python3 scripts/heap_soak.py [--queries 100] [--no-psram] [PROGRAM]
+
+PROGRAM is the env:native build (default .pio/build/native/program), built
+with the config.h of the README's mock section (credentials and MISTRAL_HOST
+"127.0.0.1"). The mock is started on its MISTRAL_PORT. It answers in turn
+with a food in the database, which the device settles locally, and a new
+dish every time, which goes to the classifier. So every other query opens
+both connections.
+
+The mic plays a generated one-word query. After each query the firmware logs
+"[VOICE] Query done. Free heap: F, largest block: L", where the native HAL
+reports glibc's own figures for an ESP32-sized heap. The first query sets up
+what stays (the capture ring, the classify cache). The run fails (exit 1)
+when the largest block then moves by more than TOLERANCE over the rest, or
+when either the local match or the classifier never answered.
+"""
+
+import argparse
+import math
+import os
+import queue
+import random
+import re
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import foods_db  # noqa: E402
+
+PROGRAM = os.path.join(".pio", "build", "native", "program")
+MOCK = os.path.join(os.path.dirname(os.path.abspath(__file__)), "mock_mistral.py")
+TEXTS = ["banana", "mystery stew {n}"]
+TOLERANCE = 1024       # bytes the largest block may move after the first query
+PSRAM = 2 * 1024 * 1024
+QUERY_TIMEOUT = 30.0   # s from the key to "Query done"
+ERROR_WAIT = 2.7       # s an error screen blocks the loop before the main menu
+KEY_DELAY = 0.3        # s: the firmware loop reads buttons every 50 ms
+RATE = 16000
+
+DONE_LINE = re.compile(r"\[VOICE\] Query done\. Free heap: (\d+), largest block: (\d+)")
+LOCAL_LINE = re.compile(r"\[VOICE\] Local answer")
+LLM_LINE = re.compile(r"\[LLM\] Response")
+PORT_LINE = re.compile(r"#define\s+MISTRAL_PORT\s+(\d+)")
+
+
+def mock_port():
+    try:
+        with open(os.path.join("include", "config.h"), encoding="utf-8") as f:
+            config = f.read()
+    except OSError:
+        config = ""
+    if "WIFI_SSID" not in config or "MISTRAL_HOST" not in config:
+        sys.exit("heap_soak: include/config.h needs the mock settings of the README")
+    m = PORT_LINE.search(config)
+    return int(m.group(1)) if m else 443
+
+
+def write_query_wav(path):
+    # 0.5 s of room noise, 0.6 s of a voiced vowel (140 Hz and its harmonics
+    # under a smooth envelope), then noise until the VAD ends the query
+    rng = random.Random(1)
+    samples = []
+    for i in range(int(RATE * 2.5)):
+        t = i / RATE
+        value = rng.gauss(0, 40)
+        if 0.5 <= t < 1.1:
+            envelope = math.sin(math.pi * (t - 0.5) / 0.6)
+            voiced = sum(math.sin(2 * math.pi * 140 * h * t) / h for h in range(1, 20))
+            value += 5000 * envelope * voiced
+        samples.append(max(-32768, min(32767, int(value))))
+    data = struct.pack("<%dh" % len(samples), *samples)
+    with open(path, "wb") as f:
+        f.write(b"RIFF" + struct.pack("<I", 36 + len(data)) + b"WAVE")
+        f.write(b"fmt " + struct.pack("<IHHIIHH", 16, 1, 1, RATE, RATE * 2, 2, 16))
+        f.write(b"data" + struct.pack("<I", len(data)) + data)
+
+
+def reader(stream, lines):
+    for raw in stream:
+        lines.put(raw.decode("utf-8", "replace"))
+    lines.put(None)
+
+
+def wait_done(lines, deadline):
+    """(free, largest, answer) of the next finished query, None at a timeout.
+    answer is "local", "classifier" or None when the query ended in an error."""
+    answer = None
+    while True:
+        try:
+            line = lines.get(timeout=max(0.0, deadline - time.monotonic()))
+        except queue.Empty:
+            return None
+        if line is None:
+            sys.exit("heap_soak: the program ended")
+        if LOCAL_LINE.search(line):
+            answer = "local"
+        elif LLM_LINE.search(line):
+            answer = "classifier"
+        m = DONE_LINE.search(line)
+        if m:
+            return int(m.group(1)), int(m.group(2)), answer
+
+
+def soak(program, queries, psram, port, work):
+    root = os.path.join(work, "fs")
+    os.makedirs(root)
+    foods_db.build(os.path.join("data", "foods.json"), os.path.join(root, "foods.bin"), None)
+    wav = os.path.join(work, "query.wav")
+    write_query_wav(wav)
+
+    mock_args = [sys.executable, MOCK, "--port", str(port), "--delay", "0.05"]
+    for text in TEXTS:
+        mock_args += ["--text", text]
+    mock = subprocess.Popen(mock_args, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+    # No per-thread caches in glibc, so a freed block reads as free
+    env = dict(os.environ, SAFEBITE_FS_ROOT=root, SAFEBITE_MIC_WAV=wav,
+               GLIBC_TUNABLES="glibc.malloc.tcache_count=0")
+    env.pop("SAFEBITE_WAKE", None)
+    if psram:
+        env["SAFEBITE_PSRAM"] = str(PSRAM)
+    else:
+        env.pop("SAFEBITE_PSRAM", None)
+    proc = subprocess.Popen([program], stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT, env=env)
+    lines = queue.Queue()
+    threading.Thread(target=reader, args=(proc.stdout, lines), daemon=True).start()
+
+    samples = []
+    answers = {"local": 0, "classifier": 0, None: 0}
+    try:
+        time.sleep(1.0)  # boot, database load, WiFi
+        for n in range(queries):
+            proc.stdin.write(b"a")  # Voice Search leads the main menu when online
+            proc.stdin.flush()
+            done = wait_done(lines, time.monotonic() + QUERY_TIMEOUT)
+            if done is None:
+                sys.exit("heap_soak: query %d did not finish in %.0f s" % (n + 1, QUERY_TIMEOUT))
+            free, largest, answer = done
+            samples.append((free, largest))
+            answers[answer] += 1
+            if (n + 1) % 10 == 0 or n == 0:
+                print("heap_soak: query %3d: free %6d, largest block %6d" % (n + 1, free, largest),
+                      flush=True)
+            if answer is None:
+                time.sleep(ERROR_WAIT)  # back on the main menu by itself
+            proc.stdin.write(b"b")  # result -> main menu (nothing on the main menu)
+            proc.stdin.flush()
+            time.sleep(KEY_DELAY)
+    finally:
+        proc.stdin.close()
+        proc.wait(timeout=30)
+        mock.terminate()
+        mock.wait()
+    return samples, answers
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("program", nargs="?", default=PROGRAM)
+    parser.add_argument("--queries", type=int, default=100)
+    parser.add_argument("--no-psram", action="store_true",
+                        help="record to LittleFS and upload after recording")
+    args = parser.parse_args()
+    if not os.path.exists(args.program):
+        sys.exit("heap_soak: %s not found, run 'pio run -e native' first" % args.program)
+    if args.queries < 2:
+        sys.exit("heap_soak: needs at least 2 queries")
+
+    work = tempfile.mkdtemp(prefix="soak_")
+    try:
+        samples, answers = soak(args.program, args.queries, not args.no_psram, mock_port(), work)
+    finally:
+        shutil.rmtree(work)
+
+    print("heap_soak: %d answered locally, %d by the classifier, %d errors"
+          % (answers["local"], answers["classifier"], answers[None]))
+    if not answers["local"] or not answers["classifier"]:
+        # e.g. a JSON library that returns no transcript: the heavy paths never ran
+        print("heap_soak: both the local match and the classifier must answer")
+        return 1
+
+    largest = [s[1] for s in samples[1:]]
+    free = [s[0] for s in samples[1:]]
+    spread = max(largest) - min(largest)
+    print("heap_soak: after query 1: largest block %d..%d (first %d, last %d), free heap %d..%d"
+          % (min(largest), max(largest), largest[0], largest[-1], min(free), max(free)))
+    if spread > TOLERANCE:
+        print("heap_soak: largest block moved by %d bytes over %d queries" % (spread, len(largest)))
+        return 1
+    print("heap_soak: ok, flat within %d bytes" % TOLERANCE)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
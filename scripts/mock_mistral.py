@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""Local stand-in for the two Mistral endpoints the device calls.
+
+Usage:
+    python3 scripts/mock_mistral.py [--port 8000] [--text "banana" ...]
+                                    [--delay 0.3] [--save-dir DIR]
+                                    [--no-chunked] [--cert CERT --key KEY]
+
+POST /v1/audio/transcriptions takes the multipart upload with either a
+Content-Length or a chunked body (the device streams it while recording),
+checks that the file part is FLAC or WAV and answers {"text": TEXT} after
+DELAY seconds of "processing". With several --text the answers take turns,
+and "{n}" in a text becomes the number of the upload, so it is new every
+time. Each chunk is logged with its arrival time, and the request with the
+time from its last byte to the answer, so the latency left after the user
+stops talking can be read off the log.
+--no-chunked answers chunked uploads with 411, as an endpoint that does not
+take them would; the device then uploads the recording again the usual way.
+--save-dir keeps each uploaded file.
+
+POST /v1/chat/completions answers every classification with FODMAP: LOW,
+GLUTEN: NO.
+
+The native build talks plain HTTP: set MISTRAL_HOST "127.0.0.1" and
+MISTRAL_PORT 8000 in include/config.h. The device needs TLS: start the mock
+with --cert/--key (any self-signed pair, the client does not verify it), and
+set MISTRAL_HOST to this computer's address and MISTRAL_PORT to its port.
+"""
+
+import argparse
+import json
+import os
+import ssl
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+BOUNDARY_PREFIX = "boundary="
+
+
+def log(msg):
+    print("%s %s" % (time.strftime("%H:%M:%S"), msg), flush=True)
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, fmt, *args):
+        pass  # our own lines only
+
+    def read_body(self):
+        """The request body and the time its last byte arrived."""
+        start = time.monotonic()
+        if self.headers.get("Transfer-Encoding", "").lower() == "chunked":
+            parts = []
+            while True:
+                size = int(self.rfile.readline().split(b";")[0].strip(), 16)
+                if size == 0:
+                    self.rfile.readline()  # no trailers
+                    break
+                parts.append(self.rfile.read(size))
+                self.rfile.readline()
+                log("  chunk %6d bytes at %6.0f ms" % (size, (time.monotonic() - start) * 1000))
+            body = b"".join(parts)
+        else:
+            body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        return body, time.monotonic()
+
+    def reply(self, status, payload):
+        data = json.dumps(payload).encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        self.send_header("Connection", "close")
+        self.end_headers()
+        self.wfile.write(data)
+        self.close_connection = True
+
+    def do_POST(self):
+        if self.path == "/v1/audio/transcriptions":
+            self.transcribe()
+        elif self.path == "/v1/chat/completions":
+            self.read_body()
+            content = "FODMAP: LOW\nGLUTEN: NO"
+            self.reply(200, {"choices": [{"message": {"role": "assistant", "content": content}}]})
+        else:
+            self.read_body()
+            self.reply(404, {"message": "not found"})
+
+    def transcribe(self):
+        chunked = self.headers.get("Transfer-Encoding", "").lower() == "chunked"
+        log("STT %s upload from %s" % ("chunked" if chunked else "sized", self.client_address[0]))
+        if chunked and self.server.args.no_chunked:
+            self.reply(411, {"message": "Length Required"})
+            return
+
+        body, done = self.read_body()
+        ctype = self.headers.get("Content-Type", "")
+        if BOUNDARY_PREFIX not in ctype:
+            self.reply(400, {"message": "not multipart"})
+            return
+        boundary = b"--" + ctype.split(BOUNDARY_PREFIX, 1)[1].strip().encode()
+
+        fields = {}
+        for part in body.split(boundary)[1:]:
+            if part.startswith(b"--"):
+                break
+            head, _, value = part[2:].partition(b"\r\n\r\n")
+            name = head.split(b'name="', 1)[1].split(b'"', 1)[0].decode()
+            fields[name] = value[:-2]  # CRLF before the next boundary
+
+        audio = fields.get("file", b"")
+        kind = "FLAC" if audio[:4] == b"fLaC" else "WAV" if audio[:4] == b"RIFF" else None
+        log("  %d bytes of %s, model %s, language %s" % (
+            len(audio), kind or "unknown audio",
+            fields.get("model", b"?").decode(), fields.get("language", b"?").decode()))
+        if kind is None:
+            self.reply(400, {"message": "file is neither FLAC nor WAV"})
+            return
+        if self.server.args.save_dir:
+            os.makedirs(self.server.args.save_dir, exist_ok=True)
+            path = os.path.join(self.server.args.save_dir,
+                                "upload-%d.%s" % (int(time.time() * 1000), "flac" if kind == "FLAC" else "wav"))
+            with open(path, "wb") as f:
+                f.write(audio)
+            log("  saved %s" % path)
+
+        time.sleep(self.server.args.delay)
+        texts = self.server.args.text or ["banana"]
+        with self.server.lock:
+            n = self.server.uploads
+            self.server.uploads += 1
+        self.reply(200, {"text": texts[n % len(texts)].replace("{n}", str(n))})
+        log("  answered %.0f ms after the last byte" % ((time.monotonic() - done) * 1000))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--port", type=int, default=8000)
+    parser.add_argument("--text", action="append",
+                        help="transcript to answer with (default banana; repeat to take turns)")
+    parser.add_argument("--delay", type=float, default=0.3, help="seconds of simulated processing")
+    parser.add_argument("--save-dir", help="keep uploaded recordings here")
+    parser.add_argument("--no-chunked", action="store_true", help="refuse chunked uploads with 411")
+    parser.add_argument("--cert", help="TLS certificate (PEM), for the device")
+    parser.add_argument("--key", help="TLS private key (PEM)")
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer(("", args.port), Handler)
+    server.args = args
+    server.uploads = 0
+    server.lock = threading.Lock()
+    if args.cert:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(args.cert, args.key)
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+    log("Mock Mistral on port %d (%s)" % (args.port, "https" if args.cert else "http"))
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
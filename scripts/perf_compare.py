@@ -0,0 +1,170 @@
+#!/usr/bin/env python3
+"""Time the firmware's hot functions on the host and compare them with a baseline.
+
+Usage: python3 scripts/perf_compare.py [--save] [PROGRAM]
+
+PROGRAM is the env:perf-bench build (default .pio/build/perf-bench/program).
+It runs each hot function a fixed number of times over the fixtures in
+bench/fixtures and prints "[PERF] name calls=.. ns/op=.. allocs/op=.. peak=.."
+per probe. It is run RUNS times on database images of several sizes
+(data/foods.json and synthetic ones); the fastest ns/op is kept per size and
+probe, as the one least disturbed by the rest of the machine.
+
+Allocations and peaks do not depend on the machine: they are checked in as
+scripts/perf_baseline.json. Timings only mean something on the machine that
+took them, so they are kept in .pio/perf_timings.json, which is not checked
+in. --save writes both. Otherwise the run fails (exit 1) when a probe
+allocates more or peaks higher than the checked-in baseline, or is more than
+THRESHOLD slower than the timings saved on this machine. Without saved
+timings only allocations and peaks are checked; without a checked-in
+baseline the run exits 2. Timings that differ by less than NOISE_NS are not
+counted as regressions.
+"""
+
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import foods_db  # noqa: E402
+import gen_synthetic_foods  # noqa: E402
+
+BASELINE = os.path.join("scripts", "perf_baseline.json")
+TIMINGS = os.path.join(".pio", "perf_timings.json")
+PROGRAM = os.path.join(".pio", "build", "perf-bench", "program")
+THRESHOLD = 0.10
+NOISE_NS = 20
+RUNS = 9
+
+# (label, foods, categories); foods 0 = data/foods.json as it is
+SIZES = [("foods.json", 0, 0), ("2k", 2000, 20), ("20k", 20000, 40)]
+
+PERF_LINE = re.compile(r"\[PERF\] (\S+) calls=(\d+) ns/op=(\d+) allocs/op=([\d.]+) peak=(\d+)")
+
+
+def make_fs(label, food_count, category_count, root):
+    os.makedirs(root)
+    src = os.path.join("data", "foods.json")
+    if food_count:
+        src = os.path.join(root, "..", label + ".json")
+        with open(src, "w", encoding="utf-8") as f:
+            json.dump(gen_synthetic_foods.generate(food_count, category_count, 1), f, ensure_ascii=False)
+    foods_db.build(src, os.path.join(root, "foods.bin"), None)
+
+
+def run_once(program, root):
+    env = dict(os.environ, SAFEBITE_FS_ROOT=root)
+    proc = subprocess.run([program], stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                          env=env, timeout=120)
+    out = proc.stdout.decode("utf-8", "replace")
+    if proc.returncode != 0:
+        sys.exit("perf_compare: %s failed:\n%s" % (program, out))
+    probes = {}
+    for m in PERF_LINE.finditer(out):
+        probes[m.group(1)] = {"calls": int(m.group(2)), "ns_op": int(m.group(3)),
+                              "allocs_op": float(m.group(4)), "peak": int(m.group(5))}
+    if not probes:
+        sys.exit("perf_compare: no [PERF] lines from %s (built without PERF_PROBES?)" % program)
+    return probes
+
+
+def measure(program):
+    # Round after round over every size, so a busy spell on the machine
+    # costs one run of each rather than every run of one
+    results = {}
+    work = tempfile.mkdtemp(prefix="perf_")
+    try:
+        roots = []
+        for label, food_count, category_count in SIZES:
+            roots.append((label, os.path.join(work, label)))
+            make_fs(label, food_count, category_count, roots[-1][1])
+        runs = {label: [] for label, _ in roots}
+        for _ in range(RUNS):
+            for label, root in roots:
+                runs[label].append(run_once(program, root))
+        for label, _ in roots:
+            for name in runs[label][0]:
+                samples = [r[name] for r in runs[label] if name in r]
+                results["%s/%s" % (label, name)] = min(samples, key=lambda s: s["ns_op"])
+            print("perf_compare: %s: %d probes" % (label, len(runs[label][0])))
+    finally:
+        shutil.rmtree(work)
+    return results
+
+
+def regressions(now, base, timing):
+    found = []
+    if timing is not None and now["ns_op"] > timing * (1 + THRESHOLD) and now["ns_op"] - timing >= NOISE_NS:
+        found.append("ns/op")
+    if now["allocs_op"] > base["allocs_op"] * (1 + THRESHOLD) + 0.005:
+        found.append("allocs/op")
+    if now["peak"] > base["peak"] * (1 + THRESHOLD):
+        found.append("peak")
+    return found
+
+
+def compare(results, baseline, timings):
+    failed = 0
+    print("%-32s %12s %12s %8s %10s %10s  %s" % ("probe", "ns/op", "saved", "change",
+                                                 "allocs/op", "peak", ""))
+    for key in sorted(set(results) | set(baseline)):
+        now, base = results.get(key), baseline.get(key)
+        if now is None or base is None:
+            print("%-32s %s" % (key, "not in this run" if now is None else "new, no baseline"))
+            continue
+        timing = timings.get(key)
+        if timing:
+            saved = "%12d %+7.1f%%" % (timing, 100.0 * (now["ns_op"] - timing) / timing)
+        else:
+            saved = "%12s %8s" % ("-", "")
+        bad = regressions(now, base, timing)
+        failed += bool(bad)
+        print("%-32s %12d %s %10.2f %10d  %s" % (
+            key, now["ns_op"], saved, now["allocs_op"], now["peak"],
+            ("REGRESSION: " + ", ".join(bad)) if bad else ""))
+    return failed
+
+
+def save(results):
+    baseline = {key: {"allocs_op": r["allocs_op"], "peak": r["peak"]} for key, r in results.items()}
+    os.makedirs(os.path.dirname(TIMINGS), exist_ok=True)
+    for path, data in ((BASELINE, baseline), (TIMINGS, {key: r["ns_op"] for key, r in results.items()})):
+        with open(path, "w", encoding="utf-8") as f:
+            json.dump(data, f, indent=1, sort_keys=True)
+            f.write("\n")
+        print("perf_compare: %d probes -> %s" % (len(data), path))
+
+
+def main():
+    args = [a for a in sys.argv[1:] if a != "--save"]
+    program = args[0] if args else PROGRAM
+    if not os.path.exists(program):
+        sys.exit("perf_compare: %s not found, run 'pio run -e perf-bench' first" % program)
+    results = measure(program)
+    if "--save" in sys.argv:
+        save(results)
+        return 0
+    try:
+        with open(BASELINE, encoding="utf-8") as f:
+            baseline = json.load(f)
+    except OSError:
+        print("perf_compare: no %s yet; record one with --save" % BASELINE)
+        return 2
+    try:
+        with open(TIMINGS, encoding="utf-8") as f:
+            timings = json.load(f)
+    except OSError:
+        print("perf_compare: no timings saved on this machine (%s), checking allocations only;"
+              " run with --save first to check timings" % TIMINGS)
+        timings = {}
+    failed = compare(results, baseline, timings)
+    print("perf_compare: %s" % ("%d regressions over %d%%" % (failed, THRESHOLD * 100) if failed else "ok"))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,30 @@
+# PlatformIO extra script: keep data/foods.bin (LittleFS image),
+# include/foods_table.h (-DFOODDB_PROGMEM builds) and include/food_model_table.h
+# (offline classifier weights) in sync with data/foods.json, and
+# include/filler_words.h with scripts/text_norm.py.
+
+Import("env")
+
+import os
+import sys
+
+project_dir = env.subst("$PROJECT_DIR")
+sys.path.insert(0, os.path.join(project_dir, "scripts"))
+
+import food_model
+import foods_db
+import text_norm
+
+text_norm.build_if_stale(os.path.join(project_dir, "include", "filler_words.h"))
+
+foods_db.build_if_stale(
+    os.path.join(project_dir, "data", "foods.json"),
+    os.path.join(project_dir, "data", "foods.bin"),
+    os.path.join(project_dir, "include", "foods_table.h"),
+)
+
+food_model.build_if_stale(
+    os.path.join(project_dir, "data", "foods.json"),
+    os.path.join(project_dir, "scripts", "model_ingredients.json"),
+    os.path.join(project_dir, "include", "food_model_table.h"),
+)
@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""Run the host behaviour checks, with deltas applied to a real image.
+
+Usage: python3 scripts/self_check.py [PROGRAM]
+
+PROGRAM is the env:self-check build (default .pio/build/self-check/program,
+see bench/self_check.cpp). It checks the JSON reader, the query arena and
+the HTTP body reader by itself. For the delta merge, data/foods.json is
+compiled into a scratch filesystem root and two edits of it are made (names
+and levels changed, a food moved to another category, foods added and
+deleted, then an added food deleted again). foods_delta.py turns them into
+the deltas the device applies in order, with a repeated one and a corrupt
+one in between. Each must be refused, leaving the view as it was.
+
+After each delta the program prints the merged view, read the way the UI
+reads it. Each category must hold the same foods as foods_db.py makes of
+that edit of foods.json, and the revision must match. The order inside a
+category is not compared: changed records go after the image's. The run
+fails (exit 1) on the first difference or when the program's own checks
+failed.
+"""
+
+import copy
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import foods_db  # noqa: E402
+import foods_delta  # noqa: E402
+
+PROGRAM = os.path.join(".pio", "build", "self-check", "program")
+
+VIEW_LINE = re.compile(r"\[VIEW\] (\S+) ([0-9a-f]{8}) (\d+)")
+FOOD_LINE = re.compile(r"\[FOOD\] (\d+) (\d+) (.*)\t(.*)")
+DELTA_LINE = re.compile(r"\[DELTA\] (\d+) (.*)")
+
+
+def edits(db):
+    """Two successive edits of foods.json, as the device would receive them."""
+    foods = db["foods"]
+    categories = [c["id"] for c in db["categories"]]
+    next_id = max(f["id"] for f in foods) + 1
+
+    first = copy.deepcopy(db)
+    f = first["foods"]
+    f[0]["name_en"] += " (edited)"
+    f[0]["fodmap"] = "high" if f[0].get("fodmap") != "high" else "low"
+    f[1]["category"] = next(c for c in categories if c != f[1]["category"])  # moved
+    f[2]["gluten"] = not f[2].get("gluten")
+    del f[3]
+    f.append({"id": next_id, "name_pt": "Fruta nova", "name_en": "New fruit",
+              "category": categories[0], "fodmap": "low", "gluten": False})
+    f.append({"id": next_id + 1, "name_pt": "Outro pão", "name_en": "Another bread",
+              "category": categories[-1], "fodmap": "moderate", "gluten": True})
+
+    second = copy.deepcopy(first)
+    f = second["foods"]
+    f[:] = [food for food in f if food["id"] != next_id]  # added by the first, deleted again
+    added = next(food for food in f if food["id"] == next_id + 1)
+    added["name_en"] = "Another bread, renamed"
+    f[1]["category"] = db["foods"][1]["category"]  # moved back
+    del f[4]
+    return first, second
+
+
+def expected_view(db):
+    categories, rows = foods_db.prepare(db)
+    view = {}
+    for r in rows:
+        view.setdefault(r["category"], []).append((foods_db.attrs_of(r), r["name_en"], r["name_pt"]))
+    return foods_db.revision_of(categories, rows), {c: sorted(v) for c, v in view.items()}
+
+
+def parse(out):
+    """Views by label, in order, and the result of each delta."""
+    views, results, current = [], {}, None
+    for line in out.splitlines():
+        m = VIEW_LINE.match(line)
+        if m:
+            current = {}
+            views.append((m.group(1), int(m.group(2), 16), int(m.group(3)), current))
+            continue
+        m = FOOD_LINE.match(line)
+        if m and current is not None:
+            current.setdefault(int(m.group(1)), []).append((int(m.group(2)), m.group(3), m.group(4)))
+            continue
+        m = DELTA_LINE.match(line)
+        if m:
+            results[int(m.group(1))] = m.group(2)
+    return views, results
+
+
+def main():
+    program = sys.argv[1] if len(sys.argv) > 1 else PROGRAM
+    if not os.path.exists(program):
+        sys.exit("self_check: %s not found, run 'pio run -e self-check' first" % program)
+
+    db = foods_db.load_json(os.path.join("data", "foods.json"))
+    first, second = edits(db)
+    delta1, _ = foods_delta.make_delta(db, first)
+    delta2, _ = foods_delta.make_delta(first, second)
+    corrupt = bytearray(delta2)
+    corrupt[len(corrupt) // 2] ^= 0x55
+    # (delta, what the device answers, the view it leaves)
+    steps = [(delta1, "applied", first),
+             (delta1, "Delta for other revision", first),
+             (bytes(corrupt), "Bad delta", first),
+             (delta2, "applied", second)]
+
+    work = tempfile.mkdtemp(prefix="check_")
+    try:
+        root = os.path.join(work, "fs")
+        os.makedirs(root)
+        foods_db.build(os.path.join("data", "foods.json"), os.path.join(root, "foods.bin"), None)
+        for n, (delta, _, _) in enumerate(steps, 1):
+            with open(os.path.join(root, "delta%d.sbdelta" % n), "wb") as f:
+                f.write(delta)
+        proc = subprocess.run([program], stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                              env=dict(os.environ, SAFEBITE_FS_ROOT=root), timeout=120)
+    finally:
+        shutil.rmtree(work)
+    out = proc.stdout.decode("utf-8", "replace")
+    for line in out.splitlines():
+        if line.startswith("[CHECK]") or line.startswith("  "):
+            print(line)
+    if proc.returncode != 0:
+        print("self_check: the program's own checks failed (exit %d)" % proc.returncode)
+        return 1
+
+    views, results = parse(out)
+    wanted = [("image", db)] + [("delta%d.sbdelta" % n, s[2]) for n, s in enumerate(steps, 1)]
+    wanted.append(("reloaded", second))
+    failed = 0
+    for n, (_, answer, _) in enumerate(steps, 1):
+        if results.get(n) != answer:
+            print("self_check: delta %d: got %r, want %r" % (n, results.get(n), answer))
+            failed += 1
+    if [v[0] for v in views] != [w[0] for w in wanted]:
+        print("self_check: views %s, want %s" % ([v[0] for v in views], [w[0] for w in wanted]))
+        return 1
+    for (label, revision, count, view), (_, source) in zip(views, wanted):
+        want_revision, want_view = expected_view(source)
+        got_view = {c: sorted(v) for c, v in view.items()}
+        if revision != want_revision:
+            print("self_check: %s: revision %08x, want %08x" % (label, revision, want_revision))
+            failed += 1
+        if count != sum(len(v) for v in want_view.values()):
+            print("self_check: %s: %d foods, want %d" % (label, count, sum(len(v) for v in want_view.values())))
+            failed += 1
+        for c in sorted(set(got_view) | set(want_view)):
+            got, want = got_view.get(c, []), want_view.get(c, [])
+            if got != want:
+                print("self_check: %s: category %d: extra %s, missing %s" % (
+                    label, c, sorted(set(got) - set(want)), sorted(set(want) - set(got))))
+                failed += 1
+    if failed:
+        print("self_check: %d differences in the merged views" % failed)
+        return 1
+    print("self_check: ok, %d deltas, %d views match foods_db.py" % (len(steps), len(views)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
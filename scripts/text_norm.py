@@ -0,0 +1,146 @@
+"""Text normalization shared by the database compiler and the firmware.
+
+Mirrors src/text_norm.cpp: both sides must produce identical normalized
+strings and trigram codes, or the match index will not line up with what the
+device computes from a transcript.
+"""
+
+import os
+
+# Latin-1 letters U+00C0..U+00FF folded to ASCII (space = not a letter)
+FOLD_LATIN1 = "aaaaaaaceeeeiiiidnooooo ouuuuy s" "aaaaaaaceeeeiiiidnooooo ouuuuy y"
+
+# PT nasal plurals (limões, pães, irmãos) are recognised before accents are folded
+NASAL_PLURALS = ("ões", "ães", "ãos")
+
+# (suffix, replacement) tried in order on the folded word; the first that leaves
+# at least MIN_STEM characters wins
+PLURAL_RULES = (
+    ("ies", "y"),    # berries -> berry
+    ("oes", "o"),    # potatoes -> potato
+    ("ches", "ch"),  # peaches -> peach
+    ("shes", "sh"),
+    ("sses", "ss"),
+    ("xes", "x"),
+    ("zes", "z"),    # nozes -> noz
+    ("ais", "al"),   # cereais -> cereal
+    ("eis", "el"),   # pastéis -> pastel
+    ("ss", "ss"),    # keep: glass
+    ("us", "us"),    # keep: hummus, asparagus
+    ("s", ""),       # maçãs -> maca, eggs -> egg
+)
+MIN_STEM = 3
+
+# Filler words of spoken queries, in normalized form. The firmware gets them
+# from include/filler_words.h, which build_if_stale() writes from this list.
+FILLER_WORDS = frozenset((
+    "a", "an", "the", "i", "can", "eat", "is", "it", "are", "ok", "okay", "safe",
+    "some", "please", "what", "about", "how",
+    "o", "os", "as", "um", "uma", "eu", "posso", "pode", "comer", "sao", "seguro",
+    "que", "tal", "por", "favor",
+))
+
+TRIGRAM_ALPHABET = 37  # space, a-z, 0-9
+NORM_MAX = 96          # firmware buffer size, including NUL
+
+
+def fold_char(ch):
+    cp = ord(ch)
+    if cp < 0x80:
+        if "a" <= ch <= "z" or "0" <= ch <= "9":
+            return ch
+        if "A" <= ch <= "Z":
+            return ch.lower()
+        return " "
+    if 0xC0 <= cp <= 0xFF:
+        return FOLD_LATIN1[cp - 0xC0]
+    return " "
+
+
+def strip_plural(word, nasal):
+    if nasal:
+        return word[:-3] + "ao"
+    for suffix, repl in PLURAL_RULES:
+        if word.endswith(suffix):
+            if len(word) - len(suffix) + len(repl) >= MIN_STEM:
+                return word[:-len(suffix)] + repl
+            if suffix == "s":
+                break
+    return word
+
+
+def normalize(text):
+    """Fold case and accents, split on non-letters and strip plural endings."""
+    words = []
+    raw, folded = "", ""
+    for ch in text + " ":
+        f = fold_char(ch)
+        if f != " ":
+            raw += ch.lower()
+            folded += f
+            continue
+        if folded:
+            nasal = len(folded) >= 3 and raw[-3:] in NASAL_PLURALS
+            words.append(strip_plural(folded, nasal))
+        raw, folded = "", ""
+    return " ".join(words)
+
+
+def query_key(text):
+    """Normalized text without filler words (unless nothing else is left)."""
+    norm = normalize(text)
+    return " ".join(w for w in norm.split() if w not in FILLER_WORDS) or norm
+
+
+def collate(text):
+    """Sort key for alphabetical lists: folded like normalize(), no plural stripping."""
+    key = " ".join("".join(fold_char(ch) for ch in text).split())
+    return key[:NORM_MAX - 1].rstrip(" ")
+
+
+def symbol(ch):
+    if ch == " ":
+        return 0
+    if "a" <= ch <= "z":
+        return 1 + ord(ch) - ord("a")
+    return 27 + ord(ch) - ord("0")
+
+
+def trigrams(norm):
+    """Sorted unique trigram codes of a normalized string padded with spaces."""
+    padded = " " + norm + " "
+    codes = set()
+    for i in range(len(padded) - 2):
+        a, b, c = (symbol(ch) for ch in padded[i:i + 3])
+        codes.add((a * TRIGRAM_ALPHABET + b) * TRIGRAM_ALPHABET + c)
+    return sorted(codes)
+
+
+def render_filler_header():
+    lines = [
+        "// Generated by scripts/text_norm.py from FILLER_WORDS - do not edit.",
+        "#ifndef FILLER_WORDS_H",
+        "#define FILLER_WORDS_H",
+        "",
+        "// Filler words of spoken queries, in normalized form: left out of the",
+        "// exact-name keys (text_norm.query_key) and of the device's query keys",
+        "static const char* const FILLER_WORDS[] = {",
+    ]
+    lines += ['    "%s",' % w for w in sorted(FILLER_WORDS)]
+    lines += ["};", "", "#endif", ""]
+    return "\n".join(lines)
+
+
+def build_if_stale(header_path):
+    """Rewrite include/filler_words.h when missing or older than this script."""
+    if os.path.exists(header_path) and os.path.getmtime(header_path) >= os.path.getmtime(__file__):
+        return False
+    with open(header_path, "w", encoding="utf-8") as f:
+        f.write(render_filler_header())
+    print("text_norm: FILLER_WORDS -> %s" % header_path)
+    return True
+
+
+if __name__ == "__main__":
+    import sys
+    build_if_stale(sys.argv[1] if len(sys.argv) > 1 else os.path.join("include", "filler_words.h"))
@@ -0,0 +1,141 @@
+#include "audio_capture.h"
+#include <M5Unified.h>
+#include <esp_heap_caps.h>
+#include <atomic>
+
+#define CAPTURE_STACK     3072
+#define CAPTURE_CORE      1   // beside loop(), away from the WiFi stack and the STT upload
+#define CAPTURE_PRIORITY  3   // above loop() (1), so nothing it does can hold capture up
+#define CAPTURE_POLL_MS   5   // two queued frames give the mic 40 ms before it runs dry
+
+static const size_t FRAME_SIZE = CAPTURE_FRAME_SAMPLES * sizeof(int16_t);
+
+// The ring: frame i lives in slot i % CAPTURE_RING_FRAMES. The counters run
+// free; only the task moves ringHead and only the consumer moves ringTail,
+// each publishing its side of the slots with a release store.
+static int16_t* ringFrames = nullptr;
+static std::atomic<uint32_t> ringHead(0);  // frames published
+static std::atomic<uint32_t> ringTail(0);  // frames released
+static std::atomic<uint32_t> overruns(0);
+static uint32_t ringPeak = 0;              // most frames waiting at once (consumer side)
+static int16_t scratchFrame[CAPTURE_FRAME_SAMPLES];
+
+static uint32_t captureRate = 16000;
+static std::atomic<bool> captureRunning(false);  // cleared to stop the task
+// Cleared by the task with a release store once it is done with the ring,
+// so captureFreeBuffer() may free it after an acquire load reads false
+static std::atomic<bool> taskAlive(false);
+
+static int16_t* slot(uint32_t frame) {
+    return ringFrames + (frame % CAPTURE_RING_FRAMES) * CAPTURE_FRAME_SAMPLES;
+}
+
+static void captureLoop() {
+    int16_t* queued[2];  // frames handed to the mic, oldest first
+    size_t queuedCount = 0;
+    uint32_t queuedSlots = 0;  // ring slots among them, from ringHead on
+
+    while (captureRunning.load(std::memory_order_relaxed)) {
+        // Keep two frames queued: the mic moves on to the next the moment one is full
+        while (queuedCount < 2) {
+            uint32_t next = ringHead.load(std::memory_order_relaxed) + queuedSlots;
+            int16_t* frame = scratchFrame;
+            if (next - ringTail.load(std::memory_order_acquire) < CAPTURE_RING_FRAMES) {
+                frame = slot(next);
+                queuedSlots++;
+            }
+            M5.Mic.record(frame, CAPTURE_FRAME_SAMPLES, captureRate);
+            queued[queuedCount++] = frame;
+        }
+
+        // isRecording() is the number of frames still queued: the rest are full
+        size_t pending = M5.Mic.isRecording();
+        while (queuedCount > pending) {
+            if (queued[0] == scratchFrame) {
+                overruns.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                queuedSlots--;
+                ringHead.store(ringHead.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+            queued[0] = queued[1];
+            queuedCount--;
+        }
+        vTaskDelay(pdMS_TO_TICKS(CAPTURE_POLL_MS));
+    }
+}
+
+static void captureTask(void*) {
+    captureLoop();
+    taskAlive.store(false, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+bool captureInit() {
+    if (ringFrames != nullptr) return true;
+    size_t size = CAPTURE_RING_FRAMES * FRAME_SIZE;
+    Serial.printf("[AUDIO] Requesting capture ring %u bytes, free heap=%u, largest block=%u\n",
+                  (unsigned)size, ESP.getFreeHeap(),
+                  (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    ringFrames = (int16_t*)heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    if (ringFrames == nullptr) {
+        Serial.println("[AUDIO] Capture ring allocation FAILED");
+        return false;
+    }
+    return true;
+}
+
+bool captureStart(uint32_t sampleRate) {
+    if (ringFrames == nullptr || taskAlive.load(std::memory_order_acquire)) return false;
+    captureRate = sampleRate;
+    ringHead.store(0);
+    ringTail.store(0);
+    overruns.store(0);
+    ringPeak = 0;
+
+    M5.Mic.begin();
+    captureRunning.store(true, std::memory_order_relaxed);
+    taskAlive.store(true, std::memory_order_relaxed);  // task creation publishes both
+    if (xTaskCreatePinnedToCore(captureTask, "capture", CAPTURE_STACK, nullptr, CAPTURE_PRIORITY,
+                                nullptr, CAPTURE_CORE) != pdPASS) {
+        Serial.println("[AUDIO] No memory for the capture task");
+        captureRunning.store(false, std::memory_order_relaxed);
+        taskAlive.store(false, std::memory_order_relaxed);
+        M5.Mic.end();
+        return false;
+    }
+    return true;
+}
+
+void captureStop() {
+    if (!taskAlive.load(std::memory_order_acquire)) return;
+    captureRunning.store(false, std::memory_order_relaxed);
+    while (taskAlive.load(std::memory_order_acquire)) delay(1);  // at most one poll
+    M5.Mic.end();
+    Serial.printf("[AUDIO] Capture stopped: %u frames, ring peak %u of %u, %u overruns\n",
+                  (unsigned)ringHead.load(), (unsigned)ringPeak, (unsigned)CAPTURE_RING_FRAMES,
+                  (unsigned)overruns.load());
+}
+
+const int16_t* captureFrame() {
+    uint32_t tail = ringTail.load(std::memory_order_relaxed);
+    uint32_t waiting = ringHead.load(std::memory_order_acquire) - tail;
+    if (waiting == 0) return nullptr;
+    if (waiting > ringPeak) ringPeak = waiting;
+    return slot(tail);
+}
+
+void captureRelease() {
+    ringTail.store(ringTail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+uint32_t captureOverruns() {
+    return overruns.load(std::memory_order_relaxed);
+}
+
+void captureFreeBuffer() {
+    if (taskAlive.load(std::memory_order_acquire)) return;  // still recording into it
+    if (ringFrames != nullptr) {
+        heap_caps_free(ringFrames);
+        ringFrames = nullptr;
+    }
+}
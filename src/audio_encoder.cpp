@@ -0,0 +1,159 @@
+#include "audio_encoder.h"
+#include <string.h>
+
+#if __has_include("config.h")
+    #include "config.h"
+#endif
+
+#ifndef AUDIO_ENCODER
+    #define AUDIO_ENCODER FLAC_ENCODER
+#endif
+
+#define SAMPLE_RATE  16000
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+// RIFF/WAVE header up to the fmt chunk's common fields; returns the offset after them
+static size_t putWavStart(uint8_t* out, uint32_t riffSize, uint32_t fmtSize, uint16_t format,
+                          uint32_t byteRate, uint16_t blockAlign, uint16_t bits) {
+    memcpy(out, "RIFF", 4);
+    put32(out + 4, riffSize);
+    memcpy(out + 8, "WAVE", 4);
+    memcpy(out + 12, "fmt ", 4);
+    put32(out + 16, fmtSize);
+    put16(out + 20, format);
+    put16(out + 22, 1);  // mono
+    put32(out + 24, SAMPLE_RATE);
+    put32(out + 28, byteRate);
+    put16(out + 32, blockAlign);
+    put16(out + 34, bits);
+    return 36;
+}
+
+// RIFF chunk size for a header of headerSize bytes followed by dataBytes
+static uint32_t riffSize(size_t headerSize, uint32_t dataBytes) {
+    return dataBytes == AUDIO_LENGTH_UNKNOWN ? AUDIO_LENGTH_UNKNOWN : headerSize - 8 + dataBytes;
+}
+
+// ---------------------------------------------------------------------------
+// PCM: the samples as they are
+
+#define PCM_HEADER_SIZE    44
+#define PCM_BLOCK_SAMPLES  512
+
+static void pcmBegin() {}
+
+static void pcmHeader(uint8_t* out, uint32_t /* samples */, uint32_t dataBytes) {
+    size_t at = putWavStart(out, riffSize(PCM_HEADER_SIZE, dataBytes), 16, 1,
+                            SAMPLE_RATE * sizeof(int16_t), sizeof(int16_t), 16);
+    memcpy(out + at, "data", 4);
+    put32(out + at + 4, dataBytes);
+}
+
+static size_t pcmEncodeBlock(const int16_t* samples, size_t count, uint8_t* out) {
+    memcpy(out, samples, count * sizeof(int16_t));  // both ends little-endian
+    return count * sizeof(int16_t);
+}
+
+const AudioEncoder PCM_ENCODER = {
+    "PCM", "audio.wav", "audio/wav",
+    PCM_HEADER_SIZE, PCM_BLOCK_SAMPLES, PCM_BLOCK_SAMPLES * sizeof(int16_t),
+    pcmBegin, pcmHeader, pcmEncodeBlock
+};
+
+// ---------------------------------------------------------------------------
+// IMA ADPCM in WAV (format 0x11): each 256-byte block holds its first sample
+// and step index, then 505 - 1 samples of 4 bits
+
+#define ADPCM_HEADER_SIZE    60
+#define ADPCM_BLOCK_BYTES    256
+#define ADPCM_BLOCK_SAMPLES  ((ADPCM_BLOCK_BYTES - 4) * 2 + 1)  // 505
+
+static const int16_t ADPCM_STEPS[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+static const int8_t ADPCM_INDEX_SHIFT[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+static int adpcmIndex = 0;  // carried from block to block, like a decoder would
+
+static void adpcmBegin() {
+    adpcmIndex = 0;
+}
+
+static void adpcmHeader(uint8_t* out, uint32_t samples, uint32_t dataBytes) {
+    size_t at = putWavStart(out, riffSize(ADPCM_HEADER_SIZE, dataBytes), 20, 0x11,
+                            SAMPLE_RATE * ADPCM_BLOCK_BYTES / ADPCM_BLOCK_SAMPLES,
+                            ADPCM_BLOCK_BYTES, 4);
+    put16(out + at, 2);  // extra fmt bytes
+    put16(out + at + 2, ADPCM_BLOCK_SAMPLES);
+    memcpy(out + at + 4, "fact", 4);
+    put32(out + at + 8, 4);
+    put32(out + at + 12, samples);
+    memcpy(out + at + 16, "data", 4);
+    put32(out + at + 20, dataBytes);
+}
+
+static uint8_t adpcmNibble(int sample, int& predictor) {
+    int step = ADPCM_STEPS[adpcmIndex];
+    int diff = sample - predictor;
+    uint8_t nibble = 0;
+    if (diff < 0) {
+        nibble = 8;
+        diff = -diff;
+    }
+    int delta = step >> 3;
+    if (diff >= step) { nibble |= 4; diff -= step; delta += step; }
+    step >>= 1;
+    if (diff >= step) { nibble |= 2; diff -= step; delta += step; }
+    step >>= 1;
+    if (diff >= step) { nibble |= 1; delta += step; }
+
+    predictor += (nibble & 8) ? -delta : delta;
+    if (predictor > 32767) predictor = 32767;
+    if (predictor < -32768) predictor = -32768;
+    adpcmIndex += ADPCM_INDEX_SHIFT[nibble & 7];
+    if (adpcmIndex < 0) adpcmIndex = 0;
+    if (adpcmIndex > 88) adpcmIndex = 88;
+    return nibble;
+}
+
+static size_t adpcmEncodeBlock(const int16_t* samples, size_t count, uint8_t* out) {
+    // A short last block is padded with its last sample; the fact chunk has the real length
+    int predictor = samples[0];
+    put16(out, (uint16_t)samples[0]);
+    out[2] = (uint8_t)adpcmIndex;
+    out[3] = 0;
+    for (size_t i = 1; i < ADPCM_BLOCK_SAMPLES; i += 2) {
+        int a = samples[i < count ? i : count - 1];
+        int b = samples[i + 1 < count ? i + 1 : count - 1];
+        uint8_t lo = adpcmNibble(a, predictor);
+        uint8_t hi = adpcmNibble(b, predictor);
+        out[4 + i / 2] = lo | (hi << 4);
+    }
+    return ADPCM_BLOCK_BYTES;
+}
+
+const AudioEncoder ADPCM_ENCODER = {
+    "IMA ADPCM", "audio.wav", "audio/wav",
+    ADPCM_HEADER_SIZE, ADPCM_BLOCK_SAMPLES, ADPCM_BLOCK_BYTES,
+    adpcmBegin, adpcmHeader, adpcmEncodeBlock
+};
+
+const AudioEncoder& audioEncoder() {
+    return AUDIO_ENCODER;
+}
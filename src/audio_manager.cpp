@@ -2,6 +2,10 @@
 #include <M5Unified.h>
 #include <LittleFS.h>
 #include "language.h"
+#include "perf_probe.h"
+#include "vad.h"
+#include "audio_encoder.h"
+#include "audio_capture.h"
 #include <esp_heap_caps.h>
 #include "fonts/DejaVuSans6pt_Latin.h"
 #include "fonts/DejaVuSans8pt_Latin.h"
@@ -14,23 +18,50 @@
 
 // Recording state
 static AudioState currentAudioState = AUDIO_IDLE;
-static int16_t* chunkBuffer = nullptr;  // 32KB total, split into two 16KB halves
-static File wavFile;
-static size_t totalSamplesWritten = 0;
-static unsigned long chunkStartTime = 0;
-static size_t wavFileSize = 0;
-static const char* WAV_FILE_PATH = "/tmp.wav";
-
-static size_t samplesRecorded = 0;  // total progress across all chunks
+static size_t samplesCaptured = 0;      // samples taken off the capture ring, written or not
+static uint32_t overrunsLogged = 0;
+static size_t recSize = 0;
+
+// Recording backends: the whole utterance in PSRAM when the board has it
+// (no flash writes or wear, and the upload sends straight from memory),
+// the LittleFS file otherwise. The PSRAM buffer is kept between queries.
+static File recFile;
+static const char* REC_FILE_PATH = "/tmp.rec";
+static uint8_t* psramRec = nullptr;
+static size_t psramCapacity = 0;
+static bool recInPsram = false;         // backend of the current recording
+static size_t psramFill = 0;
+static AudioStream stream;  // the PSRAM recording, published every half second
+
 static unsigned long recordingStartTime = 0;
 
-// Double-buffer: ping-pong two halves so DMA and flash write overlap
-static const size_t HALF_SAMPLES = AUDIO_CHUNK_SAMPLES / 2;   // 8000 (0.5s)
-static const size_t HALF_SIZE    = HALF_SAMPLES * sizeof(int16_t);  // 16000 bytes
-static const int    TOTAL_HALVES = AUDIO_TOTAL_CHUNKS * 2;    // 10
-static int16_t* recBuf  = nullptr;  // half currently being recorded into
-static int16_t* writeBuf = nullptr; // half just completed, pending flash write
-static int halvesCompleted = 0;
+// Silence trimming: nothing reaches the file before the VAD hears speech;
+// the last VAD_PREROLL_MS of silence is kept so the file can start that far
+// ahead of it. After speech every frame is written and the trailing silence
+// is cut off by the data size in the final header.
+static const size_t PREROLL_SAMPLES = AUDIO_SAMPLE_RATE * VAD_PREROLL_MS / 1000;
+static const size_t POSTROLL_SAMPLES = AUDIO_SAMPLE_RATE * VAD_POSTROLL_MS / 1000;
+static int16_t* prerollBuffer = nullptr;  // 6.4KB, optional (no pre-roll without it)
+static size_t prerollSamples = 0;         // valid samples, ending at samplesCaptured
+static size_t dataStartSample = 0;        // capture position of the file's first sample
+
+// Encoder stage: samples are staged into whole blocks, each encoded and
+// written as soon as it fills. The file can only be cut at a block boundary,
+// so the cut is the end of the last block that starts before the end of the
+// speech (plus post-roll); a last partial block is cut exactly.
+static const AudioEncoder& encoder = audioEncoder();
+static uint8_t* encoderBuffer = nullptr;  // staged samples, then one block of output
+static int16_t* blockIn = nullptr;
+static uint8_t* blockOut = nullptr;
+static size_t blockFill = 0;              // samples staged
+static size_t samplesEncoded = 0;         // from dataStartSample
+static size_t bytesEncoded = 0;           // file bytes after the header
+static size_t cutSamples = 0;
+static size_t cutBytes = 0;
+
+// A streamed upload gets the speech so far every half second
+static const size_t STREAM_PUBLISH_SAMPLES = AUDIO_SAMPLE_RATE / 2;
+static size_t publishedAt = 0;  // samplesCaptured at the last publishStream()
 
 // UI state for blinking REC dot
 static bool recDotVisible = true;
@@ -52,11 +83,13 @@ static uint8_t barLevels[NUM_BARS] = {0};
 static unsigned long lastBarUpdateTime = 0;
 static const unsigned long BAR_UPDATE_INTERVAL = 80;  // ms
 
-// Audio level: number of samples to scan for peak (~30ms window)
-static const size_t LEVEL_WINDOW = AUDIO_SAMPLE_RATE / 33;
+// Audio level: peak of the newest frame (20 ms)
+static uint8_t frameLevel = 0;
 
 // Forward declarations
-static void writeWavHeader(size_t dataSize);
+static void writeHeader(size_t samples, size_t dataBytes);
+static void captureSamples(const int16_t* samples, size_t count);
+static void finishRecording(const char* how);
 static void drawRecordingScreenInitial();
 static void updateRecordingScreen(bool updateDot, bool updateSeconds, bool updateBars);
 
@@ -65,91 +98,108 @@ bool audioInit() {
     return true;
 }
 
-static void writeWavHeader(size_t dataSize) {
-    if (!wavFile) return;
-
-    uint8_t header[WAV_HEADER_SIZE];
-    uint32_t fileSize = dataSize + WAV_HEADER_SIZE - 8;
-    uint32_t byteRate = AUDIO_SAMPLE_RATE * sizeof(int16_t);
-    uint16_t blockAlign = sizeof(int16_t);
-
-    // RIFF header
-    header[0] = 'R'; header[1] = 'I'; header[2] = 'F'; header[3] = 'F';
-    header[4] = (fileSize >> 0) & 0xFF;
-    header[5] = (fileSize >> 8) & 0xFF;
-    header[6] = (fileSize >> 16) & 0xFF;
-    header[7] = (fileSize >> 24) & 0xFF;
-
-    // WAVE
-    header[8] = 'W'; header[9] = 'A'; header[10] = 'V'; header[11] = 'E';
-
-    // fmt chunk
-    header[12] = 'f'; header[13] = 'm'; header[14] = 't'; header[15] = ' ';
-    header[16] = 16; header[17] = 0; header[18] = 0; header[19] = 0;  // chunk size
-    header[20] = 1; header[21] = 0;  // PCM format
-    header[22] = 1; header[23] = 0;  // mono
-
-    // Sample rate
-    header[24] = (AUDIO_SAMPLE_RATE >> 0) & 0xFF;
-    header[25] = (AUDIO_SAMPLE_RATE >> 8) & 0xFF;
-    header[26] = (AUDIO_SAMPLE_RATE >> 16) & 0xFF;
-    header[27] = (AUDIO_SAMPLE_RATE >> 24) & 0xFF;
-
-    // Byte rate
-    header[28] = (byteRate >> 0) & 0xFF;
-    header[29] = (byteRate >> 8) & 0xFF;
-    header[30] = (byteRate >> 16) & 0xFF;
-    header[31] = (byteRate >> 24) & 0xFF;
-
-    // Block align
-    header[32] = blockAlign & 0xFF;
-    header[33] = (blockAlign >> 8) & 0xFF;
-
-    // Bits per sample
-    header[34] = 16; header[35] = 0;
-
-    // data chunk
-    header[36] = 'd'; header[37] = 'a'; header[38] = 't'; header[39] = 'a';
-    header[40] = (dataSize >> 0) & 0xFF;
-    header[41] = (dataSize >> 8) & 0xFF;
-    header[42] = (dataSize >> 16) & 0xFF;
-    header[43] = (dataSize >> 24) & 0xFF;
-
-    wavFile.seek(0);
-    wavFile.write(header, WAV_HEADER_SIZE);
+// Append to the recording on either backend
+static void recWrite(const uint8_t* data, size_t len) {
+    if (!recInPsram) {
+        recFile.write(data, len);
+        return;
+    }
+    // The capacity covers a full-length recording, so this never cuts
+    if (len > psramCapacity - psramFill) len = psramCapacity - psramFill;
+    memcpy(psramRec + psramFill, data, len);
+    psramFill += len;
+}
+
+static void writeHeader(size_t samples, size_t dataBytes) {
+    PERF_PROBE("rec_header");
+    uint8_t header[AUDIO_ENCODER_MAX_HEADER];
+    encoder.header(header, samples, dataBytes);
+    if (recInPsram) {
+        memcpy(psramRec, header, encoder.headerSize);
+        if (psramFill < encoder.headerSize) psramFill = encoder.headerSize;
+    } else if (recFile) {
+        recFile.seek(0);
+        recFile.write(header, encoder.headerSize);
+    }
+}
+
+// Pick the backend for a new recording and open it
+static bool openRecording() {
+    if (psramRec == nullptr && ESP.getPsramSize() > 0) {
+        // Worst case: every block of a full-length recording at its largest
+        size_t capacity = encoder.headerSize +
+            (AUDIO_TOTAL_SAMPLES / encoder.blockSamples + 1) * encoder.maxBlockBytes;
+        psramRec = (uint8_t*)heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM);
+        if (psramRec != nullptr) psramCapacity = capacity;
+        Serial.printf("[AUDIO] PSRAM recording buffer %u bytes: %s\n", (unsigned)capacity,
+                      psramRec != nullptr ? "allocated" : "FAILED, using LittleFS");
+    }
+    recInPsram = psramRec != nullptr;
+    psramFill = 0;
+    if (recInPsram) return true;
+
+    // Mount on demand (no-op if already mounted; FOODDB_PROGMEM builds skip it at boot)
+    if (!LittleFS.begin(true)) {
+        Serial.println("[AUDIO] LittleFS mount failed");
+        return false;
+    }
+    recFile = LittleFS.open(REC_FILE_PATH, "w");
+    if (!recFile) {
+        Serial.println("[AUDIO] Failed to open tmp.rec for writing");
+        return false;
+    }
+    return true;
 }
 
 bool audioStartRecording() {
-    // Allocate chunk buffer (32KB)
-    if (chunkBuffer == nullptr) {
-        Serial.printf("[AUDIO] Requesting chunk buffer %u bytes, free heap=%u, largest block=%u\n",
-                      (unsigned)AUDIO_CHUNK_BUFFER_SIZE, ESP.getFreeHeap(),
-                      heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
-        chunkBuffer = (int16_t*)heap_caps_malloc(AUDIO_CHUNK_BUFFER_SIZE, MALLOC_CAP_8BIT);
-        if (chunkBuffer == nullptr) {
-            Serial.println("[AUDIO] Chunk buffer allocation FAILED");
+    // Capture ring (32KB)
+    if (!captureInit()) {
+        currentAudioState = AUDIO_ERROR;
+        return false;
+    }
+    if (encoderBuffer == nullptr) {
+        encoderBuffer = (uint8_t*)heap_caps_malloc(encoder.blockSamples * sizeof(int16_t) +
+                                                   encoder.maxBlockBytes, MALLOC_CAP_8BIT);
+        if (encoderBuffer == nullptr) {
+            Serial.println("[AUDIO] Encoder buffer allocation FAILED");
             currentAudioState = AUDIO_ERROR;
             return false;
         }
-        Serial.printf("[AUDIO] Chunk buffer allocated at %p\n", chunkBuffer);
+        blockIn = (int16_t*)encoderBuffer;
+        blockOut = encoderBuffer + encoder.blockSamples * sizeof(int16_t);
+    }
+    if (prerollBuffer == nullptr) {
+        prerollBuffer = (int16_t*)heap_caps_malloc(PREROLL_SAMPLES * sizeof(int16_t), MALLOC_CAP_8BIT);
+        if (prerollBuffer == nullptr) Serial.println("[AUDIO] No pre-roll buffer, speech starts cold");
     }
 
-    // Open WAV file for writing
-    wavFile = LittleFS.open(WAV_FILE_PATH, "w");
-    if (!wavFile) {
-        Serial.println("[AUDIO] Failed to open tmp.wav for writing");
+    // Open the recording for writing (PSRAM or flash)
+    if (!openRecording()) {
         currentAudioState = AUDIO_ERROR;
         return false;
     }
 
-    // Write placeholder WAV header (will be rewritten at end with actual size)
-    size_t maxDataSize = AUDIO_TOTAL_SAMPLES * sizeof(int16_t);
-    writeWavHeader(maxDataSize);
+    // Write placeholder header (will be rewritten at end with actual size). It
+    // says the length is unknown, as a streamed upload sends it before the end.
+    encoder.begin();
+    writeHeader(AUDIO_LENGTH_UNKNOWN, AUDIO_LENGTH_UNKNOWN);
+    stream.data = psramRec;
+    stream.ready.store(recInPsram ? encoder.headerSize : 0, std::memory_order_relaxed);
+    stream.complete.store(!recInPsram, std::memory_order_release);
 
     // Reset recording state
-    totalSamplesWritten = 0;
-    halvesCompleted = 0;
-    samplesRecorded = 0;
+    samplesCaptured = 0;
+    prerollSamples = 0;
+    dataStartSample = 0;
+    blockFill = 0;
+    samplesEncoded = 0;
+    bytesEncoded = 0;
+    cutSamples = 0;
+    cutBytes = 0;
+    publishedAt = 0;
+    overrunsLogged = 0;
+    frameLevel = 0;
+    vadReset();
     recordingStartTime = millis();
     recDotVisible = true;
     lastBlinkTime = millis();
@@ -160,20 +210,16 @@ bool audioStartRecording() {
     memset(barLevels, 0, sizeof(barLevels));
     lastBarUpdateTime = 0;
 
-    // Configure and start microphone
+    // Configure the microphone and start the capture task
     auto mic_cfg = M5.Mic.config();
     mic_cfg.sample_rate = AUDIO_SAMPLE_RATE;
     mic_cfg.magnification = 16;
     M5.Mic.config(mic_cfg);
-    M5.Mic.begin();
-
-    // Set up double-buffer halves and start first DMA
-    int16_t* bufA = chunkBuffer;
-    recBuf = bufA;
-    writeBuf = nullptr;
-    memset(chunkBuffer, 0, AUDIO_CHUNK_BUFFER_SIZE);
-    M5.Mic.record(recBuf, HALF_SAMPLES, AUDIO_SAMPLE_RATE);
-    chunkStartTime = millis();
+    if (!captureStart(AUDIO_SAMPLE_RATE)) {
+        if (recFile) recFile.close();
+        currentAudioState = AUDIO_ERROR;
+        return false;
+    }
 
     currentAudioState = AUDIO_RECORDING;
 
@@ -183,74 +229,153 @@ bool audioStartRecording() {
     return true;
 }
 
-void audioUpdate() {
-    if (currentAudioState != AUDIO_RECORDING) {
-        return;
+// Encode the staged block and move the cut past it if it holds speech
+static void encodeBlock(size_t count) {
+    size_t bytes;
+    {
+        PERF_PROBE("encode");
+        bytes = encoder.encodeBlock(blockIn, count, blockOut);
+    }
+    recWrite(blockOut, bytes);
+    size_t blockStart = dataStartSample + samplesEncoded;
+    samplesEncoded += count;
+    bytesEncoded += bytes;
+    if (blockStart < vadSpeechEnd() + POSTROLL_SAMPLES) {
+        cutSamples = samplesEncoded;
+        cutBytes = bytesEncoded;
     }
+    blockFill = 0;
+}
 
-    // Compute audio level from current buffer (for visualizer)
-    int16_t peak = 0;
-    uint8_t level = 0;
+// Samples from dataStartSample on, in order
+static void encodeSamples(const int16_t* samples, size_t count) {
+    while (count > 0) {
+        size_t take = encoder.blockSamples - blockFill;
+        if (take > count) take = count;
+        memcpy(blockIn + blockFill, samples, take * sizeof(int16_t));
+        blockFill += take;
+        samples += take;
+        count -= take;
+        if (blockFill == encoder.blockSamples) encodeBlock(blockFill);
+    }
+}
 
-    if (!M5.Mic.isRecording()) {
-        // Half-buffer DMA complete — swap buffers immediately to minimize gap
-        int16_t* completedBuf = recBuf;
-        int16_t* bufA = chunkBuffer;
-        int16_t* bufB = chunkBuffer + HALF_SAMPLES;
-        recBuf = (completedBuf == bufA) ? bufB : bufA;
+// Run the VAD over the next samples and encode the ones worth uploading
+static void captureSamples(const int16_t* samples, size_t count) {
+    size_t blockStart = samplesCaptured;
+    bool speaking = vadHeardSpeech();
+    {
+        PERF_PROBE("vad");
+        vadFeed(samples, count);
+    }
+    samplesCaptured += count;
 
-        // Start DMA on the other half right away (continuous recording)
-        if (halvesCompleted + 1 < TOTAL_HALVES) {
-            M5.Mic.record(recBuf, HALF_SAMPLES, AUDIO_SAMPLE_RATE);
-            chunkStartTime = millis();
-        }
+    if (speaking) {
+        encodeSamples(samples, count);
+        return;
+    }
 
-        // Compute level from the completed half
-        for (size_t i = (HALF_SAMPLES > LEVEL_WINDOW ? HALF_SAMPLES - LEVEL_WINDOW : 0);
-             i < HALF_SAMPLES; i++) {
-            int16_t val = completedBuf[i] < 0 ? -completedBuf[i] : completedBuf[i];
-            if (val > peak) peak = val;
-        }
-        level = (uint8_t)((peak * 255L) / 32767);
-
-        // Write completed half to flash (blocking ~20-50ms, but DMA runs in parallel)
-        wavFile.write((uint8_t*)completedBuf, HALF_SIZE);
-        totalSamplesWritten += HALF_SAMPLES;
-        halvesCompleted++;
-
-        Serial.printf("[AUDIO] Half %d/%d written\n", halvesCompleted, TOTAL_HALVES);
-
-        samplesRecorded = totalSamplesWritten;
-
-        if (halvesCompleted >= TOTAL_HALVES) {
-            // All halves done — finalize WAV
-            M5.Mic.end();
-            size_t actualDataSize = totalSamplesWritten * sizeof(int16_t);
-            writeWavHeader(actualDataSize);
-            wavFileSize = WAV_HEADER_SIZE + actualDataSize;
-            wavFile.close();
-            Serial.printf("[AUDIO] Recording complete: %u samples, WAV file %u bytes\n",
-                          (unsigned)totalSamplesWritten, (unsigned)wavFileSize);
-            currentAudioState = AUDIO_COMPLETE;
+    if (!vadHeardSpeech()) {
+        // Still silence: keep only its last PREROLL_SAMPLES for the pre-roll
+        if (prerollBuffer == nullptr) return;
+        if (count >= PREROLL_SAMPLES) {
+            prerollSamples = PREROLL_SAMPLES;
+            memcpy(prerollBuffer, samples + count - PREROLL_SAMPLES, PREROLL_SAMPLES * sizeof(int16_t));
             return;
         }
+        size_t keep = prerollSamples + count > PREROLL_SAMPLES ? PREROLL_SAMPLES - count : prerollSamples;
+        memmove(prerollBuffer, prerollBuffer + prerollSamples - keep, keep * sizeof(int16_t));
+        memcpy(prerollBuffer + keep, samples, count * sizeof(int16_t));
+        prerollSamples = keep + count;
+        return;
+    }
 
-    } else {
-        // DMA in progress — estimate progress within current half from elapsed time
-        unsigned long chunkElapsed = millis() - chunkStartTime;
-        size_t chunkProgress = (size_t)(chunkElapsed * AUDIO_SAMPLE_RATE / 1000);
-        if (chunkProgress > HALF_SAMPLES) chunkProgress = HALF_SAMPLES;
-        samplesRecorded = totalSamplesWritten + chunkProgress;
-
-        // Read audio level from in-progress buffer
-        if (chunkProgress > 0) {
-            size_t start = (chunkProgress > LEVEL_WINDOW) ? chunkProgress - LEVEL_WINDOW : 0;
-            for (size_t i = start; i < chunkProgress; i++) {
-                int16_t val = recBuf[i] < 0 ? -recBuf[i] : recBuf[i];
-                if (val > peak) peak = val;
-            }
-            level = (uint8_t)((peak * 255L) / 32767);
+    // Speech began in this frame (or in the last frames before it):
+    // the file starts VAD_PREROLL_MS ahead of it, as far as the pre-roll reaches
+    size_t onset = vadSpeechStart();
+    dataStartSample = onset > PREROLL_SAMPLES ? onset - PREROLL_SAMPLES : 0;
+    if (dataStartSample < blockStart - prerollSamples) dataStartSample = blockStart - prerollSamples;
+    if (dataStartSample < blockStart) {
+        size_t fromPreroll = blockStart - dataStartSample;
+        encodeSamples(prerollBuffer + prerollSamples - fromPreroll, fromPreroll);
+    }
+    size_t skip = dataStartSample > blockStart ? dataStartSample - blockStart : 0;
+    encodeSamples(samples + skip, count - skip);
+}
+
+// Everything up to the cut is final: out it goes to a streamed upload
+static void publishStream() {
+    if (recInPsram) stream.ready.store(encoder.headerSize + cutBytes, std::memory_order_release);
+    publishedAt = samplesCaptured;
+}
+
+// Level meter, VAD, encoder and writer, for every frame the capture task has
+// published (more than one when loop() was held up), up to the end of speech
+// or the recording
+static void consumeFrames() {
+    const int16_t* frame;
+    while (samplesCaptured < AUDIO_TOTAL_SAMPLES && !vadEndpoint() && (frame = captureFrame()) != nullptr) {
+        {
+            PERF_PROBE("peak_scan");
+            frameLevel = vadPeakLevel(frame, CAPTURE_FRAME_SAMPLES);
         }
+        captureSamples(frame, CAPTURE_FRAME_SAMPLES);
+        captureRelease();
+        if (samplesCaptured - publishedAt >= STREAM_PUBLISH_SAMPLES) publishStream();
+    }
+
+    uint32_t overruns = captureOverruns();
+    if (overruns != overrunsLogged) {
+        Serial.printf("[AUDIO] Capture ring full: %u frames (%u ms) dropped so far\n", (unsigned)overruns,
+                      (unsigned)(overruns * CAPTURE_FRAME_SAMPLES * 1000 / AUDIO_SAMPLE_RATE));
+        overrunsLogged = overruns;
+    }
+}
+
+// Mic already stopped: close the recording with only the speech (plus pre-
+// and post-roll). The upload sends getRecordingSize() bytes, so trailing
+// silence left in the file past the cut is never sent.
+static void finishRecording(const char* how) {
+    if (vadHeardSpeech() && blockFill > 0) {
+        size_t blockStart = dataStartSample + samplesEncoded;
+        size_t dataEnd = vadSpeechEnd() + POSTROLL_SAMPLES;
+        if (blockStart < dataEnd) encodeBlock(dataEnd - blockStart < blockFill ? dataEnd - blockStart : blockFill);
+    }
+    writeHeader(cutSamples, cutBytes);
+    recSize = vadHeardSpeech() ? encoder.headerSize + cutBytes : 0;
+    if (recFile) recFile.close();
+    stream.ready.store(recSize, std::memory_order_relaxed);
+    stream.complete.store(true, std::memory_order_release);  // publishes ready and the header
+
+    Serial.printf("[AUDIO] %s: %u samples (%u frames lost), %s in %s %u bytes\n", how,
+                  (unsigned)samplesCaptured, (unsigned)captureOverruns(), encoder.name,
+                  recInPsram ? "PSRAM" : "file", (unsigned)recSize);
+    // Saved against the fixed 5 s WAV capture this replaces: upload bytes,
+    // and seconds of recording the user no longer waits through
+    size_t fullSize = 44 + AUDIO_TOTAL_SAMPLES * sizeof(int16_t);
+    size_t stopSamples = samplesCaptured < AUDIO_TOTAL_SAMPLES ? AUDIO_TOTAL_SAMPLES - samplesCaptured : 0;
+    if (vadHeardSpeech()) {
+        Serial.printf("[VAD] Kept %.2f s of %.2f s recorded, saved %u bytes, stopped %.2f s early\n",
+                      (float)cutSamples / AUDIO_SAMPLE_RATE, (float)samplesCaptured / AUDIO_SAMPLE_RATE,
+                      (unsigned)(fullSize - recSize), (float)stopSamples / AUDIO_SAMPLE_RATE);
+    } else {
+        Serial.printf("[VAD] No speech in %.2f s, nothing to upload\n",
+                      (float)samplesCaptured / AUDIO_SAMPLE_RATE);
+    }
+    currentAudioState = AUDIO_COMPLETE;
+}
+
+void audioUpdate() {
+    if (currentAudioState != AUDIO_RECORDING) {
+        return;
+    }
+
+    consumeFrames();
+    if (samplesCaptured >= AUDIO_TOTAL_SAMPLES || vadEndpoint()) {
+        // Full length, or the speaker has stopped — finalize the recording
+        captureStop();
+        finishRecording(samplesCaptured >= AUDIO_TOTAL_SAMPLES ? "Recording complete" : "End of speech");
+        return;
     }
 
     // Update blinking state
@@ -262,7 +387,7 @@ void audioUpdate() {
 
     // Calculate what changed
     bool dotChanged = (recDotVisible != lastRecDotState);
-    int seconds = (AUDIO_TOTAL_SAMPLES - samplesRecorded) / AUDIO_SAMPLE_RATE;
+    int seconds = (AUDIO_TOTAL_SAMPLES - samplesCaptured) / AUDIO_SAMPLE_RATE;
     if (seconds < 0) seconds = 0;
     if (seconds > AUDIO_DURATION_SEC) seconds = AUDIO_DURATION_SEC;
     bool secondsChanged = (seconds != lastSecondsDisplayed);
@@ -274,7 +399,7 @@ void audioUpdate() {
         for (int i = 0; i < NUM_BARS - 1; i++) {
             barLevels[i] = barLevels[i + 1];
         }
-        barLevels[NUM_BARS - 1] = level;
+        barLevels[NUM_BARS - 1] = frameLevel;
         lastBarUpdateTime = now;
         barsChanged = true;
     }
@@ -293,66 +418,67 @@ AudioState getAudioState() {
     return currentAudioState;
 }
 
-size_t getWavFileSize() {
-    return wavFileSize;
+size_t getRecordingSize() {
+    return recSize;
 }
 
-const char* getWavFilePath() {
-    return WAV_FILE_PATH;
+const uint8_t* getRecordingData() {
+    return recInPsram ? psramRec : nullptr;
 }
 
-void audioStopRecording() {
-    if (currentAudioState != AUDIO_RECORDING) return;
-    M5.Mic.end();
+const char* getRecordingPath() {
+    return REC_FILE_PATH;
+}
 
-    // Estimate partial samples in the active half-buffer from elapsed time
-    unsigned long chunkElapsed = millis() - chunkStartTime;
-    size_t partialSamples = (size_t)(chunkElapsed * AUDIO_SAMPLE_RATE / 1000);
-    if (partialSamples > HALF_SAMPLES) partialSamples = HALF_SAMPLES;
+const AudioStream* audioStream() {
+    return currentAudioState == AUDIO_RECORDING && recInPsram ? &stream : nullptr;
+}
 
-    // Write partial half-buffer to flash
-    if (partialSamples > 0) {
-        size_t partialBytes = partialSamples * sizeof(int16_t);
-        wavFile.write((uint8_t*)recBuf, partialBytes);
-        totalSamplesWritten += partialSamples;
-    }
+void audioDiscardRecording() {
+    if (!recInPsram) LittleFS.remove(REC_FILE_PATH);
+    psramFill = 0;
+}
 
-    // Rewrite WAV header with actual total size
-    size_t actualDataSize = totalSamplesWritten * sizeof(int16_t);
-    writeWavHeader(actualDataSize);
-    wavFileSize = WAV_HEADER_SIZE + actualDataSize;
-    wavFile.close();
+void audioStopRecording() {
+    if (currentAudioState != AUDIO_RECORDING) return;
 
-    Serial.printf("[AUDIO] Early stop: %u samples, WAV file %u bytes\n",
-                  (unsigned)totalSamplesWritten, (unsigned)wavFileSize);
+    // Take the frames captured up to now (the one in progress is dropped)
+    captureStop();
+    consumeFrames();
 
-    currentAudioState = AUDIO_COMPLETE;
+    // Rewrite the header with the trimmed size
+    finishRecording("Early stop");
 }
 
 void audioReset() {
     if (currentAudioState == AUDIO_RECORDING) {
-        M5.Mic.end();
+        captureStop();
+        stream.ready.store(0, std::memory_order_relaxed);  // cancelled: nothing to upload
+        stream.complete.store(true, std::memory_order_release);
     }
-    if (wavFile) {
-        wavFile.close();
+    if (recFile) {
+        recFile.close();
     }
-    totalSamplesWritten = 0;
-    halvesCompleted = 0;
-    samplesRecorded = 0;
-    wavFileSize = 0;
-    recBuf = nullptr;
-    writeBuf = nullptr;
+    samplesCaptured = 0;
+    prerollSamples = 0;
+    dataStartSample = 0;
+    recSize = 0;
     recDotVisible = true;
     currentAudioState = AUDIO_IDLE;
 }
 
 void audioFreeBuffer() {
-    if (chunkBuffer != nullptr) {
-        heap_caps_free(chunkBuffer);
-        chunkBuffer = nullptr;
+    captureFreeBuffer();
+    if (encoderBuffer != nullptr) {
+        heap_caps_free(encoderBuffer);
+        encoderBuffer = nullptr;
+    }
+    if (prerollBuffer != nullptr) {
+        heap_caps_free(prerollBuffer);
+        prerollBuffer = nullptr;
     }
-    if (wavFile) {
-        wavFile.close();
+    if (recFile) {
+        recFile.close();
     }
 }
 
@@ -360,7 +486,7 @@ float getRecordingProgress() {
     if (currentAudioState != AUDIO_RECORDING) {
         return 0.0f;
     }
-    return (float)samplesRecorded / (float)AUDIO_TOTAL_SAMPLES;
+    return (float)samplesCaptured / (float)AUDIO_TOTAL_SAMPLES;
 }
 
 // Initial full screen draw - called once when recording starts
@@ -431,7 +557,7 @@ static void updateRecordingScreen(bool updateDot, bool updateSeconds, bool updat
         // Clear just the seconds area (top-right corner)
         M5.Display.fillRect(215, 4, 25, 14, TFT_BLACK);
 
-        int seconds = (AUDIO_TOTAL_SAMPLES - samplesRecorded) / AUDIO_SAMPLE_RATE;
+        int seconds = (AUDIO_TOTAL_SAMPLES - samplesCaptured) / AUDIO_SAMPLE_RATE;
         if (seconds < 0) seconds = 0;
         if (seconds > AUDIO_DURATION_SEC) seconds = AUDIO_DURATION_SEC;
 
@@ -0,0 +1,286 @@
+#include "classify_cache.h"
+#include "food_match.h"
+#include "text_norm.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#define CLASSIFY_LOG_MAGIC    "SBCC"
+#define CLASSIFY_LOG_VERSION  1
+#define CLASSIFY_LOG_TMP      "/classify.tmp"
+
+// Log records: a put stores an answer. Hits are not logged; compaction writes
+// the entries oldest use first, so replaying the puts rebuilds the LRU order.
+// Touches (a hit replayed) came from logs of older firmware and are still
+// read. Evictions are not logged: replaying the same sequence into a table of
+// the same capacity evicts the same entries.
+enum LogKind : uint8_t {
+    LOG_PUT   = 'P',
+    LOG_TOUCH = 'T'
+};
+
+struct LogRecord {
+    uint32_t hash;
+    uint8_t  value;
+    uint8_t  kind;
+    uint16_t check;  // detects a torn record at the end of the log
+};
+
+struct LogHeader {
+    char     magic[4];
+    uint32_t version;
+};
+
+struct CacheEntry {
+    uint32_t hash;
+    uint32_t lastUse;
+    uint8_t  value;
+};
+
+static CacheEntry entries[CLASSIFY_CACHE_CAPACITY];
+static int16_t slots[CLASSIFY_CACHE_SLOTS];  // entry index, -1 = empty
+static int entryCount = 0;
+static uint32_t useCounter = 0;
+static uint32_t logRecords = 0;
+static bool initialized = false;
+static bool available = false;   // LittleFS mounted: the cache is in use
+static bool orderDirty = false;  // hits since the log last matched the LRU order
+static ClassifyCacheStats stats = {};
+
+// FNV-1a over the normalized words, filler words left out
+static uint32_t transcriptHash(const char* text) {
+    char norm[TEXT_NORM_MAX];
+    textNormalize(text, norm, sizeof(norm));
+
+    uint32_t h = 2166136261u;
+    bool first = true;
+    const char* p = norm;
+    while (*p) {
+        const char* end = strchr(p, ' ');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (!foodMatchIsFiller(p, len)) {
+            if (!first) h = (h ^ ' ') * 16777619u;
+            for (size_t i = 0; i < len; i++) h = (h ^ (uint8_t)p[i]) * 16777619u;
+            first = false;
+        }
+        p += len;
+        if (*p == ' ') p++;
+    }
+    return h;
+}
+
+static uint16_t recordCheck(const LogRecord& r) {
+    return (uint16_t)(r.hash ^ (r.hash >> 16) ^ (r.value << 8) ^ r.kind ^ 0xA5A5);
+}
+
+static uint32_t homeSlot(uint32_t hash) {
+    return (hash * 2654435761u) >> 24 & (CLASSIFY_CACHE_SLOTS - 1);
+}
+
+static int findSlot(uint32_t hash) {
+    uint32_t s = homeSlot(hash);
+    while (slots[s] >= 0) {
+        if (entries[slots[s]].hash == hash) return s;
+        s = (s + 1) & (CLASSIFY_CACHE_SLOTS - 1);
+    }
+    return -1;
+}
+
+// Linear-probing delete: shift later members of the cluster back so lookups
+// never stop early at the hole
+static void removeSlot(uint32_t hole) {
+    uint32_t j = hole;
+    for (;;) {
+        j = (j + 1) & (CLASSIFY_CACHE_SLOTS - 1);
+        if (slots[j] < 0) break;
+        uint32_t home = homeSlot(entries[slots[j]].hash);
+        bool stays = (hole <= j) ? (hole < home && home <= j) : (hole < home || home <= j);
+        if (!stays) {
+            slots[hole] = slots[j];
+            hole = j;
+        }
+    }
+    slots[hole] = -1;
+}
+
+static void insertSlot(int entry) {
+    uint32_t s = homeSlot(entries[entry].hash);
+    while (slots[s] >= 0) s = (s + 1) & (CLASSIFY_CACHE_SLOTS - 1);
+    slots[s] = entry;
+}
+
+// Apply one log record to the in-RAM table
+static void apply(uint32_t hash, uint8_t value, LogKind kind) {
+    int s = findSlot(hash);
+    if (s >= 0) {
+        CacheEntry& e = entries[slots[s]];
+        if (kind == LOG_PUT) e.value = value;
+        e.lastUse = ++useCounter;
+        return;
+    }
+    if (kind != LOG_PUT) return;
+
+    int entry;
+    if (entryCount < CLASSIFY_CACHE_CAPACITY) {
+        entry = entryCount++;
+    } else {
+        entry = 0;
+        for (int i = 1; i < entryCount; i++) {
+            if (entries[i].lastUse < entries[entry].lastUse) entry = i;
+        }
+        removeSlot(findSlot(entries[entry].hash));
+    }
+    entries[entry] = { hash, ++useCounter, value };
+    insertSlot(entry);
+}
+
+static bool writeHeader(File& f) {
+    LogHeader h;
+    memcpy(h.magic, CLASSIFY_LOG_MAGIC, 4);
+    h.version = CLASSIFY_LOG_VERSION;
+    return f.write((const uint8_t*)&h, sizeof(h)) == sizeof(h);
+}
+
+static bool writeRecord(File& f, uint32_t hash, uint8_t value, LogKind kind) {
+    LogRecord r = { hash, value, kind, 0 };
+    r.check = recordCheck(r);
+    return f.write((const uint8_t*)&r, sizeof(r)) == sizeof(r);
+}
+
+// Rewrite the log as one put per live entry, oldest first, then swap it in
+static void compactLog() {
+    File f = LittleFS.open(CLASSIFY_LOG_TMP, "w");
+    if (!f) return;
+
+    int order[CLASSIFY_CACHE_CAPACITY];
+    for (int i = 0; i < entryCount; i++) {
+        int pos = i;
+        while (pos > 0 && entries[order[pos - 1]].lastUse > entries[i].lastUse) {
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        order[pos] = i;
+    }
+
+    bool ok = writeHeader(f);
+    for (int i = 0; i < entryCount && ok; i++) {
+        ok = writeRecord(f, entries[order[i]].hash, entries[order[i]].value, LOG_PUT);
+    }
+    f.close();
+
+    if (ok && LittleFS.rename(CLASSIFY_LOG_TMP, CLASSIFY_CACHE_PATH)) {
+        logRecords = entryCount;
+        orderDirty = false;
+        Serial.printf("[CACHE] Log compacted to %d records\n", entryCount);
+    } else {
+        LittleFS.remove(CLASSIFY_LOG_TMP);
+    }
+}
+
+static void appendLog(uint32_t hash, uint8_t value, LogKind kind) {
+    File f = LittleFS.open(CLASSIFY_CACHE_PATH, "a");
+    if (!f) return;
+    bool ok = (f.size() > 0 || writeHeader(f)) && writeRecord(f, hash, value, kind);
+    f.close();
+    if (ok) logRecords++;
+    if (logRecords > CLASSIFY_LOG_MAX_RECORDS) compactLog();
+}
+
+// Replay the log on first use. Builds that keep the food database in flash
+// never mount LittleFS at boot, and a recording in PSRAM never mounts it
+// either, so the cache mounts it itself.
+static void loadCache() {
+    if (initialized) return;
+    initialized = true;
+    unsigned long startTime = millis();
+
+    for (int i = 0; i < CLASSIFY_CACHE_SLOTS; i++) slots[i] = -1;
+#ifdef FOODDB_PROGMEM
+    // Nothing else lives on the partition: format it on a freshly flashed device
+    bool mounted = LittleFS.begin(true);
+#else
+    // Never format here: that would wipe the food database with it
+    bool mounted = LittleFS.begin(false);
+#endif
+    if (!mounted) {
+        Serial.println("[CACHE] LittleFS unavailable, cache off");
+        return;
+    }
+    available = true;
+
+    File f = LittleFS.open(CLASSIFY_CACHE_PATH, "r");
+    if (!f) return;
+
+    LogHeader h;
+    bool valid = f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+                 memcmp(h.magic, CLASSIFY_LOG_MAGIC, 4) == 0 && h.version == CLASSIFY_LOG_VERSION;
+    bool torn = valid && (f.size() - sizeof(h)) % sizeof(LogRecord) != 0;
+    LogRecord r;
+    while (valid && f.read((uint8_t*)&r, sizeof(r)) == sizeof(r)) {
+        if (r.check != recordCheck(r) || (r.kind != LOG_PUT && r.kind != LOG_TOUCH)) {
+            torn = true;
+            break;
+        }
+        apply(r.hash, r.value, (LogKind)r.kind);
+        logRecords++;
+    }
+    f.close();
+
+    if (!valid) {
+        LittleFS.remove(CLASSIFY_CACHE_PATH);
+    } else if (torn) {
+        compactLog();  // drop the partial tail so later appends stay readable
+    }
+    Serial.printf("[CACHE] %d entries from %u log records in %lu ms\n",
+                  entryCount, logRecords, millis() - startTime);
+}
+
+bool classifyCacheGet(const char* text, uint8_t& valueOut) {
+    loadCache();
+    if (!available) return false;
+    unsigned long startTime = micros();
+    uint32_t hash = transcriptHash(text);
+    int s = findSlot(hash);
+    uint32_t elapsed = micros() - startTime;
+    stats.lookupUsTotal += elapsed;
+    if (s >= 0) {
+        valueOut = entries[slots[s]].value;
+        apply(hash, valueOut, LOG_TOUCH);
+        orderDirty = true;
+        stats.hits++;
+    } else {
+        stats.misses++;
+    }
+
+    uint32_t total = stats.hits + stats.misses;
+    Serial.printf("[CACHE] %s %08x in %lu us, hit rate %u/%u (%u%%)",
+                  s >= 0 ? "Hit" : "Miss", hash, (unsigned long)elapsed,
+                  stats.hits, total, stats.hits * 100 / total);
+    if (s >= 0 && stats.remoteCalls > 0) {
+        Serial.printf(", saved ~%u ms", stats.remoteMsTotal / stats.remoteCalls);
+    }
+    Serial.println();
+    return s >= 0;
+}
+
+void classifyCachePut(const char* text, uint8_t value, uint32_t remoteMs) {
+    loadCache();
+    if (!available) return;
+    uint32_t hash = transcriptHash(text);
+    bool evicts = entryCount == CLASSIFY_CACHE_CAPACITY && findSlot(hash) < 0;
+    apply(hash, value, LOG_PUT);
+    // After hits the log's order is stale, and replaying it would evict
+    // another entry than this put did: write the table out instead
+    if (evicts && orderDirty) compactLog();
+    else appendLog(hash, value, LOG_PUT);
+    stats.remoteCalls++;
+    stats.remoteMsTotal += remoteMs;
+}
+
+void classifyCacheStats(ClassifyCacheStats& out) {
+    out = stats;
+    out.entries = entryCount;
+}
+
+void classifyCacheFlush() {
+    if (available && orderDirty) compactLog();
+}
@@ -0,0 +1,30 @@
+#include "classify_parse.h"
+#include "perf_probe.h"
+#include <Arduino.h>
+
+static const char* skipSpaces(const char* p) {
+    while (isspace((uint8_t)*p)) p++;
+    return p;
+}
+
+bool parseClassifyResponse(const char* content, FodmapLevel& fodmapOut, bool& glutenOut) {
+    PERF_PROBE("classify_parse");
+    if (strcasestr(content, "NOT_FOOD") || strcasestr(content, "NOT FOOD")) {
+        return false;
+    }
+
+    fodmapOut = FODMAP_UNKNOWN;
+    glutenOut = false;
+
+    const char* fodmap = strcasestr(content, "FODMAP:");
+    if (fodmap) {
+        fodmap = skipSpaces(fodmap + 7);
+        if (strncasecmp(fodmap, "LOW", 3) == 0)      fodmapOut = FODMAP_LOW;
+        else if (strncasecmp(fodmap, "MOD", 3) == 0) fodmapOut = FODMAP_MODERATE;
+        else if (strncasecmp(fodmap, "HIG", 3) == 0) fodmapOut = FODMAP_HIGH;
+    }
+
+    const char* gluten = strcasestr(content, "GLUTEN:");
+    if (gluten && strncasecmp(skipSpaces(gluten + 7), "YES", 3) == 0) glutenOut = true;
+    return true;
+}
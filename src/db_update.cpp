@@ -0,0 +1,171 @@
+#include "db_update.h"
+#include "food_db.h"
+#include "wifi_manager.h"
+#include "http_reader.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <LittleFS.h>
+
+#if __has_include("config.h")
+    #include "config.h"
+#endif
+
+#ifndef DB_UPDATE_PORT
+    #define DB_UPDATE_PORT 8000
+#endif
+
+#ifndef FOODDB_PROGMEM
+// Apply the stored delta and drop the file either way
+static bool applyPatch(const char*& errorOut) {
+    bool ok = foodDbApplyDelta(DB_UPDATE_PATCH_PATH, errorOut);
+    LittleFS.remove(DB_UPDATE_PATCH_PATH);
+    return ok;
+}
+
+// Copy `size` bytes from a stream into the patch file, optionally acking
+// each chunk on Serial; false on timeout or write failure
+static bool receivePatch(Stream& in, size_t size, bool ackChunks) {
+    File f = LittleFS.open(DB_UPDATE_PATCH_PATH, "w");
+    if (!f) return false;
+
+    uint8_t chunk[DB_UPDATE_CHUNK];
+    size_t received = 0;
+    bool ok = true;
+    while (ok && received < size) {
+        size_t want = size - received;
+        if (want > sizeof(chunk)) want = sizeof(chunk);
+        in.setTimeout(DB_UPDATE_TIMEOUT);
+        size_t n = in.readBytes(chunk, want);
+        ok = n == want && f.write(chunk, n) == n;
+        received += n;
+        if (ok && ackChunks) Serial.printf("DBPATCH ACK %u\n", (unsigned)received);
+    }
+    f.close();
+    if (!ok) LittleFS.remove(DB_UPDATE_PATCH_PATH);
+    return ok;
+}
+
+#define SERIAL_PREFIX      "DBPATCH "
+#define SERIAL_PREFIX_LEN  8
+
+// The "DBPATCH <size>" line as it arrives, across calls: nothing waits on
+// the console until the whole line is in, so stray input never holds up loop()
+static char serialLine[32];
+static size_t serialLen = 0;
+
+// Take what has arrived; true once a whole "DBPATCH <size>" line is in serialLine
+static bool readSerialLine() {
+    while (Serial.available() > 0) {
+        char c = (char)Serial.read();
+        if (c == '\n') {
+            bool whole = serialLen > SERIAL_PREFIX_LEN;
+            serialLine[serialLen] = '\0';
+            serialLen = 0;
+            if (whole) return true;
+            continue;
+        }
+        // The prefix, then the size: anything else drops the line, a 'D' may start a new one
+        bool fits = serialLen < SERIAL_PREFIX_LEN ? c == SERIAL_PREFIX[serialLen]
+                                                  : isdigit((unsigned char)c) || c == '\r';
+        if (fits && serialLen + 1 < sizeof(serialLine)) {
+            serialLine[serialLen++] = c;
+        } else {
+            serialLen = 0;
+            if (c == SERIAL_PREFIX[0]) serialLine[serialLen++] = c;
+        }
+    }
+    return false;
+}
+#endif
+
+bool dbUpdatePollSerial() {
+#ifdef FOODDB_PROGMEM
+    return false;
+#else
+    if (!readSerialLine()) return false;
+    long size = atol(serialLine + SERIAL_PREFIX_LEN);
+    if (size <= 0 || size > FOODDB_DELTA_MAX) {
+        Serial.println("DBPATCH ERR Bad size");
+        return false;
+    }
+    Serial.println("DBPATCH READY");
+    unsigned long timeout = Serial.getTimeout();
+    bool received = receivePatch(Serial, size, true);
+    Serial.setTimeout(timeout);
+    if (!received) {
+        Serial.println("DBPATCH ERR Transfer failed");
+        return false;
+    }
+
+    const char* error = nullptr;
+    if (!applyPatch(error)) {
+        Serial.printf("DBPATCH ERR %s\n", error);
+        return false;
+    }
+    Serial.printf("DBPATCH OK %08x\n", (unsigned)foodDbRevision());
+    return true;
+#endif
+}
+
+#if defined(DB_UPDATE_HOST) && !defined(FOODDB_PROGMEM)
+// One GET for the delta of the current revision. Returns 1 when a delta was
+// applied, 0 when the server has none, -1 on errors.
+static int fetchOne() {
+    char path[24];
+    snprintf(path, sizeof(path), "/%08x.sbdelta", (unsigned)foodDbRevision());
+
+    WiFiClient client;
+    client.setTimeout(DB_UPDATE_TIMEOUT / 1000);
+    if (!client.connect(DB_UPDATE_HOST, DB_UPDATE_PORT)) {
+        Serial.println("[UPDATE] Server unreachable");
+        return -1;
+    }
+    client.printf("GET %s HTTP/1.0\r\nHost: %s\r\n\r\n", path, DB_UPDATE_HOST);
+
+    // Status line, then headers up to the blank line
+    HttpResponse head;
+    httpReadHead(client, head);
+    int code = head.status;
+    long length = head.contentLength;
+
+    if (code == 404) {
+        client.stop();
+        Serial.printf("[UPDATE] Up to date (%s)\n", path + 1);
+        return 0;
+    }
+    if (code != 200 || length <= 0 || length > FOODDB_DELTA_MAX) {
+        client.stop();
+        Serial.printf("[UPDATE] GET %s: HTTP %d, %ld bytes\n", path, code, length);
+        return -1;
+    }
+    bool received = receivePatch(client, length, false);
+    client.stop();
+    if (!received) {
+        Serial.println("[UPDATE] Download failed");
+        return -1;
+    }
+
+    const char* error = nullptr;
+    if (!applyPatch(error)) {
+        Serial.printf("[UPDATE] %s: %s\n", path + 1, error);
+        return -1;
+    }
+    return 1;
+}
+#endif
+
+bool dbUpdateFetch() {
+#if defined(DB_UPDATE_HOST) && !defined(FOODDB_PROGMEM)
+    if (!isOnline() || getWifiState() != WIFI_STATE_CONNECTED) return false;
+    unsigned long startTime = millis();
+    int applied = 0;
+    while (applied < DB_UPDATE_MAX_CHAIN && fetchOne() == 1) applied++;
+    if (applied > 0) {
+        Serial.printf("[UPDATE] %d delta(s) applied in %lu ms, revision %08x\n",
+                      applied, millis() - startTime, (unsigned)foodDbRevision());
+    }
+    return applied > 0;
+#else
+    return false;
+#endif
+}
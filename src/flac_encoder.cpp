@@ -0,0 +1,261 @@
+#include "audio_encoder.h"
+#include <string.h>
+
+// FLAC subset stream, 16 kHz mono 16-bit. Each frame takes the best of the
+// fixed predictors (orders 0-4) with Rice-coded residuals in up to 16
+// partitions, falling back to verbatim samples when prediction does not pay.
+// Residuals are recomputed on every pass instead of stored, so a frame needs
+// no memory beyond its output.
+
+#define FLAC_HEADER_SIZE     42    // "fLaC" + STREAMINFO
+#define FLAC_BLOCK_SAMPLES   1152  // a standard size, coded in the frame header
+#define FLAC_MAX_ORDER       4
+#define FLAC_MAX_PARTITION   4     // 1152 = 72 << 4
+#define FLAC_MAX_RICE        14    // 15 is the escape code
+#define FLAC_MIN_PREDICTED   32    // shorter blocks (the end of a recording) go verbatim
+#define FLAC_FRAME_OVERHEAD  16    // frame header, subframe header and CRC-16, rounded up
+
+static uint32_t frameNumber = 0;
+
+struct BitWriter {
+    uint8_t* out;
+    size_t   capacity;
+    size_t   bytes;
+    uint32_t acc;     // pending bits, right-aligned
+    int      pending;
+    bool     overflow;
+};
+
+static void bitsPut(BitWriter& w, uint32_t value, int count) {
+    while (count > 0) {
+        int take = count > 16 ? 16 : count;
+        count -= take;
+        w.acc = (w.acc << take) | ((value >> count) & ((1u << take) - 1));
+        w.pending += take;
+        while (w.pending >= 8) {
+            w.pending -= 8;
+            if (w.bytes < w.capacity) w.out[w.bytes++] = (uint8_t)(w.acc >> w.pending);
+            else w.overflow = true;
+        }
+    }
+}
+
+static void bitsUnary(BitWriter& w, uint32_t zeros) {
+    while (zeros >= 16) {
+        bitsPut(w, 0, 16);
+        zeros -= 16;
+    }
+    bitsPut(w, 1, zeros + 1);
+}
+
+static void bitsAlign(BitWriter& w) {
+    if (w.pending > 0) bitsPut(w, 0, 8 - w.pending);
+}
+
+static uint8_t crc8(const uint8_t* data, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x8005) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+// Fixed predictor residual of sample i (i >= order)
+static int32_t residual(const int16_t* s, size_t i, int order) {
+    switch (order) {
+        case 0:  return s[i];
+        case 1:  return s[i] - s[i - 1];
+        case 2:  return s[i] - 2 * s[i - 1] + s[i - 2];
+        case 3:  return s[i] - 3 * s[i - 1] + 3 * s[i - 2] - s[i - 3];
+        default: return s[i] - 4 * s[i - 1] + 6 * s[i - 2] - 4 * s[i - 3] + s[i - 4];
+    }
+}
+
+static uint32_t zigzag(int32_t r) {
+    return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31);
+}
+
+// Rice parameter for n values summing to sum, and the bits it costs
+static int riceParam(uint64_t sum, size_t n, uint64_t& bits) {
+    int k = 0;
+    while (k < FLAC_MAX_RICE && ((uint64_t)n << (k + 1)) < sum) k++;
+    bits = 4 + n * (uint64_t)(k + 1) + (sum >> k);
+    return k;
+}
+
+static void flacBegin() {
+    frameNumber = 0;
+}
+
+static void flacHeader(uint8_t* out, uint32_t samples, uint32_t /* dataBytes */) {
+    if (samples == AUDIO_LENGTH_UNKNOWN) samples = 0;  // STREAMINFO's "unknown"
+    memcpy(out, "fLaC", 4);
+    out[4] = 0x80;  // last metadata block, STREAMINFO
+    out[5] = 0;
+    out[6] = 0;
+    out[7] = 34;
+
+    uint8_t* info = out + 8;
+    memset(info, 0, 34);  // frame sizes and MD5 unknown
+    info[0] = FLAC_BLOCK_SAMPLES >> 8;
+    info[1] = FLAC_BLOCK_SAMPLES & 0xFF;
+    info[2] = FLAC_BLOCK_SAMPLES >> 8;
+    info[3] = FLAC_BLOCK_SAMPLES & 0xFF;
+    // 20 bits rate, 3 bits channels - 1, 5 bits bits per sample - 1, 36 bits samples
+    uint32_t rate = 16000;
+    info[10] = (rate >> 12) & 0xFF;
+    info[11] = (rate >> 4) & 0xFF;
+    info[12] = ((rate & 0x0F) << 4) | (0 << 1) | ((16 - 1) >> 4);
+    info[13] = (((16 - 1) & 0x0F) << 4);  // total samples < 2^32: top 4 bits zero
+    info[14] = (samples >> 24) & 0xFF;
+    info[15] = (samples >> 16) & 0xFF;
+    info[16] = (samples >> 8) & 0xFF;
+    info[17] = samples & 0xFF;
+}
+
+static void writeFrameHeader(BitWriter& w, size_t count) {
+    bool standard = count == FLAC_BLOCK_SAMPLES;
+    bitsPut(w, 0xFFF8, 16);               // sync, fixed block size
+    bitsPut(w, standard ? 0x3 : 0x7, 4);  // 1152, or 16-bit size at the end
+    bitsPut(w, 0x5, 4);                   // 16 kHz
+    bitsPut(w, 0x0, 4);                   // mono
+    bitsPut(w, 0x4, 3);                   // 16 bits per sample
+    bitsPut(w, 0, 1);
+
+    // Frame number, UTF-8 style
+    uint32_t n = frameNumber;
+    if (n < 0x80) {
+        bitsPut(w, n, 8);
+    } else if (n < 0x800) {
+        bitsPut(w, 0xC0 | (n >> 6), 8);
+        bitsPut(w, 0x80 | (n & 0x3F), 8);
+    } else {
+        bitsPut(w, 0xE0 | ((n >> 12) & 0x0F), 8);
+        bitsPut(w, 0x80 | ((n >> 6) & 0x3F), 8);
+        bitsPut(w, 0x80 | (n & 0x3F), 8);
+    }
+    if (!standard) bitsPut(w, (uint32_t)(count - 1), 16);
+
+    bitsPut(w, crc8(w.out, w.bytes), 8);
+}
+
+static void writeVerbatim(BitWriter& w, const int16_t* s, size_t count) {
+    bitsPut(w, 0x01 << 1, 8);
+    for (size_t i = 0; i < count; i++) bitsPut(w, (uint16_t)s[i], 16);
+}
+
+static void writeFixed(BitWriter& w, const int16_t* s, size_t count, int order, int partitionOrder) {
+    bitsPut(w, (0x08 | order) << 1, 8);
+    for (int i = 0; i < order; i++) bitsPut(w, (uint16_t)s[i], 16);
+
+    bitsPut(w, 0, 2);  // Rice, 4-bit parameters
+    bitsPut(w, partitionOrder, 4);
+    size_t partSize = count >> partitionOrder;
+    size_t i = order;
+    for (int p = 0; p < (1 << partitionOrder); p++) {
+        size_t end = (p + 1) * partSize;
+        uint64_t sum = 0;
+        for (size_t j = i; j < end; j++) sum += zigzag(residual(s, j, order));
+        uint64_t bits;
+        int k = riceParam(sum, end - i, bits);
+        bitsPut(w, k, 4);
+        for (; i < end; i++) {
+            uint32_t u = zigzag(residual(s, i, order));
+            bitsUnary(w, u >> k);
+            if (k) bitsPut(w, u & ((1u << k) - 1), k);
+        }
+    }
+}
+
+static size_t flacEncodeBlock(const int16_t* s, size_t count, uint8_t* out) {
+    // Room for a verbatim frame; the CRC-16 goes in the last two bytes
+    BitWriter w = { out, FLAC_FRAME_OVERHEAD - 2 + count * sizeof(int16_t), 0, 0, 0, false };
+    writeFrameHeader(w, count);
+    size_t headerBytes = w.bytes;
+
+    bool constant = true;
+    for (size_t i = 1; i < count && constant; i++) constant = s[i] == s[0];
+
+    if (constant) {
+        bitsPut(w, 0, 8);  // digital silence
+        bitsPut(w, (uint16_t)s[0], 16);
+    } else {
+        // Order with the smallest residuals, then the partitioning that codes them best
+        int order = -1;
+        int partitionOrder = 0;
+        uint64_t bestBits = (uint64_t)count * 16;
+        if (count >= FLAC_MIN_PREDICTED) {
+            uint64_t bestSum = UINT64_MAX;
+            for (int o = 0; o <= FLAC_MAX_ORDER; o++) {
+                uint64_t sum = 0;
+                for (size_t i = o; i < count; i++) sum += zigzag(residual(s, i, o));
+                if (sum < bestSum) {
+                    bestSum = sum;
+                    order = o;
+                }
+            }
+
+            int maxPartition = 0;
+            while (maxPartition < FLAC_MAX_PARTITION && count % (2u << maxPartition) == 0 &&
+                   (count >> (maxPartition + 1)) > FLAC_MAX_ORDER) {
+                maxPartition++;
+            }
+            uint64_t sums[1 << FLAC_MAX_PARTITION] = {};
+            size_t fine = count >> maxPartition;
+            for (size_t i = order; i < count; i++) sums[i / fine] += zigzag(residual(s, i, order));
+
+            uint64_t orderBits = UINT64_MAX;
+            for (int po = maxPartition; po >= 0; po--) {
+                int parts = 1 << po;
+                uint64_t bits = 6 + order * 16;
+                for (int p = 0; p < parts; p++) {
+                    size_t n = (count >> po) - (p == 0 ? order : 0);
+                    uint64_t partBits;
+                    riceParam(sums[p], n, partBits);
+                    bits += partBits;
+                }
+                if (bits < orderBits) {
+                    orderBits = bits;
+                    partitionOrder = po;
+                }
+                for (int p = 0; p < parts / 2; p++) sums[p] = sums[2 * p] + sums[2 * p + 1];
+            }
+            if (orderBits >= bestBits) order = -1;
+        }
+
+        if (order >= 0) {
+            writeFixed(w, s, count, order, partitionOrder);
+            bitsAlign(w);
+        }
+        if (order < 0 || w.overflow) {
+            // Prediction did not pay (noise, clipping): start over with the samples as they are
+            w.bytes = headerBytes;
+            w.pending = 0;
+            w.overflow = false;
+            writeVerbatim(w, s, count);
+        }
+    }
+
+    bitsAlign(w);
+    w.capacity += 2;
+    uint16_t crc = crc16(out, w.bytes);
+    bitsPut(w, crc, 16);
+    frameNumber++;
+    return w.bytes;
+}
+
+const AudioEncoder FLAC_ENCODER = {
+    "FLAC", "audio.flac", "audio/flac",
+    FLAC_HEADER_SIZE, FLAC_BLOCK_SAMPLES, FLAC_FRAME_OVERHEAD + FLAC_BLOCK_SAMPLES * sizeof(int16_t),
+    flacBegin, flacHeader, flacEncodeBlock
+};
@@ -0,0 +1,226 @@
+#include "food_alpha.h"
+#include "food_db.h"
+#include "language.h"
+#include "text_norm.h"
+#include <Arduino.h>
+
+// Section layout (see scripts/foods_db.py): u32 food count, u32 category
+// count, u16 category starts, u16 order[2][foods], u16 buckets[2][categories][27]
+#define ALPHA_HEADER_SIZE  8
+#define ALPHA_SCAN_CHUNK   32
+
+static uint32_t sectionFoods = 0;
+static uint32_t sectionCategories = 0;
+static uint8_t viewLang = LANG_EN;
+static int imageBegin = 0;  // category start in the image
+static int imageCount = 0;
+static uint16_t buckets[ALPHA_BUCKETS];
+
+// Images without the section (imported from foods.json) list the category in
+// database order and have no letter search
+static bool sorted = false;
+static int viewBegin = 0;  // category start in the merged view
+static int viewCount = 0;
+
+// Delta updates: image entries of changed records are skipped, their current
+// versions (from the overlay) are merged in by key
+static uint16_t skips[FOODDB_OVERLAY_MAX];      // sorted positions in the image order
+static int skipCount = 0;
+static int extras[FOODDB_OVERLAY_MAX];          // food indices, sorted by key
+static uint16_t extraPos[FOODDB_OVERLAY_MAX];   // image position each one precedes
+static int extraCount = 0;
+
+static uint32_t ordersOffset() {
+    return ALPHA_HEADER_SIZE + (sectionCategories + 1) * sizeof(uint16_t);
+}
+
+static uint32_t bucketsOffset() {
+    return ordersOffset() + LANG_COUNT * sectionFoods * sizeof(uint16_t);
+}
+
+// Image index at a position of the image order
+static int imageAt(int pos) {
+    uint16_t index;
+    uint32_t offset = ordersOffset() + (viewLang * sectionFoods + imageBegin + pos) * sizeof(index);
+    if (!foodDbSectionRead(FOODDB_SECTION_ALPHA, offset, &index, sizeof(index))) return -1;
+    return index;
+}
+
+static void keyOf(const Food& f, char* key) {
+    textCollate(viewLang == LANG_PT ? f.name_pt : f.name_en, key, TEXT_NORM_MAX);
+}
+
+static int imageLowerBound(const char* key) {
+    int lo = 0, hi = imageCount;
+    char c = key[0];
+    if (c == '\0') return 0;
+    if (c >= 'a' && c <= 'z') {
+        // Only the foods under the same initial need comparing
+        int b = 1 + (c - 'a');
+        lo = buckets[b];
+        hi = (b + 1 < ALPHA_BUCKETS) ? buckets[b + 1] : imageCount;
+    } else if (c < 'a') {
+        hi = buckets[1];
+    } else {
+        return imageCount;
+    }
+
+    char probe[TEXT_NORM_MAX];
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        keyOf(foodDbImageFood(imageAt(mid)), probe);
+        if (strcmp(probe, key) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+void alphaOpen(int category, uint8_t lang) {
+    unsigned long startTime = micros();
+    viewLang = lang < LANG_COUNT ? lang : LANG_EN;
+    imageBegin = 0;
+    imageCount = 0;
+    skipCount = 0;
+    extraCount = 0;
+    sorted = false;
+    viewBegin = 0;
+    viewCount = 0;
+
+    uint32_t counts[2];
+    uint16_t range[2];
+    if (category < 0 || category >= foodDbCategoryCount()) return;
+    if (foodDbSectionSize(FOODDB_SECTION_ALPHA) == 0) {
+        int end;
+        foodDbCategoryRange(category, viewBegin, end);
+        viewCount = end - viewBegin;
+        Serial.printf("[ALPHA] Category %d: %d foods, unsorted (no alpha section)\n", category, viewCount);
+        return;
+    }
+    if (!foodDbSectionRead(FOODDB_SECTION_ALPHA, 0, counts, sizeof(counts)) ||
+        (uint32_t)category >= counts[1]) {
+        return;
+    }
+    sorted = true;
+    sectionFoods = counts[0];
+    sectionCategories = counts[1];
+    uint32_t bucketAt = bucketsOffset() + (viewLang * sectionCategories + category) * sizeof(buckets);
+    if (!foodDbSectionRead(FOODDB_SECTION_ALPHA, ALPHA_HEADER_SIZE + category * sizeof(uint16_t),
+                           range, sizeof(range)) ||
+        !foodDbSectionRead(FOODDB_SECTION_ALPHA, bucketAt, buckets, sizeof(buckets))) {
+        return;
+    }
+    imageBegin = range[0];
+    imageCount = range[1] - range[0];
+
+    // Image entries replaced or deleted by a delta (none without an overlay)
+    uint16_t chunk[ALPHA_SCAN_CHUNK];
+    for (int at = 0; at < imageCount; at += ALPHA_SCAN_CHUNK) {
+        int n = imageCount - at;
+        if (n > ALPHA_SCAN_CHUNK) n = ALPHA_SCAN_CHUNK;
+        uint32_t offset = ordersOffset() + (viewLang * sectionFoods + imageBegin + at) * sizeof(uint16_t);
+        if (!foodDbSectionRead(FOODDB_SECTION_ALPHA, offset, chunk, n * sizeof(uint16_t))) break;
+        for (int k = 0; k < n && skipCount < FOODDB_OVERLAY_MAX; k++) {
+            if (foodDbFromImageIndex(chunk[k]) < 0) skips[skipCount++] = at + k;
+        }
+    }
+
+    // Their current versions, and foods added by deltas, in key order
+    int changed[FOODDB_OVERLAY_MAX];
+    int changedCount = foodDbOverlayFoods(changed, FOODDB_OVERLAY_MAX);
+    char key[TEXT_NORM_MAX], other[TEXT_NORM_MAX];
+    for (int i = 0; i < changedCount; i++) {
+        Food f = foodDbGetFood(changed[i]);
+        if (f.category != category) continue;
+        keyOf(f, key);
+        int pos = extraCount++;
+        for (; pos > 0; pos--) {
+            keyOf(foodDbGetFood(extras[pos - 1]), other);
+            if (strcmp(other, key) <= 0) break;
+            extras[pos] = extras[pos - 1];
+            extraPos[pos] = extraPos[pos - 1];
+        }
+        extras[pos] = changed[i];
+        extraPos[pos] = imageLowerBound(key);
+    }
+
+    Serial.printf("[ALPHA] Category %d: %d foods (%d changed) in %lu us\n",
+                  category, alphaCount(), extraCount, micros() - startTime);
+}
+
+int alphaCount() {
+    if (!sorted) return viewCount;
+    return imageCount - skipCount + extraCount;
+}
+
+bool alphaSorted() {
+    return sorted;
+}
+
+int alphaFood(int pos) {
+    if (!sorted) return (pos >= 0 && pos < viewCount) ? viewBegin + pos : -1;
+
+    // Walk the image order, skipping and inserting changed records
+    int i = 0, m = 0, s = 0, e = 0;
+    for (;;) {
+        int boundary = imageCount;
+        if (s < skipCount && skips[s] < boundary) boundary = skips[s];
+        if (e < extraCount && extraPos[e] < boundary) boundary = extraPos[e];
+        if (pos < m + (boundary - i)) return foodDbFromImageIndex(imageAt(i + pos - m));
+        m += boundary - i;
+        i = boundary;
+
+        if (e < extraCount && extraPos[e] == i) {
+            if (pos == m) return extras[e];
+            m++;
+            e++;
+        } else if (s < skipCount && skips[s] == i) {
+            i++;
+            s++;
+        } else {
+            return -1;  // past the end
+        }
+    }
+}
+
+int alphaLowerBound(const char* key) {
+    if (!sorted) return 0;
+    int lb = imageLowerBound(key);
+    int pos = lb;
+    for (int s = 0; s < skipCount && skips[s] < lb; s++) pos--;
+
+    char other[TEXT_NORM_MAX];
+    for (int e = 0; e < extraCount; e++) {
+        keyOf(foodDbGetFood(extras[e]), other);
+        if (strcmp(other, key) >= 0) break;
+        pos++;
+    }
+    return pos;
+}
+
+void alphaPrefixRange(const char* prefix, int& begin, int& end) {
+    char bound[TEXT_NORM_MAX + 1];
+    snprintf(bound, sizeof(bound), "%s\x7f", prefix);  // after every key starting with prefix
+    begin = alphaLowerBound(prefix);
+    end = alphaLowerBound(bound);
+}
+
+char alphaNextChar(const char* prefix, char after) {
+    size_t len = strlen(prefix);
+    if (!sorted || len + 1 >= TEXT_NORM_MAX) return '\0';
+
+    char target[TEXT_NORM_MAX + 1];
+    memcpy(target, prefix, len);
+    target[len] = after ? after + 1 : ' ';  // space is the smallest key character
+    target[len + 1] = '\0';
+
+    int begin, end;
+    alphaPrefixRange(prefix, begin, end);
+    int pos = alphaLowerBound(target);
+    if (pos >= end) return '\0';
+
+    int food = alphaFood(pos);
+    if (food < 0) return '\0';
+    char key[TEXT_NORM_MAX];
+    keyOf(foodDbGetFood(food), key);
+    return key[len];
+}
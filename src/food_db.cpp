@@ -0,0 +1,1308 @@
+#include "food_db.h"
+#include "json_stream.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <new>
+
+#ifdef FOODDB_PROGMEM
+
+// Tables compiled into flash: nothing to load, nothing on the heap
+#include "foods_table.h"
+
+static const int FOOD_COUNT = sizeof(FOODDB_FOODS) / sizeof(FOODDB_FOODS[0]);
+static const int CATEGORY_COUNT = sizeof(FOODDB_CATEGORIES) / sizeof(FOODDB_CATEGORIES[0]);
+
+bool foodDbLoad(const char*& /* errorOut */) {
+    Serial.printf("[DB] Built-in table: %d foods, %d categories\n", FOOD_COUNT, CATEGORY_COUNT);
+    return true;
+}
+
+int foodDbFoodCount() {
+    return FOOD_COUNT;
+}
+
+int foodDbCategoryCount() {
+    return CATEGORY_COUNT;
+}
+
+Food foodDbGetFood(int index) {
+    return FOODDB_FOODS[index];
+}
+
+Category foodDbGetCategory(int index) {
+    return FOODDB_CATEGORIES[index];
+}
+
+void foodDbCategoryRange(int category, int& begin, int& end) {
+    begin = FOODDB_CATEGORY_START[category];
+    end = FOODDB_CATEGORY_START[category + 1];
+}
+
+void foodDbCacheStats(uint32_t& hits, uint32_t& misses) {
+    hits = 0;
+    misses = 0;
+}
+
+static const FoodDbBlob* findSection(uint16_t id) {
+    for (const FoodDbBlob& s : FOODDB_SECTIONS) {
+        if (s.id == id) return &s;
+    }
+    return nullptr;
+}
+
+uint32_t foodDbSectionSize(uint16_t id) {
+    const FoodDbBlob* s = findSection(id);
+    return s ? s->size : 0;
+}
+
+bool foodDbSectionRead(uint16_t id, uint32_t offset, void* dst, size_t len) {
+    const FoodDbBlob* s = findSection(id);
+    if (s == nullptr || offset > s->size || len > s->size - offset) return false;
+    memcpy(dst, s->data + offset, len);
+    return true;
+}
+
+bool foodDbSectionReadDirect(uint16_t id, uint32_t offset, void* dst, size_t len) {
+    return foodDbSectionRead(id, offset, dst, len);  // flash is memory-mapped: no cache to spare
+}
+
+uint32_t foodDbRevision() {
+    return FOODDB_REVISION;
+}
+
+bool foodDbApplyDelta(const char* /* path */, const char*& errorOut) {
+    errorOut = "Built-in DB";  // updating it means re-flashing the firmware
+    return false;
+}
+
+int foodDbFromImageIndex(int imageIndex) {
+    return imageIndex;
+}
+
+Food foodDbImageFood(int imageIndex) {
+    return foodDbGetFood(imageIndex);
+}
+
+void foodDbImageCategoryRange(int category, int& begin, int& end) {
+    foodDbCategoryRange(category, begin, end);
+}
+
+int foodDbOverlayFoods(int* /* out */, int /* max */) {
+    return 0;
+}
+
+#else
+
+// Page 0 header (little-endian, matches scripts/foods_db.py)
+struct FoodDbHeader {
+    char     magic[4];
+    uint16_t version;
+    uint16_t pageSize;
+    uint16_t foodCount;
+    uint16_t categoryCount;
+    uint16_t foodsPerPage;
+    uint16_t categoriesPerPage;
+    uint16_t rangePage;     // u16 start index per category, plus the food count
+    uint16_t categoryPage;  // first page of category records
+    uint16_t foodPage;      // first page of food records
+    uint16_t pageCount;
+    uint16_t sectionCount;  // FoodDbSection entries follow the header
+    uint16_t flags;         // IMPORTED_FLAG: built on the device from foods.json
+    uint32_t revision;      // content CRC-32, see scripts/foods_db.py
+};
+
+#define IMPORTED_FLAG  0x0001
+
+struct FoodDbSection {
+    uint16_t id;
+    uint16_t firstPage;
+    uint32_t size;       // bytes
+};
+
+// LRU page cache: RAM use is fixed no matter how many foods the image holds
+struct CachedPage {
+    int32_t  page;      // -1 = empty slot
+    uint32_t lastUse;
+    uint8_t  data[FOODDB_PAGE_SIZE];
+};
+
+static File dbFile;
+static FoodDbHeader header;
+static FoodDbSection sections[FOODDB_MAX_SECTIONS];
+static bool loaded = false;
+static CachedPage cache[FOODDB_CACHE_PAGES];
+static uint32_t useCounter = 0;
+static uint32_t cacheHits = 0;
+static uint32_t cacheMisses = 0;
+
+// Records changed by delta updates (see "Overlay" below)
+struct OverlayFood {
+    uint16_t       id;
+    int32_t        image;    // image index of the same id, -1 = not in the image
+    bool           deleted;
+    bool           inPlace;  // same category as the image record: shown at its index
+    Food           food;     // names point into overlayData
+    const uint8_t* change;   // encoded change record in overlayData
+    size_t         changeLen;
+};
+
+static uint8_t overlayData[FOODDB_OVERLAY_BYTES];  // overlay file contents
+static OverlayFood overlay[FOODDB_OVERLAY_MAX];
+static int overlayCount = 0;
+static uint16_t hidden[FOODDB_OVERLAY_MAX];        // image indices not shown in place, sorted
+static int hiddenCount = 0;
+static uint16_t foodStart[257];                     // per-category start of the merged view
+static uint32_t revision = 0;
+
+static void loadOverlay();
+static bool importWanted();
+static bool importJson(const char*& errorOut);
+
+// Returned when a page cannot be read (flash error or corrupt page)
+static const Food MISSING_FOOD = { "?", "?", 0, FODMAP_UNKNOWN };
+static const Category MISSING_CATEGORY = { "?", "?", "?" };
+
+static uint32_t pagesFor(uint32_t count, uint32_t perPage) {
+    return perPage ? (count + perPage - 1) / perPage : 0;
+}
+
+static uint32_t foodPageCount() {
+    return pagesFor(header.foodCount, header.foodsPerPage);
+}
+
+static void invalidateCache() {
+    for (int i = 0; i < FOODDB_CACHE_PAGES; i++) {
+        cache[i].page = -1;
+        cache[i].lastUse = 0;
+    }
+}
+
+// Record pages start with a u16 offset per slot and end in a NUL pad byte.
+// Each record is `fixedBytes` of fields then `strings` NUL-terminated strings,
+// all of which must end inside the page
+static bool recordPageValid(const uint8_t* data, uint16_t slots, uint16_t fixedBytes, int strings) {
+    if (data[FOODDB_PAGE_SIZE - 1] != '\0') return false;
+    const uint16_t* offsets = (const uint16_t*)data;
+    for (uint16_t i = 0; i < slots; i++) {
+        uint32_t at = offsets[i];
+        if (at < slots * sizeof(uint16_t) || at > (uint32_t)(FOODDB_PAGE_SIZE - fixedBytes - strings)) return false;
+        at += fixedBytes;
+        for (int s = 0; s < strings; s++) {
+            const uint8_t* nul = (const uint8_t*)memchr(data + at, '\0', FOODDB_PAGE_SIZE - at);
+            if (nul == nullptr) return false;
+            at = nul - data + 1;
+        }
+    }
+    return true;
+}
+
+static const uint8_t* getPage(uint16_t page) {
+    // Hit, or pick the least recently used slot (empty slots have lastUse 0)
+    CachedPage* victim = &cache[0];
+    for (int i = 0; i < FOODDB_CACHE_PAGES; i++) {
+        if (cache[i].page == page) {
+            cache[i].lastUse = ++useCounter;
+            cacheHits++;
+            return cache[i].data;
+        }
+        if (cache[i].lastUse < victim->lastUse) victim = &cache[i];
+    }
+
+    cacheMisses++;
+    victim->page = -1;
+    victim->lastUse = 0;
+    if (!dbFile || page >= header.pageCount ||
+        !dbFile.seek((uint32_t)page * FOODDB_PAGE_SIZE) ||
+        dbFile.read(victim->data, FOODDB_PAGE_SIZE) != FOODDB_PAGE_SIZE) {
+        Serial.printf("[DB] Page %u read failed\n", page);
+        return nullptr;
+    }
+
+    // Validate record pages once, when they enter the cache (section pages are raw bytes)
+    bool valid = true;
+    if (page >= header.foodPage + foodPageCount()) valid = true;
+    else if (page >= header.foodPage) valid = recordPageValid(victim->data, header.foodsPerPage, 2, 2);
+    else if (page >= header.categoryPage) valid = recordPageValid(victim->data, header.categoriesPerPage, 0, 3);
+    if (!valid) {
+        Serial.printf("[DB] Page %u corrupt\n", page);
+        return nullptr;
+    }
+
+    victim->page = page;
+    victim->lastUse = ++useCounter;
+    return victim->data;
+}
+
+// Locate record `index` of a section with `perPage` records per page
+static const uint8_t* getRecord(uint16_t firstPage, uint16_t perPage, int index) {
+    const uint8_t* data = getPage(firstPage + index / perPage);
+    if (data == nullptr) return nullptr;
+    const uint16_t* offsets = (const uint16_t*)data;
+    return data + offsets[index % perPage];
+}
+
+static uint16_t rangeEntry(int i) {
+    const uint8_t* data = getPage(header.rangePage);
+    if (data == nullptr) return 0;
+    return ((const uint16_t*)data)[i];
+}
+
+static void closeDb() {
+    if (dbFile) {
+        dbFile.close();
+    }
+    invalidateCache();
+    loaded = false;
+    header.sectionCount = 0;
+    overlayCount = 0;
+    hiddenCount = 0;
+}
+
+bool foodDbLoad(const char*& errorOut) {
+    unsigned long startTime = millis();
+
+    closeDb();
+
+    // A foods.json on the filesystem stands in for a missing image, or
+    // replaces one imported earlier, and is consumed by the import
+    if (LittleFS.exists(FOODDB_JSON_PATH) && importWanted()) {
+        const char* importError = nullptr;
+        if (importJson(importError)) {
+            LittleFS.remove(FOODDB_JSON_PATH);
+        } else if (!LittleFS.exists(FOODDB_PATH)) {
+            errorOut = importError;
+            return false;
+        } else {
+            Serial.printf("[DB] foods.json not imported: %s\n", importError);
+        }
+    }
+
+    dbFile = LittleFS.open(FOODDB_PATH, "r");
+    if (!dbFile) {
+        errorOut = "No foods.bin!";
+        return false;
+    }
+
+    if (dbFile.read((uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+        closeDb();
+        errorOut = "DB too small";
+        return false;
+    }
+    if (memcmp(header.magic, FOODDB_MAGIC, 4) != 0) {
+        closeDb();
+        errorOut = "Bad DB image";
+        return false;
+    }
+    if (header.version != FOODDB_VERSION || header.pageSize != FOODDB_PAGE_SIZE) {
+        closeDb();
+        errorOut = "DB version mismatch";
+        return false;
+    }
+
+    // Layout: header | ranges | category pages | food pages | optional sections
+    uint32_t categoryPages = pagesFor(header.categoryCount, header.categoriesPerPage);
+    uint32_t nextPage = header.foodPage + foodPageCount();
+    size_t tableSize = header.sectionCount * sizeof(FoodDbSection);
+    bool sectionsOk = header.sectionCount <= FOODDB_MAX_SECTIONS &&
+        (size_t)dbFile.read((uint8_t*)sections, tableSize) == tableSize;
+    for (uint16_t i = 0; i < header.sectionCount && sectionsOk; i++) {
+        sectionsOk = (sections[i].firstPage == nextPage);
+        nextPage += pagesFor(sections[i].size, FOODDB_PAGE_SIZE);
+    }
+    if (!sectionsOk || header.categoryCount == 0 || header.foodsPerPage == 0 || header.categoriesPerPage == 0 ||
+        (header.categoryCount + 1) * sizeof(uint16_t) > FOODDB_PAGE_SIZE ||
+        header.rangePage != 1 ||
+        header.categoryPage != header.rangePage + 1 ||
+        header.foodPage != header.categoryPage + categoryPages ||
+        header.pageCount != nextPage ||
+        dbFile.size() != (size_t)header.pageCount * FOODDB_PAGE_SIZE) {
+        closeDb();
+        errorOut = "DB size mismatch";
+        return false;
+    }
+
+    // Ranges must tile [0, foodCount)
+    uint16_t prev = rangeEntry(0);
+    bool rangesOk = (prev == 0);
+    for (int c = 1; c <= header.categoryCount && rangesOk; c++) {
+        uint16_t next = rangeEntry(c);
+        rangesOk = (next >= prev);
+        prev = next;
+    }
+    if (!rangesOk || prev != header.foodCount) {
+        closeDb();
+        errorOut = "DB index corrupt";
+        return false;
+    }
+
+    loaded = true;
+    loadOverlay();
+    Serial.printf("[DB] Opened %u foods, %u categories (%u pages) in %lu ms, page cache %u bytes\n",
+                  header.foodCount, header.categoryCount, header.pageCount,
+                  millis() - startTime, (unsigned)sizeof(cache));
+    return true;
+}
+
+int foodDbCategoryCount() {
+    return loaded ? header.categoryCount : 0;
+}
+
+// Food record as stored in the image, by image index
+static Food imageFood(int index) {
+    if (index < 0 || index >= header.foodCount) return MISSING_FOOD;
+    const uint8_t* rec = getRecord(header.foodPage, header.foodsPerPage, index);
+    if (rec == nullptr) return MISSING_FOOD;
+
+    // Record: u8 category, u8 attrs, name_pt\0, name_en\0
+    Food f;
+    f.category = rec[0] < header.categoryCount ? rec[0] : 0;
+    f.attrs    = rec[1];
+    f.name_pt  = (const char*)rec + 2;
+    f.name_en  = f.name_pt + strlen(f.name_pt) + 1;
+    return f;
+}
+
+Category foodDbGetCategory(int index) {
+    const uint8_t* rec = getRecord(header.categoryPage, header.categoriesPerPage, index);
+    if (rec == nullptr) return MISSING_CATEGORY;
+
+    // Record: id\0, name_pt\0, name_en\0
+    Category c;
+    c.id      = (const char*)rec;
+    c.name_pt = c.id + strlen(c.id) + 1;
+    c.name_en = c.name_pt + strlen(c.name_pt) + 1;
+    return c;
+}
+
+void foodDbCacheStats(uint32_t& hits, uint32_t& misses) {
+    hits = cacheHits;
+    misses = cacheMisses;
+}
+
+static const FoodDbSection* findSection(uint16_t id) {
+    if (!loaded) return nullptr;
+    for (uint16_t i = 0; i < header.sectionCount; i++) {
+        if (sections[i].id == id) return &sections[i];
+    }
+    return nullptr;
+}
+
+uint32_t foodDbSectionSize(uint16_t id) {
+    const FoodDbSection* s = findSection(id);
+    return s ? s->size : 0;
+}
+
+// Sections are contiguous pages, so a read may span several cached pages
+bool foodDbSectionRead(uint16_t id, uint32_t offset, void* dst, size_t len) {
+    const FoodDbSection* s = findSection(id);
+    if (s == nullptr || offset > s->size || len > s->size - offset) return false;
+
+    uint8_t* out = (uint8_t*)dst;
+    while (len > 0) {
+        const uint8_t* data = getPage(s->firstPage + offset / FOODDB_PAGE_SIZE);
+        if (data == nullptr) return false;
+        uint32_t inPage = offset % FOODDB_PAGE_SIZE;
+        size_t n = FOODDB_PAGE_SIZE - inPage;
+        if (n > len) n = len;
+        memcpy(out, data + inPage, n);
+        out += n;
+        offset += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool foodDbSectionReadDirect(uint16_t id, uint32_t offset, void* dst, size_t len) {
+    const FoodDbSection* s = findSection(id);
+    if (s == nullptr || offset > s->size || len > s->size - offset) return false;
+    if (!dbFile || !dbFile.seek((uint32_t)s->firstPage * FOODDB_PAGE_SIZE + offset) ||
+        (size_t)dbFile.read((uint8_t*)dst, len) != len) {
+        Serial.printf("[DB] Section %u read failed\n", id);
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Overlay
+//
+// /foods.ovl holds the merged effect of all deltas applied since the image
+// was uploaded, as change records keyed by stable id (same encoding as the
+// delta ops of scripts/foods_delta.py, with 'P' for a put):
+//
+//   magic "SBOV", u16 version, u16 count, u32 image revision, u32 revision,
+//   records: u8 'P' | 'D', u16 id, ['P': u8 category, u8 attrs, name_pt\0 name_en\0]
+//   u32 CRC-32 of everything before it
+//
+// Food indices seen by the UI are a merged view: per category, the image
+// records that were neither deleted nor moved (modified ones shown in place),
+// then the added or moved records.
+
+#define DELTA_MAGIC     "SBDP"
+#define OVERLAY_MAGIC   "SBOV"
+#define CHANGES_VERSION 1
+#define OVERLAY_TMP     "/foods.tmp"
+
+struct ChangeSetHeader {
+    char     magic[4];
+    uint16_t version;
+    uint16_t count;
+    uint32_t fromRevision;  // overlay: revision of the image it applies to
+    uint32_t toRevision;
+};
+
+// CRC-32; pass the previous result as `crc` to continue over more data
+static uint32_t changeSetCrc(const uint8_t* data, size_t len, uint32_t crc = 0) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *data++;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+// Check magic, version and trailing CRC of a delta or overlay held in memory
+static bool changeSetValid(const uint8_t* data, size_t size, const char* magic) {
+    if (size < sizeof(ChangeSetHeader) + sizeof(uint32_t)) return false;
+    const ChangeSetHeader* h = (const ChangeSetHeader*)data;
+    uint32_t crc;
+    memcpy(&crc, data + size - sizeof(crc), sizeof(crc));
+    return memcmp(h->magic, magic, 4) == 0 && h->version == CHANGES_VERSION &&
+           crc == changeSetCrc(data, size - sizeof(crc));
+}
+
+// Parse one change record; returns its size, 0 if malformed
+static size_t parseChange(const uint8_t* p, const uint8_t* end, uint8_t& op, uint16_t& id, Food& food) {
+    if (end - p < 3) return 0;
+    op = p[0];
+    id = p[1] | (p[2] << 8);
+    if (op == 'D') return 3;
+    if ((op != 'A' && op != 'M' && op != 'P') || end - p < 5 || p[3] >= header.categoryCount) return 0;
+
+    const uint8_t* namePt = p + 5;
+    const uint8_t* endPt = (const uint8_t*)memchr(namePt, 0, end - namePt);
+    if (endPt == nullptr) return 0;
+    const uint8_t* nameEn = endPt + 1;
+    const uint8_t* endEn = (const uint8_t*)memchr(nameEn, 0, end - nameEn);
+    if (endEn == nullptr) return 0;
+
+    food.category = p[3];
+    food.attrs = p[4];
+    food.name_pt = (const char*)namePt;
+    food.name_en = (const char*)nameEn;
+    return endEn + 1 - p;
+}
+
+// Image index of a stable id, -1 if the image does not have it
+static int imageIndexOfId(uint16_t id) {
+    uint32_t count;
+    if (!foodDbSectionRead(FOODDB_SECTION_IDS, 0, &count, sizeof(count))) return -1;
+    uint32_t lo = 0, hi = count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        uint16_t pair[2];  // id, image index
+        if (!foodDbSectionRead(FOODDB_SECTION_IDS, 4 + mid * sizeof(pair), pair, sizeof(pair))) return -1;
+        if (pair[0] == id) return pair[1];
+        if (pair[0] < id) lo = mid + 1;
+        else hi = mid;
+    }
+    return -1;
+}
+
+static bool appended(const OverlayFood& o) {
+    return !o.deleted && !o.inPlace;
+}
+
+static int hiddenIn(int begin, int end) {
+    int n = 0;
+    for (int i = 0; i < hiddenCount; i++) {
+        if (hidden[i] >= begin && hidden[i] < end) n++;
+    }
+    return n;
+}
+
+static const OverlayFood* inPlaceAt(int imageIndex) {
+    for (int i = 0; i < overlayCount; i++) {
+        if (overlay[i].inPlace && overlay[i].image == imageIndex) return &overlay[i];
+    }
+    return nullptr;
+}
+
+// Image records of a category still shown in the merged view
+static int keptIn(int category) {
+    int begin = rangeEntry(category), end = rangeEntry(category + 1);
+    return (end - begin) - hiddenIn(begin, end);
+}
+
+// Merged-view index of an image record (that is not hidden)
+static int viewIndexOf(int imageIndex, int category) {
+    int begin = rangeEntry(category);
+    return foodStart[category] + (imageIndex - begin) - hiddenIn(begin, imageIndex);
+}
+
+static void loadOverlay() {
+    overlayCount = 0;
+    hiddenCount = 0;
+    revision = header.revision;
+
+    File f = LittleFS.open(FOODDB_OVERLAY_PATH, "r");
+    if (!f) return;
+    size_t size = f.size();
+    bool ok = size <= sizeof(overlayData) && (size_t)f.read(overlayData, size) == size &&
+              changeSetValid(overlayData, size, OVERLAY_MAGIC);
+    f.close();
+
+    const ChangeSetHeader* h = (const ChangeSetHeader*)overlayData;
+    ok = ok && h->fromRevision == header.revision && h->count <= FOODDB_OVERLAY_MAX;
+    const uint8_t* p = overlayData + sizeof(ChangeSetHeader);
+    const uint8_t* end = overlayData + size - sizeof(uint32_t);
+    for (int i = 0; ok && i < h->count; i++) {
+        OverlayFood& o = overlay[i];
+        uint8_t op;
+        size_t len = parseChange(p, end, op, o.id, o.food);
+        o.image = len ? imageIndexOfId(o.id) : -1;
+        o.deleted = (op == 'D');
+        ok = len > 0 && (op == 'P' || (o.deleted && o.image >= 0));
+        if (!ok) break;
+        o.inPlace = !o.deleted && o.image >= 0 && imageFood(o.image).category == o.food.category;
+        o.change = p;
+        o.changeLen = len;
+        if (o.image >= 0 && !o.inPlace) hidden[hiddenCount++] = o.image;
+        p += len;
+    }
+    if (!ok || p != end) {
+        // Left over from an older image (or damaged): the image alone is consistent
+        Serial.println("[DB] Discarding stale overlay");
+        hiddenCount = 0;
+        LittleFS.remove(FOODDB_OVERLAY_PATH);
+        return;
+    }
+    overlayCount = h->count;
+    revision = h->toRevision;
+
+    // Sort hidden image indices (insertion sort, at most FOODDB_OVERLAY_MAX)
+    for (int i = 1; i < hiddenCount; i++) {
+        uint16_t v = hidden[i];
+        int j = i;
+        for (; j > 0 && hidden[j - 1] > v; j--) hidden[j] = hidden[j - 1];
+        hidden[j] = v;
+    }
+
+    // The merged view is indexed with 16 bits like the image: an overlay that
+    // would take it past that is left out rather than wrapping the starts
+    int start = 0;
+    foodStart[0] = 0;
+    for (int c = 0; c < header.categoryCount; c++) {
+        int added = 0;
+        for (int i = 0; i < overlayCount; i++) {
+            if (appended(overlay[i]) && overlay[i].food.category == c) added++;
+        }
+        start += keptIn(c) + added;
+        if (start > UINT16_MAX) {
+            Serial.printf("[DB] Overlay would make more than %u foods, ignored\n", (unsigned)UINT16_MAX);
+            overlayCount = 0;
+            hiddenCount = 0;
+            revision = header.revision;
+            return;
+        }
+        foodStart[c + 1] = start;
+    }
+    Serial.printf("[DB] Overlay: %d changed records, revision %08x\n", overlayCount, (unsigned)revision);
+}
+
+int foodDbFoodCount() {
+    if (!loaded) return 0;
+    return overlayCount ? foodStart[header.categoryCount] : header.foodCount;
+}
+
+void foodDbCategoryRange(int category, int& begin, int& end) {
+    if (overlayCount == 0) {
+        begin = rangeEntry(category);
+        end = rangeEntry(category + 1);
+        return;
+    }
+    begin = foodStart[category];
+    end = foodStart[category + 1];
+}
+
+Food foodDbGetFood(int index) {
+    if (overlayCount == 0) return imageFood(index);
+    if (index < 0 || index >= foodStart[header.categoryCount]) return MISSING_FOOD;
+
+    // Category holding the index: last one starting at or before it
+    int lo = 0, hi = header.categoryCount - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (foodStart[mid] <= index) lo = mid;
+        else hi = mid - 1;
+    }
+    int c = lo;
+    int k = index - foodStart[c];
+    int kept = keptIn(c);
+
+    if (k < kept) {
+        // k-th image record of the category that is not hidden
+        int image = rangeEntry(c) + k;
+        for (int i = 0; i < hiddenCount; i++) {
+            if (hidden[i] < rangeEntry(c)) continue;
+            if (hidden[i] <= image) image++;
+            else break;
+        }
+        const OverlayFood* o = inPlaceAt(image);
+        return o ? o->food : imageFood(image);
+    }
+
+    k -= kept;
+    for (int i = 0; i < overlayCount; i++) {
+        if (appended(overlay[i]) && overlay[i].food.category == c && k-- == 0) return overlay[i].food;
+    }
+    return MISSING_FOOD;
+}
+
+uint32_t foodDbRevision() {
+    return revision;
+}
+
+int foodDbFromImageIndex(int imageIndex) {
+    if (overlayCount == 0) return imageIndex;
+    for (int i = 0; i < hiddenCount; i++) {
+        if (hidden[i] == imageIndex) return -1;
+    }
+    if (inPlaceAt(imageIndex)) return -1;
+    return viewIndexOf(imageIndex, imageFood(imageIndex).category);
+}
+
+Food foodDbImageFood(int imageIndex) {
+    return imageFood(imageIndex);
+}
+
+void foodDbImageCategoryRange(int category, int& begin, int& end) {
+    begin = rangeEntry(category);
+    end = rangeEntry(category + 1);
+}
+
+int foodDbOverlayFoods(int* out, int max) {
+    int n = 0;
+    for (int i = 0; i < overlayCount && n < max; i++) {
+        const OverlayFood& o = overlay[i];
+        if (o.deleted) continue;
+        if (o.inPlace) {
+            out[n++] = viewIndexOf(o.image, o.food.category);
+            continue;
+        }
+        int pos = 0;  // among the records appended to the same category
+        for (int j = 0; j < i; j++) {
+            if (appended(overlay[j]) && overlay[j].food.category == o.food.category) pos++;
+        }
+        out[n++] = foodStart[o.food.category] + keptIn(o.food.category) + pos;
+    }
+    return n;
+}
+
+// Merge a delta into the overlay: the current records plus the delta ops in
+// order give the new overlay, written to a temp file and renamed over the old
+bool foodDbApplyDelta(const char* path, const char*& errorOut) {
+    unsigned long startTime = millis();
+    if (!loaded) {
+        errorOut = "No database";
+        return false;
+    }
+    if (header.flags & IMPORTED_FLAG) {
+        errorOut = "DB imported from JSON";  // no id index to apply deltas to
+        return false;
+    }
+
+    File f = LittleFS.open(path, "r");
+    if (!f) {
+        errorOut = "No delta file";
+        return false;
+    }
+    size_t size = f.size();
+    uint8_t* delta = (size <= FOODDB_DELTA_MAX) ? (uint8_t*)malloc(size) : nullptr;
+    bool readOk = delta && (size_t)f.read(delta, size) == size;
+    f.close();
+    if (!readOk || !changeSetValid(delta, size, DELTA_MAGIC)) {
+        free(delta);
+        errorOut = "Bad delta";
+        return false;
+    }
+    const ChangeSetHeader* dh = (const ChangeSetHeader*)delta;
+    if (dh->fromRevision != revision) {
+        free(delta);
+        errorOut = "Delta for other revision";
+        return false;
+    }
+
+    struct Merged {
+        uint16_t       id;
+        bool           deleted;
+        const uint8_t* data;  // after op and id
+        size_t         len;
+    };
+    Merged* merged = (Merged*)malloc(sizeof(Merged) * FOODDB_OVERLAY_MAX);
+    uint8_t* out = (uint8_t*)malloc(FOODDB_OVERLAY_BYTES);
+    if (merged == nullptr || out == nullptr) {
+        free(merged);
+        free(out);
+        free(delta);
+        errorOut = "Out of memory";
+        return false;
+    }
+
+    int count = 0;
+    for (int i = 0; i < overlayCount; i++) {
+        merged[count++] = { overlay[i].id, overlay[i].deleted, overlay[i].change + 3, overlay[i].changeLen - 3 };
+    }
+
+    errorOut = nullptr;
+    const uint8_t* p = delta + sizeof(ChangeSetHeader);
+    const uint8_t* end = delta + size - sizeof(uint32_t);
+    for (int op = 0; op < dh->count && errorOut == nullptr; op++) {
+        uint8_t kind;
+        uint16_t id;
+        Food food;
+        size_t len = parseChange(p, end, kind, id, food);
+        if (len == 0 || kind == 'P') {
+            errorOut = "Bad delta op";
+            break;
+        }
+
+        int m = 0;
+        while (m < count && merged[m].id != id) m++;
+        bool inImage = imageIndexOfId(id) >= 0;
+        bool exists = (m < count) ? !merged[m].deleted : inImage;
+        if ((kind == 'A') == exists) {
+            errorOut = (kind == 'A') ? "Delta adds existing id" : "Delta changes missing id";
+            break;
+        }
+
+        if (kind == 'D' && !inImage) {
+            merged[m] = merged[--count];  // added by an earlier delta: just forget it
+        } else {
+            if (m == count) {
+                if (count == FOODDB_OVERLAY_MAX) {
+                    errorOut = "Too many changes";
+                    break;
+                }
+                count++;
+            }
+            merged[m] = { id, kind == 'D', p + 3, len - 3 };
+        }
+        p += len;
+    }
+    if (errorOut == nullptr && p != end) errorOut = "Bad delta op";
+
+    // Serialize the new overlay
+    size_t outLen = sizeof(ChangeSetHeader);
+    for (int i = 0; i < count && errorOut == nullptr; i++) {
+        if (outLen + 3 + merged[i].len + sizeof(uint32_t) > FOODDB_OVERLAY_BYTES) {
+            errorOut = "Overlay full";
+            break;
+        }
+        out[outLen++] = merged[i].deleted ? 'D' : 'P';
+        out[outLen++] = merged[i].id & 0xFF;
+        out[outLen++] = merged[i].id >> 8;
+        memcpy(out + outLen, merged[i].data, merged[i].len);
+        outLen += merged[i].len;
+    }
+
+    bool ok = (errorOut == nullptr);
+    if (ok) {
+        ChangeSetHeader oh;
+        memcpy(oh.magic, OVERLAY_MAGIC, 4);
+        oh.version = CHANGES_VERSION;
+        oh.count = count;
+        oh.fromRevision = header.revision;
+        oh.toRevision = dh->toRevision;
+        memcpy(out, &oh, sizeof(oh));
+        uint32_t crc = changeSetCrc(out, outLen);
+        memcpy(out + outLen, &crc, sizeof(crc));
+        outLen += sizeof(crc);
+
+        File tmp = LittleFS.open(OVERLAY_TMP, "w");
+        ok = tmp && tmp.write(out, outLen) == outLen;
+        if (tmp) tmp.close();
+        ok = ok && LittleFS.rename(OVERLAY_TMP, FOODDB_OVERLAY_PATH);
+        if (!ok) {
+            LittleFS.remove(OVERLAY_TMP);
+            errorOut = "Write failed";
+        }
+    }
+
+    int ops = dh->count;
+    uint32_t from = dh->fromRevision;
+    free(merged);
+    free(out);
+    free(delta);
+    if (!ok) return false;
+
+    loadOverlay();
+    Serial.printf("[DB] Applied delta: %d ops, revision %08x -> %08x, overlay %u bytes, in %lu ms\n",
+                  ops, (unsigned)from, (unsigned)revision, (unsigned)outLen, millis() - startTime);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// JSON import
+//
+// For deployments that keep foods.json as the on-device format. The file is
+// read with the streaming parser (json_stream.h) once per pass and the image
+// is written page by page in order:
+//
+//   1. categories: count, longest record, ids (stops after the array)
+//   2. foods: per-category counts, longest record, validation; each record
+//      is appended to its category's run in a spill file
+//   3. category pages (stops after the array)
+//   4. food pages, copied from the runs one category after the other
+//
+// The foods are parsed once whatever the number of categories. A run keeps
+// IMPORT_RUN_BYTES in RAM and spills them as a chunk when full, with a u16
+// link per chunk to the next of the same run, so the import state grows by
+// IMPORT_RUN_BYTES per category and 2 bytes per chunk of records.
+//
+// Imported images hold the records only: lists keep foods.json order, names
+// are matched by the classifier and deltas are refused (the revision is a
+// CRC-32 of the file). scripts/foods_db.py builds the full image.
+
+#define IMPORT_TMP             "/foods.imp"
+#define IMPORT_SPILL           "/foods.spl"
+#define IMPORT_MAX_CATEGORIES  ((FOODDB_PAGE_SIZE / 2) - 1)  // range table fits one page
+#define IMPORT_RUN_BYTES       256
+#define IMPORT_NO_CHUNK        0xFFFF
+
+// One category or food object of foods.json
+struct ImportRecord {
+    char    id[JSON_STREAM_TEXT];  // category id, or the food's category
+    char    namePt[JSON_STREAM_TEXT];
+    char    nameEn[JSON_STREAM_TEXT];
+    uint8_t attrs;
+};
+
+// One category's food records (u8 attrs, name_pt\0, name_en\0) in foods.json order
+struct ImportRun {
+    uint16_t head;  // first and last spilled chunk, IMPORT_NO_CHUNK = none yet
+    uint16_t tail;
+    uint16_t fill;  // bytes in the run's buffer, after the spilled chunks
+};
+
+struct JsonImport {
+    File         in;
+    File         out;
+    File         spill;
+    JsonStream   js;
+    ImportRecord rec;
+    const char*  error;
+    int          categoryCount;
+    uint32_t     categoryHash[IMPORT_MAX_CATEGORIES];
+    uint16_t     categoryId[IMPORT_MAX_CATEGORIES];  // offsets into ids
+    char*        ids;                                // category ids, NUL-terminated
+    size_t       idsUsed;
+    size_t       idsSize;
+    ImportRun*   runs;                               // per category
+    uint8_t*     runBuffers;                         // IMPORT_RUN_BYTES per category
+    uint16_t*    chunkNext;                          // per spilled chunk
+    uint16_t     chunkCount;
+    uint16_t     chunkCap;
+    uint8_t      chunk[IMPORT_RUN_BYTES];            // chunk being read back
+    uint32_t     start[IMPORT_MAX_CATEGORIES + 1];  // food counts, then first index per category
+    size_t       longestCategory;
+    size_t       longestFood;
+    uint8_t      page[FOODDB_PAGE_SIZE];            // page being written
+    uint16_t     perPage;
+    uint16_t     slot;
+    uint16_t     used;
+};
+
+static uint32_t idHash(const char* id) {
+    uint32_t h = 0x811C9DC5;
+    while (*id) h = (h ^ (uint8_t)*id++) * 0x01000193;
+    return h;
+}
+
+static bool importFail(JsonImport& im, const char* error) {
+    if (im.error == nullptr) im.error = error;
+    return false;
+}
+
+// Rewind to the first element of the top-level array `name`
+static bool importSeek(JsonImport& im, const char* name) {
+    if (!im.in.seek(0)) return importFail(im, "Read failed");
+    jsonStreamBegin(im.js, im.in);
+    if (jsonStreamNext(im.js) != JSON_OBJECT_BEGIN) return importFail(im, "Not a JSON object");
+    for (;;) {
+        JsonEvent ev = jsonStreamNext(im.js);
+        if (ev == JSON_OBJECT_END) return importFail(im, "Missing array");
+        if (ev != JSON_KEY) break;
+        bool wanted = strcmp(im.js.text, name) == 0;
+        ev = jsonStreamNext(im.js);
+        if (wanted) return ev == JSON_ARRAY_BEGIN ? true : importFail(im, "Expected an array");
+        if (!jsonStreamSkip(im.js, ev)) break;
+    }
+    Serial.printf("[DB] foods.json: %s at byte %u\n", im.js.error ? im.js.error : "Bad document",
+                  (unsigned)jsonStreamOffset(im.js));
+    return importFail(im, "JSON syntax error");
+}
+
+static bool copyString(JsonImport& im, JsonEvent ev, char* dst) {
+    if (ev != JSON_STRING) return importFail(im, ev == JSON_ERROR ? "JSON syntax error" : "Expected a string");
+    memcpy(dst, im.js.text, im.js.textLen + 1);
+    return true;
+}
+
+// Next object of the array: 1 = read into im.rec, 0 = end of the array, -1 = error
+static int importNext(JsonImport& im, bool food) {
+    ImportRecord& r = im.rec;
+    r.id[0] = r.namePt[0] = r.nameEn[0] = '\0';
+    r.attrs = FODMAP_UNKNOWN;
+
+    JsonEvent ev = jsonStreamNext(im.js);
+    if (ev == JSON_ARRAY_END) return 0;
+    bool ok = (ev == JSON_OBJECT_BEGIN) || importFail(im, "Expected an object");
+    while (ok && (ev = jsonStreamNext(im.js)) == JSON_KEY) {
+        // The value overwrites the key text: note which field this is first
+        const char* key = im.js.text;
+        char* name = strcmp(key, "name_pt") == 0 ? r.namePt :
+                     strcmp(key, "name_en") == 0 ? r.nameEn :
+                     strcmp(key, food ? "category" : "id") == 0 ? r.id : nullptr;
+        bool fodmap = food && strcmp(key, "fodmap") == 0;
+        bool gluten = food && strcmp(key, "gluten") == 0;
+        ev = jsonStreamNext(im.js);
+        if (name) ok = copyString(im, ev, name);
+        else if (fodmap && ev == JSON_STRING) r.attrs |= parseFodmapLevel(im.js.text);
+        else if (gluten && ev == JSON_TRUE) r.attrs |= FOOD_ATTR_GLUTEN;
+        else ok = jsonStreamSkip(im.js, ev) || importFail(im, "JSON syntax error");
+    }
+    if (ok && ev != JSON_OBJECT_END) ok = importFail(im, "JSON syntax error");
+    if (ok && (r.id[0] == '\0' || r.namePt[0] == '\0' || r.nameEn[0] == '\0')) {
+        ok = importFail(im, food ? "Food without names" : "Category without names");
+    }
+    if (!ok && im.js.error) {
+        Serial.printf("[DB] foods.json: %s at byte %u\n", im.js.error, (unsigned)jsonStreamOffset(im.js));
+    }
+    return ok ? 1 : -1;
+}
+
+static int importCategoryOf(const JsonImport& im, const char* id) {
+    uint32_t h = idHash(id);
+    for (int c = 0; c < im.categoryCount; c++) {
+        if (im.categoryHash[c] == h && strcmp(im.ids + im.categoryId[c], id) == 0) return c;
+    }
+    return -1;
+}
+
+static bool importAddCategory(JsonImport& im, const char* id) {
+    size_t len = strlen(id) + 1;
+    if (im.idsUsed + len > im.idsSize) {
+        size_t size = im.idsSize ? im.idsSize * 2 : 256;
+        while (size < im.idsUsed + len) size *= 2;
+        char* ids = (char*)realloc(im.ids, size);
+        if (ids == nullptr) return importFail(im, "Out of memory");
+        im.ids = ids;
+        im.idsSize = size;
+    }
+    if (im.idsUsed + len > 0xFFFF) return importFail(im, "Too many categories");
+    memcpy(im.ids + im.idsUsed, id, len);
+    im.categoryId[im.categoryCount] = im.idsUsed;
+    im.categoryHash[im.categoryCount++] = idHash(id);
+    im.idsUsed += len;
+    return true;
+}
+
+// Write the full buffer of run `c` to the spill file as its next chunk
+static bool runSpill(JsonImport& im, int c) {
+    ImportRun& run = im.runs[c];
+    if (im.chunkCount == IMPORT_NO_CHUNK) return importFail(im, "Too many foods");
+    if (im.chunkCount == im.chunkCap) {
+        uint16_t cap = im.chunkCap ? (im.chunkCap > IMPORT_NO_CHUNK / 2 ? IMPORT_NO_CHUNK : im.chunkCap * 2) : 64;
+        uint16_t* next = (uint16_t*)realloc(im.chunkNext, cap * sizeof(uint16_t));
+        if (next == nullptr) return importFail(im, "Out of memory");
+        im.chunkNext = next;
+        im.chunkCap = cap;
+    }
+    if (im.spill.write(im.runBuffers + c * IMPORT_RUN_BYTES, IMPORT_RUN_BYTES) != IMPORT_RUN_BYTES) {
+        return importFail(im, "Write failed");
+    }
+    uint16_t chunk = im.chunkCount++;
+    im.chunkNext[chunk] = IMPORT_NO_CHUNK;
+    if (run.tail == IMPORT_NO_CHUNK) run.head = chunk;
+    else im.chunkNext[run.tail] = chunk;
+    run.tail = chunk;
+    run.fill = 0;
+    return true;
+}
+
+static bool runPut(JsonImport& im, int c, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    ImportRun& run = im.runs[c];
+    while (len > 0) {
+        size_t n = min(len, (size_t)(IMPORT_RUN_BYTES - run.fill));
+        memcpy(im.runBuffers + c * IMPORT_RUN_BYTES + run.fill, p, n);
+        run.fill += n;
+        p += n;
+        len -= n;
+        if (run.fill == IMPORT_RUN_BYTES && !runSpill(im, c)) return false;
+    }
+    return true;
+}
+
+// Reads one run back: its spilled chunks, then what is left in its buffer
+struct RunCursor {
+    int            category;
+    uint16_t       next;  // chunk to load after this one
+    bool           last;  // reading the run's buffer
+    const uint8_t* data;
+    uint16_t       len;
+    uint16_t       pos;
+};
+
+static void runOpen(JsonImport& im, RunCursor& cur, int c) {
+    cur.category = c;
+    cur.next = im.runs[c].head;
+    cur.last = false;
+    cur.data = nullptr;
+    cur.len = cur.pos = 0;
+}
+
+static bool runByte(JsonImport& im, RunCursor& cur, uint8_t& out) {
+    while (cur.pos == cur.len) {
+        if (cur.next != IMPORT_NO_CHUNK) {
+            if (!im.spill.seek((uint32_t)cur.next * IMPORT_RUN_BYTES) ||
+                im.spill.read(im.chunk, IMPORT_RUN_BYTES) != IMPORT_RUN_BYTES) {
+                return importFail(im, "Read failed");
+            }
+            cur.data = im.chunk;
+            cur.len = IMPORT_RUN_BYTES;
+            cur.next = im.chunkNext[cur.next];
+        } else if (!cur.last) {
+            cur.last = true;
+            cur.data = im.runBuffers + cur.category * IMPORT_RUN_BYTES;
+            cur.len = im.runs[cur.category].fill;
+        } else {
+            return importFail(im, "Spill file truncated");
+        }
+        cur.pos = 0;
+    }
+    out = cur.data[cur.pos++];
+    return true;
+}
+
+static bool runString(JsonImport& im, RunCursor& cur, char* dst) {
+    for (size_t i = 0; i < JSON_STREAM_TEXT; i++) {
+        uint8_t b;
+        if (!runByte(im, cur, b)) return false;
+        dst[i] = b;
+        if (b == '\0') return true;
+    }
+    return importFail(im, "Spill file corrupt");
+}
+
+static size_t categoryRecordSize(const ImportRecord& r) {
+    return strlen(r.id) + strlen(r.namePt) + strlen(r.nameEn) + 3;
+}
+
+static size_t foodRecordSize(const ImportRecord& r) {
+    return 2 + strlen(r.namePt) + strlen(r.nameEn) + 2;
+}
+
+// Records per page when every record may be the longest one (the last byte
+// of a page stays NUL, see recordPageValid)
+static uint16_t importPerPage(uint32_t count, size_t longest) {
+    uint32_t n = (FOODDB_PAGE_SIZE - 1) / (sizeof(uint16_t) + longest);
+    if (n > (FOODDB_PAGE_SIZE - 1) / 4) n = (FOODDB_PAGE_SIZE - 1) / 4;
+    if (n > count) n = count;
+    return n > 0 ? n : 1;
+}
+
+static void pageStart(JsonImport& im, uint16_t perPage) {
+    memset(im.page, 0, sizeof(im.page));
+    im.perPage = perPage;
+    im.slot = 0;
+    im.used = perPage * sizeof(uint16_t);
+}
+
+static bool pageFlush(JsonImport& im) {
+    if (im.slot == 0) return true;
+    uint16_t* offsets = (uint16_t*)im.page;
+    for (uint16_t i = im.slot; i < im.perPage; i++) offsets[i] = im.perPage * sizeof(uint16_t);  // unused slots
+    bool ok = im.out.write(im.page, sizeof(im.page)) == sizeof(im.page);
+    pageStart(im, im.perPage);
+    return ok || importFail(im, "Write failed");
+}
+
+// Room for the next record of `len` bytes, starting a new page when full
+static uint8_t* pageRecord(JsonImport& im, size_t len) {
+    if (im.slot == im.perPage && !pageFlush(im)) return nullptr;
+    ((uint16_t*)im.page)[im.slot++] = im.used;
+    uint8_t* p = im.page + im.used;
+    im.used += len;
+    return p;
+}
+
+static uint8_t* putName(uint8_t* p, const char* name) {
+    size_t len = strlen(name) + 1;
+    memcpy(p, name, len);
+    return p + len;
+}
+
+static bool importWanted() {
+    File f = LittleFS.open(FOODDB_PATH, "r");
+    if (!f) return true;
+    FoodDbHeader h;
+    bool imported = f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+                    memcmp(h.magic, FOODDB_MAGIC, 4) == 0 && (h.flags & IMPORTED_FLAG);
+    f.close();
+    return imported;
+}
+
+static bool importPasses(JsonImport& im, FoodDbHeader& h, int& passes) {
+    // Revision: CRC-32 of the file
+    uint32_t crc = 0;
+    for (size_t n; (n = im.in.read(im.page, sizeof(im.page))) > 0;) crc = changeSetCrc(im.page, n, crc);
+
+    // 1. Categories
+    if (!importSeek(im, "categories")) return false;
+    passes++;
+    int r;
+    while ((r = importNext(im, false)) == 1) {
+        if (im.categoryCount == IMPORT_MAX_CATEGORIES) return importFail(im, "Too many categories");
+        if (importCategoryOf(im, im.rec.id) >= 0) return importFail(im, "Duplicate category");
+        size_t len = categoryRecordSize(im.rec);
+        if (len > im.longestCategory) im.longestCategory = len;
+        if (!importAddCategory(im, im.rec.id)) return false;
+    }
+    if (r < 0) return false;
+    if (im.categoryCount == 0) return importFail(im, "No categories");
+
+    // 2. Foods: count per category and append each to its run
+    im.runs = (ImportRun*)malloc(im.categoryCount * sizeof(ImportRun));
+    im.runBuffers = (uint8_t*)malloc(im.categoryCount * IMPORT_RUN_BYTES);
+    if (im.runs == nullptr || im.runBuffers == nullptr) return importFail(im, "Out of memory");
+    for (int c = 0; c < im.categoryCount; c++) im.runs[c] = { IMPORT_NO_CHUNK, IMPORT_NO_CHUNK, 0 };
+    if (!importSeek(im, "foods")) return false;
+    passes++;
+    uint32_t foodCount = 0;
+    while ((r = importNext(im, true)) == 1) {
+        int c = importCategoryOf(im, im.rec.id);
+        if (c < 0) return importFail(im, "Unknown category");
+        if (++foodCount > 0xFFFF) return importFail(im, "Too many foods");
+        size_t len = foodRecordSize(im.rec);
+        if (len > im.longestFood) im.longestFood = len;
+        im.start[c + 1]++;
+        if (!runPut(im, c, &im.rec.attrs, 1) ||
+            !runPut(im, c, im.rec.namePt, strlen(im.rec.namePt) + 1) ||
+            !runPut(im, c, im.rec.nameEn, strlen(im.rec.nameEn) + 1)) {
+            return false;
+        }
+    }
+    if (r < 0) return false;
+    im.spill.close();
+    im.spill = LittleFS.open(IMPORT_SPILL, "r");
+    if (!im.spill) return importFail(im, "Read failed");
+    for (int c = 0; c < im.categoryCount; c++) im.start[c + 1] += im.start[c];
+
+    // Header and range pages
+    memcpy(h.magic, FOODDB_MAGIC, 4);
+    h.version = FOODDB_VERSION;
+    h.pageSize = FOODDB_PAGE_SIZE;
+    h.foodCount = foodCount;
+    h.categoryCount = im.categoryCount;
+    h.foodsPerPage = importPerPage(foodCount, im.longestFood);
+    h.categoriesPerPage = importPerPage(im.categoryCount, im.longestCategory);
+    h.rangePage = 1;
+    h.categoryPage = 2;
+    h.foodPage = h.categoryPage + pagesFor(im.categoryCount, h.categoriesPerPage);
+    uint32_t pageCount = h.foodPage + pagesFor(foodCount, h.foodsPerPage);
+    if (pageCount > 0xFFFF) return importFail(im, "Too many foods");
+    h.pageCount = pageCount;
+    h.sectionCount = 0;
+    h.flags = IMPORTED_FLAG;
+    h.revision = crc;
+
+    memset(im.page, 0, sizeof(im.page));
+    memcpy(im.page, &h, sizeof(h));
+    bool ok = im.out.write(im.page, sizeof(im.page)) == sizeof(im.page);
+    memset(im.page, 0, sizeof(im.page));
+    for (int c = 0; c <= im.categoryCount; c++) ((uint16_t*)im.page)[c] = im.start[c];
+    ok = ok && im.out.write(im.page, sizeof(im.page)) == sizeof(im.page);
+    if (!ok) return importFail(im, "Write failed");
+
+    // 3. Category pages. Record: id\0, name_pt\0, name_en\0
+    if (!importSeek(im, "categories")) return false;
+    passes++;
+    pageStart(im, h.categoriesPerPage);
+    while ((r = importNext(im, false)) == 1) {
+        uint8_t* p = pageRecord(im, categoryRecordSize(im.rec));
+        if (p == nullptr) return false;
+        putName(putName(putName(p, im.rec.id), im.rec.namePt), im.rec.nameEn);
+    }
+    if (r < 0 || !pageFlush(im)) return false;
+
+    // 4. Food pages from the runs, one category at a time. Record: u8 category, u8 attrs, name_pt\0, name_en\0
+    pageStart(im, h.foodsPerPage);
+    for (int c = 0; c < im.categoryCount; c++) {
+        RunCursor cur;
+        runOpen(im, cur, c);
+        for (uint32_t left = im.start[c + 1] - im.start[c]; left > 0; left--) {
+            if (!runByte(im, cur, im.rec.attrs) || !runString(im, cur, im.rec.namePt) ||
+                !runString(im, cur, im.rec.nameEn)) {
+                return false;
+            }
+            uint8_t* p = pageRecord(im, foodRecordSize(im.rec));
+            if (p == nullptr) return false;
+            p[0] = c;
+            p[1] = im.rec.attrs;
+            putName(putName(p + 2, im.rec.namePt), im.rec.nameEn);
+        }
+    }
+    return pageFlush(im) && (im.out.size() == pageCount * FOODDB_PAGE_SIZE || importFail(im, "Write failed"));
+}
+
+static bool importJson(const char*& errorOut) {
+    unsigned long startTime = millis();
+    JsonImport* im = new (std::nothrow) JsonImport();
+    if (im == nullptr) {
+        errorOut = "Out of memory";
+        return false;
+    }
+    im->in = LittleFS.open(FOODDB_JSON_PATH, "r");
+    im->out = LittleFS.open(IMPORT_TMP, "w");
+    im->spill = LittleFS.open(IMPORT_SPILL, "w");
+    FoodDbHeader h;
+    int passes = 0;
+    bool ok = (im->in && im->out && im->spill) ? importPasses(*im, h, passes) : importFail(*im, "Cannot open files");
+    uint32_t heapDuring = ESP.getFreeHeap();  // with the runs still allocated
+    size_t jsonSize = im->in ? im->in.size() : 0;
+    size_t stateBytes = sizeof(JsonImport) + im->idsSize + im->chunkCap * sizeof(uint16_t) +
+                        (im->runs ? im->categoryCount * (sizeof(ImportRun) + IMPORT_RUN_BYTES) : 0);
+    if (im->in) im->in.close();
+    if (im->out) im->out.close();
+    if (im->spill) im->spill.close();
+    LittleFS.remove(IMPORT_SPILL);
+    errorOut = im->error;
+    free(im->ids);
+    free(im->runs);
+    free(im->runBuffers);
+    free(im->chunkNext);
+    delete im;
+
+    ok = ok && LittleFS.rename(IMPORT_TMP, FOODDB_PATH);
+    if (!ok) {
+        LittleFS.remove(IMPORT_TMP);
+        if (errorOut == nullptr) errorOut = "Write failed";
+        return false;
+    }
+    Serial.printf("[DB] Imported foods.json (%u bytes): %u foods, %u categories, %d passes in %lu ms, "
+                  "import state %u bytes (free heap %u during)\n",
+                  (unsigned)jsonSize, h.foodCount, h.categoryCount, passes, millis() - startTime,
+                  (unsigned)stateBytes, (unsigned)heapDuring);
+    return true;
+}
+
+#endif  // FOODDB_PROGMEM
+
+FodmapLevel parseFodmapLevel(const char* level) {
+    if (strcmp(level, "low") == 0) return FODMAP_LOW;
+    if (strcmp(level, "moderate") == 0) return FODMAP_MODERATE;
+    if (strcmp(level, "high") == 0) return FODMAP_HIGH;
+    return FODMAP_UNKNOWN;
+}
@@ -0,0 +1,316 @@
+#include "food_match.h"
+#include "food_db.h"
+#include "food_vector.h"
+#include "text_norm.h"
+#include "filler_words.h"  // generated from scripts/text_norm.py
+#include <Arduino.h>
+
+#define MATCH_TABLE_SIZE      256  // candidate hash table slots (power of two)
+#define MATCH_MAX_CANDIDATES  192  // keep the table at most 3/4 full
+#define MATCH_RESCORE         16   // top candidates compared name by name
+#define MATCH_POSTING_CHUNK   32   // postings read per section access
+#define MATCH_VECTOR_CANDIDATES 32 // best-covered candidates whose sketches are compared
+#define MATCH_EMPTY           0xFFFF
+
+// Exact-name hash (must match scripts/foods_db.py)
+#define EXACT_FNV_OFFSET       0x811C9DC5u
+#define EXACT_FNV_PRIME        0x01000193u
+
+struct Candidate {
+    uint16_t food;
+    uint16_t hits;   // query trigrams found in the food's names and aliases
+    bool     taken;  // rescored
+};
+
+struct PostingList {
+    uint32_t begin;
+    uint32_t end;
+};
+
+// Match index layout (see scripts/foods_db.py): u32 key count, u16 keys[n],
+// u32 starts[n + 1], u16 postings[]
+static uint32_t keyCount = 0;
+
+static Candidate table[MATCH_TABLE_SIZE];
+static size_t candCount = 0;
+
+static Candidate* findCandidate(uint16_t food, bool insert) {
+    uint32_t slot = ((food * 2654435761u) >> 24) & (MATCH_TABLE_SIZE - 1);
+    while (table[slot].food != MATCH_EMPTY) {
+        if (table[slot].food == food) return &table[slot];
+        slot = (slot + 1) & (MATCH_TABLE_SIZE - 1);
+    }
+    if (!insert || candCount >= MATCH_MAX_CANDIDATES) return nullptr;
+    candCount++;
+    table[slot] = { food, 0, false };
+    return &table[slot];
+}
+
+static uint32_t startsOffset() {
+    return 4 + keyCount * sizeof(uint16_t);
+}
+
+static uint32_t postingsOffset() {
+    return startsOffset() + (keyCount + 1) * sizeof(uint32_t);
+}
+
+static bool findPostings(uint16_t code, PostingList& out) {
+    uint32_t lo = 0, hi = keyCount;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        uint16_t key;
+        if (!foodDbSectionRead(FOODDB_SECTION_MATCH, 4 + mid * sizeof(uint16_t), &key, sizeof(key))) return false;
+        if (key == code) {
+            uint32_t range[2];
+            if (!foodDbSectionRead(FOODDB_SECTION_MATCH, startsOffset() + mid * sizeof(uint32_t), range, sizeof(range))) {
+                return false;
+            }
+            out.begin = range[0];
+            out.end = range[1];
+            return out.end > out.begin;
+        }
+        if (key < code) lo = mid + 1;
+        else hi = mid;
+    }
+    return false;
+}
+
+// Filler words of spoken queries ("can I eat apples?", "posso comer maçãs?"):
+// the same list keys the exact hash, so the two cannot drift apart
+bool foodMatchIsFiller(const char* word, size_t len) {
+    for (const char* filler : FILLER_WORDS) {
+        if (strlen(filler) == len && memcmp(filler, word, len) == 0) return true;
+    }
+    return false;
+}
+
+void foodMatchQueryKey(const char* text, char* out, size_t outSize) {
+    char norm[TEXT_NORM_MAX];
+    textNormalize(text, norm, sizeof(norm));
+
+    size_t outLen = 0;
+    const char* p = norm;
+    while (*p) {
+        const char* end = strchr(p, ' ');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (!foodMatchIsFiller(p, len) && outLen + len + 1 < outSize) {
+            if (outLen > 0) out[outLen++] = ' ';
+            memcpy(out + outLen, p, len);
+            outLen += len;
+        }
+        p += len;
+        if (*p == ' ') p++;
+    }
+    out[outLen] = '\0';
+    if (outLen == 0) snprintf(out, outSize, "%s", norm);
+}
+
+// FNV-1a with the offset basis mixed with a seed
+static uint32_t exactHash(uint32_t seed, const char* key) {
+    uint32_t h = EXACT_FNV_OFFSET ^ seed;
+    for (const uint8_t* p = (const uint8_t*)key; *p; p++) h = (h ^ *p) * EXACT_FNV_PRIME;
+    return h;
+}
+
+// Exact section layout (see scripts/foods_db.py): u32 key count n, u32 bucket
+// count, i32 displacement[buckets], u32 key offset[n], u16 food[n], then the
+// keys. The hash only picks the slot; its key is read and compared in full.
+static int exactLookup(const char* key) {
+    uint32_t counts[2];  // keys, buckets
+    if (!foodDbSectionRead(FOODDB_SECTION_EXACT, 0, counts, sizeof(counts)) ||
+        counts[0] == 0 || counts[1] == 0) {
+        return -1;
+    }
+
+    int32_t displace;
+    uint32_t bucket = exactHash(0, key) % counts[1];
+    if (!foodDbSectionRead(FOODDB_SECTION_EXACT, 8 + bucket * sizeof(displace), &displace, sizeof(displace)) ||
+        displace == 0) {
+        return -1;
+    }
+    uint32_t slot = displace < 0 ? (uint32_t)(-1 - displace) : exactHash(displace, key) % counts[0];
+    if (slot >= counts[0]) return -1;
+
+    uint32_t offsetsAt = 8 + counts[1] * sizeof(int32_t);
+    uint32_t keyAt;
+    char stored[TEXT_NORM_MAX];
+    size_t len = strlen(key) + 1;  // the NUL too, so a longer stored key differs
+    uint16_t image;
+    if (len > sizeof(stored) ||
+        !foodDbSectionRead(FOODDB_SECTION_EXACT, offsetsAt + slot * sizeof(keyAt), &keyAt, sizeof(keyAt)) ||
+        !foodDbSectionRead(FOODDB_SECTION_EXACT, keyAt, stored, len) || memcmp(stored, key, len) != 0 ||
+        !foodDbSectionRead(FOODDB_SECTION_EXACT, offsetsAt + counts[0] * sizeof(keyAt) + slot * sizeof(image),
+                           &image, sizeof(image))) {
+        return -1;
+    }
+    return foodDbFromImageIndex(image);  // -1: changed by a delta, left to the fuzzy match
+}
+
+int foodMatchExact(const char* text) {
+    char query[TEXT_NORM_MAX];
+    foodMatchQueryKey(text, query, sizeof(query));
+    return exactLookup(query);
+}
+
+// Dice coefficient of two sorted trigram sets
+static float similarity(const uint16_t* a, size_t an, const uint16_t* b, size_t bn) {
+    if (an + bn == 0) return 0.0f;
+    size_t i = 0, j = 0, common = 0;
+    while (i < an && j < bn) {
+        if (a[i] == b[j]) { common++; i++; j++; }
+        else if (a[i] < b[j]) i++;
+        else j++;
+    }
+    return 2.0f * common / (an + bn);
+}
+
+static float nameSimilarity(const char* name, const uint16_t* query, size_t queryCount) {
+    char norm[TEXT_NORM_MAX];
+    uint16_t grams[TEXT_TRIGRAM_MAX];
+    textNormalize(name, norm, sizeof(norm));
+    size_t n = textTrigrams(norm, grams, TEXT_TRIGRAM_MAX);
+    return similarity(query, queryCount, grams, n);
+}
+
+// A sketch cosine on the Dice scale: FOOD_VECTOR_CONFIDENT maps onto
+// FOOD_MATCH_CONFIDENT and 1 onto 1
+static float vectorScore(float cosine) {
+    return FOOD_MATCH_CONFIDENT +
+           (cosine - FOOD_VECTOR_CONFIDENT) * (1.0f - FOOD_MATCH_CONFIDENT) / (1.0f - FOOD_VECTOR_CONFIDENT);
+}
+
+// Keep the best two scores of distinct foods
+static void consider(int food, float score, FoodMatch& out) {
+    if (food == out.foodIndex) {
+        if (score > out.score) out.score = score;
+    } else if (score > out.score) {
+        out.runnerUp = out.score;
+        out.score = score;
+        out.foodIndex = food;
+    } else if (score > out.runnerUp) {
+        out.runnerUp = score;
+    }
+}
+
+// Score one food of the merged view against its names
+static void rescore(int food, const uint16_t* query, size_t queryCount, FoodMatch& out) {
+    Food f = foodDbGetFood(food);
+    float score = nameSimilarity(f.name_pt, query, queryCount);
+    float scoreEn = nameSimilarity(f.name_en, query, queryCount);
+    consider(food, scoreEn > score ? scoreEn : score, out);
+}
+
+bool foodMatchFind(const char* text, FoodMatch& out) {
+    unsigned long startTime = micros();
+    out.foodIndex = -1;
+    out.score = 0.0f;
+    out.runnerUp = 0.0f;
+
+    char query[TEXT_NORM_MAX];
+    foodMatchQueryKey(text, query, sizeof(query));
+
+    // Exact names and aliases: one hash and two reads, no candidate search
+    int exact = exactLookup(query);
+    if (exact >= 0) {
+        out.foodIndex = exact;
+        out.score = 1.0f;
+        Serial.printf("[MATCH] \"%s\" -> %d (exact) in %lu us\n", query, exact, micros() - startTime);
+        return true;
+    }
+
+    if (!foodDbSectionRead(FOODDB_SECTION_MATCH, 0, &keyCount, sizeof(keyCount)) || keyCount == 0) {
+        return false;
+    }
+    uint16_t grams[TEXT_TRIGRAM_MAX];
+    size_t gramCount = textTrigrams(query, grams, TEXT_TRIGRAM_MAX);
+
+    // Posting lists of the query trigrams, shortest (most selective) first
+    PostingList lists[TEXT_TRIGRAM_MAX];
+    size_t listCount = 0;
+    for (size_t i = 0; i < gramCount; i++) {
+        PostingList pl;
+        if (!findPostings(grams[i], pl)) continue;
+        size_t pos = listCount++;
+        while (pos > 0 && lists[pos - 1].end - lists[pos - 1].begin > pl.end - pl.begin) {
+            lists[pos] = lists[pos - 1];
+            pos--;
+        }
+        lists[pos] = pl;
+    }
+
+    // A food within FOOD_MATCH_MARGIN of a confident score shares at least
+    // minHits trigrams with the query (Dice >= s implies hits >= s*q/(2-s)),
+    // so it appears in one of the first q - minHits + 1 (shortest) lists. Only
+    // those lists admit new candidates; the long common ones just add hits.
+    const float minScore = FOOD_MATCH_CONFIDENT - FOOD_MATCH_MARGIN;
+    size_t minHits = (size_t)ceilf(minScore * gramCount / (2.0f - minScore));
+    if (minHits < 1) minHits = 1;
+    size_t admitLists = listCount >= minHits ? listCount - minHits + 1 : 0;
+
+    for (size_t i = 0; i < MATCH_TABLE_SIZE; i++) table[i].food = MATCH_EMPTY;
+    candCount = 0;
+    uint16_t chunk[MATCH_POSTING_CHUNK];
+    for (size_t l = 0; l < listCount; l++) {
+        for (uint32_t at = lists[l].begin; at < lists[l].end; at += MATCH_POSTING_CHUNK) {
+            uint32_t n = lists[l].end - at;
+            if (n > MATCH_POSTING_CHUNK) n = MATCH_POSTING_CHUNK;
+            if (!foodDbSectionRead(FOODDB_SECTION_MATCH, postingsOffset() + at * sizeof(uint16_t),
+                                   chunk, n * sizeof(uint16_t))) {
+                return false;
+            }
+            for (uint32_t k = 0; k < n; k++) {
+                Candidate* c = findCandidate(chunk[k], l < admitLists);
+                if (c) c->hits++;
+            }
+        }
+    }
+
+    // Rescore the best-covered candidates against each of their names
+    for (size_t i = 0; i < MATCH_RESCORE; i++) {
+        Candidate* top = nullptr;
+        for (Candidate& c : table) {
+            if (c.food != MATCH_EMPTY && !c.taken && c.hits >= minHits && (!top || c.hits > top->hits)) top = &c;
+        }
+        if (top == nullptr) break;
+
+        int food = foodDbFromImageIndex(top->food);  // -1: changed by a delta
+        if (food >= 0) rescore(food, grams, gramCount, out);
+        top->taken = true;
+    }
+
+    // Records changed by deltas are not in the index: compare them directly
+    int changed[FOODDB_OVERLAY_MAX];
+    int changedCount = foodDbOverlayFoods(changed, FOODDB_OVERLAY_MAX);
+    for (int i = 0; i < changedCount; i++) rescore(changed[i], grams, gramCount, out);
+
+    // Not settled by the names: nearest sketches of the names and aliases
+    // of the best-covered candidates ("berinjella" -> the alias "berinjela"
+    // of Eggplant), in image order so the reads move forward in the file
+    if (!foodMatchConfident(out)) {
+        uint16_t nearest[MATCH_VECTOR_CANDIDATES];
+        size_t nearestCount = 0;
+        while (nearestCount < MATCH_VECTOR_CANDIDATES) {
+            Candidate* top = nullptr;
+            for (Candidate& c : table) {
+                if (c.food != MATCH_EMPTY && c.hits > 0 && (!top || c.hits > top->hits)) top = &c;
+            }
+            if (top == nullptr) break;
+            size_t pos = nearestCount++;
+            for (; pos > 0 && nearest[pos - 1] > top->food; pos--) nearest[pos] = nearest[pos - 1];
+            nearest[pos] = top->food;
+            top->hits = 0;
+        }
+
+        FoodVectorHit hits[FOOD_VECTOR_TOP_K];
+        int hitCount = foodVectorSearch(grams, gramCount, nearest, nearestCount, hits, FOOD_VECTOR_TOP_K);
+        for (int i = 0; i < hitCount; i++) {
+            float score = vectorScore(hits[i].score);
+            if (score < minScore) break;
+            consider(hits[i].foodIndex, score, out);
+        }
+    }
+
+    Serial.printf("[MATCH] \"%s\" -> %d (%.2f, next %.2f), %u candidates in %lu us\n",
+                  query, out.foodIndex, out.score, out.runnerUp, (unsigned)candCount, micros() - startTime);
+    return out.foodIndex >= 0;
+}
@@ -0,0 +1,87 @@
+#include "food_model.h"
+#include "food_model_table.h"
+#include "food_match.h"
+#include "text_norm.h"
+#include <Arduino.h>
+#include <math.h>
+
+// Feature hashing, as features() in scripts/food_model.py
+#define MODEL_TRIGRAM_TAG  0x10000u   // keeps trigram codes apart from word hashes
+#define MODEL_FNV_OFFSET   0x811C9DC5u
+#define MODEL_FNV_PRIME    0x01000193u
+#define MODEL_MAX_FEATURES (TEXT_NORM_MAX / 2 + TEXT_TRIGRAM_MAX)  // words + trigrams
+
+// Murmur3 finalizer (mix32 in scripts/foods_db.py)
+static uint32_t mix32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x85EBCA6B;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35;
+    return x ^ (x >> 16);
+}
+
+static uint32_t wordHash(const char* word, size_t len) {
+    uint32_t h = MODEL_FNV_OFFSET;
+    for (size_t i = 0; i < len; i++) h = (h ^ (uint8_t)word[i]) * MODEL_FNV_PRIME;
+    return h;
+}
+
+// Add a bucket unless present: features are binary, as in training
+static void addFeature(uint16_t* buckets, size_t& count, uint32_t hash) {
+    uint16_t bucket = hash % FOOD_MODEL_FEATURES;
+    for (size_t i = 0; i < count; i++) {
+        if (buckets[i] == bucket) return;
+    }
+    if (count < MODEL_MAX_FEATURES) buckets[count++] = bucket;
+}
+
+bool foodModelGuess(const char* text, FoodGuess& out) {
+    unsigned long startTime = micros();
+    char key[TEXT_NORM_MAX];
+    foodMatchQueryKey(text, key, sizeof(key));
+    if (key[0] == '\0') return false;
+
+    uint16_t buckets[MODEL_MAX_FEATURES];
+    size_t count = 0;
+    for (const char* p = key; *p;) {
+        const char* end = strchr(p, ' ');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        addFeature(buckets, count, mix32(wordHash(p, len)));
+        p += len;
+        if (*p == ' ') p++;
+    }
+    uint16_t grams[TEXT_TRIGRAM_MAX];
+    size_t gramCount = textTrigrams(key, grams, TEXT_TRIGRAM_MAX);
+    for (size_t i = 0; i < gramCount; i++) addFeature(buckets, count, mix32(grams[i] | MODEL_TRIGRAM_TAG));
+
+    // Sum the int8 weights of the active buckets, then one multiply per output
+    int32_t acc[FOOD_MODEL_OUTPUTS] = {0};
+    for (size_t i = 0; i < count; i++) {
+        const int8_t* w = FOOD_MODEL_WEIGHTS + buckets[i] * FOOD_MODEL_OUTPUTS;
+        for (int o = 0; o < FOOD_MODEL_OUTPUTS; o++) acc[o] += w[o];
+    }
+    float logits[FOOD_MODEL_OUTPUTS];
+    for (int o = 0; o < FOOD_MODEL_OUTPUTS; o++) logits[o] = acc[o] * FOOD_MODEL_SCALE[o] + FOOD_MODEL_BIAS[o];
+
+    // Softmax over the three FODMAP levels, sigmoid for gluten
+    float top = fmaxf(logits[0], fmaxf(logits[1], logits[2]));
+    float probs[3], total = 0;
+    for (int o = 0; o < 3; o++) {
+        probs[o] = expf(logits[o] - top);
+        total += probs[o];
+    }
+    int level = 0;
+    for (int o = 1; o < 3; o++) {
+        if (probs[o] > probs[level]) level = o;
+    }
+
+    out.fodmap = (FodmapLevel)(FODMAP_LOW + level);
+    out.fodmapConfidence = probs[level] / total;
+    out.glutenLikelihood = 1.0f / (1.0f + expf(-logits[3]));
+    out.confidence = fminf(out.fodmapConfidence, fmaxf(out.glutenLikelihood, 1.0f - out.glutenLikelihood));
+
+    Serial.printf("[MODEL] \"%s\": FODMAP %d (%.2f), gluten %.2f, %s in %lu us\n", key, out.fodmap,
+                  out.fodmapConfidence, out.glutenLikelihood,
+                  foodGuessConfident(out) ? "confident" : "uncertain", micros() - startTime);
+    return true;
+}
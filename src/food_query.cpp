@@ -0,0 +1,170 @@
+#include "food_query.h"
+#include <Arduino.h>
+
+// Section layout (see scripts/foods_db.py): u32 food count, u32 bitmap
+// count, then per bitmap u32 words over the image food indices
+#define QUERY_HEADER_SIZE  8
+#define QUERY_CHUNK_WORDS  32   // bitmap words read at a time
+#define QUERY_RANK_WORDS   16   // words per rank table entry
+
+static uint32_t* result = nullptr;  // matches, words [wordBegin, wordBegin + wordCount)
+static uint16_t* ranks = nullptr;   // matches before each block of QUERY_RANK_WORDS words
+static int wordBegin = 0;
+static int wordCount = 0;
+static int imageMatches = 0;
+
+// Records changed by delta updates are not in the bitmaps: tested one by one
+static int extras[FOODDB_OVERLAY_MAX];
+static int extraCount = 0;
+
+uint32_t foodBitmapsOf(const Food& f) {
+    uint32_t bits = 0;
+    switch (getFodmap(f)) {
+        case FODMAP_LOW:      bits |= FOOD_BIT(FOOD_BITMAP_FODMAP_LOW); break;
+        case FODMAP_MODERATE: bits |= FOOD_BIT(FOOD_BITMAP_FODMAP_MODERATE); break;
+        case FODMAP_HIGH:     bits |= FOOD_BIT(FOOD_BITMAP_FODMAP_HIGH); break;
+        default:              break;
+    }
+    if (hasGluten(f)) bits |= FOOD_BIT(FOOD_BITMAP_GLUTEN);
+    return bits;
+}
+
+bool foodQueryMatches(const FoodQuery& q, const Food& f) {
+    uint32_t bits = foodBitmapsOf(f);
+    return (bits & q.require) == q.require && (bits & q.exclude) == 0 &&
+           (q.category < 0 || f.category == q.category);
+}
+
+void foodQueryClear() {
+    free(result);
+    free(ranks);
+    result = nullptr;
+    ranks = nullptr;
+    wordCount = 0;
+    imageMatches = 0;
+    extraCount = 0;
+}
+
+bool foodQueryRun(const FoodQuery& q) {
+    unsigned long startTime = micros();
+    foodQueryClear();
+
+    // Images without the section (imported from foods.json) are scanned record by record
+    uint32_t counts[2];  // foods, bitmaps
+    bool scan = foodDbSectionSize(FOODDB_SECTION_ATTRS) == 0;
+    if (scan) {
+        int first, last;  // the last category ends with the image
+        foodDbImageCategoryRange(foodDbCategoryCount() - 1, first, last);
+        counts[0] = last;
+        counts[1] = FOOD_BITMAP_COUNT;
+    } else if (!foodDbSectionRead(FOODDB_SECTION_ATTRS, 0, counts, sizeof(counts))) {
+        return false;
+    }
+    uint32_t used = q.require | q.exclude;
+    if (counts[1] < 32 && (used >> counts[1]) != 0) {
+        Serial.println("[QUERY] Attribute not in this database image");
+        return false;
+    }
+
+    int begin = 0, end = counts[0];
+    if (q.category >= 0) foodDbImageCategoryRange(q.category, begin, end);
+    wordBegin = begin / 32;
+    wordCount = (end + 31) / 32 - wordBegin;
+    int blocks = (wordCount + QUERY_RANK_WORDS - 1) / QUERY_RANK_WORDS;
+    result = (uint32_t*)malloc(wordCount * sizeof(uint32_t) + 1);
+    ranks = (uint16_t*)malloc(blocks * sizeof(uint16_t) + 1);
+    if (result == nullptr || ranks == nullptr) {
+        Serial.println("[QUERY] Out of memory");
+        foodQueryClear();
+        return false;
+    }
+
+    // AND the required bitmaps and the complements of the excluded ones
+    uint32_t bitmapWords = (counts[0] + 31) / 32;
+    uint32_t chunk[QUERY_CHUNK_WORDS];
+    for (int at = 0; at < wordCount; at += QUERY_CHUNK_WORDS) {
+        int n = wordCount - at;
+        if (n > QUERY_CHUNK_WORDS) n = QUERY_CHUNK_WORDS;
+        for (int k = 0; k < n; k++) result[at + k] = 0xFFFFFFFF;
+        if (scan) {
+            for (int k = 0; k < n; k++) {
+                for (int bit = 0; bit < 32; bit++) {
+                    int image = (wordBegin + at + k) * 32 + bit;
+                    if (image >= (int)counts[0] || !foodQueryMatches(q, foodDbImageFood(image))) {
+                        result[at + k] &= ~FOOD_BIT(bit);
+                    }
+                }
+            }
+            continue;
+        }
+        for (uint32_t b = 0; b < counts[1] && b < 32; b++) {
+            if ((used & FOOD_BIT(b)) == 0) continue;
+            uint32_t offset = QUERY_HEADER_SIZE + (b * bitmapWords + wordBegin + at) * sizeof(uint32_t);
+            if (!foodDbSectionRead(FOODDB_SECTION_ATTRS, offset, chunk, n * sizeof(uint32_t))) {
+                foodQueryClear();
+                return false;
+            }
+            uint32_t invert = (q.exclude & FOOD_BIT(b)) ? 0xFFFFFFFF : 0;
+            for (int k = 0; k < n; k++) result[at + k] &= chunk[k] ^ invert;
+        }
+    }
+    if (wordCount > 0) {
+        result[0] &= 0xFFFFFFFF << (begin % 32);
+        if (end % 32) result[wordCount - 1] &= (1u << (end % 32)) - 1;
+    }
+
+    // Drop image records changed by deltas, count and build the rank table
+    for (int w = 0; w < wordCount; w++) {
+        if (w % QUERY_RANK_WORDS == 0) ranks[w / QUERY_RANK_WORDS] = imageMatches;
+        uint32_t bits = result[w];
+        for (uint32_t rest = bits; rest; rest &= rest - 1) {
+            int image = (wordBegin + w) * 32 + __builtin_ctz(rest);
+            if (foodDbFromImageIndex(image) < 0) bits &= ~(rest & (0 - rest));
+        }
+        result[w] = bits;
+        imageMatches += __builtin_popcount(bits);
+    }
+
+    int changed[FOODDB_OVERLAY_MAX];
+    int changedCount = foodDbOverlayFoods(changed, FOODDB_OVERLAY_MAX);
+    for (int i = 0; i < changedCount; i++) {
+        if (foodQueryMatches(q, foodDbGetFood(changed[i]))) extras[extraCount++] = changed[i];
+    }
+
+    Serial.printf("[QUERY] require %02x exclude %02x category %d: %d of %d foods in %lu us\n",
+                  (unsigned)q.require, (unsigned)q.exclude, q.category, foodQueryCount(),
+                  end - begin, micros() - startTime);
+    return true;
+}
+
+int foodQueryCount() {
+    return imageMatches + extraCount;
+}
+
+int foodQueryFood(int pos) {
+    if (pos < 0) return -1;
+    if (pos >= imageMatches) {
+        pos -= imageMatches;
+        return pos < extraCount ? extras[pos] : -1;
+    }
+
+    // Last block starting at or before pos, then the word, then the bit
+    int lo = 0, hi = (wordCount - 1) / QUERY_RANK_WORDS;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (ranks[mid] <= pos) lo = mid;
+        else hi = mid - 1;
+    }
+    int rest = pos - ranks[lo];
+    for (int w = lo * QUERY_RANK_WORDS; w < wordCount; w++) {
+        uint32_t bits = result[w];
+        int count = __builtin_popcount(bits);
+        if (rest >= count) {
+            rest -= count;
+            continue;
+        }
+        while (rest-- > 0) bits &= bits - 1;
+        return foodDbFromImageIndex((wordBegin + w) * 32 + __builtin_ctz(bits));
+    }
+    return -1;
+}
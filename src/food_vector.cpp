@@ -0,0 +1,130 @@
+#include "food_vector.h"
+#include "food_db.h"
+#include <Arduino.h>
+#include <math.h>
+
+// Section layout (see scripts/foods_db.py): u32 key count, u32 dimensions
+// (a multiple of 4), u32 food count, u32 first key per food plus the key
+// count, then per key u16 food index, u16 norm, i8 vector[dims]
+#define VECTOR_HEADER_SIZE  12
+#define VECTOR_KEY_HEADER   4
+#define VECTOR_CHUNK_BYTES  512   // keys read per section access
+#define VECTOR_GOLDEN       0x9E3779B9u
+
+// Murmur3 finalizer (mix32 in scripts/foods_db.py)
+static uint32_t mix32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x85EBCA6B;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35;
+    return x ^ (x >> 16);
+}
+
+// Sum of a +-1 vector per trigram (bit j of the mixed code), scaled so the
+// largest component is +-127, rounding half away from zero as foods_db.py
+static void sketch(const uint16_t* grams, size_t gramCount, uint32_t dims, int8_t* out) {
+    int32_t acc[FOOD_VECTOR_MAX_DIMS] = {0};
+    for (size_t i = 0; i < gramCount; i++) {
+        for (uint32_t word = 0; word * 32 < dims; word++) {
+            uint32_t bits = mix32(grams[i] + word * VECTOR_GOLDEN);
+            for (uint32_t j = word * 32; j < dims && j < word * 32 + 32; j++) {
+                acc[j] += ((bits >> (j % 32)) & 1) ? 1 : -1;
+            }
+        }
+    }
+
+    int32_t peak = 0;
+    for (uint32_t j = 0; j < dims; j++) {
+        if (abs(acc[j]) > peak) peak = abs(acc[j]);
+    }
+    for (uint32_t j = 0; j < dims; j++) {
+        int32_t v = peak ? (2 * 127 * abs(acc[j]) + peak) / (2 * peak) : 0;
+        out[j] = acc[j] < 0 ? -v : v;
+    }
+}
+
+// int8 dot product in four independent accumulators, which the compiler
+// keeps in registers and schedules around the multiplier latency
+static int32_t dot(const int8_t* a, const int8_t* b, uint32_t dims) {
+    int32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (uint32_t j = 0; j < dims; j += 4) {
+        s0 += a[j] * b[j];
+        s1 += a[j + 1] * b[j + 1];
+        s2 += a[j + 2] * b[j + 2];
+        s3 += a[j + 3] * b[j + 3];
+    }
+    return s0 + s1 + s2 + s3;
+}
+
+// Insert into the best-first list, one entry per food
+static void keepBest(FoodVectorHit* out, int& hits, int k, int food, float score) {
+    int pos = -1;
+    for (int i = 0; i < hits; i++) {
+        if (out[i].foodIndex == food) {
+            if (out[i].score >= score) return;
+            pos = i;
+            break;
+        }
+    }
+    if (pos < 0) {
+        if (hits < k) pos = hits++;
+        else if (score > out[k - 1].score) pos = k - 1;
+        else return;
+    }
+    for (; pos > 0 && out[pos - 1].score < score; pos--) out[pos] = out[pos - 1];
+    out[pos].foodIndex = food;
+    out[pos].score = score;
+}
+
+int foodVectorSearch(const uint16_t* grams, size_t gramCount, const uint16_t* candidates,
+                     size_t candidateCount, FoodVectorHit* out, int k) {
+    unsigned long startTime = micros();
+    uint32_t counts[3];  // keys, dimensions, foods
+    if (k <= 0 || gramCount == 0 || candidateCount == 0 ||
+        !foodDbSectionReadDirect(FOODDB_SECTION_VECTORS, 0, counts, sizeof(counts)) ||
+        counts[1] == 0 || counts[1] > FOOD_VECTOR_MAX_DIMS || counts[1] % 4 != 0) {
+        return 0;
+    }
+    uint32_t dims = counts[1];
+    uint32_t stride = VECTOR_KEY_HEADER + dims;
+    uint32_t keysAt = VECTOR_HEADER_SIZE + (counts[2] + 1) * sizeof(uint32_t);
+
+    int8_t query[FOOD_VECTOR_MAX_DIMS];
+    sketch(grams, gramCount, dims, query);
+    float queryNorm = sqrtf((float)dot(query, query, dims));
+    if (queryNorm == 0.0f) return 0;
+
+    int hits = 0;
+    uint32_t keysRead = 0;
+    uint8_t chunk[VECTOR_CHUNK_BYTES];
+    uint32_t perChunk = sizeof(chunk) / stride;
+    for (size_t c = 0; c < candidateCount; c++) {
+        uint16_t image = candidates[c];
+        int food = foodDbFromImageIndex(image);  // -1: changed by a delta, not sketched
+        uint32_t range[2];                       // its keys
+        if (food < 0 || image >= counts[2] ||
+            !foodDbSectionReadDirect(FOODDB_SECTION_VECTORS, VECTOR_HEADER_SIZE + image * sizeof(uint32_t),
+                                     range, sizeof(range)) ||
+            range[1] > counts[0]) {
+            continue;
+        }
+        for (uint32_t at = range[0]; at < range[1]; at += perChunk) {
+            uint32_t n = range[1] - at;
+            if (n > perChunk) n = perChunk;
+            if (!foodDbSectionReadDirect(FOODDB_SECTION_VECTORS, keysAt + at * stride, chunk, n * stride)) break;
+            keysRead += n;
+            for (uint32_t i = 0; i < n; i++) {
+                const uint8_t* rec = chunk + i * stride;
+                uint16_t norm = rec[2] | (rec[3] << 8);
+                if (norm == 0) continue;
+                float score = dot(query, (const int8_t*)rec + VECTOR_KEY_HEADER, dims) / (queryNorm * norm);
+                if (hits < k || score > out[k - 1].score) keepBest(out, hits, k, food, score);
+            }
+        }
+    }
+
+    Serial.printf("[VECTOR] %u candidates, %u of %u keys x %u dims: best %d (%.2f) in %lu us\n",
+                  (unsigned)candidateCount, (unsigned)keysRead, (unsigned)counts[0], (unsigned)dims,
+                  hits ? out[0].foodIndex : -1, hits ? out[0].score : 0.0f, micros() - startTime);
+    return hits;
+}
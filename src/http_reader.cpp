@@ -0,0 +1,102 @@
+#include "http_reader.h"
+#include "perf_probe.h"
+#include <string.h>
+
+#define HTTP_STATUS_TRIES  3   // lines read looking for the status line
+
+size_t httpReadLine(Stream& in, char* buf, size_t size) {
+    size_t len = 0;
+    char c;
+    while (in.readBytes(&c, 1) == 1 && c != '\n') {
+        if (len + 1 < size) buf[len++] = c;
+    }
+    while (len > 0 && (buf[len - 1] == '\r' || buf[len - 1] == ' ' || buf[len - 1] == '\t')) len--;
+    buf[len] = '\0';
+    return len;
+}
+
+bool httpReadHead(Stream& in, HttpResponse& out) {
+    PERF_PROBE("http_head");
+    out.status = 0;
+    out.chunked = false;
+    out.contentLength = -1;
+
+    // Status line (e.g. "HTTP/1.1 200 OK"); a read that times out counts as a try
+    char line[HTTP_LINE_MAX];
+    size_t len = 0;
+    for (int i = 0; i < HTTP_STATUS_TRIES && len == 0; i++) len = httpReadLine(in, line, sizeof(line));
+    if (len == 0) return false;
+    const char* space = strchr(line, ' ');
+    if (space) out.status = atoi(space + 1);
+
+    while (httpReadLine(in, line, sizeof(line)) > 0) {
+        if (strncasecmp(line, "transfer-encoding:", 18) == 0 && strcasestr(line + 18, "chunked")) {
+            out.chunked = true;
+        } else if (strncasecmp(line, "content-length:", 15) == 0) {
+            out.contentLength = atol(line + 15);
+        }
+    }
+    return true;
+}
+
+HttpBody::HttpBody(Stream& in, const HttpResponse& head)
+    : in(in), chunked(head.chunked), left(head.chunked ? 0 : head.contentLength), done(false) {}
+
+bool HttpBody::ready() {
+    if (done) return false;
+    if (left != 0) return true;
+    if (!chunked) {
+        done = true;
+        return false;
+    }
+
+    // Next chunk size in hex; after a chunk's data its "\r\n" comes first
+    char line[24];
+    size_t len = httpReadLine(in, line, sizeof(line));
+    if (len == 0) len = httpReadLine(in, line, sizeof(line));
+    left = len ? strtol(line, nullptr, 16) : 0;
+    if (left <= 0) {
+        left = 0;
+        done = true;  // last chunk (trailers are not read), or a broken stream
+        return false;
+    }
+    return true;
+}
+
+int HttpBody::available() {
+    if (!ready()) return 0;
+    int n = in.available();
+    return (left >= 0 && n > left) ? (int)left : n;
+}
+
+int HttpBody::read() {
+    if (!ready()) return -1;
+    int c = in.read();
+    if (c >= 0 && left > 0) left--;
+    return c;
+}
+
+int HttpBody::peek() {
+    return ready() ? in.peek() : -1;
+}
+
+size_t HttpBody::readBytes(char* buf, size_t len) {
+    size_t n = 0;
+    while (n < len && ready()) {
+        size_t want = len - n;
+        if (left > 0 && (long)want > left) want = left;
+        size_t got = in.readBytes(buf + n, want);
+        if (got == 0) {
+            done = true;  // timed out or closed
+            break;
+        }
+        n += got;
+        if (left > 0) left -= got;
+    }
+    return n;
+}
+
+void HttpBody::drain() {
+    char buf[64];
+    while (readBytes(buf, sizeof(buf)) > 0) {}
+}
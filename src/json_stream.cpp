@@ -0,0 +1,253 @@
+#include "json_stream.h"
+
+// Parser states: what the next token may be
+enum {
+    JS_VALUE,        // any value
+    JS_FIRST_VALUE,  // a value or ']' (just after '[')
+    JS_KEY,          // a key
+    JS_FIRST_KEY,    // a key or '}' (just after '{')
+    JS_COLON,        // ':' after a key
+    JS_AFTER,        // ',' or the end of the container
+    JS_DONE
+};
+
+void jsonStreamBegin(JsonStream& js, Stream& in) {
+    js.in = &in;
+    js.len = 0;
+    js.pos = 0;
+    js.offset = 0;
+    js.text[0] = '\0';
+    js.textLen = 0;
+    js.depth = 0;
+    js.state = JS_VALUE;
+    js.arrays = 0;
+    js.error = nullptr;
+}
+
+uint32_t jsonStreamOffset(const JsonStream& js) {
+    return js.offset + js.pos;
+}
+
+// Next byte without consuming it, -1 at the end of the stream
+static int peekByte(JsonStream& js) {
+    if (js.pos == js.len) {
+        js.offset += js.len;
+        js.pos = 0;
+        js.len = js.in->readBytes(js.buf, sizeof(js.buf));
+        if (js.len == 0) return -1;
+    }
+    return js.buf[js.pos];
+}
+
+static int readByte(JsonStream& js) {
+    int c = peekByte(js);
+    if (c >= 0) js.pos++;
+    return c;
+}
+
+static int skipSpace(JsonStream& js) {
+    int c = peekByte(js);
+    while (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+        js.pos++;
+        c = peekByte(js);
+    }
+    return c;
+}
+
+// Record the first error and stop; false for the readers below
+static bool setError(JsonStream& js, const char* error) {
+    if (js.error == nullptr) js.error = error;
+    js.state = JS_DONE;
+    return false;
+}
+
+static JsonEvent fail(JsonStream& js, const char* error) {
+    setError(js, error);
+    return JSON_ERROR;
+}
+
+static bool putText(JsonStream& js, char c) {
+    if (js.textLen + 1 >= JSON_STREAM_TEXT) return false;
+    js.text[js.textLen++] = c;
+    return true;
+}
+
+static bool putCodePoint(JsonStream& js, uint32_t cp) {
+    if (cp < 0x80) return putText(js, (char)cp);
+    if (cp < 0x800) return putText(js, 0xC0 | (cp >> 6)) && putText(js, 0x80 | (cp & 0x3F));
+    if (cp < 0x10000) {
+        return putText(js, 0xE0 | (cp >> 12)) && putText(js, 0x80 | ((cp >> 6) & 0x3F)) &&
+               putText(js, 0x80 | (cp & 0x3F));
+    }
+    return putText(js, 0xF0 | (cp >> 18)) && putText(js, 0x80 | ((cp >> 12) & 0x3F)) &&
+           putText(js, 0x80 | ((cp >> 6) & 0x3F)) && putText(js, 0x80 | (cp & 0x3F));
+}
+
+static int readHex4(JsonStream& js) {
+    int v = 0;
+    for (int i = 0; i < 4; i++) {
+        int c = readByte(js);
+        if (c >= '0' && c <= '9') v = v * 16 + (c - '0');
+        else if (c >= 'a' && c <= 'f') v = v * 16 + (c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') v = v * 16 + (c - 'A' + 10);
+        else return -1;
+    }
+    return v;
+}
+
+// String body after the opening quote, unescaped into text
+static bool readString(JsonStream& js) {
+    js.textLen = 0;
+    for (;;) {
+        int c = readByte(js);
+        if (c < 0) return setError(js, "Unexpected end");
+        if (c == '"') break;
+        if (c < 0x20) return setError(js, "Bad string");
+        if (c != '\\') {
+            if (!putText(js, (char)c)) return setError(js, "String too long");
+            continue;
+        }
+
+        c = readByte(js);
+        uint32_t cp;
+        switch (c) {
+            case '"': case '\\': case '/': cp = c; break;
+            case 'b': cp = '\b'; break;
+            case 'f': cp = '\f'; break;
+            case 'n': cp = '\n'; break;
+            case 'r': cp = '\r'; break;
+            case 't': cp = '\t'; break;
+            case 'u': {
+                int hi = readHex4(js);
+                if (hi < 0) return setError(js, "Bad escape");
+                cp = hi;
+                if (hi >= 0xD800 && hi < 0xDC00) {
+                    // Surrogate pair: the low half must follow as another \u escape
+                    int lo = (readByte(js) == '\\' && readByte(js) == 'u') ? readHex4(js) : -1;
+                    if (lo < 0xDC00 || lo >= 0xE000) return setError(js, "Bad escape");
+                    cp = 0x10000 + ((hi - 0xD800) << 10) + (lo - 0xDC00);
+                }
+                break;
+            }
+            default:
+                return setError(js, "Bad escape");
+        }
+        if (!putCodePoint(js, cp)) return setError(js, "String too long");
+    }
+    js.text[js.textLen] = '\0';
+    return true;
+}
+
+static bool readNumber(JsonStream& js) {
+    js.textLen = 0;
+    for (int c = peekByte(js); (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+         c = peekByte(js)) {
+        if (!putText(js, (char)c)) return setError(js, "Number too long");
+        js.pos++;
+    }
+    js.text[js.textLen] = '\0';
+    return true;
+}
+
+static bool readLiteral(JsonStream& js, const char* word) {
+    for (const char* p = word; *p; p++) {
+        if (readByte(js) != *p) return false;
+    }
+    return true;
+}
+
+static JsonEvent openContainer(JsonStream& js, bool array) {
+    if (js.depth >= JSON_STREAM_DEPTH) return fail(js, "Nesting too deep");
+    js.pos++;
+    if (array) js.arrays |= 1u << js.depth;
+    else js.arrays &= ~(1u << js.depth);
+    js.depth++;
+    js.state = array ? JS_FIRST_VALUE : JS_FIRST_KEY;
+    return array ? JSON_ARRAY_BEGIN : JSON_OBJECT_BEGIN;
+}
+
+static JsonEvent closeContainer(JsonStream& js) {
+    js.pos++;
+    js.depth--;
+    js.state = JS_AFTER;
+    return (js.arrays & (1u << js.depth)) ? JSON_ARRAY_END : JSON_OBJECT_END;
+}
+
+static bool inArray(const JsonStream& js) {
+    return js.depth > 0 && (js.arrays & (1u << (js.depth - 1)));
+}
+
+JsonEvent jsonStreamNext(JsonStream& js) {
+    for (;;) {
+        if (js.state == JS_DONE) return js.error ? JSON_ERROR : JSON_DONE;
+        if (js.state == JS_AFTER && js.depth == 0) {
+            js.state = JS_DONE;
+            return JSON_DONE;
+        }
+
+        int c = skipSpace(js);
+        if (c < 0) return fail(js, "Unexpected end");
+
+        switch (js.state) {
+            case JS_AFTER:
+                if (c == ',') {
+                    js.pos++;
+                    js.state = inArray(js) ? JS_VALUE : JS_KEY;
+                    continue;
+                }
+                if (c == (inArray(js) ? ']' : '}')) return closeContainer(js);
+                return fail(js, "Expected ','");
+
+            case JS_COLON:
+                if (c != ':') return fail(js, "Expected ':'");
+                js.pos++;
+                js.state = JS_VALUE;
+                continue;
+
+            case JS_FIRST_KEY:
+                if (c == '}') return closeContainer(js);
+                // fall through
+            case JS_KEY:
+                if (c != '"') return fail(js, "Expected key");
+                js.pos++;
+                if (!readString(js)) return JSON_ERROR;
+                js.state = JS_COLON;
+                return JSON_KEY;
+
+            case JS_FIRST_VALUE:
+                if (c == ']') return closeContainer(js);
+                // fall through
+            default:
+                break;
+        }
+
+        // A value
+        js.state = JS_AFTER;
+        switch (c) {
+            case '{': return openContainer(js, false);
+            case '[': return openContainer(js, true);
+            case '"':
+                js.pos++;
+                return readString(js) ? JSON_STRING : JSON_ERROR;
+            case 't': return readLiteral(js, "true") ? JSON_TRUE : fail(js, "Bad literal");
+            case 'f': return readLiteral(js, "false") ? JSON_FALSE : fail(js, "Bad literal");
+            case 'n': return readLiteral(js, "null") ? JSON_NULL : fail(js, "Bad literal");
+            default:
+                if (c == '-' || (c >= '0' && c <= '9')) return readNumber(js) ? JSON_NUMBER : JSON_ERROR;
+                return fail(js, "Unexpected character");
+        }
+    }
+}
+
+bool jsonStreamSkip(JsonStream& js, JsonEvent first) {
+    if (first == JSON_ERROR || first == JSON_DONE) return false;
+    if (first != JSON_OBJECT_BEGIN && first != JSON_ARRAY_BEGIN) return true;
+    int level = 1;
+    while (level > 0) {
+        JsonEvent ev = jsonStreamNext(js);
+        if (ev == JSON_ERROR || ev == JSON_DONE) return false;
+        if (ev == JSON_OBJECT_BEGIN || ev == JSON_ARRAY_BEGIN) level++;
+        else if (ev == JSON_OBJECT_END || ev == JSON_ARRAY_END) level--;
+    }
+    return true;
+}
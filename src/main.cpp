@@ -1,11 +1,24 @@
 #include <M5Unified.h>
 #include <LittleFS.h>
-#include <ArduinoJson.h>
 #include <Preferences.h>
+#include <esp_heap_caps.h>
+#include <atomic>
 #include "language.h"
 #include "wifi_manager.h"
 #include "audio_manager.h"
 #include "mistral_client.h"
+#include "food_db.h"
+#include "food_alpha.h"
+#include "food_query.h"
+#include "text_norm.h"
+#include "meal_eval.h"
+#include "food_model.h"
+#include "classify_cache.h"
+#include "db_update.h"
+#include "query_arena.h"
+#include "resume_state.h"
+#include "scroll_text.h"
+#include "perf_probe.h"
 #include "fonts/DejaVuSans6pt_Latin.h"
 #include "fonts/DejaVuSans8pt_Latin.h"
 #include "fonts/DejaVuSans9pt_Latin.h"
@@ -35,6 +48,10 @@ const char* STR_SETTINGS[] = {"Settings", "Definições"};
 const char* STR_LANGUAGE[] = {"Language", "Idioma"};
 const char* STR_LANG_NAME[] = {"English", "Português"};
 const char* STR_NAV_SETTINGS[] = {"M5:Change  B:Back", "M5:Mudar  B:Voltar"};
+const char* STR_NAV_FOODS[] = {"PWR:Next  M5:Select  Hold M5:A-Z", "PWR:Próx  M5:Escolher  Manter M5:A-Z"};
+const char* STR_NAV_SEARCH[] = {"PWR:Letter  M5:Add  Hold M5:Go", "PWR:Letra  M5:Juntar  Manter M5:Ir"};
+const char* STR_FIND[] = {"Find: ", "Procurar: "};
+const char* STR_SAFE_FOODS[] = {"Safe foods (all)", "Seguros (todos)"};
 
 // WiFi status strings
 const char* STR_WIFI_CONNECTING[] = {"Connecting...", "A ligar..."};
@@ -52,6 +69,8 @@ const char* STR_BROWSE_FOODS[] = {"Browse Foods", "Ver Alimentos"};
 const char* STR_ERROR_API[]    = {"API Error", "Erro de API"};
 const char* STR_NOT_FOOD[]     = {"Not a food", "Não é alimento"};
 const char* STR_TRY_AGAIN[]    = {"Try again", "Tente novamente"};
+const char* STR_ESTIMATE[]     = {"Offline estimate", "Estimativa offline"};
+const char* STR_UNCERTAIN[]    = {"Uncertain", "Incerto"};
 
 // Language functions
 void loadLanguage() {
@@ -76,45 +95,57 @@ enum MenuState {
     STATE_MAIN_MENU,
     STATE_CATEGORIES,
     STATE_FOODS,
+    STATE_SEARCH,
     STATE_RESULT,
     STATE_SETTINGS,
     STATE_RECORDING,
     STATE_AI_PROCESSING
 };
 
-// Food structure
-struct Food {
-    String name_pt;
-    String name_en;
-    String category;
-    String fodmap;
-    bool gluten;
-};
-
-// Category structure
-struct Category {
-    String id;
-    String name_pt;
-    String name_en;
-};
-
 // Global state
 MenuState currentState = STATE_MAIN_MENU;
 int currentIndex = 0;
 int itemCount = 0;
-String selectedCategory = "";
-
-// Data storage
-Category categories[8];
-int categoryCount = 0;
-Food foods[200];
-int foodCount = 0;
-Food* filteredFoods[200];
+int selectedCategory = -1;
+
+// Foods in the selected category, in alphabetical order (food_alpha.h), or
+// the safe foods of all categories (food_query.h) after the last category
 int filteredCount = 0;
+static bool safeList = false;
+
+// Letter search: typed prefix of the collation key and the letter offered next
+static char searchPrefix[TEXT_NORM_MAX] = "";
+static size_t searchLen = 0;
+static char searchNext = '\0';
+static int searchBegin = 0;  // foods under prefix + offered letter: [searchBegin, searchEnd)
+static int searchEnd = 0;
+static MenuState btnAPressState = STATE_MAIN_MENU;  // screen on which M5 went down
 
 // Voice search result state
 static Food voiceResultFood;
+static char voiceResultName[MISTRAL_TEXT_MAX];  // backing storage for voiceResultFood names
 static bool voiceResultActive = false;
+static bool voiceResultEstimate = false;   // guessed on the device (food_model), not classified
+static bool voiceResultUncertain = false;  // ...and below FOOD_MODEL_CONFIDENT
+static bool voiceWifiKept = false;   // WiFi left on through the recording (PSRAM boards)
+static bool voiceStreaming = false;  // ...and the recording uploaded while it is made
+
+// Food database, loaded by a task on the other core while the main menu is
+// already up; Voice Search and Browse Foods read foods, so they wait for it.
+// The task stores dbLoadState with release once the database (or the error
+// below) is in place; loop() loads it with acquire before reading either.
+enum DbLoadState { DB_LOADING, DB_READY, DB_FAILED };
+#define DB_LOAD_STACK  8192
+#define DB_LOAD_CORE   0   // loop() runs on core 1
+static std::atomic<DbLoadState> dbLoadState(DB_LOADING);
+static const char* dbLoadTitle = "";   // what failed, with DB_FAILED
+static const char* dbLoadError = "";
+static int dbWaitItem = -1;  // main menu item chosen before DB_READY (MENU_*), opened once ready
+static ResumeState dbWaitResume;     // food screen left before sleep, back to it once ready
+static bool dbWaitResumeSet = false;
+
+// Main menu items; Voice Search is only listed when online
+enum MainMenuItem { MENU_VOICE, MENU_BROWSE, MENU_SETTINGS };
 
 // Display colors
 const uint16_t COLOR_LOW = TFT_GREEN;
@@ -123,12 +154,11 @@ const uint16_t COLOR_HIGH = TFT_RED;
 const uint16_t COLOR_UNKNOWN = TFT_BLUE;
 
 // Scroll state for long text
-String scrollText = "";
+char scrollText[SCROLL_TEXT_MAX] = "";
 int scrollPos = 0;
 unsigned long lastScrollTime = 0;
 const int SCROLL_DELAY = 300;        // ms between scroll steps
 const int SCROLL_PAUSE = 1500;       // ms pause at start/end
-const int SCROLL_AREA_WIDTH = 220;   // pixels available for scrolling text
 bool scrollPaused = true;
 int lastFoodIndex = -1;  // Track food index for scroll reset
 
@@ -137,53 +167,59 @@ unsigned long lastActivityTime = 0;
 const unsigned long INACTIVITY_TIMEOUT = 5 * 60 * 1000;  // 5 minutes in ms
 
 // Function declarations
-void loadFoodsDatabase();
+void startDbLoad();
+void drawDbError();
+void drawDbWaiting();
+void openMainMenuItem(int item);
+bool resumeScreen(const ResumeState& resume);
+void saveResume();
 void drawMainMenu();
 void drawCategories();
 void drawFoods();
+void drawSearch();
 void drawResult();
 void drawSettings();
 void drawProcessing();
 void drawError(const char* title, const char* detail);
-void filterFoodsByCategory(const String& categoryId);
-uint16_t getFodmapColor(const String& level);
-String getFodmapLabel(const String& level);
-void resetScroll(const String& text);
-String getScrolledText(const String& text);
+void filterFoodsByCategory(int categoryId);
+void searchStart();
+void searchUpdate(unsigned long startTime);
+void searchJump();
+uint16_t getFodmapColor(FodmapLevel level);
+const char* getFodmapLabel(FodmapLevel level);
+void resetScroll(const char* text);
 bool updateScroll();
 
 // Language-aware name accessors
-inline const String& getName(const Category& c) {
+inline const char* getName(const Category& c) {
     return (currentLang == LANG_PT) ? c.name_pt : c.name_en;
 }
-inline const String& getName(const Food& f) {
+inline const char* getName(const Food& f) {
     return (currentLang == LANG_PT) ? f.name_pt : f.name_en;
 }
 
+// Food index at a position of the current food list
+int listFood(int pos) {
+    return safeList ? foodQueryFood(pos) : alphaFood(pos);
+}
+
+// Food under the cursor (or the voice search answer on the result screen)
+Food getSelectedFood() {
+    if (voiceResultActive) return voiceResultFood;
+    return foodDbGetFood(listFood(currentIndex));
+}
+
 // Reset scroll state when changing items
-void resetScroll(const String& text) {
-    scrollText = text;
+void resetScroll(const char* text) {
+    snprintf(scrollText, sizeof(scrollText), "%s", text);
     scrollPos = 0;
     lastScrollTime = millis();
     scrollPaused = true;
 }
 
-// Get the visible portion of scrolling text (pixel-based for proportional fonts)
-String getScrolledText(const String& text) {
-    if (M5.Display.textWidth(text.c_str()) <= SCROLL_AREA_WIDTH) {
-        return text;
-    }
-
-    // Add padding for smooth loop
-    String padded = text + "   " + text;
-    String visible = padded.substring(scrollPos);
-    int len = M5.Display.textLength(visible.c_str(), SCROLL_AREA_WIDTH);
-    return visible.substring(0, len);
-}
-
 // Update scroll position (call from loop)
 bool updateScroll() {
-    if (M5.Display.textWidth(scrollText.c_str()) <= SCROLL_AREA_WIDTH) {
+    if (M5.Display.textWidth(scrollText) <= SCROLL_AREA_WIDTH) {
         return false;  // No scroll needed
     }
 
@@ -196,7 +232,7 @@ bool updateScroll() {
         scrollPos++;
 
         // Reset when we've scrolled through original text + padding
-        if (scrollPos >= (int)scrollText.length() + 3) {
+        if (scrollPos >= (int)strlen(scrollText) + 3) {
             scrollPos = 0;
             scrollPaused = true;
         }
@@ -218,32 +254,21 @@ void setup() {
     M5.Display.setTextSize(1);
     M5.Display.setTextDatum(textdatum_t::top_left);
 
-    // Splash screen — vertically and horizontally centered
-    M5.Display.setFont(FONT_LARGE);
-    int titleW = M5.Display.textWidth("Safe Bite");
-    int titleH = M5.Display.fontHeight();
-    M5.Display.setFont(FONT_SMALL);
-    int tagW = M5.Display.textWidth("Food Safety Checker");
-    int tagH = M5.Display.fontHeight();
-    int gap = 8;
-    int totalH = titleH + gap + tagH;
-    int startY = (135 - totalH) / 2;
-
-    M5.Display.setFont(FONT_LARGE);
-    M5.Display.setTextColor(TFT_GREEN);
-    M5.Display.setCursor((240 - titleW) / 2, startY);
-    M5.Display.print("Safe Bite");
-
-    M5.Display.setFont(FONT_SMALL);
-    M5.Display.setTextColor(TFT_LIGHTGREY);
-    M5.Display.setCursor((240 - tagW) / 2, startY + titleH + gap);
-    M5.Display.print("Food Safety Checker");
-
-    delay(1500);  // Show for 1.5 seconds
-    M5.Display.fillScreen(TFT_BLACK);  // Clear before loading screen
+    // A wake from deep sleep brings the language and the last access point
+    // back from RTC memory (resume_state.h); a cold boot reads the language from NVS
+    ResumeState resume;
+    bool warm = resumeTake(resume);
+    if (warm) {
+        currentLang = resume.lang < LANG_COUNT ? resume.lang : LANG_EN;
+        wifiHintAp(resume.bssid, resume.channel);
+    } else {
+        loadLanguage();
+    }
 
-    // Initialize WiFi (non-blocking)
+    // Start WiFi association and the database load; both go on in the
+    // background while the menu is in use
     wifiInit();
+    startDbLoad();
 
     // Initialize audio recording (allocate buffer)
     if (!audioInit()) {
@@ -252,32 +277,11 @@ void setup() {
 
     // Power button is handled by M5Unified via M5.BtnPWR
 
-    // Load saved language preference
-    loadLanguage();
-
-    // Show loading screen
-    M5.Display.setTextColor(TFT_WHITE);
-    M5.Display.setFont(FONT_MEDIUM);
-    M5.Display.setCursor(20, 50);
-    M5.Display.print(STR(STR_LOADING));
-
-    // Initialize LittleFS
-    if (!LittleFS.begin(true)) {
-        M5.Display.fillScreen(TFT_RED);
-        M5.Display.setFont(FONT_MEDIUM);
-        M5.Display.setTextColor(TFT_WHITE);
-        M5.Display.setCursor(10, 50);
-        M5.Display.print("FS Error!");
-        while (1) delay(1000);
-    }
-
-    // Load food database
-    loadFoodsDatabase();
-
-    // Initial display - main menu
+    // Initial display - the screen left before sleep, or the main menu
     currentState = STATE_MAIN_MENU;
     currentIndex = 0;
-    drawMainMenu();
+    if (!warm || !resumeScreen(resume)) drawMainMenu();
+    Serial.printf("[BOOT] Interactive in %lu ms (target 300%s)\n", millis(), warm ? ", warm resume" : "");
 
     // Initialize inactivity timer
     lastActivityTime = millis();
@@ -298,6 +302,32 @@ void loop() {
         lastWifiState = wifiState;
     }
 
+    // Background database load: a failure stops here as it did at boot; an
+    // item chosen while loading opens now, unless the user moved on
+    DbLoadState dbState = dbLoadState.load(std::memory_order_acquire);
+    if (dbState == DB_FAILED) drawDbError();
+    if (dbWaitItem >= 0 && dbState == DB_READY) {
+        int item = dbWaitItem;
+        dbWaitItem = -1;
+        if (currentState == STATE_MAIN_MENU) openMainMenuItem(item);
+    }
+    if (dbWaitResumeSet && dbState == DB_READY) {
+        dbWaitResumeSet = false;
+        if (currentState == STATE_MAIN_MENU && !resumeScreen(dbWaitResume)) drawMainMenu();
+    }
+
+    // Food database deltas: pushed over serial any time the main menu is up,
+    // fetched from the update server once per boot when online. The main
+    // menu shows no foods, so nothing on screen goes stale.
+    static bool updateFetched = false;
+    if (currentState == STATE_MAIN_MENU && dbState == DB_READY) {
+        dbUpdatePollSerial();
+        if (!updateFetched && wifiState == WIFI_STATE_CONNECTED) {
+            updateFetched = true;
+            dbUpdateFetch();
+        }
+    }
+
     // Power button (left side): Next item (short press)
     unsigned long now = millis();
 
@@ -309,20 +339,33 @@ void loop() {
                 // Online: Voice Search, Browse Foods, Settings (3 items)
                 // Offline: Browse Foods, Settings (2 items)
                 int totalItems = isOnline() ? 3 : 2;
+                dbWaitResumeSet = false;  // the user has moved on
                 currentIndex = (currentIndex + 1) % totalItems;
+                dbWaitItem = -1;
                 drawMainMenu();
                 break;
             }
             case STATE_CATEGORIES: {
-                currentIndex = (currentIndex + 1) % categoryCount;
+                // Categories, then the safe foods list
+                currentIndex = (currentIndex + 1) % (foodDbCategoryCount() + 1);
                 drawCategories();
                 break;
             }
             case STATE_FOODS:
                 currentIndex = (currentIndex + 1) % itemCount;
-                resetScroll(getName(*filteredFoods[currentIndex]));
+                resetScroll(getName(getSelectedFood()));
                 drawFoods();
                 break;
+            case STATE_SEARCH: {
+                // Next letter that still matches a food (wraps around)
+                unsigned long startTime = micros();
+                char next = alphaNextChar(searchPrefix, searchNext);
+                if (next == '\0') next = alphaNextChar(searchPrefix, '\0');
+                searchNext = next;
+                searchUpdate(startTime);
+                drawSearch();
+                break;
+            }
             case STATE_SETTINGS:
             case STATE_RESULT:
             case STATE_RECORDING:
@@ -335,65 +378,41 @@ void loop() {
     // Button A (big M5): Select / Change
     if (M5.BtnA.wasPressed()) {
         lastActivityTime = millis();  // Reset inactivity timer
+        btnAPressState = currentState;
         switch (currentState) {
-            case STATE_MAIN_MENU: {
+            case STATE_MAIN_MENU:
                 // Online: 0=Voice Search, 1=Browse Foods, 2=Settings
                 // Offline: 0=Browse Foods, 1=Settings
-                if (isOnline()) {
-                    if (currentIndex == 0) {
-                        // Voice Search selected - disable WiFi to free heap for audio buffer
-                        wifiDisable();
-                        if (audioStartRecording()) {
-                            currentState = STATE_RECORDING;
-                        } else {
-                            // Audio init failed - reconnect WiFi and show error
-                            wifiReconnect();
-                            drawError("Audio Error", STR(STR_TRY_AGAIN));
-                            delay(1500);
-                            drawMainMenu();
-                        }
-                    } else if (currentIndex == 1) {
-                        // Browse Foods selected
-                        currentState = STATE_CATEGORIES;
-                        currentIndex = 0;
-                        drawCategories();
-                    } else {
-                        // Settings selected
-                        currentState = STATE_SETTINGS;
-                        drawSettings();
-                    }
-                } else {
-                    if (currentIndex == 0) {
-                        // Browse Foods selected
-                        currentState = STATE_CATEGORIES;
-                        currentIndex = 0;
-                        drawCategories();
-                    } else {
-                        // Settings selected
-                        currentState = STATE_SETTINGS;
-                        drawSettings();
-                    }
-                }
+                dbWaitResumeSet = false;  // the user has moved on
+                openMainMenuItem(isOnline() ? currentIndex : currentIndex + 1);
                 break;
-            }
             case STATE_CATEGORIES: {
-                // Select category -> show foods
-                selectedCategory = categories[currentIndex].id;
-                filterFoodsByCategory(selectedCategory);
+                // Select category (or the safe foods of all) -> show foods
+                selectedCategory = currentIndex;
+                safeList = (selectedCategory == foodDbCategoryCount());
+                if (safeList) {
+                    FoodQuery safe = FOOD_QUERY_SAFE;
+                    foodQueryRun(safe);
+                    filteredCount = foodQueryCount();
+                } else {
+                    filterFoodsByCategory(selectedCategory);
+                }
+                uint32_t hits, misses;
+                foodDbCacheStats(hits, misses);
+                Serial.printf("[DB] Category %d: %d foods (page cache: %u hits, %u misses)\n",
+                              selectedCategory, filteredCount, (unsigned)hits, (unsigned)misses);
                 if (filteredCount > 0) {
                     currentState = STATE_FOODS;
                     currentIndex = 0;
                     itemCount = filteredCount;
-                    resetScroll(getName(*filteredFoods[0]));
+                    resetScroll(getName(getSelectedFood()));
                     drawFoods();
                 }
                 break;
             }
             case STATE_FOODS:
-                // Select food -> show result
-                currentState = STATE_RESULT;
-                resetScroll(getName(*filteredFoods[currentIndex]));
-                drawResult();
+            case STATE_SEARCH:
+                // Handled on release (click) or hold below
                 break;
             case STATE_SETTINGS:
                 // Toggle language
@@ -413,12 +432,47 @@ void loop() {
         }
     }
 
+    // Button A in the food list and letter search: click selects, hold opens
+    // the search / jumps to the foods under the offered prefix. Only presses
+    // that started on the same screen count.
+    if ((currentState == STATE_FOODS || currentState == STATE_SEARCH) && btnAPressState == currentState) {
+        if (M5.BtnA.wasHold()) {
+            lastActivityTime = millis();
+            if (currentState == STATE_SEARCH) searchJump();
+            else if (!safeList && alphaSorted()) searchStart();
+        } else if (M5.BtnA.wasClicked()) {
+            lastActivityTime = millis();
+            if (currentState == STATE_FOODS) {
+                // Select food -> show result
+                currentState = STATE_RESULT;
+                resetScroll(getName(getSelectedFood()));
+                drawResult();
+            } else {
+                // Add the offered letter; open the food once only one is left
+                unsigned long startTime = micros();
+                if (searchNext != '\0' && searchLen + 1 < sizeof(searchPrefix)) {
+                    searchPrefix[searchLen++] = searchNext;
+                    searchPrefix[searchLen] = '\0';
+                    searchNext = alphaNextChar(searchPrefix, '\0');
+                }
+                searchUpdate(startTime);
+                if (searchEnd - searchBegin <= 1 || searchNext == '\0') searchJump();
+                else drawSearch();
+            }
+        }
+    }
+
     // Button B (right side): Back
     if (M5.BtnB.wasPressed()) {
         lastActivityTime = millis();  // Reset inactivity timer
         switch (currentState) {
             case STATE_MAIN_MENU:
-                // Already at top level, no action
+                // Already at top level; drops an item or a resume waiting for the database
+                if (dbWaitItem >= 0 || dbWaitResumeSet) {
+                    dbWaitItem = -1;
+                    dbWaitResumeSet = false;
+                    drawMainMenu();
+                }
                 break;
             case STATE_CATEGORIES:
                 // Back to main menu
@@ -428,13 +482,31 @@ void loop() {
                 break;
             case STATE_FOODS:
                 // Back to categories
+                if (safeList) {
+                    foodQueryClear();
+                    safeList = false;
+                }
                 currentState = STATE_CATEGORIES;
                 currentIndex = 0;
                 drawCategories();
                 break;
+            case STATE_SEARCH:
+                if (searchLen > 0) {
+                    // Delete the last letter, offering it again
+                    unsigned long startTime = micros();
+                    searchNext = searchPrefix[--searchLen];
+                    searchPrefix[searchLen] = '\0';
+                    searchUpdate(startTime);
+                    drawSearch();
+                } else {
+                    currentState = STATE_FOODS;
+                    drawFoods();
+                }
+                break;
             case STATE_RESULT:
                 if (voiceResultActive) {
                     voiceResultActive = false;
+                    voiceResultEstimate = false;
                     currentState = STATE_MAIN_MENU;
                     currentIndex = 0;
                     drawMainMenu();
@@ -455,10 +527,11 @@ void loop() {
                 break;
             case STATE_RECORDING:
                 // Cancel recording, back to main menu
+                if (voiceStreaming) mistralStreamCancel();
                 audioReset();
                 audioFreeBuffer();
-                LittleFS.remove(getWavFilePath());
-                wifiReconnect();
+                audioDiscardRecording();
+                if (!voiceWifiKept) wifiReconnect();
                 currentState = STATE_MAIN_MENU;
                 currentIndex = 0;
                 drawMainMenu();
@@ -472,9 +545,10 @@ void loop() {
 
         AudioState audioState = getAudioState();
         if (audioState == AUDIO_COMPLETE) {
-            // WAV is already on flash — just grab the path and size
-            const char* wavPath = getWavFilePath();
-            size_t wavSize = getWavFileSize();
+            // Recording is already in PSRAM or on flash — just grab where and how big
+            const uint8_t* audioData = getRecordingData();
+            const char* audioPath = getRecordingPath();
+            size_t audioSize = getRecordingSize();
 
             audioReset();
             audioFreeBuffer();
@@ -482,12 +556,28 @@ void loop() {
             currentState = STATE_AI_PROCESSING;
             drawProcessing();
 
-            Serial.printf("[VOICE] WAV file: %s, %u bytes\n", wavPath, (unsigned)wavSize);
+            Serial.printf("[VOICE] Audio: %s, %u bytes\n", audioData ? "PSRAM" : audioPath, (unsigned)audioSize);
+
+            // Step 1: Transcribe. A streamed upload is already done with
+            // the audio and only waits for the answer; otherwise (or when the
+            // endpoint turned the stream down) it goes from PSRAM or file now.
+            char transcript[MISTRAL_TEXT_MAX];
+            const char* sttError = nullptr;
+            bool heard = false;
+            bool speech = audioSize > 0;
+            bool upload = speech;
+            if (voiceStreaming) {
+                bool retry;
+                heard = mistralStreamFinish(transcript, sizeof(transcript), sttError, retry);
+                upload = speech && retry;
+                if (upload) Serial.printf("[VOICE] Streamed upload failed (%s), sending again\n", sttError);
+            }
 
-            // Reconnect WiFi (was disabled to free heap for audio buffer)
-            wifiReconnect();
+            // Reconnect WiFi (was disabled to free heap for audio buffer);
+            // without speech there is nothing to send, so no need to wait for it
+            if (!voiceWifiKept) wifiReconnect();
             unsigned long wifiWait = millis();
-            while (!isOnline() && millis() - wifiWait < WIFI_CONNECTION_TIMEOUT) {
+            while (upload && !isOnline() && millis() - wifiWait < WIFI_CONNECTION_TIMEOUT) {
                 wifiUpdate();
                 delay(100);
             }
@@ -497,41 +587,89 @@ void loop() {
             MistralResult res;
             res.success = false;
             res.notFood = false;
-            res.fodmap = "unknown";
+            res.transcribedText[0] = '\0';
+            res.fodmap = FODMAP_UNKNOWN;
             res.gluten = false;
-
-            // Step 1: Transcribe (streams from file)
-            String sttError;
-            String transcript = mistralTranscribeFile(wavPath, wavSize, sttError);
-            LittleFS.remove(wavPath);
-
-            if (transcript.length() == 0) {
-                res.errorMsg = sttError.length() > 0 ? sttError : "No transcript";
+            res.errorMsg = "";
+
+            if (upload) {
+                heard = audioData
+                    ? mistralTranscribeMemory(audioData, audioSize, transcript, sizeof(transcript), sttError)
+                    : mistralTranscribeFile(audioPath, audioSize, transcript, sizeof(transcript), sttError);
+            } else if (!speech) {
+                sttError = "No speech";
+            }
+            audioDiscardRecording();
+
+            uint8_t resultAttrs = 0;
+            uint8_t cached = 0;
+            bool estimate = false;
+            bool uncertain = false;
+            MealResult meal;
+
+            if (!heard) {
+                res.errorMsg = sttError;
+            } else if (mealEvaluate(transcript, meal)) {
+                // Step 2a: Every ingredient is in the local database - no classify round trip.
+                // A single food is shown under its database name.
+                snprintf(res.transcribedText, sizeof(res.transcribedText), "%s",
+                         meal.count == 1 ? getName(foodDbGetFood(meal.foods[0])) : transcript);
+                resultAttrs = meal.attrs;
+                res.success = true;
+                Serial.printf("[VOICE] Local answer: %s\n", res.transcribedText);
+            } else if (classifyCacheGet(transcript, cached)) {
+                // Step 2b: Asked before - reuse the classifier's answer
+                snprintf(res.transcribedText, sizeof(res.transcribedText), "%s", transcript);
+                if (cached & CLASSIFY_CACHE_NOT_FOOD) {
+                    res.notFood = true;
+                } else {
+                    resultAttrs = cached;
+                    res.success = true;
+                }
             } else {
-                res.transcribedText = transcript;
-                // Step 2: Classify (only needs text string)
-                String classifyError;
-                String fodmapOut;
+                snprintf(res.transcribedText, sizeof(res.transcribedText), "%s", transcript);
+                // Step 2c: Classify (only needs text string)
+                const char* classifyError = nullptr;
+                FodmapLevel fodmapOut = FODMAP_UNKNOWN;
                 bool glutenOut = false;
                 bool notFood = false;
+                FoodGuess guess;
+                unsigned long classifyStart = millis();
                 if (mistralClassify(transcript, fodmapOut, glutenOut, notFood, classifyError)) {
                     if (notFood) {
                         res.notFood = true;
+                        resultAttrs = CLASSIFY_CACHE_NOT_FOOD;
                     } else {
                         res.fodmap = fodmapOut;
                         res.gluten = glutenOut;
                         res.success = true;
+                        resultAttrs = fodmapOut | (glutenOut ? FOOD_ATTR_GLUTEN : 0);
                     }
+                    classifyCachePut(transcript, resultAttrs, millis() - classifyStart);
+                } else if (foodModelGuess(transcript, guess)) {
+                    // Step 2d: No classifier (offline, timeout) - estimate on the device, not cached
+                    resultAttrs = foodGuessAttrs(guess);
+                    res.success = true;
+                    estimate = true;
+                    uncertain = !foodGuessConfident(guess);
+                    Serial.printf("[VOICE] Classify failed (%s), offline estimate\n", classifyError);
                 } else {
                     res.errorMsg = classifyError;
                 }
             }
 
+            // The query is over: its transient allocations go in one step
+            queryArenaReset();
+            Serial.printf("[VOICE] Query done. Free heap: %u, largest block: %u\n",
+                          ESP.getFreeHeap(), (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+
             if (res.success) {
-                voiceResultFood = { res.transcribedText, res.transcribedText, "", res.fodmap, res.gluten };
-                filteredFoods[0] = &voiceResultFood;
+                snprintf(voiceResultName, sizeof(voiceResultName), "%s", res.transcribedText);
+                voiceResultFood = { voiceResultName, voiceResultName, 0, resultAttrs };
                 currentIndex = 0;
                 voiceResultActive = true;
+                voiceResultEstimate = estimate;
+                voiceResultUncertain = uncertain;
                 currentState = STATE_RESULT;
                 resetScroll(res.transcribedText);
                 drawResult();
@@ -542,7 +680,7 @@ void loop() {
                 currentIndex = 0;
                 drawMainMenu();
             } else {
-                drawError(STR(STR_ERROR_API), res.errorMsg.c_str());
+                drawError(STR(STR_ERROR_API), res.errorMsg);
                 delay(2500);
                 currentState = STATE_MAIN_MENU;
                 currentIndex = 0;
@@ -550,10 +688,11 @@ void loop() {
             }
         } else if (audioState == AUDIO_ERROR) {
             // Audio error during recording - recover gracefully
+            if (voiceStreaming) mistralStreamCancel();
             audioReset();
             audioFreeBuffer();
-            LittleFS.remove(getWavFilePath());
-            wifiReconnect();
+            audioDiscardRecording();
+            if (!voiceWifiKept) wifiReconnect();
             drawError("Audio Error", STR(STR_TRY_AGAIN));
             delay(1500);
             currentState = STATE_MAIN_MENU;
@@ -570,7 +709,7 @@ void loop() {
             M5.Display.fillRect(10, 8, 220, 20, TFT_BLACK);
             M5.Display.setTextColor(TFT_WHITE);
             M5.Display.setCursor(10, 8);
-            M5.Display.print(getScrolledText(scrollText));
+            M5.Display.print(getScrolledText(scrollText, scrollPos));
         }
     } else if (currentState == STATE_FOODS) {
         M5.Display.setFont(FONT_MEDIUM);
@@ -591,7 +730,7 @@ void loop() {
             M5.Display.fillRect(10, y + 1, 220, 21, TFT_BLUE);
             M5.Display.setTextColor(TFT_WHITE);
             M5.Display.setCursor(10, y);
-            M5.Display.print(getScrolledText(scrollText));
+            M5.Display.print(getScrolledText(scrollText, scrollPos));
         }
     }
 
@@ -605,6 +744,10 @@ void loop() {
         M5.Display.print("Sleeping...");
         delay(1000);
 
+        // Remember where the user was for the next wake, and what was asked lately
+        saveResume();
+        classifyCacheFlush();
+
         // Disable WiFi to save power
         wifiDisable();
 
@@ -622,66 +765,233 @@ void loop() {
     delay(currentState == STATE_RECORDING ? 10 : 50);
 }
 
-void loadFoodsDatabase() {
-    File file = LittleFS.open("/foods.json", "r");
-    if (!file) {
-        M5.Display.fillScreen(TFT_RED);
-        M5.Display.setCursor(10, 50);
-        M5.Display.print("No foods.json!");
-        while (1) delay(1000);
+// Mounts LittleFS and loads the database, then reports through dbLoadState;
+// it never draws, the display belongs to loop()
+static void loadDb() {
+    PERF_PROBE("db_load");
+    unsigned long startTime = millis();
+#ifndef FOODDB_PROGMEM
+    // LittleFS holds the food database image
+    if (!LittleFS.begin(true)) {
+        dbLoadTitle = "FS Error!";
+        dbLoadState.store(DB_FAILED, std::memory_order_release);
+        return;
+    }
+#endif
+    const char* error = nullptr;
+    if (!foodDbLoad(error)) {
+        dbLoadTitle = "DB Error!";
+        dbLoadError = error;
+        dbLoadState.store(DB_FAILED, std::memory_order_release);
+        return;
+    }
+    Serial.printf("[BOOT] Database ready at %lu ms (loaded in %lu ms)\n",
+                  millis(), millis() - startTime);
+    dbLoadState.store(DB_READY, std::memory_order_release);
+}
+
+static void dbLoadTask(void*) {
+    loadDb();
+    vTaskDelete(nullptr);
+}
+
+void startDbLoad() {
+    if (xTaskCreatePinnedToCore(dbLoadTask, "dbload", DB_LOAD_STACK, nullptr, 1, nullptr,
+                                DB_LOAD_CORE) != pdPASS) {
+        Serial.println("[BOOT] No memory for the load task, loading in place");
+        loadDb();
     }
+}
 
-    // Parse JSON
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, file);
-    file.close();
+// The device is no use without its database: show why and stop
+void drawDbError() {
+    M5.Display.fillScreen(TFT_RED);
+    M5.Display.setFont(FONT_MEDIUM);
+    M5.Display.setTextColor(TFT_WHITE);
+    M5.Display.setCursor(10, 30);
+    M5.Display.print(dbLoadTitle);
+    M5.Display.setFont(FONT_SMALL);
+    M5.Display.setCursor(10, 60);
+    M5.Display.print(dbLoadError);
+    while (1) delay(1000);
+}
 
-    if (error) {
-        M5.Display.fillScreen(TFT_RED);
-        M5.Display.setFont(FONT_MEDIUM);
-        M5.Display.setTextColor(TFT_WHITE);
-        M5.Display.setCursor(10, 30);
-        M5.Display.print("JSON Error!");
-        M5.Display.setFont(FONT_SMALL);
-        M5.Display.setCursor(10, 60);
-        M5.Display.print(error.c_str());
-        while (1) delay(1000);
-    }
-
-    // Load categories
-    JsonArray cats = doc["categories"];
-    categoryCount = 0;
-    for (JsonObject cat : cats) {
-        if (categoryCount < 8) {
-            categories[categoryCount].id = cat["id"].as<String>();
-            categories[categoryCount].name_pt = cat["name_pt"].as<String>();
-            categories[categoryCount].name_en = cat["name_en"].as<String>();
-            categoryCount++;
-        }
+// In place of the navigation hint while a chosen item waits for the database
+void drawDbWaiting() {
+    M5.Display.fillRect(0, 118, 240, 17, TFT_BLACK);
+    M5.Display.setTextColor(TFT_YELLOW);
+    M5.Display.setFont(FONT_SMALL);
+    M5.Display.setCursor(5, 120);
+    M5.Display.print(STR(STR_LOADING));
+}
+
+// Open a main menu item (MENU_*); those that read foods wait for the database
+void openMainMenuItem(int item) {
+    if (item != MENU_SETTINGS && dbLoadState.load(std::memory_order_acquire) != DB_READY) {
+        Serial.println("[BOOT] Waiting for the database");
+        dbWaitItem = item;
+        drawDbWaiting();
+        return;
     }
 
-    // Load foods
-    JsonArray foodsArray = doc["foods"];
-    foodCount = 0;
-    for (JsonObject food : foodsArray) {
-        if (foodCount < 200) {
-            foods[foodCount].name_pt = food["name_pt"].as<String>();
-            foods[foodCount].name_en = food["name_en"].as<String>();
-            foods[foodCount].category = food["category"].as<String>();
-            foods[foodCount].fodmap = food["fodmap"].as<String>();
-            foods[foodCount].gluten = food["gluten"].as<bool>();
-            foodCount++;
+    if (item == MENU_VOICE) {
+        // Voice Search selected - disable WiFi to free heap for audio buffer.
+        // With PSRAM there is room for both, and the recording is uploaded
+        // while it is made.
+        voiceWifiKept = isOnline() && ESP.getPsramSize() > 0 && mistralStreamSupported();
+        voiceStreaming = false;
+        if (!voiceWifiKept) wifiDisable();
+        if (audioStartRecording()) {
+            const AudioStream* stream = audioStream();
+            voiceStreaming = voiceWifiKept && stream != nullptr && mistralStreamBegin(*stream);
+            Serial.printf("[VOICE] Upload %s\n", voiceStreaming ? "while recording" : "after recording");
+            currentState = STATE_RECORDING;
+        } else {
+            // Audio init failed - reconnect WiFi and show error
+            if (!voiceWifiKept) wifiReconnect();
+            drawError("Audio Error", STR(STR_TRY_AGAIN));
+            delay(1500);
+            drawMainMenu();
         }
+    } else if (item == MENU_BROWSE) {
+        // Browse Foods selected
+        currentState = STATE_CATEGORIES;
+        currentIndex = 0;
+        drawCategories();
+    } else {
+        // Settings selected
+        currentState = STATE_SETTINGS;
+        drawSettings();
     }
 }
 
-void filterFoodsByCategory(const String& categoryId) {
-    filteredCount = 0;
-    for (int i = 0; i < foodCount; i++) {
-        if (foods[i].category == categoryId) {
-            filteredFoods[filteredCount] = &foods[i];
-            filteredCount++;
+// Back to the screen left before deep sleep (resume_state.h); false to start
+// at the main menu. Until the database load started in setup() is done, the
+// food screens show the menu with the loading hint, and loop() comes back
+// here once it is, unless the user has moved on by then.
+bool resumeScreen(const ResumeState& resume) {
+    if (resume.screen == STATE_SETTINGS) {
+        currentState = STATE_SETTINGS;
+        drawSettings();
+        return true;
+    }
+    if (resume.screen != STATE_CATEGORIES && resume.screen != STATE_FOODS) return false;
+
+    DbLoadState dbState = dbLoadState.load(std::memory_order_acquire);
+    if (dbState == DB_LOADING) {
+        dbWaitResume = resume;
+        dbWaitResumeSet = true;
+        drawMainMenu();
+        drawDbWaiting();
+        return true;
+    }
+    if (dbState != DB_READY || foodDbRevision() != resume.dbRevision) return false;
+    int categories = foodDbCategoryCount();
+    currentIndex = constrain((int)resume.index, 0, categories);
+
+    // The foods screen: its list again, or the categories with the cursor on it
+    if (resume.screen == STATE_FOODS) {
+        if (resume.category < 0 || resume.category > categories) return false;
+        selectedCategory = resume.category;
+        safeList = (selectedCategory == categories);
+        if (safeList) {
+            FoodQuery safe = FOOD_QUERY_SAFE;
+            foodQueryRun(safe);
+            filteredCount = foodQueryCount();
+        } else {
+            filterFoodsByCategory(selectedCategory);
         }
+        if (filteredCount > 0) {
+            currentState = STATE_FOODS;
+            currentIndex = constrain((int)resume.index, 0, filteredCount - 1);
+            itemCount = filteredCount;
+            resetScroll(getName(getSelectedFood()));
+            drawFoods();
+            return true;
+        }
+        if (safeList) foodQueryClear();
+        safeList = false;
+        currentIndex = selectedCategory;
+    }
+    currentState = STATE_CATEGORIES;
+    drawCategories();
+    return true;
+}
+
+// Snapshot for resumeScreen(): the food list and its letter search or food
+// resume as the list (a search at its first match, the position it offers),
+// a voice answer or recording as the main menu
+void saveResume() {
+    ResumeState resume = {};
+    resume.lang = currentLang;
+    resume.screen = STATE_MAIN_MENU;
+    resume.category = selectedCategory;
+    resume.dbRevision = foodDbRevision();
+    switch (currentState) {
+        case STATE_CATEGORIES:
+        case STATE_SETTINGS:
+            resume.screen = currentState;
+            resume.index = currentIndex;
+            break;
+        case STATE_SEARCH:
+            // currentIndex is still the list cursor from before the search
+            resume.screen = STATE_FOODS;
+            resume.index = searchEnd > searchBegin ? searchBegin : currentIndex;
+            break;
+        case STATE_FOODS:
+        case STATE_RESULT:
+            if (!voiceResultActive) {
+                resume.screen = STATE_FOODS;
+                resume.index = currentIndex;
+            }
+            break;
+        default:
+            break;
+    }
+    if (!wifiLastAp(resume.bssid, resume.channel)) resume.channel = 0;
+    resumeSave(resume);
+}
+
+// The database keeps each category's alphabetical order per language precomputed
+void filterFoodsByCategory(int categoryId) {
+    PERF_PROBE("filter_category");
+    alphaOpen(categoryId, currentLang);
+    filteredCount = alphaCount();
+}
+
+// Letter search over the selected category: PWR offers the next letter that
+// still leads to a food, M5 adds it, so each keystroke narrows the list
+void searchStart() {
+    unsigned long startTime = micros();
+    searchLen = 0;
+    searchPrefix[0] = '\0';
+    searchNext = alphaNextChar(searchPrefix, '\0');
+    searchUpdate(startTime);
+    currentState = STATE_SEARCH;
+    drawSearch();
+}
+
+// Foods under the typed prefix plus the offered letter
+void searchUpdate(unsigned long startTime) {
+    char key[TEXT_NORM_MAX + 1];
+    memcpy(key, searchPrefix, searchLen);
+    key[searchLen] = searchNext;
+    key[searchLen + 1] = '\0';
+    alphaPrefixRange(key, searchBegin, searchEnd);
+    Serial.printf("[ALPHA] \"%s\": %d foods in %lu us\n", key, searchEnd - searchBegin, micros() - startTime);
+}
+
+// Back to the list at the first match, or straight to the food if it is the only one
+void searchJump() {
+    currentState = STATE_FOODS;
+    itemCount = filteredCount;
+    if (searchEnd > searchBegin) currentIndex = searchBegin;
+    resetScroll(getName(getSelectedFood()));
+    if (searchEnd - searchBegin == 1) {
+        currentState = STATE_RESULT;
+        drawResult();
+    } else {
+        drawFoods();
     }
 }
 
@@ -759,7 +1069,8 @@ void drawCategories() {
     // Draw line under title
     M5.Display.drawLine(0, 28, 240, 28, TFT_DARKGREY);
 
-    // Calculate visible items (show 4 items max)
+    // Calculate visible items (show 4 items max); the last one is the safe foods list
+    int categoryCount = foodDbCategoryCount() + 1;
     int startIdx = 0;
     if (currentIndex >= 2) {
         startIdx = currentIndex - 1;
@@ -782,7 +1093,12 @@ void drawCategories() {
 
         M5.Display.setFont(FONT_MEDIUM);
         M5.Display.setCursor(10, y);
-        M5.Display.print(getName(categories[i]));
+        if (i == foodDbCategoryCount()) {
+            if (i != currentIndex) M5.Display.setTextColor(COLOR_LOW);
+            M5.Display.print(STR(STR_SAFE_FOODS));
+        } else {
+            M5.Display.print(getName(foodDbGetCategory(i)));
+        }
         y += 22;
     }
 
@@ -803,16 +1119,11 @@ void drawFoods() {
     M5.Display.setFont(FONT_HEADER);
     M5.Display.setCursor(5, 8);
 
-    // Find category name
-    for (int i = 0; i < categoryCount; i++) {
-        if (categories[i].id == selectedCategory) {
-            M5.Display.print(getName(categories[i]));
-            break;
-        }
-    }
+    // Category name
+    M5.Display.print(safeList ? STR(STR_SAFE_FOODS) : getName(foodDbGetCategory(selectedCategory)));
 
     // Item count (right-aligned)
-    char countBuf[10];
+    char countBuf[16];
     snprintf(countBuf, sizeof(countBuf), "%d/%d", currentIndex + 1, filteredCount);
     int countW = M5.Display.textWidth(countBuf);
     M5.Display.setCursor(235 - countW, 8);
@@ -845,18 +1156,14 @@ void drawFoods() {
 
         M5.Display.setCursor(10, y);
 
-        String name = getName(*filteredFoods[i]);
+        const char* name = getName(foodDbGetFood(listFood(i)));
         if (i == currentIndex) {
             // Highlighted item: use scrolling
-            M5.Display.print(getScrolledText(name));
+            M5.Display.print(getScrolledText(name, scrollPos));
         } else {
             // Non-highlighted: truncate with ellipsis if too wide
-            if (M5.Display.textWidth(name.c_str()) > SCROLL_AREA_WIDTH) {
-                int ellipsisW = M5.Display.textWidth("..");
-                int len = M5.Display.textLength(name.c_str(), SCROLL_AREA_WIDTH - ellipsisW);
-                name = name.substring(0, len) + "..";
-            }
-            M5.Display.print(name);
+            char cut[SCROLL_TEXT_MAX];
+            M5.Display.print(fitText(name, cut, sizeof(cut)));
         }
         y += 22;
     }
@@ -865,7 +1172,53 @@ void drawFoods() {
     M5.Display.setTextColor(TFT_DARKGREY);
     M5.Display.setFont(FONT_SMALL);
     M5.Display.setCursor(5, 120);
-    M5.Display.print(STR(STR_NAV_NEXT_SEL));
+    M5.Display.print(safeList || !alphaSorted() ? STR(STR_NAV_NEXT_SEL) : STR(STR_NAV_FOODS));
+}
+
+void drawSearch() {
+    M5.Display.fillScreen(TFT_BLACK);
+
+    // Title - typed prefix, then the offered letter highlighted
+    M5.Display.setFont(FONT_HEADER);
+    M5.Display.setTextColor(TFT_WHITE);
+    M5.Display.setCursor(5, 8);
+    M5.Display.print(STR(STR_FIND));
+    for (size_t i = 0; i < searchLen; i++) {
+        M5.Display.print((char)(searchPrefix[i] == ' ' ? '_' : toupper(searchPrefix[i])));
+    }
+    if (searchNext != '\0') {
+        M5.Display.setTextColor(TFT_YELLOW);
+        M5.Display.print((char)(searchNext == ' ' ? '_' : toupper(searchNext)));
+    }
+
+    // Match count (right-aligned)
+    char countBuf[16];
+    snprintf(countBuf, sizeof(countBuf), "%d", searchEnd - searchBegin);
+    int countW = M5.Display.textWidth(countBuf);
+    M5.Display.setTextColor(TFT_WHITE);
+    M5.Display.setCursor(235 - countW, 8);
+    M5.Display.print(countBuf);
+
+    // Draw line under title
+    M5.Display.drawLine(0, 28, 240, 28, TFT_DARKGREY);
+
+    // First matches
+    M5.Display.setFont(FONT_MEDIUM);
+    M5.Display.setTextColor(TFT_LIGHTGREY);
+    int y = 32;
+    for (int i = searchBegin; i < min(searchBegin + 4, searchEnd); i++) {
+        char cut[SCROLL_TEXT_MAX];
+        const char* name = fitText(getName(foodDbGetFood(alphaFood(i))), cut, sizeof(cut));
+        M5.Display.setCursor(10, y);
+        M5.Display.print(name);
+        y += 22;
+    }
+
+    // Navigation hint
+    M5.Display.setTextColor(TFT_DARKGREY);
+    M5.Display.setFont(FONT_SMALL);
+    M5.Display.setCursor(5, 120);
+    M5.Display.print(STR(STR_NAV_SEARCH));
 }
 
 void drawProcessing() {
@@ -911,7 +1264,8 @@ void drawError(const char* title, const char* detail) {
 }
 
 void drawResult() {
-    Food* food = filteredFoods[currentIndex];
+    Food food = getSelectedFood();
+    bool uncertain = voiceResultActive && voiceResultEstimate && voiceResultUncertain;
 
     M5.Display.fillScreen(TFT_BLACK);
 
@@ -920,11 +1274,10 @@ void drawResult() {
     M5.Display.setTextColor(TFT_WHITE);
     M5.Display.setCursor(10, 8);
 
-    String name = getName(*food);
-    M5.Display.print(getScrolledText(name));
+    M5.Display.print(getScrolledText(getName(food), scrollPos));
 
     // FODMAP section
-    uint16_t fodmapColor = getFodmapColor(food->fodmap);
+    uint16_t fodmapColor = getFodmapColor(getFodmap(food));
     M5.Display.fillRect(0, 35, 240, 40, fodmapColor);
 
     // FODMAP text - dark text on light backgrounds
@@ -936,24 +1289,34 @@ void drawResult() {
     M5.Display.setFont(FONT_MEDIUM);
     M5.Display.setCursor(10, 45);
     M5.Display.print(STR_FODMAP_LABEL);
-    M5.Display.print(getFodmapLabel(food->fodmap));
+    M5.Display.print(getFodmapLabel(getFodmap(food)));
+    if (uncertain) M5.Display.print("?");
 
     // Gluten section
-    uint16_t glutenColor = food->gluten ? TFT_RED : TFT_GREEN;
+    uint16_t glutenColor = hasGluten(food) ? TFT_RED : TFT_GREEN;
     M5.Display.fillRect(0, 80, 240, 40, glutenColor);
 
     // Dark text on green background for readability
-    M5.Display.setTextColor(food->gluten ? TFT_WHITE : TFT_BLACK);
+    M5.Display.setTextColor(hasGluten(food) ? TFT_WHITE : TFT_BLACK);
     M5.Display.setFont(FONT_MEDIUM);
     M5.Display.setCursor(10, 90);
     M5.Display.print(STR_GLUTEN_LABEL);
-    M5.Display.print(food->gluten ? STR(STR_YES) : STR(STR_NO));
+    M5.Display.print(hasGluten(food) ? STR(STR_YES) : STR(STR_NO));
+    if (uncertain) M5.Display.print("?");
 
     // Back hint
     M5.Display.setTextColor(TFT_DARKGREY);
     M5.Display.setFont(FONT_SMALL);
     M5.Display.setCursor(5, 120);
     M5.Display.print(STR(STR_NAV_BACK));
+
+    // Answers guessed on the device are flagged next to it
+    if (voiceResultActive && voiceResultEstimate) {
+        const char* note = uncertain ? STR(STR_UNCERTAIN) : STR(STR_ESTIMATE);
+        M5.Display.setTextColor(TFT_ORANGE);
+        M5.Display.setCursor(235 - M5.Display.textWidth(note), 120);
+        M5.Display.print(note);
+    }
 }
 
 void drawSettings() {
@@ -988,16 +1351,20 @@ void drawSettings() {
     M5.Display.print(STR(STR_NAV_SETTINGS));
 }
 
-uint16_t getFodmapColor(const String& level) {
-    if (level == "low") return COLOR_LOW;
-    if (level == "moderate") return COLOR_MODERATE;
-    if (level == "high") return COLOR_HIGH;
-    return COLOR_UNKNOWN;
+uint16_t getFodmapColor(FodmapLevel level) {
+    switch (level) {
+        case FODMAP_LOW:      return COLOR_LOW;
+        case FODMAP_MODERATE: return COLOR_MODERATE;
+        case FODMAP_HIGH:     return COLOR_HIGH;
+        default:              return COLOR_UNKNOWN;
+    }
 }
 
-String getFodmapLabel(const String& level) {
-    if (level == "low") return STR(STR_FODMAP_LOW);
-    if (level == "moderate") return STR(STR_FODMAP_MOD);
-    if (level == "high") return STR(STR_FODMAP_HIGH);
-    return "?";
+const char* getFodmapLabel(FodmapLevel level) {
+    switch (level) {
+        case FODMAP_LOW:      return STR(STR_FODMAP_LOW);
+        case FODMAP_MODERATE: return STR(STR_FODMAP_MOD);
+        case FODMAP_HIGH:     return STR(STR_FODMAP_HIGH);
+        default:              return "?";
+    }
 }
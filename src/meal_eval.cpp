@@ -0,0 +1,154 @@
+#include "meal_eval.h"
+#include "food_db.h"
+#include "food_match.h"
+#include "text_norm.h"
+#include <Arduino.h>
+
+enum ConnectiveKind {
+    CONNECTIVE_NONE,
+    CONNECTIVE_AND,      // next phrase is another ingredient
+    CONNECTIVE_WITH,     // ...and ends a "sem"/"without" list
+    CONNECTIVE_WITHOUT   // following phrases are left out
+};
+
+struct Connective {
+    const char*    word;  // folded as textCollate() does, plural endings kept
+    ConnectiveKind kind;
+};
+
+// Only words that mean the same in both languages: PT "no" ("in the") is
+// left out, as in EN it negates ("no cheese") and would add the ingredient
+static const Connective CONNECTIVES[] = {
+    { "e",       CONNECTIVE_AND },
+    { "and",     CONNECTIVE_AND },
+    { "em",      CONNECTIVE_AND },
+    { "na",      CONNECTIVE_AND },
+    { "num",     CONNECTIVE_AND },
+    { "numa",    CONNECTIVE_AND },
+    { "in",      CONNECTIVE_AND },
+    { "on",      CONNECTIVE_AND },
+    { "com",     CONNECTIVE_WITH },
+    { "with",    CONNECTIVE_WITH },
+    { "mais",    CONNECTIVE_WITH },
+    { "plus",    CONNECTIVE_WITH },
+    { "sem",     CONNECTIVE_WITHOUT },
+    { "without", CONNECTIVE_WITHOUT },
+};
+
+// Phrase between connectives, as a byte range of the normalized text
+struct Segment {
+    uint8_t begin;
+    uint8_t end;
+    bool    excluded;  // after "sem"/"without"
+    bool    filler;    // only filler words ("can I eat")
+};
+
+static ConnectiveKind connectiveOf(const char* word, size_t len) {
+    for (const Connective& c : CONNECTIVES) {
+        if (strlen(c.word) == len && memcmp(c.word, word, len) == 0) return c.kind;
+    }
+    return CONNECTIVE_NONE;
+}
+
+// raw is the same text through textCollate(): word for word the same as
+// norm, before plural stripping turns "mais" into "mal"
+static int splitSegments(const char* norm, const char* raw, Segment* segs) {
+    int count = 0;
+    bool excluding = false;
+    bool open = false;
+    const char* p = norm;
+    while (*p) {
+        const char* end = strchr(p, ' ');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        size_t rawLen = strcspn(raw, " ");
+        ConnectiveKind kind = connectiveOf(raw, rawLen);
+        raw += rawLen;
+        if (*raw == ' ') raw++;
+
+        if (kind != CONNECTIVE_NONE) {
+            open = false;
+            if (kind == CONNECTIVE_WITHOUT) excluding = true;
+            else if (kind == CONNECTIVE_WITH) excluding = false;
+        } else {
+            if (!open) {
+                if (count == MEAL_MAX_SEGMENTS) return -1;
+                segs[count++] = { (uint8_t)(p - norm), 0, excluding, true };
+                open = true;
+            }
+            Segment& s = segs[count - 1];
+            s.end = (uint8_t)(p - norm + len);
+            if (!foodMatchIsFiller(p, len)) s.filler = false;
+        }
+        p += len;
+        if (*p == ' ') p++;
+    }
+    return count;
+}
+
+// Longest run of segments starting at `first` that names one food; returns
+// the number of segments consumed (0 = no confident match)
+static int matchSpan(const char* norm, const Segment* segs, int first, int count, int& foodOut) {
+    int last = first + MEAL_MAX_SPAN - 1;
+    if (last >= count) last = count - 1;
+    for (; last >= first; last--) {
+        char span[TEXT_NORM_MAX];
+        size_t len = segs[last].end - segs[first].begin;
+        memcpy(span, norm + segs[first].begin, len);
+        span[len] = '\0';
+
+        FoodMatch m;
+        if (foodMatchFind(span, m) && foodMatchConfident(m)) {
+            foodOut = m.foodIndex;
+            return last - first + 1;
+        }
+    }
+    return 0;
+}
+
+bool mealEvaluate(const char* text, MealResult& out) {
+    unsigned long startTime = millis();
+    out.count = 0;
+    out.attrs = FODMAP_UNKNOWN;
+
+    char norm[TEXT_NORM_MAX];
+    textNormalize(text, norm, sizeof(norm));
+    char raw[TEXT_NORM_MAX];
+    textCollate(text, raw, sizeof(raw));
+    Segment segs[MEAL_MAX_SEGMENTS];
+    int segCount = splitSegments(norm, raw, segs);
+    if (segCount <= 0) return false;
+
+    for (int i = 0; i < segCount;) {
+        if (segs[i].filler) {
+            i++;
+            continue;
+        }
+        int food = -1;
+        int used = matchSpan(norm, segs, i, segCount, food);
+        if (used == 0) {
+            if (segs[i].excluded) {
+                i++;  // left out anyway: no need to know what it is
+                continue;
+            }
+            Serial.printf("[MEAL] Unresolved: \"%.*s\"\n", segs[i].end - segs[i].begin, norm + segs[i].begin);
+            return false;
+        }
+        if (!segs[i].excluded) {
+            if (out.count == MEAL_MAX_INGREDIENTS) return false;
+            Food f = foodDbGetFood(food);
+            if (getFodmap(f) == FODMAP_UNKNOWN) return false;
+            if (getFodmap(f) > (out.attrs & FOOD_ATTR_FODMAP_MASK)) {
+                out.attrs = (out.attrs & ~FOOD_ATTR_FODMAP_MASK) | getFodmap(f);
+            }
+            out.attrs |= f.attrs & FOOD_ATTR_GLUTEN;
+            out.foods[out.count++] = food;
+        }
+        i += used;
+    }
+
+    if (out.count == 0) return false;
+    Serial.printf("[MEAL] %d ingredient(s), FODMAP %d, gluten %s in %lu ms\n",
+                  out.count, out.attrs & FOOD_ATTR_FODMAP_MASK,
+                  (out.attrs & FOOD_ATTR_GLUTEN) ? "yes" : "no", millis() - startTime);
+    return true;
+}
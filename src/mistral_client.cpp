@@ -1,9 +1,15 @@
 #include "mistral_client.h"
 #include "language.h"
+#include "http_reader.h"
+#include "query_arena.h"
+#include "perf_probe.h"
+#include "audio_encoder.h"
+#include "classify_parse.h"
 #include <WiFiClientSecure.h>
 #include <ArduinoJson.h>
 #include <esp_heap_caps.h>
 #include <LittleFS.h>
+#include <atomic>
 
 #if __has_include("config.h")
     #include "config.h"
@@ -13,9 +19,20 @@
     #define HAS_MISTRAL_CONFIG
 #endif
 
-static const char MISTRAL_HOST[] = "api.mistral.ai";
-static const int  MISTRAL_PORT   = 443;
-static const char BOUNDARY[]     = "safebite1234";
+// Another endpoint (a mock server, see scripts/mock_mistral.py) can be set in config.h
+#ifndef MISTRAL_HOST
+    #define MISTRAL_HOST "api.mistral.ai"
+#endif
+#ifndef MISTRAL_PORT
+    #define MISTRAL_PORT 443
+#endif
+
+// Upload voice recordings while they are made (PSRAM boards); 0 sends them after
+#ifndef MISTRAL_STREAM_UPLOAD
+    #define MISTRAL_STREAM_UPLOAD 1
+#endif
+
+static const char BOUNDARY[] = "safebite1234";
 
 static const char SYSTEM_PROMPT[] =
     "You are a dietary assistant for people with FODMAP and gluten restrictions.\n"
@@ -33,220 +50,387 @@ static const char SYSTEM_PROMPT[] =
     "NOT_FOOD\n"
     "Never provide explanations.";
 
-// Parse "FODMAP: LOW\nGLUTEN: YES" or "NOT_FOOD" response
-// Returns false if NOT_FOOD
-static bool parseClassifyResponse(const String& content, String& fodmapOut, bool& glutenOut) {
-    String upper = content;
-    upper.toUpperCase();
-
-    if (upper.indexOf("NOT_FOOD") >= 0 || upper.indexOf("NOT FOOD") >= 0) {
-        return false;
+#ifdef HAS_MISTRAL_CONFIG
+#define STATUS_ERROR_SIZE  24
+static char statusError[STATUS_ERROR_SIZE];  // "STT HTTP 500"
+
+// Copy cut to fit, never in the middle of a UTF-8 character
+static void copyText(const char* src, char* dst, size_t size) {
+    if (size == 0) return;
+    size_t len = strlen(src);
+    if (len >= size) {
+        len = size - 1;
+        while (len > 0 && ((uint8_t)src[len] & 0xC0) == 0x80) len--;
     }
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
 
-    fodmapOut = "unknown";
-    glutenOut = false;
+// First bytes of an error response, for the log
+static void logErrorBody(const char* tag, int status, WiFiClientSecure& client, const HttpResponse& head) {
+    char text[128];
+    HttpBody body(client, head);
+    size_t n = body.readBytes(text, sizeof(text) - 1);
+    text[n] = '\0';
+    Serial.printf("[%s] Error %d: %s\n", tag, status, text);
+}
+#endif
 
-    int fi = upper.indexOf("FODMAP:");
-    if (fi >= 0) {
-        String after = upper.substring(fi + 7);
-        after.trim();
-        if (after.startsWith("LOW"))  fodmapOut = "low";
-        else if (after.startsWith("MOD")) fodmapOut = "moderate";
-        else if (after.startsWith("HIG")) fodmapOut = "high";
-    }
+#ifdef HAS_MISTRAL_CONFIG
+static bool sttConnect(WiFiClientSecure& client) {
+    Serial.printf("[STT] Free heap: %u, largest block: %u\n",
+                  ESP.getFreeHeap(), (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    client.setInsecure();
+    client.setTimeout(30);
 
-    int gi = upper.indexOf("GLUTEN:");
-    if (gi >= 0) {
-        String after = upper.substring(gi + 7);
-        after.trim();
-        if (after.startsWith("YES")) glutenOut = true;
+    Serial.println("[STT] Connecting...");
+    if (!client.connect(MISTRAL_HOST, MISTRAL_PORT)) {
+        Serial.printf("[STT] Connect failed. Free heap: %u, largest block: %u\n",
+                      ESP.getFreeHeap(), (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+        return false;
     }
+    Serial.println("[STT] Connected.");
     return true;
 }
 
-// Skip HTTP response headers; return status code, set chunked flag
-static int skipHeaders(WiFiClientSecure& client, bool& chunked) {
-    chunked = false;
+// Multipart preamble (model + language + file field headers); returns its length
+static int sttPreamble(char* out, size_t size) {
+    const char* langCode = (currentLang == LANG_PT) ? "pt" : "en";
+    return snprintf(out, size,
+        "--%s\r\nContent-Disposition: form-data; name=\"model\"\r\n\r\nvoxtral-mini-latest\r\n"
+        "--%s\r\nContent-Disposition: form-data; name=\"language\"\r\n\r\n%s\r\n"
+        "--%s\r\nContent-Disposition: form-data; name=\"file\"; filename=\"%s\"\r\n"
+        "Content-Type: %s\r\n\r\n",
+        BOUNDARY, BOUNDARY, langCode, BOUNDARY, audioEncoder().fileName, audioEncoder().mimeType);
+}
+
+static int sttClosing(char* out, size_t size) {
+    return snprintf(out, size, "\r\n--%s--\r\n", BOUNDARY);
+}
 
-    // Read status line, skipping any leading blank lines
-    String statusLine;
-    while (client.connected() || client.available()) {
-        statusLine = client.readStringUntil('\n');
-        statusLine.trim();
-        if (statusLine.length() > 0) break;
+// Request headers; a contentLength of 0 sends the body chunked
+static void sttRequestHead(WiFiClientSecure& client, size_t contentLength) {
+    client.print("POST /v1/audio/transcriptions HTTP/1.1\r\n");
+    client.print("Host: " MISTRAL_HOST "\r\n");
+    client.print("Authorization: Bearer ");
+    client.print(MISTRAL_API_KEY);
+    client.print("\r\n");
+    client.print("Content-Type: multipart/form-data; boundary=");
+    client.print(BOUNDARY);
+    client.print("\r\n");
+    if (contentLength > 0) {
+        client.print("Content-Length: ");
+        client.print((unsigned int)contentLength);
+        client.print("\r\n");
+    } else {
+        client.print("Transfer-Encoding: chunked\r\n");
     }
-    Serial.printf("[HTTP] Status: %s\n", statusLine.c_str());
+    client.print("Connection: close\r\n\r\n");
+}
 
-    // Extract status code (e.g. "HTTP/1.1 200 OK" -> 200)
-    int statusCode = 0;
-    int spaceIdx = statusLine.indexOf(' ');
-    if (spaceIdx > 0) {
-        statusCode = statusLine.substring(spaceIdx + 1).toInt();
+// Read and validate the response; statusOut is 0 when none arrived. The
+// document comes from allocator, an HTTP error is written to errorText
+// (STATUS_ERROR_SIZE bytes).
+static bool sttReadTranscript(WiFiClientSecure& client, ArduinoJson::Allocator* allocator, char* errorText,
+                              char* textOut, size_t textSize, const char*& errorOut, int& statusOut) {
+    HttpResponse head;
+    httpReadHead(client, head);
+    statusOut = head.status;
+    Serial.printf("[HTTP] Status: %d\n", head.status);
+    if (head.status != 200) {
+        logErrorBody("STT", head.status, client, head);
+        snprintf(errorText, STATUS_ERROR_SIZE, "STT HTTP %d", head.status);
+        errorOut = errorText;
+        client.stop();
+        return false;
     }
 
-    while (client.connected() || client.available()) {
-        String line = client.readStringUntil('\n');
-        String lower = line;
-        lower.toLowerCase();
-        if (lower.startsWith("transfer-encoding:") && lower.indexOf("chunked") >= 0) {
-            chunked = true;
-        }
-        line.trim();
-        if (line.length() == 0) break;
+    // Parse straight from the socket: only "text" is kept
+    JsonDocument filter(allocator);
+    filter["text"] = true;
+    JsonDocument doc(allocator);
+    HttpBody body(client, head);
+    DeserializationError err;
+    {
+        PERF_PROBE("stt_body");
+        err = deserializeJson(doc, body, DeserializationOption::Filter(filter));
     }
-    return statusCode;
-}
-
-// Read HTTP body, transparently handling chunked transfer encoding
-static String readBodyStr(WiFiClientSecure& client, bool chunked) {
-    if (!chunked) {
-        return client.readString();
+    client.stop();
+    if (err) {
+        Serial.printf("[STT] JSON: %s\n", err.c_str());
+        errorOut = "STT JSON err";
+        return false;
     }
 
-    String result;
-    while (client.connected() || client.available()) {
-        String sizeLine = client.readStringUntil('\n');
-        sizeLine.trim();
-        if (sizeLine.length() == 0) continue;
-        long sz = strtol(sizeLine.c_str(), nullptr, 16);
-        if (sz == 0) break;
-        while (sz > 0 && (client.connected() || client.available())) {
-            char buf[64];
-            int n = client.readBytes(buf, (size_t)min((long)64, sz));
-            result += String(buf, n);
-            sz -= n;
-        }
-        client.readStringUntil('\n');  // trailing \r\n after chunk data
+    copyText(doc["text"] | "", textOut, textSize);
+    Serial.printf("[STT] Transcript: %s\n", textOut);
+    if (textOut[0] == '\0') {
+        errorOut = "No transcript";
+        return false;
     }
-    return result;
+    return true;
 }
+#endif
 
-String mistralTranscribeFile(const char* wavPath, size_t wavSize, String& errorOut) {
+// The recording comes from audioData when set, otherwise from the file at audioPath
+static bool transcribe(const uint8_t* audioData, const char* audioPath, size_t audioSize,
+                       char* textOut, size_t textSize, const char*& errorOut) {
+    textOut[0] = '\0';
 #ifndef HAS_MISTRAL_CONFIG
+    (void)audioData; (void)audioPath; (void)audioSize; (void)textSize;
     errorOut = "No API key";
-    return "";
+    return false;
 #else
-    Serial.printf("[STT] Free heap: %u, largest block: %u\n",
-                  ESP.getFreeHeap(), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
-
     WiFiClientSecure client;
-    client.setInsecure();
-    client.setTimeout(30);
-
-    Serial.println("[STT] Connecting...");
-    if (!client.connect(MISTRAL_HOST, MISTRAL_PORT)) {
-        Serial.printf("[STT] Connect failed. Free heap: %u, largest block: %u\n",
-                      ESP.getFreeHeap(), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    if (!sttConnect(client)) {
         errorOut = "Connect failed";
-        return "";
+        return false;
     }
-    Serial.println("[STT] Connected.");
 
-    // Build multipart preamble (model + language + file field headers)
-    const char* langCode = (currentLang == LANG_PT) ? "pt" : "en";
+    char preamble[320];
+    int preambleLen = sttPreamble(preamble, sizeof(preamble));
+    char closing[32];
+    int closingLen = sttClosing(closing, sizeof(closing));
 
-    String preamble = "--";
-    preamble += BOUNDARY;
-    preamble += "\r\nContent-Disposition: form-data; name=\"model\"\r\n\r\nvoxtral-mini-latest\r\n";
-    preamble += "--";
-    preamble += BOUNDARY;
-    preamble += "\r\nContent-Disposition: form-data; name=\"language\"\r\n\r\n";
-    preamble += langCode;
-    preamble += "\r\n";
-    preamble += "--";
-    preamble += BOUNDARY;
-    preamble += "\r\nContent-Disposition: form-data; name=\"file\"; filename=\"audio.wav\"\r\nContent-Type: audio/wav\r\n\r\n";
-
-    String closing = "\r\n--";
-    closing += BOUNDARY;
-    closing += "--\r\n";
-
-    size_t contentLength = preamble.length() + wavSize + closing.length();
-
-    // Send HTTP request headers
-    client.print("POST /v1/audio/transcriptions HTTP/1.1\r\n");
-    client.print("Host: api.mistral.ai\r\n");
-    client.print("Authorization: Bearer ");
-    client.print(MISTRAL_API_KEY);
-    client.print("\r\n");
-    client.print("Content-Type: multipart/form-data; boundary=");
-    client.print(BOUNDARY);
-    client.print("\r\n");
-    client.print("Content-Length: ");
-    client.print((unsigned int)contentLength);
-    client.print("\r\n");
-    client.print("Connection: close\r\n\r\n");
+    sttRequestHead(client, preambleLen + audioSize + closingLen);
 
     // Send multipart body: preamble
-    client.print(preamble);
-
-    // Stream WAV from file in small chunks (no large heap buffer needed)
-    File f = LittleFS.open(wavPath, "r");
-    if (!f) {
-        errorOut = "File read err";
-        client.stop();
-        return "";
-    }
-    uint8_t chunk[512];
-    while (f.available()) {
-        int n = f.read(chunk, sizeof(chunk));
-        if (n > 0) client.write(chunk, n);
+    client.write((const uint8_t*)preamble, preambleLen);
+
+    if (audioData) {
+        // Straight from PSRAM: TLS takes it in records as large as it allows
+        client.write(audioData, audioSize);
+    } else {
+        // Stream the recording from file in small chunks (no large heap buffer needed)
+        File f = LittleFS.open(audioPath, "r");
+        if (!f) {
+            errorOut = "File read err";
+            client.stop();
+            return false;
+        }
+        // Only audioSize bytes: a trimmed recording leaves silence past its end
+        uint8_t chunk[512];
+        size_t remaining = audioSize;
+        while (remaining > 0 && f.available()) {
+            int n = f.read(chunk, remaining < sizeof(chunk) ? remaining : sizeof(chunk));
+            if (n <= 0) break;
+            client.write(chunk, n);
+            remaining -= n;
+        }
+        f.close();
     }
-    f.close();
 
-    client.print(closing);
+    client.write((const uint8_t*)closing, closingLen);
 
     Serial.println("[STT] Data sent, waiting for response...");
+    int status;
+    return sttReadTranscript(client, queryArenaJsonAllocator(), statusError, textOut, textSize, errorOut, status);
+#endif
+}
+
+bool mistralTranscribeFile(const char* audioPath, size_t audioSize, char* textOut, size_t textSize,
+                           const char*& errorOut) {
+    return transcribe(nullptr, audioPath, audioSize, textOut, textSize, errorOut);
+}
 
-    // Read and validate response
-    bool chunked = false;
-    int status = skipHeaders(client, chunked);
-    if (status != 200) {
-        String errBody = readBodyStr(client, chunked);
-        Serial.printf("[STT] Error %d: %s\n", status, errBody.c_str());
-        errorOut = "STT HTTP " + String(status);
+bool mistralTranscribeMemory(const uint8_t* audioData, size_t audioSize, char* textOut, size_t textSize,
+                             const char*& errorOut) {
+    return transcribe(audioData, nullptr, audioSize, textOut, textSize, errorOut);
+}
+
+// ---------------------------------------------------------------------------
+// Pipelined transcription: a task on the WiFi core opens the request while
+// the user speaks and sends the recording in chunks as the recorder makes it
+// final, so only the tail of the upload and the server's answer are left to
+// wait for when recording ends.
+
+#ifdef HAS_MISTRAL_CONFIG
+#define STREAM_STACK    12288  // TLS handshake and the response parse run on it
+#define STREAM_CORE     0      // with the WiFi stack; loop() and the recorder run on core 1
+#define STREAM_POLL_MS  20     // the recorder publishes every 500 ms
+#define STREAM_WAIT_MS  45000  // beyond the socket timeout, so the task gives up first
+
+// streamState is stored with release once the task is done with the rest
+enum StreamState { STREAM_IDLE, STREAM_RUNNING, STREAM_DONE };
+static std::atomic<StreamState> streamState(STREAM_IDLE);
+static std::atomic<bool> streamCancel(false);
+static const AudioStream* streamSource = nullptr;
+static uint8_t streamHeader[AUDIO_ENCODER_MAX_HEADER];  // the placeholder, before it is rewritten
+static char streamText[MISTRAL_TEXT_MAX];
+static const char* streamError = nullptr;  // nullptr with a transcript
+static bool streamRetry = false;           // failed before the request was complete
+static unsigned long streamSentAt = 0;
+static char streamStatusError[STATUS_ERROR_SIZE];
+
+// The task may still be reading a slow answer after mistralStreamFinish()
+// has given up on it and loop() has moved on to the next query, so it keeps
+// off the query arena and the statics the foreground uses. Its one document
+// goes to PSRAM, which every board that streams has.
+class StreamJsonAllocator : public ArduinoJson::Allocator {
+public:
+    void* allocate(size_t size) override { return heap_caps_malloc(size, MALLOC_CAP_SPIRAM); }
+    void deallocate(void* ptr) override { heap_caps_free(ptr); }
+    void* reallocate(void* ptr, size_t size) override { return heap_caps_realloc(ptr, size, MALLOC_CAP_SPIRAM); }
+};
+static StreamJsonAllocator streamAllocator;
+
+static bool sendChunk(WiFiClientSecure& client, const uint8_t* data, size_t len) {
+    char size[12];
+    int n = snprintf(size, sizeof(size), "%x\r\n", (unsigned)len);
+    return client.write((const uint8_t*)size, n) == (size_t)n && client.write(data, len) == len &&
+           client.write((const uint8_t*)"\r\n", 2) == 2;
+}
+
+static void streamUpload() {
+    WiFiClientSecure client;
+    streamRetry = true;
+    if (!sttConnect(client)) {
+        streamError = "Connect failed";
+        return;
+    }
+    sttRequestHead(client, 0);
+
+    char preamble[320];
+    int preambleLen = sttPreamble(preamble, sizeof(preamble));
+    size_t sent = audioEncoder().headerSize;
+    int chunks = 2;
+    bool ok = sendChunk(client, (const uint8_t*)preamble, preambleLen) &&
+              sendChunk(client, streamHeader, sent);
+
+    // Whatever the recorder has made final, one chunk per poll (half a second each)
+    while (ok) {
+        if (streamCancel.load(std::memory_order_relaxed)) {
+            streamError = "Cancelled";
+            streamRetry = false;
+            client.stop();
+            return;
+        }
+        bool complete = streamSource->complete.load(std::memory_order_acquire);  // before ready: it is set last
+        size_t ready = streamSource->ready.load(std::memory_order_acquire);
+        if (complete && ready == 0) {
+            streamError = "No speech";
+            streamRetry = false;
+            client.stop();
+            return;
+        }
+        if (ready > sent) {
+            ok = sendChunk(client, streamSource->data + sent, ready - sent);
+            sent = ready;
+            chunks++;
+        }
+        if (complete) break;
+        vTaskDelay(pdMS_TO_TICKS(STREAM_POLL_MS));
+    }
+
+    char closing[32];
+    int closingLen = sttClosing(closing, sizeof(closing));
+    ok = ok && sendChunk(client, (const uint8_t*)closing, closingLen) &&
+         client.write((const uint8_t*)"0\r\n\r\n", 5) == 5;
+    if (!ok) {
+        Serial.println("[STT] Upload failed");
+        streamError = "Upload failed";
         client.stop();
-        return "";
+        return;
     }
+    streamSentAt = millis();
+    Serial.printf("[STT] Streamed %u bytes in %d chunks, waiting for response...\n", (unsigned)sent, chunks);
+
+    // No answer or 411 Length Required: the endpoint does not take chunked
+    // bodies, and the recording can still go the usual way
+    int status;
+    streamRetry = false;
+    if (!sttReadTranscript(client, &streamAllocator, streamStatusError, streamText, sizeof(streamText),
+                           streamError, status)) {
+        streamRetry = status == 0 || status == 411;
+    }
+}
 
-    String body = readBodyStr(client, chunked);
-    client.stop();
+static void streamTask(void*) {
+    streamUpload();  // its client is closed and gone before the task is
+    streamState.store(STREAM_DONE, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+#endif
 
-    Serial.printf("[STT] Response: %s\n", body.c_str());
+bool mistralStreamSupported() {
+#ifdef HAS_MISTRAL_CONFIG
+    return MISTRAL_STREAM_UPLOAD;
+#else
+    return false;
+#endif
+}
 
-    JsonDocument filter;
-    filter["text"] = true;
-    JsonDocument doc;
-    DeserializationError err = deserializeJson(doc, body, DeserializationOption::Filter(filter));
-    if (err) {
-        errorOut = "STT JSON err";
-        return "";
+bool mistralStreamBegin(const AudioStream& source) {
+#ifndef HAS_MISTRAL_CONFIG
+    (void)source;
+    return false;
+#else
+    if (streamState == STREAM_RUNNING) {
+        Serial.println("[STT] Last upload still closing, uploading after recording");
+        return false;
     }
-
-    return doc["text"].as<String>();
+    memcpy(streamHeader, source.data, audioEncoder().headerSize);
+    streamSource = &source;
+    streamCancel.store(false, std::memory_order_relaxed);
+    streamText[0] = '\0';
+    streamError = nullptr;
+    streamRetry = false;
+    streamSentAt = 0;
+    streamState = STREAM_RUNNING;
+    if (xTaskCreatePinnedToCore(streamTask, "stt", STREAM_STACK, nullptr, 1, nullptr,
+                                STREAM_CORE) != pdPASS) {
+        Serial.println("[STT] No memory for the upload task, uploading after recording");
+        streamState = STREAM_IDLE;
+        return false;
+    }
+    return true;
 #endif
 }
 
-bool mistralClassify(const String& text, String& fodmapOut, bool& glutenOut, bool& notFoodOut, String& errorOut) {
+bool mistralStreamFinish(char* textOut, size_t textSize, const char*& errorOut, bool& retryOut) {
+    textOut[0] = '\0';
+    retryOut = false;
 #ifndef HAS_MISTRAL_CONFIG
+    (void)textSize;
     errorOut = "No API key";
     return false;
 #else
-    // Build JSON request body once (reused on retry)
-    JsonDocument reqDoc;
-    reqDoc["model"] = "mistral-small-latest";
-    reqDoc["max_tokens"] = 50;
-    JsonArray messages = reqDoc["messages"].to<JsonArray>();
-    JsonObject sysMsg = messages.add<JsonObject>();
-    sysMsg["role"] = "system";
-    sysMsg["content"] = SYSTEM_PROMPT;
-    JsonObject userMsg = messages.add<JsonObject>();
-    userMsg["role"] = "user";
-    userMsg["content"] = text;
+    unsigned long start = millis();
+    while (streamState.load(std::memory_order_acquire) == STREAM_RUNNING && millis() - start < STREAM_WAIT_MS) {
+        delay(10);
+    }
+    if (streamState.load(std::memory_order_acquire) != STREAM_DONE) {
+        // The task ends on its own, touching nothing loop() uses; its result is dropped
+        streamCancel.store(true, std::memory_order_relaxed);
+        errorOut = "STT timeout";
+        return false;
+    }
+    streamState = STREAM_IDLE;
+    // The upload ends with the recording, so this is about the server's time alone
+    if (streamSentAt != 0) {
+        Serial.printf("[STT] Answer %lu ms after recording ended (upload done at %ld ms)\n",
+                      millis() - start, (long)(streamSentAt - start));
+    }
+    if (streamError != nullptr) {
+        errorOut = streamError;
+        retryOut = streamRetry;
+        return false;
+    }
+    copyText(streamText, textOut, textSize);
+    return true;
+#endif
+}
 
-    String body;
-    serializeJson(reqDoc, body);
+void mistralStreamCancel() {
+#ifdef HAS_MISTRAL_CONFIG
+    if (streamState.load(std::memory_order_acquire) == STREAM_RUNNING) streamCancel.store(true, std::memory_order_relaxed);
+#endif
+}
 
+#ifdef HAS_MISTRAL_CONFIG
+// POST a classify request, retrying on rate limits
+static bool postClassify(const char* body, size_t bodyLen, FodmapLevel& fodmapOut, bool& glutenOut,
+                         bool& notFoodOut, const char*& errorOut) {
     for (int attempt = 0; attempt < 3; attempt++) {
         if (attempt > 0) {
             Serial.printf("[LLM] Retry %d after rate limit...\n", attempt);
@@ -254,7 +438,7 @@ bool mistralClassify(const String& text, String& fodmapOut, bool& glutenOut, boo
         }
 
         Serial.printf("[LLM] Free heap: %u, largest block: %u\n",
-                      ESP.getFreeHeap(), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+                      ESP.getFreeHeap(), (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
 
         WiFiClientSecure client;
         client.setInsecure();
@@ -263,7 +447,7 @@ bool mistralClassify(const String& text, String& fodmapOut, bool& glutenOut, boo
         Serial.println("[LLM] Connecting...");
         if (!client.connect(MISTRAL_HOST, MISTRAL_PORT)) {
             Serial.printf("[LLM] Connect failed. Free heap: %u, largest block: %u\n",
-                          ESP.getFreeHeap(), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+                          ESP.getFreeHeap(), (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
             errorOut = "Connect failed";
             return false;
         }
@@ -271,53 +455,93 @@ bool mistralClassify(const String& text, String& fodmapOut, bool& glutenOut, boo
 
         // Send HTTP request headers + body
         client.print("POST /v1/chat/completions HTTP/1.1\r\n");
-        client.print("Host: api.mistral.ai\r\n");
+        client.print("Host: " MISTRAL_HOST "\r\n");
         client.print("Authorization: Bearer ");
         client.print(MISTRAL_API_KEY);
         client.print("\r\n");
         client.print("Content-Type: application/json\r\n");
         client.print("Content-Length: ");
-        client.print(body.length());
+        client.print((unsigned int)bodyLen);
         client.print("\r\n");
         client.print("Connection: close\r\n\r\n");
-        client.print(body);
+        client.write((const uint8_t*)body, bodyLen);
 
         // Read and validate response
-        bool chunked = false;
-        int status = skipHeaders(client, chunked);
+        HttpResponse head;
+        httpReadHead(client, head);
+        Serial.printf("[HTTP] Status: %d\n", head.status);
 
-        if (status == 429) {
-            readBodyStr(client, chunked);  // drain body
+        if (head.status == 429) {
+            HttpBody(client, head).drain();
             client.stop();
             continue;  // retry
         }
 
-        if (status != 200) {
-            errorOut = "LLM HTTP " + String(status);
+        if (head.status != 200) {
+            logErrorBody("LLM", head.status, client, head);
+            snprintf(statusError, sizeof(statusError), "LLM HTTP %d", head.status);
+            errorOut = statusError;
             client.stop();
             return false;
         }
 
-        String respBody = readBodyStr(client, chunked);
-        client.stop();
-
-        JsonDocument filter;
+        JsonDocument filter(queryArenaJsonAllocator());
         filter["choices"][0]["message"]["content"] = true;
-        JsonDocument respDoc;
-        DeserializationError err = deserializeJson(respDoc, respBody, DeserializationOption::Filter(filter));
+        JsonDocument respDoc(queryArenaJsonAllocator());
+        HttpBody respBody(client, head);
+        DeserializationError err;
+        {
+            PERF_PROBE("classify_body");
+            err = deserializeJson(respDoc, respBody, DeserializationOption::Filter(filter));
+        }
+        client.stop();
         if (err) {
+            Serial.printf("[LLM] JSON: %s\n", err.c_str());
             errorOut = "LLM JSON err";
             return false;
         }
 
-        String content = respDoc["choices"][0]["message"]["content"].as<String>();
-        Serial.printf("[LLM] Response: %s\n", content.c_str());
+        const char* content = respDoc["choices"][0]["message"]["content"] | "";
+        Serial.printf("[LLM] Response: %s\n", content);
         notFoodOut = !parseClassifyResponse(content, fodmapOut, glutenOut);
         return true;
     }
 
     errorOut = "Rate limited";
     return false;
-#endif
 }
+#endif
 
+bool mistralClassify(const char* text, FodmapLevel& fodmapOut, bool& glutenOut, bool& notFoodOut,
+                     const char*& errorOut) {
+#ifndef HAS_MISTRAL_CONFIG
+    (void)text; (void)fodmapOut; (void)glutenOut; (void)notFoodOut;
+    errorOut = "No API key";
+    return false;
+#else
+    // Build JSON request body once (reused on retry)
+    JsonDocument reqDoc(queryArenaJsonAllocator());
+    reqDoc["model"] = "mistral-small-latest";
+    reqDoc["max_tokens"] = 50;
+    JsonArray messages = reqDoc["messages"].to<JsonArray>();
+    JsonObject sysMsg = messages.add<JsonObject>();
+    sysMsg["role"] = "system";
+    sysMsg["content"] = SYSTEM_PROMPT;
+    JsonObject userMsg = messages.add<JsonObject>();
+    userMsg["role"] = "user";
+    userMsg["content"] = text;
+
+    size_t bodyLen = measureJson(reqDoc);
+    char* body = (char*)queryArenaAlloc(bodyLen + 1);
+    if (body == nullptr) {
+        errorOut = "Out of memory";
+        return false;
+    }
+    serializeJson(reqDoc, body, bodyLen + 1);
+    reqDoc.clear();
+
+    bool ok = postClassify(body, bodyLen, fodmapOut, glutenOut, notFoodOut, errorOut);
+    queryArenaFree(body);
+    return ok;
+#endif
+}
@@ -0,0 +1,73 @@
+#ifdef PERF_PROBES
+
+#include "perf_probe.h"
+#include <Arduino.h>
+#include <native_hal.h>
+#include <chrono>
+#include <mutex>
+
+#define PERF_MAX_SLOTS  32
+
+struct PerfSlot {
+    const char* name;
+    uint64_t    calls;
+    uint64_t    totalNs;
+    uint64_t    allocs;
+    size_t      peak;  // most bytes allocated above the start of one call
+};
+
+static PerfSlot slots[PERF_MAX_SLOTS];
+static int slotCount = 0;
+static std::mutex slotLock;  // the database loads on its own task
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+PerfSlot& perfSlot(const char* name) {
+    std::lock_guard<std::mutex> guard(slotLock);
+    if (slotCount == 0) atexit(perfReport);
+    if (slotCount == PERF_MAX_SLOTS) {
+        Serial.printf("[PERF] Too many probes, %s shares the last slot\n", name);
+        return slots[PERF_MAX_SLOTS - 1];
+    }
+    slots[slotCount].name = name;
+    return slots[slotCount++];
+}
+
+PerfProbe::PerfProbe(PerfSlot& slot) : slot(slot) {
+    NativeHeapStats heap;
+    nativeHeapStats(heap);
+    startAllocs = heap.allocs;
+    startLive = heap.live;
+    outerPeak = heap.peak;
+    nativeHeapSetPeak(heap.live);
+    startNs = nowNs();
+}
+
+PerfProbe::~PerfProbe() {
+    uint64_t ns = nowNs() - startNs;
+    NativeHeapStats heap;
+    nativeHeapStats(heap);
+    nativeHeapSetPeak(max(outerPeak, heap.peak));
+
+    std::lock_guard<std::mutex> guard(slotLock);
+    slot.calls++;
+    slot.totalNs += ns;
+    slot.allocs += heap.allocs - startAllocs;
+    if (heap.peak > startLive && heap.peak - startLive > slot.peak) slot.peak = heap.peak - startLive;
+}
+
+void perfReport() {
+    std::lock_guard<std::mutex> guard(slotLock);
+    for (int i = 0; i < slotCount; i++) {
+        const PerfSlot& s = slots[i];
+        if (s.calls == 0) continue;
+        Serial.printf("[PERF] %s calls=%llu ns/op=%llu allocs/op=%.2f peak=%u\n", s.name,
+                      (unsigned long long)s.calls, (unsigned long long)(s.totalNs / s.calls),
+                      (double)s.allocs / s.calls, (unsigned)s.peak);
+    }
+}
+
+#endif
@@ -0,0 +1,119 @@
+#include "query_arena.h"
+#include <Arduino.h>
+
+// Each block starts with a header: its size (ARENA_FREED set once freed) and
+// the offset of the block below it, so the top can be unwound block by block
+#define ARENA_ALIGN  8
+#define ARENA_NONE   0xFFFFFFFFu
+#define ARENA_FREED  0x80000000u
+
+struct BlockHeader {
+    uint32_t size;
+    uint32_t below;  // header offset of the previous block, ARENA_NONE for the first
+};
+
+static uint8_t arena[QUERY_ARENA_SIZE] __attribute__((aligned(ARENA_ALIGN)));
+static uint32_t top = 0;             // first free byte
+static uint32_t last = ARENA_NONE;   // header offset of the topmost block
+static uint32_t peak = 0;
+static uint32_t live = 0;            // blocks allocated and not freed (arena and heap)
+static uint32_t fallbacks = 0;       // requests served by malloc this query
+
+static bool inArena(const void* ptr) {
+    return (const uint8_t*)ptr >= arena && (const uint8_t*)ptr < arena + sizeof(arena);
+}
+
+static BlockHeader* headerOf(const void* ptr) {
+    return (BlockHeader*)((uint8_t*)ptr - sizeof(BlockHeader));
+}
+
+static uint32_t roundUp(size_t size) {
+    return (size + ARENA_ALIGN - 1) & ~(uint32_t)(ARENA_ALIGN - 1);
+}
+
+void* queryArenaAlloc(size_t size) {
+    uint32_t need = sizeof(BlockHeader) + roundUp(size);
+    if (size >= ARENA_FREED || need > sizeof(arena) - top) {
+        void* ptr = malloc(size);
+        if (ptr) {
+            fallbacks++;
+            live++;
+        }
+        return ptr;
+    }
+
+    BlockHeader* h = (BlockHeader*)(arena + top);
+    h->size = size;
+    h->below = last;
+    last = top;
+    top += need;
+    if (top > peak) peak = top;
+    live++;
+    return h + 1;
+}
+
+void queryArenaFree(void* ptr) {
+    if (ptr == nullptr) return;
+    live--;
+    if (!inArena(ptr)) {
+        free(ptr);
+        return;
+    }
+
+    // Mark, then unwind the top while it is free
+    headerOf(ptr)->size |= ARENA_FREED;
+    while (last != ARENA_NONE) {
+        BlockHeader* h = (BlockHeader*)(arena + last);
+        if ((h->size & ARENA_FREED) == 0) break;
+        top = last;
+        last = h->below;
+    }
+}
+
+void* queryArenaRealloc(void* ptr, size_t size) {
+    if (ptr == nullptr) return queryArenaAlloc(size);
+    if (!inArena(ptr)) return realloc(ptr, size);
+
+    // The topmost block grows or shrinks in place (ArduinoJson shrinks its pools after parsing)
+    BlockHeader* h = headerOf(ptr);
+    uint32_t offset = (uint8_t*)h - arena;
+    if (offset == last && size < ARENA_FREED &&
+        sizeof(BlockHeader) + roundUp(size) <= sizeof(arena) - offset) {
+        h->size = size;
+        top = offset + sizeof(BlockHeader) + roundUp(size);
+        if (top > peak) peak = top;
+        return ptr;
+    }
+
+    void* moved = queryArenaAlloc(size);
+    if (moved == nullptr) return nullptr;
+    memcpy(moved, ptr, min((size_t)h->size, size));
+    queryArenaFree(ptr);
+    return moved;
+}
+
+bool queryArenaReset() {
+    if (live > 0) {
+        Serial.printf("[ARENA] Reset refused: %u blocks in use\n", (unsigned)live);
+        return false;
+    }
+    Serial.printf("[ARENA] Query peak %u of %u bytes, %u heap fallbacks\n",
+                  (unsigned)peak, (unsigned)sizeof(arena), (unsigned)fallbacks);
+    top = 0;
+    last = ARENA_NONE;
+    peak = 0;
+    fallbacks = 0;
+    return true;
+}
+
+class QueryArenaAllocator : public ArduinoJson::Allocator {
+public:
+    void* allocate(size_t size) override { return queryArenaAlloc(size); }
+    void deallocate(void* ptr) override { queryArenaFree(ptr); }
+    void* reallocate(void* ptr, size_t size) override { return queryArenaRealloc(ptr, size); }
+};
+
+ArduinoJson::Allocator* queryArenaJsonAllocator() {
+    static QueryArenaAllocator allocator;
+    return &allocator;
+}
@@ -0,0 +1,34 @@
+#include "resume_state.h"
+#include <Arduino.h>
+#include <esp_sleep.h>
+#include <esp_rom_crc.h>
+
+#define RESUME_MAGIC  0x53425253u  // "SRBS"
+
+struct ResumeSnapshot {
+    uint32_t    magic;
+    ResumeState state;
+    uint32_t    crc;  // CRC-32 of magic and state
+};
+
+static RTC_DATA_ATTR ResumeSnapshot snapshot;
+
+static uint32_t snapshotCrc() {
+    return esp_rom_crc32_le(0, (const uint8_t*)&snapshot, offsetof(ResumeSnapshot, crc));
+}
+
+void resumeSave(const ResumeState& state) {
+    memset(&snapshot, 0, sizeof(snapshot));  // padding included, it is under the CRC
+    snapshot.magic = RESUME_MAGIC;
+    snapshot.state = state;
+    snapshot.crc = snapshotCrc();
+}
+
+bool resumeTake(ResumeState& out) {
+    bool valid = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_EXT0 &&
+                 snapshot.magic == RESUME_MAGIC && snapshot.crc == snapshotCrc();
+    if (valid) out = snapshot.state;
+    snapshot.magic = 0;
+    Serial.printf("[RESUME] %s\n", valid ? "Warm wake from deep sleep" : "Cold boot");
+    return valid;
+}
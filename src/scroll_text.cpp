@@ -0,0 +1,38 @@
+#include "scroll_text.h"
+#include "perf_probe.h"
+#include <M5Unified.h>
+
+const char* getScrolledText(const char* text, int pos) {
+    PERF_PROBE("scroll_text");
+    if (M5.Display.textWidth(text) <= SCROLL_AREA_WIDTH) {
+        return text;
+    }
+
+    // text + "   " + text from pos (padding for smooth loop)
+    static char visible[2 * SCROLL_TEXT_MAX + 3];
+    // Longer names never come from the database; cut them rather than overrun
+    size_t len = min(strlen(text), (size_t)SCROLL_TEXT_MAX - 1);
+    size_t from = min((size_t)pos, len + 3);
+    size_t n = 0;
+    if (from < len) {
+        memcpy(visible, text + from, len - from);
+        n = len - from;
+    }
+    for (size_t i = max(from, len); i < len + 3; i++) visible[n++] = ' ';
+    size_t tail = min(len, sizeof(visible) - 1 - n);
+    memcpy(visible + n, text, tail);
+    visible[n + tail] = '\0';
+
+    visible[M5.Display.textLength(visible, SCROLL_AREA_WIDTH)] = '\0';
+    return visible;
+}
+
+const char* fitText(const char* text, char* buf, size_t bufSize) {
+    if (M5.Display.textWidth(text) <= SCROLL_AREA_WIDTH) {
+        return text;
+    }
+    int ellipsisW = M5.Display.textWidth("..");
+    int len = M5.Display.textLength(text, SCROLL_AREA_WIDTH - ellipsisW);
+    snprintf(buf, bufSize, "%.*s..", len, text);
+    return buf;
+}
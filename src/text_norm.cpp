@@ -0,0 +1,161 @@
+#include "text_norm.h"
+#include <string.h>
+
+// Latin-1 letters U+00C0..U+00FF folded to ASCII (space = not a letter)
+static const char FOLD_LATIN1[] =
+    "aaaaaaaceeeeiiiidnooooo ouuuuy s"
+    "aaaaaaaceeeeiiiidnooooo ouuuuy y";
+
+// (suffix, replacement) tried in order on the folded word; the first that
+// leaves at least MIN_STEM characters wins
+struct PluralRule {
+    const char* suffix;
+    const char* repl;
+};
+
+static const PluralRule PLURAL_RULES[] = {
+    { "ies",  "y"  },  // berries -> berry
+    { "oes",  "o"  },  // potatoes -> potato
+    { "ches", "ch" },  // peaches -> peach
+    { "shes", "sh" },
+    { "sses", "ss" },
+    { "xes",  "x"  },
+    { "zes",  "z"  },  // nozes -> noz
+    { "ais",  "al" },  // cereais -> cereal
+    { "eis",  "el" },  // pastéis -> pastel
+    { "ss",   "ss" },  // keep: glass
+    { "us",   "us" },  // keep: hummus, asparagus
+    { "s",    ""   },  // maçãs -> maca, eggs -> egg
+};
+static const size_t MIN_STEM = 3;
+
+// Decode one UTF-8 sequence; malformed bytes decode as U+FFFD
+static uint32_t nextCodepoint(const uint8_t*& p) {
+    uint8_t c = *p++;
+    if (c < 0x80) return c;
+    int extra = (c >= 0xF0) ? 3 : (c >= 0xE0) ? 2 : (c >= 0xC0) ? 1 : -1;
+    if (extra < 0) return 0xFFFD;
+    uint32_t cp = c & (0x3F >> extra);
+    for (int i = 0; i < extra; i++) {
+        if ((*p & 0xC0) != 0x80) return 0xFFFD;
+        cp = (cp << 6) | (*p++ & 0x3F);
+    }
+    return cp;
+}
+
+static char foldCodepoint(uint32_t cp) {
+    if (cp < 0x80) {
+        if ((cp >= 'a' && cp <= 'z') || (cp >= '0' && cp <= '9')) return (char)cp;
+        if (cp >= 'A' && cp <= 'Z') return (char)(cp - 'A' + 'a');
+        return ' ';
+    }
+    if (cp >= 0xC0 && cp <= 0xFF) return FOLD_LATIN1[cp - 0xC0];
+    return ' ';
+}
+
+static uint32_t lowerLatin1(uint32_t cp) {
+    return (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) ? cp + 0x20 : cp;
+}
+
+// PT nasal plurals (limões, pães, irmãos) are recognised before accents are folded
+static bool isNasalPlural(const uint32_t tail[3]) {
+    return (tail[0] == 0xF5 && tail[1] == 'e' && tail[2] == 's') ||   // ões
+           (tail[0] == 0xE3 && tail[1] == 'e' && tail[2] == 's') ||   // ães
+           (tail[0] == 0xE3 && tail[1] == 'o' && tail[2] == 's');     // ãos
+}
+
+static size_t stripPlural(char* word, size_t len, bool nasal) {
+    if (nasal) {
+        memcpy(word + len - 3, "ao", 2);
+        return len - 1;
+    }
+    for (const PluralRule& rule : PLURAL_RULES) {
+        size_t sl = strlen(rule.suffix);
+        if (len < sl || memcmp(word + len - sl, rule.suffix, sl) != 0) continue;
+        size_t rl = strlen(rule.repl);
+        if (len - sl + rl >= MIN_STEM) {
+            memcpy(word + len - sl, rule.repl, rl);
+            return len - sl + rl;
+        }
+        if (rl == 0) break;
+    }
+    return len;
+}
+
+size_t textNormalize(const char* in, char* out, size_t outSize) {
+    if (outSize == 0) return 0;
+    size_t outLen = 0;
+    char word[TEXT_NORM_MAX];
+    size_t wordLen = 0;
+    uint32_t tail[3] = { 0, 0, 0 };  // last raw codepoints of the word, lowercased
+    const uint8_t* p = (const uint8_t*)in;
+
+    for (;;) {
+        uint32_t cp = *p ? nextCodepoint(p) : 0;
+        char f = cp ? foldCodepoint(cp) : ' ';
+        if (f != ' ') {
+            if (wordLen < sizeof(word)) word[wordLen++] = f;
+            tail[0] = tail[1];
+            tail[1] = tail[2];
+            tail[2] = lowerLatin1(cp);
+        } else if (wordLen > 0) {
+            wordLen = stripPlural(word, wordLen, wordLen >= 3 && isNasalPlural(tail));
+            size_t need = wordLen + (outLen > 0 ? 1 : 0);
+            if (outLen + need >= outSize) break;
+            if (outLen > 0) out[outLen++] = ' ';
+            memcpy(out + outLen, word, wordLen);
+            outLen += wordLen;
+            wordLen = 0;
+        }
+        if (cp == 0) break;
+    }
+    out[outLen] = '\0';
+    return outLen;
+}
+
+size_t textCollate(const char* in, char* out, size_t outSize) {
+    if (outSize == 0) return 0;
+    size_t outLen = 0;
+    bool space = false;
+    const uint8_t* p = (const uint8_t*)in;
+    while (*p) {
+        char f = foldCodepoint(nextCodepoint(p));
+        if (f == ' ') {
+            space = outLen > 0;
+            continue;
+        }
+        if (outLen + (space ? 2 : 1) >= outSize) break;
+        if (space) out[outLen++] = ' ';
+        out[outLen++] = f;
+        space = false;
+    }
+    out[outLen] = '\0';
+    return outLen;
+}
+
+static uint16_t trigramSymbol(char c) {
+    if (c >= 'a' && c <= 'z') return 1 + (c - 'a');
+    if (c >= '0' && c <= '9') return 27 + (c - '0');
+    return 0;
+}
+
+size_t textTrigrams(const char* norm, uint16_t* out, size_t maxOut) {
+    size_t len = strlen(norm);
+    size_t count = 0;
+    // Padded string " norm ": position i is ' ' at both ends
+    for (size_t i = 0; i + 3 <= len + 2 && count < maxOut; i++) {
+        uint16_t code = 0;
+        for (size_t k = i; k < i + 3; k++) {
+            char c = (k == 0 || k == len + 1) ? ' ' : norm[k - 1];
+            code = code * TEXT_TRIGRAM_ALPHABET + trigramSymbol(c);
+        }
+        // Insert sorted, skipping duplicates
+        size_t pos = 0;
+        while (pos < count && out[pos] < code) pos++;
+        if (pos < count && out[pos] == code) continue;
+        memmove(out + pos + 1, out + pos, (count - pos) * sizeof(uint16_t));
+        out[pos] = code;
+        count++;
+    }
+    return count;
+}
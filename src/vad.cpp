@@ -0,0 +1,132 @@
+#include "vad.h"
+
+// Mean-square energies (DC removed) against the floor
+#define SPEECH_RATIO      6      // voiced speech: about 8 dB over the floor
+#define UNVOICED_RATIO    2      // fricatives: 3 dB over it ...
+#define UNVOICED_ZC       (VAD_FRAME_SAMPLES / 4)  // ... with a crossing every 4 samples (> 2 kHz)
+#define FLOOR_MIN         400    // RMS 20: a silent mic must not make every tick speech
+#define FLOOR_RISE_SHIFT  4      // silent frames pull the floor 1/16 of the way up
+// The floor starts from the quietest of the first frames. They are classified
+// only then, so the recorder's pre-roll must still hold them: as many
+#define SEED_FRAMES       (VAD_PREROLL_MS / VAD_FRAME_MS)  // 10
+
+static const size_t TRAILING_SAMPLES = VAD_SAMPLE_RATE * VAD_TRAILING_MS / 1000;
+
+static size_t position = 0;      // samples fed since vadReset()
+static uint32_t noiseFloor = 0;  // 0 until the first SEED_FRAMES have been seen
+static uint32_t seedEnergy[SEED_FRAMES];
+static int seedCrossings[SEED_FRAMES];
+static int seedCount = 0;
+static int speechRun = 0;        // speech frames in a row
+static size_t runStart = 0;
+static bool heard = false;
+static size_t speechStart = 0;
+static size_t speechEnd = 0;
+
+static void analyzeFrame(const int16_t* s, uint32_t& energy, int& crossings) {
+    int32_t sum = 0;
+    for (int i = 0; i < VAD_FRAME_SAMPLES; i++) sum += s[i];
+    int32_t mean = sum / VAD_FRAME_SAMPLES;
+
+    uint64_t squares = 0;
+    bool wasNegative = s[0] < mean;
+    crossings = 0;
+    for (int i = 0; i < VAD_FRAME_SAMPLES; i++) {
+        int32_t v = s[i] - mean;
+        squares += (int64_t)v * v;
+        bool negative = v < 0;
+        if (negative != wasNegative) crossings++;
+        wasNegative = negative;
+    }
+    energy = (uint32_t)(squares / VAD_FRAME_SAMPLES);
+}
+
+void vadReset() {
+    position = 0;
+    noiseFloor = 0;
+    seedCount = 0;
+    speechRun = 0;
+    runStart = 0;
+    heard = false;
+    speechStart = 0;
+    speechEnd = 0;
+}
+
+static void classifyFrame(size_t frameStart, uint32_t energy, int crossings) {
+    bool speech = (uint64_t)energy > (uint64_t)noiseFloor * SPEECH_RATIO ||
+                  ((uint64_t)energy > (uint64_t)noiseFloor * UNVOICED_RATIO &&
+                   crossings > UNVOICED_ZC);
+    if (speech) {
+        if (speechRun++ == 0) runStart = frameStart;
+        if (speechRun >= VAD_ONSET_FRAMES) {
+            if (!heard) {
+                heard = true;
+                speechStart = runStart;
+            }
+            speechEnd = frameStart + VAD_FRAME_SAMPLES;
+        }
+    } else {
+        speechRun = 0;
+        if (energy < noiseFloor) {
+            noiseFloor = energy < FLOOR_MIN ? FLOOR_MIN : energy;
+        } else {
+            noiseFloor += ((energy - noiseFloor) >> FLOOR_RISE_SHIFT) + 1;
+        }
+    }
+}
+
+void vadFeed(const int16_t* samples, size_t count) {
+    size_t frames = count / VAD_FRAME_SAMPLES;
+    for (size_t f = 0; f < frames; f++) {
+        size_t frameStart = position + f * VAD_FRAME_SAMPLES;
+        uint32_t energy;
+        int crossings;
+        analyzeFrame(samples + f * VAD_FRAME_SAMPLES, energy, crossings);
+        if (noiseFloor != 0) {
+            classifyFrame(frameStart, energy, crossings);
+            continue;
+        }
+
+        // The first frames wait for the floor: it starts from the quietest of
+        // them, so speech right at the start of the recording is still
+        // measured against the room, and then they are classified in order
+        seedEnergy[seedCount] = energy;
+        seedCrossings[seedCount] = crossings;
+        if (++seedCount < SEED_FRAMES) continue;
+        noiseFloor = UINT32_MAX;
+        for (int i = 0; i < SEED_FRAMES; i++) {
+            if (seedEnergy[i] < noiseFloor) noiseFloor = seedEnergy[i];
+        }
+        if (noiseFloor < FLOOR_MIN) noiseFloor = FLOOR_MIN;
+        size_t seedStart = frameStart - (SEED_FRAMES - 1) * VAD_FRAME_SAMPLES;
+        for (int i = 0; i < SEED_FRAMES; i++) {
+            classifyFrame(seedStart + i * VAD_FRAME_SAMPLES, seedEnergy[i], seedCrossings[i]);
+        }
+    }
+    position += count;
+}
+
+bool vadHeardSpeech() {
+    return heard;
+}
+
+size_t vadSpeechStart() {
+    return speechStart;
+}
+
+size_t vadSpeechEnd() {
+    return speechEnd;
+}
+
+bool vadEndpoint() {
+    return heard && position - speechEnd >= TRAILING_SAMPLES;
+}
+
+uint8_t vadPeakLevel(const int16_t* samples, size_t count) {
+    int16_t peak = 0;
+    for (size_t i = 0; i < count; i++) {
+        int16_t val = samples[i] < 0 ? -samples[i] : samples[i];
+        if (val > peak) peak = val;
+    }
+    return (uint8_t)((peak * 255L) / 32767);
+}
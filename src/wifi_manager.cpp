@@ -20,6 +20,9 @@ static unsigned long lastReconnectAttempt = 0;
 static unsigned long lastBlinkTime = 0;
 static bool indicatorVisible = true;
 static WifiState lastDrawnState = WIFI_STATE_IDLE;
+static uint8_t apBssid[6];     // last access point joined (or hinted), apChannel 0 = none
+static uint8_t apChannel = 0;
+static bool apHinted = false;  // next connect goes straight to apBssid
 
 // Forward declaration for event handler
 static void onWifiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
@@ -28,7 +31,11 @@ static void onWifiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
 static void startConnection() {
     currentWifiState = WIFI_STATE_CONNECTING;
     connectionStartTime = millis();
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    if (apHinted) {
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, apChannel, apBssid);
+    } else {
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    }
 }
 #endif
 
@@ -56,9 +63,12 @@ static void onWifiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
     switch (event) {
         case ARDUINO_EVENT_WIFI_STA_GOT_IP:
             currentWifiState = WIFI_STATE_CONNECTED;
+            memcpy(apBssid, WiFi.BSSID(), sizeof(apBssid));
+            apChannel = WiFi.channel();
             break;
 
         case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            apHinted = false;  // the hint is for the first connect only
             if (currentWifiState != WIFI_STATE_OFF) {
                 currentWifiState = WIFI_STATE_DISCONNECTED;
                 lastReconnectAttempt = millis();
@@ -82,6 +92,7 @@ void wifiUpdate() {
         case WIFI_STATE_CONNECTING:
             // Check for connection timeout
             if (now - connectionStartTime > WIFI_CONNECTION_TIMEOUT) {
+                apHinted = false;  // the access point moved or is gone: scan next time
                 currentWifiState = WIFI_STATE_DISCONNECTED;
                 lastReconnectAttempt = now;
                 WiFi.disconnect();
@@ -141,6 +152,20 @@ void wifiReconnect() {
 #endif
 }
 
+bool wifiLastAp(uint8_t bssid[6], uint8_t& channel) {
+    if (apChannel == 0) return false;
+    memcpy(bssid, apBssid, sizeof(apBssid));
+    channel = apChannel;
+    return true;
+}
+
+void wifiHintAp(const uint8_t bssid[6], uint8_t channel) {
+    if (channel == 0) return;
+    memcpy(apBssid, bssid, sizeof(apBssid));
+    apChannel = channel;
+    apHinted = true;
+}
+
 WifiState getWifiState() {
     return currentWifiState;
 }